@@ -0,0 +1,89 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   hdrhist.c
+ * @brief  Fixed memory log-linear histogram
+ */
+
+#include <string.h>
+#include "hdrhist.h"
+
+#define SUB       (1U<<HDR_SUB_BITS)
+#define HALF      (1U<<(HDR_SUB_BITS-1))
+#define MAX_VALUE ((1ULL<<HDR_MAX_BITS)-1)
+
+static unsigned hdr_index(uint64_t v){
+    unsigned shift;
+
+    if(v < SUB){
+        return v;
+    }
+    /* v has msb at bit >= HDR_SUB_BITS, keep HDR_SUB_BITS significant bits*/
+    shift = 63 - __builtin_clzll(v) - HDR_SUB_BITS + 1;
+    return SUB + (shift-1)*HALF + ((v >> shift) - HALF);
+}
+
+static uint64_t hdr_upperBound(unsigned i){
+    unsigned shift;
+    uint64_t sub;
+
+    if(i < SUB){
+        return i;
+    }
+    shift = (i - SUB)/HALF + 1;
+    sub = (i - SUB)%HALF + HALF;
+    return ((sub + 1) << shift) - 1;
+}
+
+void hdr_record(HdrHist *h, uint64_t v){
+    if(v > MAX_VALUE){
+        v = MAX_VALUE;
+    }
+    h->count[hdr_index(v)]++;
+    h->total++;
+    if(v > h->max){
+        h->max = v;
+    }
+}
+
+uint64_t hdr_percentile(const HdrHist *h, double p){
+    uint64_t target, acc = 0;
+    unsigned i;
+
+    if(h->total == 0){
+        return 0;
+    }
+    target = (uint64_t)(p/100.0*h->total + 0.5);
+    if(target == 0){
+        target = 1;
+    }
+    for(i=0; i<HDR_BUCKETS; i++){
+        acc += h->count[i];
+        if(acc >= target){
+            break;
+        }
+    }
+    if(i >= HDR_BUCKETS){
+        return h->max;
+    }
+    return hdr_upperBound(i) < h->max ? hdr_upperBound(i) : h->max;
+}
+
+void hdr_reset(HdrHist *h){
+    memset(h, 0, sizeof(HdrHist));
+}
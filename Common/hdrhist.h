@@ -0,0 +1,64 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   hdrhist.h
+ * @brief  Fixed memory log-linear histogram
+ *
+ * Values below 2^HDR_SUB_BITS are counted exactly. Above, each power of two
+ * is split in 2^(HDR_SUB_BITS-1) linear buckets, so the relative error of a
+ * percentile is below 2^-(HDR_SUB_BITS-1), 1.6% with the default. Recording
+ * a value is a few arithmetic operations and never allocates.
+ */
+
+#ifndef _HDRHIST_H
+#define _HDRHIST_H
+
+#include <stdint.h>
+
+#define HDR_SUB_BITS  7
+#define HDR_MAX_BITS  32    /**< Larger values are clamped to 2^HDR_MAX_BITS-1*/
+#define HDR_BUCKETS   ((1<<HDR_SUB_BITS) +                              \
+                       (HDR_MAX_BITS-HDR_SUB_BITS)*(1<<(HDR_SUB_BITS-1)))
+
+typedef struct{
+    uint64_t count[HDR_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+}HdrHist;
+
+/**
+ * @brief Record a value
+ * @param [in] h  Histogram
+ * @param [in] v  Value
+ */
+extern void hdr_record(HdrHist *h, uint64_t v);
+
+/**
+ * @brief Value at a percentile
+ * @param [in] h  Histogram
+ * @param [in] p  Percentile, 0 to 100
+ * @return Upper bound of the bucket holding the percentile, 0 if empty
+ */
+extern uint64_t hdr_percentile(const HdrHist *h, double p);
+
+/**
+ * @brief Clear the histogram
+ */
+extern void hdr_reset(HdrHist *h);
+
+#endif /* !_HDRHIST_H */
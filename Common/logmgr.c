@@ -28,38 +28,221 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <syslog.h>
 #include <string.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
 #include <libgen.h>
 
 #include "logmgr.h"
 
-/** Structure to store the logger variables.
- *  Currently it is storing only the priority.
- */
-struct log_entity{
-  int priority;
+/** Number of messages in the ring, power of 2*/
+#define LOG_RING_SIZE  4096
+/** Maximum number of lines written at once*/
+#define LOG_BATCH      64
+/** Maximum length of an output line*/
+#define LOG_LINESIZE   (SYSERR_MSGSIZE + 256)
+/** Writer sleep when the ring is empty, in us*/
+#define LOG_IDLE_US    2000
+
+/** Message stored in the ring*/
+typedef struct{
+  unsigned long  seq;       /**< Slot sequence, see log_ring_push*/
+  struct timeval tv;
+  int            pri;
+  const char     *fn;
+  const char     *func;
+  int            ln;
+  char           msg[SYSERR_MSGSIZE];
+}log_record;
+
+/** Cached date string, recalculated once per second*/
+typedef struct{
+  time_t sec;
+  char   str[64];
+}log_clock;
+
+/** Asynchronous sink, a bounded lock-free queue drained by the writer thread.
+ *  Producers never wait: the message is dropped when the ring is full. */
+struct log_sink{
+  log_record    *ring;
+  unsigned long enqPos;
+  unsigned long deqPos;
+  unsigned long dropped;
+  int           running;
+  pthread_t     writer;
 };
 
-/** msgentity instance*/
-static struct log_entity logger;
+static struct log_sink sink;
+
+/** Current priority, checked by the log macros*/
+int log_priority;
 
 /** Log Level dictionary to convert the priority to a string*/
 static char* logLevelStr[] = {"EMER", "ALER", "CRIT", "ERRO", "WARN", "NOTI", "INFO", "DEBG"};
 
+
+static int log_format(char *out, size_t size, const log_record *r, log_clock *clk){
+  int len;
+#ifdef DEBUG
+  struct tm tm;
+  char usec[8] = "";
+  if(r->tv.tv_sec != clk->sec){
+    localtime_r(&r->tv.tv_sec, &tm);
+    strftime(clk->str, sizeof(clk->str), "%d/%m/%Y %T", &tm);
+    clk->sec = r->tv.tv_sec;
+  }
+  if(log_priority >= LOG_DEBUG){
+    snprintf(usec, sizeof(usec), ".%06u", (unsigned int)r->tv.tv_usec);
+  }
+  len = snprintf(out, size, "[%s%s] %s - %s <%s(), %s:%d>\n",
+                 clk->str, usec, logLevelStr[r->pri], r->msg,
+                 r->func, basename((char *)r->fn), r->ln);
+#else
+  len = snprintf(out, size, "%s - %s\n", logLevelStr[r->pri], r->msg);
+#endif
+  if(len >= (int)size){
+    len = size - 1;
+    out[len-1] = '\n';
+  }
+  return len;
+}
+
+
+static void log_writev(struct iovec *iov, int n){
+  ssize_t w;
+  while(n > 0){
+    w = writev(STDOUT_FILENO, iov, n);
+    if(w < 0){
+      if(errno == EINTR)
+        continue;
+      return;
+    }
+    while(n > 0 && (size_t)w >= iov->iov_len){
+      w -= iov->iov_len;
+      iov++;
+      n--;
+    }
+    if(n > 0){
+      iov->iov_base = (char *)iov->iov_base + w;
+      iov->iov_len -= w;
+    }
+  }
+}
+
+
+/** Reserve a slot, returns NULL when the ring is full*/
+static log_record *log_ring_reserve(unsigned long *pos){
+  log_record *r;
+  unsigned long seq, p = __atomic_load_n(&sink.enqPos, __ATOMIC_RELAXED);
+  long dif;
+
+  for(;;){
+    r = &sink.ring[p & (LOG_RING_SIZE-1)];
+    seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    dif = (long)seq - (long)p;
+    if(dif == 0){
+      if(__atomic_compare_exchange_n(&sink.enqPos, &p, p+1, 1,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        *pos = p;
+        return r;
+      }
+    }else if(dif < 0){
+      return NULL;
+    }else{
+      p = __atomic_load_n(&sink.enqPos, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+
+static void log_ring_commit(log_record *r, unsigned long pos){
+  __atomic_store_n(&r->seq, pos+1, __ATOMIC_RELEASE);
+}
+
+
+/** Writer thread, the only consumer of the ring*/
+static void *log_writer(void *arg){
+  char lines[LOG_BATCH][LOG_LINESIZE];
+  struct iovec iov[LOG_BATCH+1];
+  char dropStr[64];
+  log_clock clk = {0};
+  log_record *r;
+  unsigned long dropped, reported = 0;
+  struct timespec idle = {0, LOG_IDLE_US*1000};
+  int n, running;
+
+  for(;;){
+    running = __atomic_load_n(&sink.running, __ATOMIC_ACQUIRE);
+    n = 0;
+    while(n < LOG_BATCH){
+      r = &sink.ring[sink.deqPos & (LOG_RING_SIZE-1)];
+      if(__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != sink.deqPos+1){
+        break;
+      }
+      iov[n].iov_base = lines[n];
+      iov[n].iov_len = log_format(lines[n], LOG_LINESIZE, r, &clk);
+      n++;
+      __atomic_store_n(&r->seq, sink.deqPos+LOG_RING_SIZE, __ATOMIC_RELEASE);
+      sink.deqPos++;
+    }
+    dropped = __atomic_load_n(&sink.dropped, __ATOMIC_RELAXED);
+    if(dropped != reported){
+      iov[n].iov_base = dropStr;
+      iov[n].iov_len = snprintf(dropStr, sizeof(dropStr),
+                                "%s - Log ring full, %lu messages dropped\n",
+                                logLevelStr[LOG_WARNING], dropped - reported);
+      n++;
+      reported = dropped;
+    }
+    if(n > 0){
+      log_writev(iov, n);
+      continue;
+    }
+    if(!running){
+      break;
+    }
+    nanosleep(&idle, NULL);
+  }
+  return NULL;
+}
+
+
 void init_logger(const char * app, int priority){
+  unsigned long i;
   /*openlog(app, (LOG_PID | LOG_PERROR), LOG_USER);*/
-  logger.priority = priority;
+  log_priority = priority;
   setlogmask (LOG_UPTO (priority));
+
+  sink.ring = calloc(LOG_RING_SIZE, sizeof(log_record));
+  for(i=0; sink.ring && i<LOG_RING_SIZE; i++){
+    sink.ring[i].seq = i;
+  }
+  sink.enqPos = sink.deqPos = sink.dropped = 0;
+  sink.running = 1;
+  if(!sink.ring || pthread_create(&sink.writer, NULL, log_writer, NULL) != 0){
+    sink.running = 0;
+    log_msg(LOG_WARNING, 0, "Log writer not started, logging synchronously");
+  }
   log_msg(LOG_INFO, 0, "Log initialized with level %s", logLevelStr[priority]);
 }
 
 void close_logger(){
   log_msg(LOG_INFO, 0, "Closing Log");
+  if(__atomic_load_n(&sink.running, __ATOMIC_ACQUIRE)){
+    /* The writer drains the ring before exiting*/
+    __atomic_store_n(&sink.running, 0, __ATOMIC_RELEASE);
+    pthread_join(sink.writer, NULL);
+  }
+  free(sink.ring);
+  sink.ring = NULL;
   /*closelog();*/
 }
 
@@ -67,7 +250,7 @@ void close_logger(){
 void change_logger_lvl(int priority){
   if(priority>=0 && priority<8){
     setlogmask (LOG_UPTO (priority));
-    logger.priority=priority;
+    log_priority=priority;
     log_msg(LOG_INFO, 0, "Changed log level: %s", logLevelStr[priority]);
   }else{
     log_msg(LOG_ERR, 0, "Couldn't Change Log level, value incorrect %d", priority);
@@ -75,40 +258,48 @@ void change_logger_lvl(int priority){
 }
 
 
+unsigned long log_getDropped(){
+  return __atomic_load_n(&sink.dropped, __ATOMIC_RELAXED);
+}
+
+
 void log_msg_s(int pri, char *fn, const char *func, int ln, int en, const char *msg) {
-  char timeStr[128];
-  struct timeval tv;
-  struct tm *pTm;
-  gettimeofday( &tv, NULL );
-  pTm = localtime ( (const time_t*)&tv.tv_sec );
-  strftime ((char*) timeStr, 128, "%d/%m/%Y %T", pTm );
-  if(logger.priority >= LOG_DEBUG){
-    sprintf((char*)(timeStr + strlen((char*)timeStr)),
-            ".%06u",
-            (unsigned int)tv.tv_usec);
-  }
- /* if(logger.priority >= LOG_DEBUG){ */
-  if(pri <= logger.priority){
-#ifdef DEBUG
-      if (en)
-          printf("[%s] %s - %d (%s) %s <%s(), %s:%d>\n",
-                 timeStr, logLevelStr[pri], en, strerror(en), msg,
-                 func, basename(fn), ln);
-      else
-          printf("[%s] %s - %s <%s(), %s:%d>\n",
-                 timeStr, logLevelStr[pri], msg,
-                 func, basename(fn), ln);
-#endif
-#ifndef DEBUG
-      if (en)
-          printf("%s - %d (%s) %s\n",
-                 logLevelStr[pri], en, strerror(en), msg);
-      else
-          printf("%s - %s\n", logLevelStr[pri], msg);
+  log_record *r, sync;
+  unsigned long pos = 0;
+  char line[LOG_LINESIZE];
+  static log_clock clk;
+  struct iovec iov;
 
-#endif
-      fflush(stdout);
+  if(pri > log_priority){
+    return;
   }
+  if(!__atomic_load_n(&sink.running, __ATOMIC_ACQUIRE)){
+    /* No writer thread, before init_logger or after close_logger*/
+    r = &sync;
+  }else if(!(r = log_ring_reserve(&pos))){
+    __atomic_fetch_add(&sink.dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  gettimeofday(&r->tv, NULL);
+  r->pri = pri;
+  r->fn = fn;
+  r->func = func;
+  r->ln = ln;
+  if(en){
+    snprintf(r->msg, SYSERR_MSGSIZE, "%d (%s) %s", en, strerror(en), msg);
+  }else{
+    strncpy(r->msg, msg, SYSERR_MSGSIZE-1);
+    r->msg[SYSERR_MSGSIZE-1] = 0;
+  }
+
+  if(r == &sync){
+    iov.iov_base = line;
+    iov.iov_len = log_format(line, LOG_LINESIZE, r, &clk);
+    log_writev(&iov, 1);
+    return;
+  }
+  log_ring_commit(r, pos);
 }
 
 
@@ -129,7 +320,6 @@ void log_errpack_(int pri, char *fn, const char *func, int ln, int en, struct so
 
   va_list args;
   char buf[SYSERR_MSGSIZE];
-  char buf2[SYSERR_MSGSIZE];
   unsigned int n;
   int pos;
 
@@ -138,25 +328,20 @@ void log_errpack_(int pri, char *fn, const char *func, int ln, int en, struct so
   va_end(args);
   buf[SYSERR_MSGSIZE-1] = 0;
 
-  snprintf(buf2, SYSERR_MSGSIZE, "Packet from/to %s:%u, length: %d, content:",
-       inet_ntoa(peer->sin_addr),
-       ntohs(peer->sin_port),
-       len);
-  buf2[SYSERR_MSGSIZE-1] = 0;
-  pos = strlen(buf2);
+  pos = strlen(buf);
+  pos += snprintf(buf+pos, SYSERR_MSGSIZE-pos, ". Packet from/to %s:%u, length: %d, content:",
+                  inet_ntoa(peer->sin_addr),
+                  ntohs(peer->sin_port),
+                  len);
   for(n=0; n<len; n++) {
     if ((pos+4)<SYSERR_MSGSIZE) {
-      sprintf((buf2+pos), " %02hhx", ((unsigned char*)pack)[n]);
+      sprintf((buf+pos), " %02hhx", ((unsigned char*)pack)[n]);
       pos += 3;
     }
   }
-  buf2[pos] = 0;
-
-  if (en)
-    syslog(pri, "%s - %d (%s) %s. %s <%s, %s(),%d> ", logLevelStr[pri], en, strerror(en), buf, buf2, fn, func, ln);
-  else
-    syslog(pri, "%s - %s. %s <%s, %s(),%d>", logLevelStr[pri], buf, buf2, fn, func, ln);
+  buf[SYSERR_MSGSIZE-1] = 0;
 
+  log_msg_s(pri, fn, func, ln, en, buf);
 }
 
 
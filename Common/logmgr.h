@@ -33,8 +33,35 @@
 
 
 #define SYSERR_MSGSIZE 512
-#define log_msg(p, en, ...) log_msg_(p, __FILE__, __func__, __LINE__, en, __VA_ARGS__)
-#define log_errpack(p, en, ...) log_errpack_(p, __FILE__, __func__, __LINE__, en, __VA_ARGS__)
+
+/**
+ * Messages less important than LOG_COMPILED_LEVEL are removed at compile
+ * time, e.g. -DLOG_COMPILED_LEVEL=LOG_INFO drops all the LOG_DEBUG messages.
+ */
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_DEBUG
+#endif
+
+/** Current log level, use change_logger_lvl to modify it*/
+extern int log_priority;
+
+/**
+ * @brief Check if a message with priority p is printed
+ *
+ * The log macros check it before evaluating the arguments, use it to skip
+ * building arguments only needed by the log message.
+ */
+#define log_enabled(p) ((p) <= LOG_COMPILED_LEVEL && (p) <= log_priority)
+
+#define log_msg(p, en, ...) do{                                         \
+        if(log_enabled(p))                                              \
+            log_msg_(p, __FILE__, __func__, __LINE__, en, __VA_ARGS__); \
+    }while(0)
+
+#define log_errpack(p, en, ...) do{                                         \
+        if(log_enabled(p))                                                  \
+            log_errpack_(p, __FILE__, __func__, __LINE__, en, __VA_ARGS__); \
+    }while(0)
 
 
 /**
@@ -71,6 +98,12 @@ extern void close_logger();
 extern void change_logger_lvl(int priority);
 
 
+/**
+ * @brief Number of messages dropped because the log ring was full
+ */
+extern unsigned long log_getDropped();
+
+
 /**
  * @brief send log message
  * @param [in] priority priority level acording to syslog levels
@@ -79,7 +112,9 @@ extern void change_logger_lvl(int priority);
  * @param [in] errno error number
  * @param [in] msg Message to be printed
  *
- * Used by other libraries.
+ * Used by other libraries. The message is queued to the writer thread
+ * started by init_logger, it is dropped if the queue is full. The filename
+ * and function strings are not copied, they must be static.
  */
 extern void log_msg_s(int pri, char *fn, const char *func, int ln, int en, const char *msg);
 
@@ -0,0 +1,159 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   loopprof.c
+ * @brief  Event loop callback profiler
+ */
+
+#include <time.h>
+
+#include "loopprof.h"
+#include "logmgr.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define LOOPPROF_DEPTH 4
+
+const char *loopProfName[LP_NUM] = {
+    "s1_accept", "s1", "s11", "s11_path", "s6a", "commands", "timers",
+    "metrics", "replica"};
+
+typedef struct{
+    LoopProfSlot slot;
+    uint64_t     start;
+    uint64_t     nested;      /**< Cycles of the nested sections*/
+    LoopProfSlot heaviest;    /**< Longest nested section, top level only*/
+    uint64_t     heaviestCycles;
+}LoopProfFrame;
+
+static LoopProfStat stats[LP_NUM];
+static LoopProfFrame stack[LOOPPROF_DEPTH];
+static unsigned depth = 0;
+static unsigned skipped = 0;     /**< Sections entered over the max depth*/
+static uint64_t overruns = 0;
+static uint64_t watchdog = 0;    /**< Threshold in cycles, 0 disabled*/
+
+/* Reference points to convert cycles to time*/
+static uint64_t refCycles;
+static uint64_t refNs;
+
+static uint64_t mono_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t cycles(){
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return mono_ns();
+#endif
+}
+
+uint64_t loopprof_us(uint64_t c){
+    uint64_t dc = cycles() - refCycles;
+    uint64_t dns = mono_ns() - refNs;
+    if(dc == 0){
+        return 0;
+    }
+    return (uint64_t)((double)c * dns / dc / 1000.0);
+}
+
+void init_loopprof(uint32_t wdUs){
+    struct timespec pause = {.tv_sec = 0, .tv_nsec = 10000000};
+
+    refCycles = cycles();
+    refNs = mono_ns();
+    if(wdUs == 0){
+        return;
+    }
+    /* First estimation of the cycle rate for the watchdog threshold*/
+    nanosleep(&pause, NULL);
+    watchdog = (uint64_t)((double)wdUs * 1000.0 * (cycles() - refCycles)
+                          / (mono_ns() - refNs));
+    log_msg(LOG_INFO, 0, "Event loop watchdog set to %u us", wdUs);
+}
+
+void loopprof_enter(LoopProfSlot s){
+    LoopProfFrame *f;
+
+    if(depth == LOOPPROF_DEPTH){
+        skipped++;
+        return;
+    }
+    f = &stack[depth++];
+    f->slot = s;
+    f->nested = 0;
+    f->heaviestCycles = 0;
+    f->start = cycles();
+}
+
+void loopprof_leave(){
+    LoopProfFrame *f;
+    LoopProfStat *st;
+    uint64_t run;
+
+    if(skipped > 0){
+        skipped--;
+        return;
+    }
+    if(depth == 0){
+        return;
+    }
+    f = &stack[--depth];
+    run = cycles() - f->start;
+    st = &stats[f->slot];
+    st->calls++;
+    st->cycles += run > f->nested ? run - f->nested : 0;
+    if(run > st->maxCycles){
+        st->maxCycles = run;
+    }
+
+    if(depth > 0){
+        stack[depth-1].nested += run;
+        if(run > stack[0].heaviestCycles){
+            stack[0].heaviestCycles = run;
+            stack[0].heaviest = f->slot;
+        }
+        return;
+    }
+
+    if(watchdog && run > watchdog){
+        overruns++;
+        if(f->heaviestCycles){
+            log_msg(LOG_WARNING, 0, "Event loop blocked %lu us in %s, %lu us in %s",
+                    loopprof_us(run), loopProfName[f->slot],
+                    loopprof_us(f->heaviestCycles), loopProfName[f->heaviest]);
+        }else{
+            log_msg(LOG_WARNING, 0, "Event loop blocked %lu us in %s",
+                    loopprof_us(run), loopProfName[f->slot]);
+        }
+    }
+}
+
+const LoopProfStat *loopprof_get(LoopProfSlot s){
+    return &stats[s];
+}
+
+uint64_t loopprof_getOverruns(){
+    return overruns;
+}
@@ -0,0 +1,97 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   loopprof.h
+ * @brief  Event loop callback profiler
+ *
+ * The callbacks run on the event loop are bracketed with loopprof_enter and
+ * loopprof_leave. Each slot accumulates the calls, the cycles spent (without
+ * the nested slots) and the longest single run. When a top level callback
+ * runs longer than the watchdog threshold a warning is logged with the
+ * callback and its heaviest nested slot.
+ *
+ * The counters are read from other threads without locking, the values are
+ * aligned 64 bit words updated only by the event loop thread.
+ */
+
+#ifndef _LOOPPROF_H
+#define _LOOPPROF_H
+
+#include <stdint.h>
+
+/** Default watchdog threshold (ms)*/
+#define LOOP_WATCHDOG_MS 50
+
+/**
+ * Profiled code sections*/
+typedef enum{
+    LP_S1_ACCEPT,   /**< New SCTP associations*/
+    LP_S1,          /**< S1AP messages*/
+    LP_S11,         /**< GTPv2-C messages*/
+    LP_S11_PATH,    /**< S11 path supervision sweep*/
+    LP_S6A,         /**< HSS queries, nested in other callbacks*/
+    LP_COMMANDS,    /**< Command shell*/
+    LP_TIMERS,      /**< Timer wheel tick*/
+    LP_METRICS,     /**< Metrics sampler*/
+    LP_REPLICA,     /**< Standby replication stream*/
+    LP_NUM
+}LoopProfSlot;
+
+typedef struct{
+    uint64_t calls;
+    uint64_t cycles;      /**< Own cycles, nested slots excluded*/
+    uint64_t maxCycles;   /**< Longest run, nested slots included*/
+}LoopProfStat;
+
+extern const char *loopProfName[LP_NUM];
+
+/**
+ * @brief Start the profiler
+ * @param [in] watchdogUs  Threshold of the loop watchdog, 0 disables it
+ */
+extern void init_loopprof(uint32_t watchdogUs);
+
+/**
+ * @brief Mark the start of a profiled section
+ * @param [in] s  Slot
+ *
+ * Sections can be nested up to a small depth, deeper ones are ignored.
+ */
+extern void loopprof_enter(LoopProfSlot s);
+
+/**
+ * @brief Mark the end of the last section entered
+ */
+extern void loopprof_leave();
+
+/**
+ * @brief Statistics of a slot
+ */
+extern const LoopProfStat *loopprof_get(LoopProfSlot s);
+
+/**
+ * @brief Convert cycles to microseconds
+ */
+extern uint64_t loopprof_us(uint64_t cycles);
+
+/**
+ * @brief Number of callbacks over the watchdog threshold
+ */
+extern uint64_t loopprof_getOverruns();
+
+#endif /* !_LOOPPROF_H */
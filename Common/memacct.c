@@ -0,0 +1,81 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   memacct.c
+ * @brief  Memory accounting of the UE contexts
+ */
+
+#include <glib.h>
+
+#include "memacct.h"
+
+const char *memTagName[MA_NUM] = {
+    "emm_ctx", "ecm_session", "esm", "eps_session", "bearer", "s11_user",
+    "s11_trxn", "subscription", "auth_vector", "nas_parser", "hash_table",
+    "timer", "timer_pool"};
+
+static MemAcctStat stats[MA_NUM];
+
+void memacct_add(MemTag t, size_t bytes){
+    MemAcctStat *st = &stats[t];
+    st->objects++;
+    st->bytes += bytes;
+    st->allocs++;
+    if(st->objects > st->peak){
+        st->peak = st->objects;
+    }
+}
+
+void memacct_sub(MemTag t, size_t bytes){
+    MemAcctStat *st = &stats[t];
+    if(G_UNLIKELY(st->objects == 0 || st->bytes < bytes)){
+        g_warning("Memory accounting underflow on %s", memTagName[t]);
+        return;
+    }
+    st->objects--;
+    st->bytes -= bytes;
+}
+
+void *memacct_alloc0(MemTag t, size_t bytes){
+    memacct_add(t, bytes);
+    return g_malloc0(bytes);
+}
+
+void memacct_free(MemTag t, size_t bytes, void *p){
+    if(!p){
+        return;
+    }
+    memacct_sub(t, bytes);
+    g_free(p);
+}
+
+const MemAcctStat *memacct_get(MemTag t){
+    return &stats[t];
+}
+
+uint64_t memacct_ueBytes(const MemAcctUE *ue){
+    uint64_t bytes = 0;
+    MemTag t;
+
+    for(t=0; t<MA_NUM; t++){
+        if(ue->objects[t] && stats[t].objects){
+            bytes += ue->objects[t] * stats[t].bytes / stats[t].objects;
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,119 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   memacct.h
+ * @brief  Memory accounting of the UE contexts
+ *
+ * The objects that make up a UE context are allocated with a tag. Each tag
+ * keeps the live objects and bytes, the peak of live objects and the total
+ * allocations, so the memory used by the UEs can be reported by type and a
+ * steady growth of a type under constant load points to a leak.
+ *
+ * The bytes are the size requested, without the allocator overhead. The
+ * GLib hash tables don't expose their size, the tables owned by the UE
+ * objects are accounted with an estimation.
+ *
+ * Only the event loop thread updates the counters.
+ */
+
+#ifndef _MEMACCT_H
+#define _MEMACCT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Allocation tags*/
+typedef enum{
+    MA_EMM_CTX,         /**< EMMCtx_t*/
+    MA_ECM_SESSION,     /**< ECMSession_t*/
+    MA_ESM,             /**< ESM_t*/
+    MA_EPS_SESSION,     /**< EPS_Session_t*/
+    MA_BEARER,          /**< ESM_BearerContext_t*/
+    MA_S11_USER,        /**< S11_user_t*/
+    MA_S11_TRXN,        /**< S11_TrxnT*/
+    MA_SUBSCRIPTION,    /**< Subs_t and its PDN context*/
+    MA_AUTH_VECTOR,     /**< AuthQuadruplet*/
+    MA_NAS_PARSER,      /**< libnas handler*/
+    MA_HASH_TABLE,      /**< GHashTable owned by an UE object, estimated*/
+    MA_TIMER,           /**< Timers in use, part of the timer pool*/
+    MA_TIMER_POOL,      /**< Timer chunks of the timer managers*/
+    MA_NUM
+}MemTag;
+
+/** Estimated size of an empty GHashTable with its first 8 buckets*/
+#define MEMACCT_GHASH_BYTES 256
+
+typedef struct{
+    uint64_t objects;   /**< Live objects*/
+    uint64_t bytes;     /**< Live bytes*/
+    uint64_t peak;      /**< Maximum of live objects*/
+    uint64_t allocs;    /**< Objects allocated since the start*/
+}MemAcctStat;
+
+/**
+ * Objects that belong to one UE, filled by the context owners*/
+typedef struct{
+    uint32_t objects[MA_NUM];
+}MemAcctUE;
+
+extern const char *memTagName[MA_NUM];
+
+/**
+ * @brief Account an object allocated elsewhere
+ * @param [in] t      Tag
+ * @param [in] bytes  Size of the object
+ */
+extern void memacct_add(MemTag t, size_t bytes);
+
+/**
+ * @brief Account the release of an object
+ * @param [in] t      Tag
+ * @param [in] bytes  Size given to memacct_add
+ */
+extern void memacct_sub(MemTag t, size_t bytes);
+
+/**
+ * @brief Allocate a zeroed object and account it
+ * @param [in] t      Tag
+ * @param [in] bytes  Size of the object
+ */
+extern void *memacct_alloc0(MemTag t, size_t bytes);
+
+/**
+ * @brief Release an object allocated with memacct_alloc0
+ */
+extern void memacct_free(MemTag t, size_t bytes, void *p);
+
+#define ma_new0(t, type)        ((type *)memacct_alloc0((t), sizeof(type)))
+#define ma_free(t, type, p)     memacct_free((t), sizeof(type), (p))
+
+/**
+ * @brief Counters of a tag
+ */
+extern const MemAcctStat *memacct_get(MemTag t);
+
+/**
+ * @brief Bytes of the objects of an UE
+ *
+ * Uses the average size of the live objects of each tag, exact for the
+ * fixed size types.
+ */
+extern uint64_t memacct_ueBytes(const MemAcctUE *ue);
+
+#endif /* !_MEMACCT_H */
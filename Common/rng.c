@@ -0,0 +1,157 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rng.c
+ * @brief  Cryptographically secure random numbers
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/random.h>
+
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+
+#include "rng.h"
+#include "logmgr.h"
+
+/** AES-256 key and CTR initial block*/
+#define RNG_SEED    48
+
+typedef struct{
+    EVP_CIPHER_CTX *ctx;
+    uint8_t        buf[RNG_BUF];
+    size_t         pos;         /**< First byte not returned*/
+    size_t         sinceSeed;   /**< Bytes returned since the last seed*/
+    int            seeded;
+}Rng_t;
+
+static __thread Rng_t rng;
+
+static pthread_once_t forkOnce = PTHREAD_ONCE_INIT;
+
+/* Only the forking thread exists on the child*/
+static void rng_forked(){
+    rng.seeded = 0;
+}
+
+static void rng_registerFork(){
+    pthread_atfork(NULL, NULL, rng_forked);
+}
+
+static void rng_getrandom(uint8_t *p, size_t len){
+    ssize_t r;
+
+    while(len > 0){
+        r = getrandom(p, len, 0);
+        if(r < 0){
+            if(errno == EINTR)
+                continue;
+            log_msg(LOG_ERR, errno, "Unable to seed the random number generator");
+            abort();
+        }
+        p += r;
+        len -= r;
+    }
+}
+
+static void rng_key(const uint8_t *seed){
+    if(!EVP_EncryptInit_ex(rng.ctx, EVP_aes_256_ctr(), NULL, seed, seed+32)){
+        log_msg(LOG_ERR, 0, "Unable to key the random number generator");
+        abort();
+    }
+}
+
+/* Next keystream block, its first RNG_SEED bytes are the next key*/
+static void rng_refill(){
+    int len;
+
+    memset(rng.buf, 0, RNG_BUF);
+    if(!EVP_EncryptUpdate(rng.ctx, rng.buf, &len, rng.buf, RNG_BUF)){
+        log_msg(LOG_ERR, 0, "Unable to run the random number generator");
+        abort();
+    }
+    rng_key(rng.buf);
+    OPENSSL_cleanse(rng.buf, RNG_SEED);
+    rng.pos = RNG_SEED;
+}
+
+static void rng_seed(){
+    uint8_t seed[RNG_SEED];
+    size_t i;
+
+    rng_getrandom(seed, RNG_SEED);
+    if(!rng.ctx){
+        pthread_once(&forkOnce, rng_registerFork);
+        rng.ctx = EVP_CIPHER_CTX_new();
+        if(!rng.ctx){
+            log_msg(LOG_ERR, 0, "Unable to allocate the random number generator");
+            abort();
+        }
+    }else{
+        /* Keep the entropy of the current state too*/
+        rng_refill();
+        for(i=0; i<RNG_SEED; i++){
+            seed[i] ^= rng.buf[RNG_SEED+i];
+        }
+    }
+    rng_key(seed);
+    OPENSSL_cleanse(seed, RNG_SEED);
+    rng_refill();
+    rng.sinceSeed = 0;
+    rng.seeded = 1;
+}
+
+void rng_bytes(void *buf, size_t len){
+    uint8_t *p = (uint8_t*)buf;
+    size_t n;
+
+    if(!rng.seeded || rng.sinceSeed >= RNG_RESEED){
+        rng_seed();
+    }
+    rng.sinceSeed += len;
+    while(len > 0){
+        if(rng.pos == RNG_BUF){
+            rng_refill();
+        }
+        n = RNG_BUF - rng.pos;
+        if(n > len){
+            n = len;
+        }
+        memcpy(p, rng.buf + rng.pos, n);
+        OPENSSL_cleanse(rng.buf + rng.pos, n);
+        rng.pos += n;
+        p += n;
+        len -= n;
+    }
+}
+
+uint32_t rng_u32(){
+    uint32_t r;
+    rng_bytes(&r, sizeof(r));
+    return r;
+}
+
+void rng_free(){
+    if(rng.ctx){
+        EVP_CIPHER_CTX_free(rng.ctx);
+    }
+    OPENSSL_cleanse(&rng, sizeof(rng));
+}
@@ -0,0 +1,62 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rng.h
+ * @brief  Cryptographically secure random numbers
+ *
+ * Random numbers for the RAND of the authentication vectors, the M-TMSIs
+ * and the NONCEs. Each thread has an AES-256-CTR generator seeded with
+ * getrandom(). The keystream is produced RNG_BUF bytes at a time and the
+ * first bytes of each block become the next key, so the bytes already
+ * returned can't be recovered from the state. The bytes are erased from the
+ * buffer when returned. New kernel entropy is mixed in every RNG_RESEED
+ * bytes and in the child after a fork.
+ *
+ * The generator aborts the process if the kernel can't provide a seed.
+ */
+
+#ifndef _RNG_H
+#define _RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Keystream bytes produced per block*/
+#define RNG_BUF     4096
+
+/** Bytes returned before mixing in new kernel entropy*/
+#define RNG_RESEED  (1<<20)
+
+/**
+ * @brief Fill a buffer with random bytes
+ * @param [out] buf  Output buffer
+ * @param [in]  len  Bytes
+ */
+extern void rng_bytes(void *buf, size_t len);
+
+/**
+ * @brief Random 32 bit number
+ */
+extern uint32_t rng_u32();
+
+/**
+ * @brief Erase and free the generator of the calling thread
+ */
+extern void rng_free();
+
+#endif /* _RNG_H */
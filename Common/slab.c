@@ -0,0 +1,203 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   slab.c
+ * @brief  Fixed size object pools
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "slab.h"
+
+/** Target chunk size, below the default mmap threshold of malloc*/
+#define SLAB_CHUNK_BYTES   (64*1024)
+#define SLAB_MIN_PER_CHUNK 8
+#define SLAB_ALIGN         16
+
+typedef struct SlabObj_t{
+    struct SlabObj_t *next;     /**< Free list, only while not in use*/
+}SlabObj_t;
+
+typedef struct{
+    SlabStat   st;
+    MemTag     tag;
+    gsize      chunkBytes;
+    SlabObj_t  *freeList;
+    GPtrArray  *chunks;
+}Slab_t;
+
+/** All the pools, for the statistics and slab_trimAll*/
+static GPtrArray *pools = NULL;
+
+Slab slab_new(const char *name, size_t size, MemTag tag){
+    Slab_t *self = g_new0(Slab_t, 1);
+
+    if(size < sizeof(SlabObj_t)){
+        size = sizeof(SlabObj_t);
+    }
+    self->st.name = name;
+    self->st.size = (size + SLAB_ALIGN - 1) & ~((size_t)SLAB_ALIGN - 1);
+    self->st.perChunk = MAX(SLAB_MIN_PER_CHUNK, SLAB_CHUNK_BYTES/self->st.size);
+    self->tag = tag;
+    self->chunkBytes = self->st.size * self->st.perChunk;
+    self->chunks = g_ptr_array_new_with_free_func(g_free);
+
+    if(!pools){
+        pools = g_ptr_array_new();
+    }
+    g_ptr_array_add(pools, self);
+    return self;
+}
+
+void slab_destroy(Slab s){
+    Slab_t *self = (Slab_t*)s;
+
+    g_ptr_array_remove(pools, self);
+    g_ptr_array_free(self->chunks, TRUE);
+    g_free(self);
+}
+
+static void slab_grow(Slab_t *self){
+    guint8 *chunk = g_malloc(self->chunkBytes);
+    SlabObj_t *o;
+    guint i;
+
+    g_ptr_array_add(self->chunks, chunk);
+    self->st.chunks++;
+    /* Push in reverse so the objects are handed out in address order*/
+    for(i=self->st.perChunk; i>0; i--){
+        o = (SlabObj_t*)(chunk + (i-1)*self->st.size);
+        o->next = self->freeList;
+        self->freeList = o;
+    }
+}
+
+void *slab_alloc0(Slab s){
+    Slab_t *self = (Slab_t*)s;
+    SlabObj_t *o;
+
+    if(G_UNLIKELY(!self->freeList)){
+        slab_grow(self);
+    }
+    o = self->freeList;
+    self->freeList = o->next;
+    memset(o, 0, self->st.size);
+
+    self->st.allocs++;
+    if(++self->st.inUse > self->st.peak){
+        self->st.peak = self->st.inUse;
+    }
+    memacct_add(self->tag, self->st.size);
+    return o;
+}
+
+void slab_free(Slab s, void *p){
+    Slab_t *self = (Slab_t*)s;
+    SlabObj_t *o = (SlabObj_t*)p;
+
+    if(!p){
+        return;
+    }
+    o->next = self->freeList;
+    self->freeList = o;
+    self->st.inUse--;
+    memacct_sub(self->tag, self->st.size);
+}
+
+static gint cmpChunk(gconstpointer a, gconstpointer b){
+    const guint8 *ca = *(guint8 * const *)a;
+    const guint8 *cb = *(guint8 * const *)b;
+    return ca < cb ? -1 : ca > cb;
+}
+
+/** Index of the chunk holding p, the chunks are sorted by address*/
+static guint findChunk(const Slab_t *self, const guint8 *p){
+    guint lo = 0, hi = self->chunks->len, mid;
+    const guint8 *c;
+
+    while(hi - lo > 1){
+        mid = (lo + hi)/2;
+        c = g_ptr_array_index(self->chunks, mid);
+        if(p < c){
+            hi = mid;
+        }else{
+            lo = mid;
+        }
+    }
+    return lo;
+}
+
+uint32_t slab_trim(Slab s){
+    Slab_t *self = (Slab_t*)s;
+    SlabObj_t *o, *next, **tail;
+    guint32 *nfree;
+    guint i, released = 0;
+
+    if(self->chunks->len == 0){
+        return 0;
+    }
+    g_ptr_array_sort(self->chunks, cmpChunk);
+    nfree = g_new0(guint32, self->chunks->len);
+
+    for(o=self->freeList; o; o=o->next){
+        nfree[findChunk(self, (guint8*)o)]++;
+    }
+
+    /* Rebuild the free list without the objects of the empty chunks*/
+    tail = &self->freeList;
+    for(o=self->freeList; o; o=next){
+        next = o->next;
+        if(nfree[findChunk(self, (guint8*)o)] != self->st.perChunk){
+            *tail = o;
+            tail = &o->next;
+        }
+    }
+    *tail = NULL;
+
+    /* Backwards, so the indexes in nfree stay valid*/
+    for(i=self->chunks->len; i>0; i--){
+        if(nfree[i-1] == self->st.perChunk){
+            g_ptr_array_remove_index(self->chunks, i-1);
+            released++;
+        }
+    }
+    self->st.chunks -= released;
+    g_free(nfree);
+    return released;
+}
+
+uint32_t slab_trimAll(){
+    guint i;
+    uint32_t released = 0;
+
+    for(i=0; pools && i<pools->len; i++){
+        released += slab_trim(g_ptr_array_index(pools, i));
+    }
+    return released;
+}
+
+void slab_foreach(void (*cb)(const SlabStat *st, void *data), void *data){
+    guint i;
+    Slab_t *p;
+
+    for(i=0; pools && i<pools->len; i++){
+        p = g_ptr_array_index(pools, i);
+        cb(&p->st, data);
+    }
+}
@@ -0,0 +1,96 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   slab.h
+ * @brief  Fixed size object pools
+ *
+ * The long lived UE objects are allocated from a pool per type. A pool takes
+ * memory from malloc in chunks of many objects and keeps the released objects
+ * in a free list, so an allocation is a list pop and an attach/detach storm
+ * does not fragment the heap. The chunks with no object in use are given back
+ * with slab_trim.
+ *
+ * The objects are accounted in memacct with the tag of the pool. The pools
+ * are only used from the event loop thread.
+ */
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "memacct.h"
+
+/**
+ * @typedef Pool handler*/
+typedef void* Slab;
+
+typedef struct{
+    const char *name;
+    size_t     size;      /**< Object size, rounded up to the alignment*/
+    uint32_t   perChunk;  /**< Objects per chunk*/
+    uint32_t   chunks;    /**< Chunks allocated*/
+    uint64_t   inUse;     /**< Objects in use*/
+    uint64_t   peak;      /**< Maximum of objects in use*/
+    uint64_t   allocs;    /**< Objects allocated since the start*/
+}SlabStat;
+
+/**
+ * @brief Create a pool
+ * @param [in] name  Name shown in the statistics, not copied
+ * @param [in] size  Object size
+ * @param [in] tag   Memory accounting tag of the objects
+ * @return pool handler, released with slab_destroy
+ */
+extern Slab slab_new(const char *name, size_t size, MemTag tag);
+
+/**
+ * @brief Release the pool and all its chunks at once
+ *
+ * The objects still in use are invalid after this call.
+ */
+extern void slab_destroy(Slab s);
+
+/**
+ * @brief Get a zeroed object from the pool
+ */
+extern void *slab_alloc0(Slab s);
+
+/**
+ * @brief Return an object to the pool
+ */
+extern void slab_free(Slab s, void *p);
+
+/**
+ * @brief Release the chunks without objects in use
+ * @return number of chunks released
+ */
+extern uint32_t slab_trim(Slab s);
+
+/**
+ * @brief slab_trim on all the pools
+ */
+extern uint32_t slab_trimAll();
+
+/**
+ * @brief Statistics of all the pools, in creation order
+ */
+extern void slab_foreach(void (*cb)(const SlabStat *st, void *data),
+                         void *data);
+
+#endif /* !_SLAB_H */
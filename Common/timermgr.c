@@ -20,110 +20,342 @@
  * @Author Vicent Ferrer
  * @date   Octover, 2015
  * @brief
+ *
+ * The timers are kept in a hierarchical timing wheel driven by a single
+ * libevent tick of TM_TICK_MS. The first level has one slot per tick, each
+ * upper level slot covers a whole turn of the level below and its timers are
+ * cascaded down when the lower level wraps. Adding and stopping a timer is a
+ * list operation. The timers are allocated from chunks kept by the manager.
  */
 
 #include "timermgr.h"
+#include "loopprof.h"
+#include "memacct.h"
 #include <glib.h>
+#include <string.h>
 
+/** Wheel resolution*/
+#define TM_TICK_MS     10
 
-/**
- * @typedef Internal timer manager structure*/
-typedef struct{
-    struct event_base *evbase;
-    GHashTable         *timers;
-}TimerMgr_t;
+#define TM_ROOT_BITS   8
+#define TM_ROOT_SIZE   (1 << TM_ROOT_BITS)
+#define TM_ROOT_MASK   (TM_ROOT_SIZE - 1)
+#define TM_LVL_BITS    6
+#define TM_LVL_SIZE    (1 << TM_LVL_BITS)
+#define TM_LVL_MASK    (TM_LVL_SIZE - 1)
+#define TM_LEVELS      4
+
+/** Maximum timer length in ticks, 2^32 ticks of 10 ms are ~497 days*/
+#define TM_MAX_TICKS   ((G_GUINT64_CONSTANT(1) << (TM_ROOT_BITS + TM_LEVELS*TM_LVL_BITS)) - 1)
+
+/** Number of timers allocated at once*/
+#define TM_CHUNK       256
 
 /**
  * @typedef Internal timer structure*/
-typedef struct{
-    struct event   *ev;
-    struct timeval tv;
-    TimerMgr       mgr;
+typedef struct Timer_t{
+    struct Timer_t *next;      /**< Slot list, or free list when not used*/
+    struct Timer_t *prev;
+    guint64        expires;    /**< Expiration tick*/
+    guint64        period;     /**< Timer length in ticks*/
+    gpointer       mgr;
     guint32        max_rtx;
     guint32        rtx;
     Timer_cb       cb_to;
     Timer_cb       cb_maxTo;
     Timer_cb       cb_free;
     gpointer       cb_args;
+    gboolean       running;    /**< Callback in progress*/
+    gboolean       stopped;    /**< Stopped during its own callback*/
+    gboolean       restarted;  /**< Restarted during its own callback*/
 }Timer_t;
 
+/**
+ * @typedef Timer list head, circular*/
+typedef struct{
+    Timer_t *next;
+    Timer_t *prev;
+}TimerList_t;
+
+/**
+ * @typedef Internal timer manager structure*/
+typedef struct{
+    struct event_base *evbase;
+    struct event      *tick;
+    gboolean          tickActive;
+    gint64            start;       /**< Monotonic time of tick 0*/
+    guint64           now;         /**< Current wheel tick*/
+    guint32           count;       /**< Timers in the wheel*/
+    TimerList_t       root[TM_ROOT_SIZE];
+    TimerList_t       lvl[TM_LEVELS][TM_LVL_SIZE];
+    Timer_t           *freeList;
+    GPtrArray         *chunks;
+}TimerMgr_t;
+
+
+static void list_init(TimerList_t *l){
+    l->next = (Timer_t *)l;
+    l->prev = (Timer_t *)l;
+}
+
+static gboolean list_empty(const TimerList_t *l){
+    return l->next == (const Timer_t *)l;
+}
+
+static void list_add(TimerList_t *l, Timer_t *t){
+    t->prev = l->prev;
+    t->next = (Timer_t *)l;
+    l->prev->next = t;
+    l->prev = t;
+}
 
+static void list_del(Timer_t *t){
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = NULL;
+    t->prev = NULL;
+}
+
+/** Move all the timers of src to dst, leaving src empty*/
+static void list_move(TimerList_t *src, TimerList_t *dst){
+    list_init(dst);
+    if(list_empty(src)){
+        return;
+    }
+    dst->next = src->next;
+    dst->prev = src->prev;
+    dst->next->prev = (Timer_t *)dst;
+    dst->prev->next = (Timer_t *)dst;
+    list_init(src);
+}
+
+static Timer_t *timer_alloc(TimerMgr_t *tm){
+    Timer_t *chunk, *t;
+    guint i;
+
+    if(!tm->freeList){
+        chunk = g_new(Timer_t, TM_CHUNK);
+        g_ptr_array_add(tm->chunks, chunk);
+        memacct_add(MA_TIMER_POOL, sizeof(Timer_t)*TM_CHUNK);
+        for(i=0; i<TM_CHUNK; i++){
+            chunk[i].next = tm->freeList;
+            tm->freeList = &chunk[i];
+        }
+    }
+    t = tm->freeList;
+    tm->freeList = t->next;
+    memset(t, 0, sizeof(Timer_t));
+    memacct_add(MA_TIMER, sizeof(Timer_t));
+    return t;
+}
 
 /**
- * @brief  Starts a new timer
+ * @brief  Release a timer
  * @param [in]  t Timer handler
  *
  * Private function to be called when the timer is removed
  */
 static void free_timer(Timer_t *t){
+    TimerMgr_t *tm = t->mgr;
+
     if(t->cb_free){
         t->cb_free((Timer)t, t->cb_args);
     }
+    t->mgr = NULL;
+    memacct_sub(MA_TIMER, sizeof(Timer_t));
+    t->next = tm->freeList;
+    tm->freeList = t;
+}
+
+static guint64 tm_currentTick(const TimerMgr_t *tm){
+    return (g_get_monotonic_time() - tm->start)/(TM_TICK_MS*1000);
 }
 
+static void wheel_add(TimerMgr_t *tm, Timer_t *t){
+    guint64 delta;
+    guint level, shift;
+
+    if(t->expires <= tm->now){
+        /* Already expired, run on the next tick*/
+        t->expires = tm->now;
+        list_add(&tm->root[tm->now & TM_ROOT_MASK], t);
+        return;
+    }
+    delta = t->expires - tm->now;
+    if(delta > TM_MAX_TICKS){
+        delta = TM_MAX_TICKS;
+        t->expires = tm->now + delta;
+    }
+    if(delta < TM_ROOT_SIZE){
+        list_add(&tm->root[t->expires & TM_ROOT_MASK], t);
+        return;
+    }
+    for(level=0; level<TM_LEVELS; level++){
+        shift = TM_ROOT_BITS + level*TM_LVL_BITS;
+        if(delta < (G_GUINT64_CONSTANT(1) << (shift + TM_LVL_BITS))){
+            break;
+        }
+    }
+    list_add(&tm->lvl[level][(t->expires >> shift) & TM_LVL_MASK], t);
+}
+
+/** Move the timers of the current slot of a level to the lower levels*/
+static guint wheel_cascade(TimerMgr_t *tm, guint level){
+    guint idx = (tm->now >> (TM_ROOT_BITS + level*TM_LVL_BITS)) & TM_LVL_MASK;
+    TimerList_t work;
+    Timer_t *t;
+
+    list_move(&tm->lvl[level][idx], &work);
+    while(!list_empty(&work)){
+        t = work.next;
+        list_del(t);
+        wheel_add(tm, t);
+    }
+    return idx;
+}
+
+static void tick_start(TimerMgr_t *tm){
+    const struct timeval tv = {.tv_sec = 0, .tv_usec = TM_TICK_MS*1000};
+
+    if(tm->tickActive){
+        return;
+    }
+    /* The wheel is empty, resynchronize it with the clock*/
+    tm->now = tm_currentTick(tm);
+    evtimer_add(tm->tick, &tv);
+    tm->tickActive = TRUE;
+}
 
 /**
- * @brief  Timer callback
- * @param [in] sock   Not Used
- * @param [in] which  Not Used
- * @param [in] arg    User Data
+ * @brief  Run an expired timer
+ * @param [in] t  Timer handler, out of the wheel
  *
- * Private callback function. It calls the appropiate callback.
+ * Private function. It calls the appropiate callback and rearms the timer
+ * for the next retransmission.
  */
-static void timer_cb(int sock, short which, void *arg){
-    Timer_t * t = (Timer_t*)arg;
-    TimerMgr_t *tm;
-    Timer_cb cb_max_To;
-    guint32 rtx, max_rtx;
-    gboolean timerExists = FALSE;
-
-    tm = t->mgr;
+static void timer_run(TimerMgr_t *tm, Timer_t *t){
+    t->running = TRUE;
+    t->restarted = FALSE;
     t->rtx++;
-    if(t->rtx <= t->max_rtx ){
-        /* Store variables just in case the Timer is freed in the cb */
-        cb_max_To = t->cb_maxTo;
-        rtx = t->rtx;
-        max_rtx = t->max_rtx;
-
-        /* Process CB*/
+    if(t->rtx <= t->max_rtx){
         t->cb_to((Timer)t, t->cb_args);
-
-        /* Check if timer still exists*/
-        timerExists = g_hash_table_contains(tm->timers, t);
         /*Last timer and cb_maxTo is NULL*/
-        if(!cb_max_To && rtx == max_rtx && timerExists){
-            tm_stop_timer(t);
+        if(!t->cb_maxTo && t->rtx == t->max_rtx && !t->restarted){
+            t->stopped = TRUE;
+        }
+    }else{
+        /* Max Retransmission reached*/
+        t->cb_maxTo((Timer)t, t->cb_args);
+        if(!t->restarted){
+            t->stopped = TRUE;
         }
+    }
+    t->running = FALSE;
+
+    if(t->stopped){
+        tm->count--;
+        free_timer(t);
         return;
     }
+    if(t->restarted){
+        t->expires = tm->now + t->period;
+    }else{
+        t->expires += t->period;
+    }
+    wheel_add(tm, t);
+}
+
+/**
+ * @brief  Tick callback
+ * @param [in] sock   Not Used
+ * @param [in] which  Not Used
+ * @param [in] arg    User Data
+ *
+ * Private callback function. It advances the wheel up to the current time
+ * and runs the expired timers.
+ */
+static void tick_cb(int sock, short which, void *arg){
+    TimerMgr_t *tm = (TimerMgr_t*)arg;
+    guint64 target = tm_currentTick(tm);
+    TimerList_t work;
+    Timer_t *t;
+    guint idx, level;
 
-    /* Max Retransmission reached*/
-    t->cb_maxTo((Timer)t, t->cb_args);
+    loopprof_enter(LP_TIMERS);
+    while(tm->now <= target && tm->count > 0){
+        idx = tm->now & TM_ROOT_MASK;
+        for(level=0; idx == 0 && level<TM_LEVELS; level++){
+            if(wheel_cascade(tm, level) != 0){
+                break;
+            }
+        }
+        list_move(&tm->root[idx], &work);
+        /* Timers added from the callbacks go after the current tick*/
+        tm->now++;
+        while(!list_empty(&work)){
+            t = work.next;
+            list_del(t);
+            timer_run(tm, t);
+        }
+    }
 
-    timerExists = g_hash_table_contains(tm->timers, t);
-    if(timerExists){
-        tm_stop_timer(t);
+    if(tm->count == 0){
+        evtimer_del(tm->tick);
+        tm->tickActive = FALSE;
     }
+    loopprof_leave();
 }
 
 TimerMgr init_timerMgr(struct event_base *ev_base){
-    TimerMgr_t *self = g_new0(TimerMgr_t, 1);
+    TimerMgr_t *self;
+    guint i, j;
 
     if(!ev_base){
         return NULL;
     }
+    self = g_new0(TimerMgr_t, 1);
     self->evbase = ev_base;
-    self->timers = g_hash_table_new_full(g_direct_hash,
-                                         g_direct_equal,
-                                         NULL,
-                                         (GDestroyNotify)free_timer);
+    self->tick = event_new(ev_base, -1, EV_PERSIST, tick_cb, self);
+    self->start = g_get_monotonic_time();
+    self->chunks = g_ptr_array_new_with_free_func(g_free);
+    for(i=0; i<TM_ROOT_SIZE; i++){
+        list_init(&self->root[i]);
+    }
+    for(i=0; i<TM_LEVELS; i++){
+        for(j=0; j<TM_LVL_SIZE; j++){
+            list_init(&self->lvl[i][j]);
+        }
+    }
     return self;
 }
 
+static void free_list(TimerList_t *l){
+    Timer_t *t;
+    while(!list_empty(l)){
+        t = l->next;
+        list_del(t);
+        free_timer(t);
+    }
+}
+
 void free_timerMgr(TimerMgr h){
     TimerMgr_t *self = (TimerMgr_t*) h;
+    guint i, j;
 
-    g_hash_table_destroy(self->timers);
+    for(i=0; i<TM_ROOT_SIZE; i++){
+        free_list(&self->root[i]);
+    }
+    for(i=0; i<TM_LEVELS; i++){
+        for(j=0; j<TM_LVL_SIZE; j++){
+            free_list(&self->lvl[i][j]);
+        }
+    }
+    event_free(self->tick);
+    for(i=0; i<self->chunks->len; i++){
+        memacct_sub(MA_TIMER_POOL, sizeof(Timer_t)*TM_CHUNK);
+    }
+    g_ptr_array_free(self->chunks, TRUE);
+    g_free(self);
 }
 
 
@@ -132,6 +364,7 @@ Timer tm_add_timer(TimerMgr h, const struct timeval *tv, const uint32_t max_rtx,
                    void* cb_args){
     Timer_t *t;
     TimerMgr_t *self = (TimerMgr_t*) h;
+    guint64 ms;
     if(!tv || !cb_to){
         return NULL;
     }
@@ -142,10 +375,15 @@ Timer tm_add_timer(TimerMgr h, const struct timeval *tv, const uint32_t max_rtx,
         return NULL;
     }
 
-    t = g_new0(Timer_t, 1);
+    if(self->count == 0){
+        tick_start(self);
+    }
+
+    t = timer_alloc(self);
 
-    t->tv.tv_sec = tv->tv_sec;
-    t->tv.tv_usec = tv->tv_usec;
+    ms = (guint64)tv->tv_sec*1000 + (tv->tv_usec + 999)/1000;
+    t->period = MAX((ms + TM_TICK_MS - 1)/TM_TICK_MS, 1);
+    t->expires = self->now + t->period;
     t->mgr = self;
     t->max_rtx = max_rtx;
     t->cb_to = cb_to;
@@ -153,13 +391,8 @@ Timer tm_add_timer(TimerMgr h, const struct timeval *tv, const uint32_t max_rtx,
     t->cb_free = cb_free;
     t->cb_args = cb_args;
 
-    t->ev = event_new(self->evbase, -1, EV_PERSIST , timer_cb, t);
-    if(!t->ev){
-        return NULL;
-    }
-    evtimer_add(t->ev, &(t->tv));
-
-    g_hash_table_add(self->timers, t);
+    wheel_add(self, t);
+    self->count++;
     return t;
 }
 
@@ -176,13 +409,41 @@ void tm_stop_timer(Timer timer){
     }
     tm = t->mgr;
 
-    if(evtimer_del(t->ev) == -1){
-        /* Error occurred, was the timer deleted in the last
-         * retransmission callback ?*/
+    if(t->running){
+        /* Stopped from its own callback, the timer is released after it
+         * returns*/
+        if(t->cb_free){
+            t->cb_free((Timer)t, t->cb_args);
+            t->cb_free = NULL;
+        }
+        t->stopped = TRUE;
         return;
     }
 
-    g_hash_table_remove(tm->timers, t);
+    list_del(t);
+    tm->count--;
+    free_timer(t);
+}
+
+void tm_restart_timer(Timer timer){
+    Timer_t *t = (Timer_t*)timer;
+    TimerMgr_t *tm;
+    if(!t){
+        return;
+    }
+    tm = t->mgr;
+    t->rtx = 0;
+
+    if(t->running){
+        t->restarted = TRUE;
+        return;
+    }
+    list_del(t);
+    t->expires = tm->now + t->period;
+    wheel_add(tm, t);
+}
 
-    g_free(t);
+uint32_t tm_getCount(TimerMgr h){
+    TimerMgr_t *tm = (TimerMgr_t*)h;
+    return tm->count;
 }
@@ -73,7 +73,8 @@ extern void free_timerMgr(TimerMgr h);
  * @param [in]  cb_args  Callback arguments
  * @return Timer handler
  *
- * Starts a new timer.
+ * Starts a new timer. The expiration is rounded up to the 10 ms resolution of
+ * the timer manager.
  * The parameters cb_maxTO and cb_free can be NULL. The cb_to cannot be NULL.
  * The max_rtx must be greater than 0.
  */
@@ -93,4 +94,21 @@ extern Timer tm_add_timer(TimerMgr h,
 extern void tm_stop_timer(Timer t);
 
 
+/**
+ * @brief Timer restart
+ * @param [in]  t        Timer handler
+ *
+ * Restart the timer with its initial length and retransmission counter.
+ * The timer keeps its handler and callbacks.
+ */
+extern void tm_restart_timer(Timer t);
+
+
+/**
+ * @brief Number of running timers
+ * @param [in]  h        Timer manager handler
+ */
+extern uint32_t tm_getCount(TimerMgr h);
+
+
 #endif /* !_TIMERMGR_H */
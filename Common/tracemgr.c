@@ -0,0 +1,114 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tracemgr.c
+ * @brief  Binary event tracing
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "tracemgr.h"
+#include "logmgr.h"
+
+TraceRecord *trace_ring = NULL;
+
+static TraceFileHeader *trace_hdr = NULL;
+static size_t trace_size = 0;
+
+static uint64_t trace_clock(clockid_t clk){
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+int init_tracer(const char *dir, uint32_t records){
+    char path[256], old[260];
+    int fd;
+    void *map;
+
+    if(records == 0){
+        log_msg(LOG_INFO, 0, "Tracing disabled");
+        return 0;
+    }
+    /* The trace of the previous run is kept for post-mortem analysis*/
+    snprintf(path, sizeof(path), "%s/mme.trace", dir);
+    snprintf(old, sizeof(old), "%s.1", path);
+    if(rename(path, old) != 0 && errno != ENOENT){
+        log_msg(LOG_WARNING, errno, "Couldn't rotate trace file %s", path);
+    }
+
+    trace_size = sizeof(TraceFileHeader) + (size_t)records*sizeof(TraceRecord);
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        log_msg(LOG_WARNING, errno, "Couldn't create trace file %s", path);
+        return -1;
+    }
+    if(ftruncate(fd, trace_size) != 0){
+        log_msg(LOG_WARNING, errno, "Couldn't size trace file %s", path);
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, trace_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        log_msg(LOG_WARNING, errno, "Couldn't map trace file %s", path);
+        return -1;
+    }
+
+    trace_hdr = (TraceFileHeader *)map;
+    trace_hdr->magic = TRACE_MAGIC;
+    trace_hdr->version = TRACE_VERSION;
+    trace_hdr->recordSize = sizeof(TraceRecord);
+    trace_hdr->capacity = records;
+    trace_hdr->head = 0;
+    trace_hdr->realOffset = (int64_t)(trace_clock(CLOCK_REALTIME)
+                                      - trace_clock(CLOCK_MONOTONIC_COARSE));
+    trace_ring = (TraceRecord *)(trace_hdr + 1);
+
+    log_msg(LOG_INFO, 0, "Tracing %u events on %s", records, path);
+    return 0;
+}
+
+void close_tracer(){
+    if(!trace_hdr){
+        return;
+    }
+    trace_ring = NULL;
+    msync(trace_hdr, trace_size, MS_ASYNC);
+    munmap(trace_hdr, trace_size);
+    trace_hdr = NULL;
+}
+
+void trace_event_(TraceEvent ev, uint64_t ue, uint16_t proc,
+                  uint16_t from, uint32_t arg){
+    TraceRecord *r = &trace_ring[trace_hdr->head % trace_hdr->capacity];
+
+    r->ts = trace_clock(CLOCK_MONOTONIC_COARSE);
+    r->ue = ue;
+    r->event = ev;
+    r->proc = proc;
+    r->from = from;
+    r->arg = arg;
+    trace_hdr->head++;
+}
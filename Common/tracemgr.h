@@ -0,0 +1,109 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tracemgr.h
+ * @brief  Binary event tracing
+ *
+ * The trace events are stored as fixed size records in a ring mapped on the
+ * file mme.trace. The file can be read with the trace_decode tool while
+ * the MME is running or after it exits, the file of the previous run is
+ * renamed to mme.trace.1.
+ */
+
+#ifndef _TRACEMGR_H
+#define _TRACEMGR_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC   0x434152544d4d4541ULL /* "AEMMTRAC"*/
+#define TRACE_VERSION 1
+
+/**
+ * Trace event identifiers*/
+typedef enum{
+    TRACE_NONE,
+    TRACE_EMM_STATE,     /**< ue: IMSI, proc: new EMMState, from: old*/
+    TRACE_ECM_STATE,     /**< ue: MME UE S1AP ID, proc: new ECMSessionState,
+                          *   from: old, arg: eNB UE S1AP ID*/
+    TRACE_S1ASSOC_STATE, /**< ue: eNB ID, proc: new S1AssocState, from: old*/
+    TRACE_S11_TX_REQ,    /**< ue: local TEID, proc: GTPv2 type, arg: seq*/
+    TRACE_S11_RX_RSP,
+    TRACE_S11_RX_REQ,
+    TRACE_S11_TX_RSP,
+    TRACE_NUM_EVENTS
+}TraceEvent;
+
+/**
+ * Trace record, 32 bytes*/
+typedef struct{
+    uint64_t ts;         /**< CLOCK_MONOTONIC_COARSE, ns*/
+    uint64_t ue;         /**< UE or node identifier, depends on the event*/
+    uint16_t event;      /**< TraceEvent*/
+    uint16_t proc;       /**< New state or message type*/
+    uint16_t from;       /**< Previous state*/
+    uint16_t spare;
+    uint32_t arg;        /**< Event argument*/
+    uint32_t spare2;
+}TraceRecord;
+
+/**
+ * Trace file header, followed by the records*/
+typedef struct{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;   /**< Number of records in the ring*/
+    uint64_t head;       /**< Total records written, next = head % capacity*/
+    int64_t  realOffset; /**< CLOCK_REALTIME - CLOCK_MONOTONIC_COARSE at init, ns*/
+    uint64_t spare[3];
+}TraceFileHeader;
+
+/** Records of the active trace file, NULL if tracing is disabled*/
+extern TraceRecord *trace_ring;
+
+/**
+ * @brief Record a trace event
+ *
+ * A single test when tracing is disabled.
+ */
+#define trace_event(ev, ue, proc, from, arg) do{                       \
+        if(trace_ring)                                                  \
+            trace_event_(ev, ue, proc, from, arg);                      \
+    }while(0)
+
+/**
+ * @brief Open the trace file
+ * @param [in] dir      Directory of the trace file
+ * @param [in] records  Number of records of the ring, 0 disables tracing
+ * @return 0 on success, -1 on error
+ *
+ * The file is named mme.trace, an existing one is renamed to mme.trace.1
+ */
+extern int init_tracer(const char *dir, uint32_t records);
+
+/**
+ * @brief Unmap the trace file
+ *
+ * The file is kept for offline decoding.
+ */
+extern void close_tracer();
+
+extern void trace_event_(TraceEvent ev, uint64_t ue, uint16_t proc,
+                         uint16_t from, uint32_t arg);
+
+#endif /* !_TRACEMGR_H */
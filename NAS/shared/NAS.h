@@ -81,6 +81,13 @@ NAS nas_newHandler();
 void nas_freeHandler(NAS h);
 
 
+/**
+ * @brief Size of the NAS handler
+ * @return bytes allocated by nas_newHandler
+ */
+size_t nas_getHandlerSize();
+
+
 /**
  * @brief Reset NAS handler information
  * @param [inout] h           NAS handler
@@ -121,6 +128,28 @@ int nas_getHeader(const uint8_t *buf, const uint32_t size,
 const uint32_t nas_getLastCount(const NAS h, const NAS_Direction direction);
 
 
+/**
+ * @brief Get the NAS security state
+ * @param [in]  h      NAS handler
+ * @param [out] i      Integrity algorithm
+ * @param [out] e      Encryption algorithm
+ * @param [out] count  Next NAS COUNT, index: 0 Uplink, 1 Downlink
+ * @return 1 if the security is set, 0 otherwise
+ *
+ * Used with nas_restoreSecurity to save and restore the NAS security context.
+ */
+int nas_getSecurity(const NAS h, NAS_EIA *i, NAS_EEA *e, uint32_t count[2]);
+
+/**
+ * @brief Set the NAS security keeping the given NAS COUNT values
+ *
+ * Same as nas_setSecurity, with the counts saved with nas_getSecurity
+ * instead of zero.
+ */
+void nas_restoreSecurity(NAS h, const NAS_EIA i, const NAS_EEA e,
+                         const uint8_t *kasme, const uint32_t count[2]);
+
+
 /**
  * @brief Check NAS integrity of a message
  * @param [in]  h           NAS handler
@@ -222,6 +251,23 @@ int newNASMsg_sec(const NAS h,
                   const uint8_t *plain, const size_t pLen);
 
 
+/**
+ * @brief Encode a Service Request message
+ * @param [in]  h           NAS handler
+ * @param [out] out         Buffer to place the encoded message, 4 octets
+ * @param [out] len         Size of the encoded message
+ * @param [in]  ksi         NAS key set identifier
+ * @return 1 on success, 0 if the security context is not valid
+ *
+ * The Service Request has its own security header (TS 24.301 8.2.25): the
+ * KSI, the 5 least significant bits of the uplink NAS COUNT and the 2 least
+ * significant octets of the MAC calculated over the first 2 octets. The
+ * uplink NAS COUNT is incremented.
+ */
+int newNASMsg_service(const NAS h, uint8_t *out, size_t *len,
+                      const uint8_t ksi);
+
+
 void encaps_ESM(uint8_t **curpos,
                 ProcedureTransactionId_t procedureTransactionIdentity,
                 NASMessageType_t messageType);
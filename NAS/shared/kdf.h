@@ -0,0 +1,129 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   kdf.h
+ * @brief  3GPP TS 33.401 key derivation functions
+ *
+ * The KDF of TS 33.220 Annex B is HMAC-SHA-256(Key, S) with
+ * S = FC || P0 || L0 || P1 || L1 ... The derived keys of 128 bits are the
+ * least significant bits of the output.
+ *
+ * A KDFKey holds the SHA-256 states after the key XOR ipad and key XOR opad
+ * blocks, so a derivation from a key already set only hashes S and the
+ * inner digest. The key of the NAS, KeNB and NH derivations is the KASME,
+ * the EMM context keeps its KDFKey while the KASME is in use. The SHA-256
+ * is the one of OpenSSL.
+ */
+
+#ifndef _KDF_H
+#define _KDF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/sha.h>
+
+#define KDF_FC_KASME      0x10  /**< KASME from CK, IK (A.2)*/
+#define KDF_FC_KENB       0x11  /**< KeNB from KASME (A.3)*/
+#define KDF_FC_NH         0x12  /**< NH from KASME (A.4)*/
+#define KDF_FC_KENB_STAR  0x13  /**< KeNB* from KeNB or NH (A.5)*/
+#define KDF_FC_ALG_KEY    0x15  /**< NAS and AS algorithm keys (A.7)*/
+
+/* Algorithm type distinguishers of A.7*/
+#define KDF_NAS_ENC       0x01
+#define KDF_NAS_INT       0x02
+#define KDF_RRC_ENC       0x03
+#define KDF_RRC_INT       0x04
+#define KDF_UP_ENC        0x05
+
+typedef struct{
+    SHA256_CTX inner;   /**< State after the key XOR ipad block*/
+    SHA256_CTX outer;   /**< State after the key XOR opad block*/
+}KDFKey;
+
+/**
+ * @brief Precompute the HMAC states of a key
+ * @param [out] k    KDF key
+ * @param [in]  key  Key, 256 bits for all the TS 33.401 derivations
+ * @param [in]  len  Key length in bytes
+ */
+void kdf_setKey(KDFKey *k, const uint8_t *key, size_t len);
+
+/**
+ * @brief Erase a KDF key
+ */
+void kdf_clearKey(KDFKey *k);
+
+/**
+ * @brief HMAC-SHA-256 with a precomputed key
+ * @param [in]  k       KDF key
+ * @param [in]  s       Input string S
+ * @param [in]  len     Length of S
+ * @param [out] out     Least significant outLen bytes of the HMAC
+ * @param [in]  outLen  Up to 32 bytes
+ */
+void kdf_derive(const KDFKey *k, const uint8_t *s, size_t len,
+                uint8_t *out, size_t outLen);
+
+/**
+ * @brief KASME, FC = 0x10
+ * @param [in]  ck     Cipher Key - 128 bits
+ * @param [in]  ik     Integrity Key - 128 bits
+ * @param [in]  sn     Serving Network id, TBCD PLMN - 24 bits
+ * @param [in]  sqnAk  SQN XOR AK - 48 bits
+ * @param [out] kasme  256 bits
+ */
+void kdf_kasme(const uint8_t *ck, const uint8_t *ik, const uint8_t *sn,
+               const uint8_t *sqnAk, uint8_t *kasme);
+
+/**
+ * @brief KeNB, FC = 0x11
+ * @param [in]  kasme    KDF key of the KASME
+ * @param [in]  ulCount  Uplink NAS COUNT
+ * @param [out] keNB     256 bits
+ */
+void kdf_keNB(const KDFKey *kasme, uint32_t ulCount, uint8_t *keNB);
+
+/**
+ * @brief NH, FC = 0x12
+ * @param [in]  kasme  KDF key of the KASME
+ * @param [in]  sync   SYNC-input, the KeNB on the first hop, the last NH later
+ * @param [out] nh     256 bits, can be the same buffer as sync
+ */
+void kdf_nh(const KDFKey *kasme, const uint8_t *sync, uint8_t *nh);
+
+/**
+ * @brief KeNB*, FC = 0x13
+ * @param [in]  key       KeNB or NH - 256 bits
+ * @param [in]  pci       Target PCI
+ * @param [in]  earfcn    Target EARFCN-DL, coded on 3 bytes above 65535
+ * @param [out] keNBStar  256 bits
+ */
+void kdf_keNBStar(const uint8_t *key, uint16_t pci, uint32_t earfcn,
+                  uint8_t *keNBStar);
+
+/**
+ * @brief NAS or AS algorithm key, FC = 0x15
+ * @param [in]  kasme          KDF key of the KASME, or of the KeNB for AS keys
+ * @param [in]  distinguisher  Algorithm type distinguisher, KDF_NAS_ENC...
+ * @param [in]  algId          Algorithm identity
+ * @param [out] k              128 bits
+ */
+void kdf_algKey(const KDFKey *kasme, uint8_t distinguisher, uint8_t algId,
+                uint8_t *k);
+
+#endif /* _KDF_H */
@@ -28,7 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>     /*htonl*/
-#include <openssl/hmac.h>
+#include "kdf.h"
 
 /* ************************************************** */
 /*                  Internal Functions                */
@@ -155,53 +155,6 @@ static int nas_checkCOUNTshort(const uint32_t last, const uint8_t recv){
 }
 
 
-static void hmac_sha256(const unsigned char *key, unsigned int key_size,
-                        const unsigned char *message, unsigned int message_len,
-                        unsigned char *mac, unsigned mac_size){
-    uint8_t res[EVP_MAX_MD_SIZE];
-    uint32_t len;
-    HMAC_CTX ctx;
-
-    HMAC_CTX_init(&ctx);
-    HMAC_Init_ex(&ctx, key, key_size, EVP_sha256(), NULL);
-    HMAC_Update(&ctx, message, message_len);
-    HMAC_Final(&ctx, res, &len);
-    HMAC_CTX_cleanup(&ctx);
-    /* Use least significant bits */
-    memcpy(mac, res + len - mac_size, mac_size);
-}
-
-/**
- * @brief Key derivation function
- * @param [in]  kasme          derived key - 256 bits
- * @param [in]  distinguisher  Algorithm distinguisher
- * @param [in]  algId          Algorithm identity
- * @param [out] k              Derived Key - 128 bits
- */
-static void kdf(const uint8_t *kasme,
-                const uint8_t distinguisher, const uint8_t algId,
-                uint8_t *k){
-
-    /*
-    FC = 0x15,
-    P0 = algorithm type distinguisher,
-    L0 = length of algorithm type distinguisher (i.e. 0x00 0x01)
-    P1 = algorithm identity
-    L1 = length of algorithm identity (i.e. 0x00 0x01)
-     */
-    uint8_t s[7];
-    s[0]=0x15;
-    s[1]=distinguisher;
-    s[2]=0x00;
-    s[3]=0x01;
-    s[4]=algId;
-    s[5]=0x00;
-    s[6]=0x01;
-
-    hmac_sha256(kasme, 32, s, 7, k, 16);
-}
-
-
 /* ***** Decoding functions ***** */
 
 
@@ -507,8 +460,34 @@ int newNASMsg_sec(const NAS h,
     /* Add sequence number and cyphered message */
     nasIe_v_t3(&pointer, buf, pLen + 1);
     *len = pointer - out;
-    /* Increment downlink counter*/
-    nas_incrementNASCount(n, NAS_DownLink);
+    /* Increment the counter of the direction used*/
+    nas_incrementNASCount(n, direction);
+    return 1;
+}
+
+int newNASMsg_service(const NAS h, uint8_t *out, size_t *len,
+                      const uint8_t ksi){
+    uint8_t count[4], mac[4];
+    uint32_t ncount;
+    NASHandler *n = (NASHandler*)h;
+
+    if(!n->isValid)
+        return 0;
+
+    ncount = htonl(n->nas_count[NAS_UpLink]);
+    memcpy(count, &ncount, 4);
+
+    /* Security header, KSI and 5 bits of the NAS COUNT*/
+    out[0] = SecurityHeaderForServiceRequestMessage<<4
+        | EPSMobilityManagementMessages;
+    out[1] = (ksi&0x07)<<5 | (n->nas_count[NAS_UpLink]&0x1F);
+
+    /* Short MAC, 2 least significant bytes of the MAC of the first 2 octets*/
+    eia_cb[n->i](n->ikey, count, 0, NAS_UpLink, out, 2*8, mac);
+    memcpy(out+2, mac+2, 2);
+    *len = 4;
+
+    nas_incrementNASCount(n, NAS_UpLink);
     return 1;
 }
 
@@ -538,17 +517,24 @@ void nas_freeHandler(NAS h){
     return;
 }
 
+size_t nas_getHandlerSize(){
+    return sizeof(NASHandler);
+}
+
 
 void nas_setSecurity(NAS h, const NAS_EIA i, const NAS_EEA e,
                      const uint8_t *kasme){
 
     NASHandler *n = (NASHandler*)h;
+    KDFKey k;
 
     n->i = i;
     n->e = e;
 
-    kdf(kasme, 0x02, i, n->ikey);
-    kdf(kasme, 0x01, e, n->ekey);
+    kdf_setKey(&k, kasme, 32);
+    kdf_algKey(&k, KDF_NAS_INT, i, n->ikey);
+    kdf_algKey(&k, KDF_NAS_ENC, e, n->ekey);
+    kdf_clearKey(&k);
 
     n->nas_count[0] = 0;
     n->nas_count[1] = 0;
@@ -575,6 +561,24 @@ const uint32_t nas_getLastCount(const NAS h, const NAS_Direction direction){
     return n->nas_count[direction]-1;
 }
 
+int nas_getSecurity(const NAS h, NAS_EIA *i, NAS_EEA *e, uint32_t count[2]){
+    NASHandler *n = (NASHandler*)h;
+    *i = n->i;
+    *e = n->e;
+    count[0] = n->nas_count[0];
+    count[1] = n->nas_count[1];
+    return n->isValid;
+}
+
+void nas_restoreSecurity(NAS h, const NAS_EIA i, const NAS_EEA e,
+                         const uint8_t *kasme, const uint32_t count[2]){
+    NASHandler *n = (NASHandler*)h;
+
+    nas_setSecurity(h, i, e, kasme);
+    n->nas_count[0] = count[0];
+    n->nas_count[1] = count[1];
+}
+
 int nas_authenticateMsg(const NAS h,
                         const uint8_t *buf, const uint32_t size,
                         const NAS_Direction direction, uint8_t *isAuth){
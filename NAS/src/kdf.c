@@ -0,0 +1,195 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   kdf.c
+ * @brief  3GPP TS 33.401 key derivation functions
+ */
+
+/* The SHA256_* functions are deprecated on OpenSSL 3, the EVP interface
+ * can't copy a state without an allocation*/
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "kdf.h"
+
+void kdf_setKey(KDFKey *k, const uint8_t *key, size_t len){
+    uint8_t pad[SHA256_CBLOCK], hash[SHA256_DIGEST_LENGTH];
+    size_t i;
+
+    /* Longer keys are hashed first (RFC 2104)*/
+    if(len > SHA256_CBLOCK){
+        SHA256(key, len, hash);
+        key = hash;
+        len = SHA256_DIGEST_LENGTH;
+    }
+
+    memset(pad, 0x36, SHA256_CBLOCK);
+    for(i=0; i<len; i++){
+        pad[i] ^= key[i];
+    }
+    SHA256_Init(&k->inner);
+    SHA256_Update(&k->inner, pad, SHA256_CBLOCK);
+
+    memset(pad, 0x5c, SHA256_CBLOCK);
+    for(i=0; i<len; i++){
+        pad[i] ^= key[i];
+    }
+    SHA256_Init(&k->outer);
+    SHA256_Update(&k->outer, pad, SHA256_CBLOCK);
+
+    OPENSSL_cleanse(pad, sizeof(pad));
+    OPENSSL_cleanse(hash, sizeof(hash));
+}
+
+void kdf_clearKey(KDFKey *k){
+    OPENSSL_cleanse(k, sizeof(KDFKey));
+}
+
+void kdf_derive(const KDFKey *k, const uint8_t *s, size_t len,
+                uint8_t *out, size_t outLen){
+    SHA256_CTX ctx;
+    uint8_t d[SHA256_DIGEST_LENGTH];
+
+    ctx = k->inner;
+    SHA256_Update(&ctx, s, len);
+    SHA256_Final(d, &ctx);
+
+    ctx = k->outer;
+    SHA256_Update(&ctx, d, SHA256_DIGEST_LENGTH);
+    SHA256_Final(d, &ctx);
+
+    /* Use least significant bits*/
+    memcpy(out, d + SHA256_DIGEST_LENGTH - outLen, outLen);
+    OPENSSL_cleanse(d, sizeof(d));
+    OPENSSL_cleanse(&ctx, sizeof(ctx));
+}
+
+void kdf_kasme(const uint8_t *ck, const uint8_t *ik, const uint8_t *sn,
+               const uint8_t *sqnAk, uint8_t *kasme){
+    /*
+    -    FC = 0x10,
+    -    P0 = SN id,
+    -    L0 = length of SN id (i.e. 0x00 0x03),
+    -    P1 = SQN ^ AK
+    -    L1 = length of SQN ^ AK (i.e. 0x00 0x06)
+    KEY = CK || IK
+    */
+    KDFKey k;
+    uint8_t key[32], s[14];
+
+    memcpy(key, ck, 16);
+    memcpy(key+16, ik, 16);
+    kdf_setKey(&k, key, 32);
+    OPENSSL_cleanse(key, sizeof(key));
+
+    s[0]=KDF_FC_KASME;
+    memcpy(s+1, sn, 3);
+    s[4]=0x00;
+    s[5]=0x03;
+    memcpy(s+6, sqnAk, 6);
+    s[12]=0x00;
+    s[13]=0x06;
+    kdf_derive(&k, s, 14, kasme, 32);
+    kdf_clearKey(&k);
+}
+
+void kdf_keNB(const KDFKey *kasme, uint32_t ulCount, uint8_t *keNB){
+    /*
+    FC = 0x11,
+    P0 = Uplink NAS COUNT,
+    L0 = length of uplink NAS COUNT (i.e. 0x00 0x04)
+     */
+    uint8_t s[7];
+
+    s[0]=KDF_FC_KENB;
+    s[1]=ulCount>>24;
+    s[2]=ulCount>>16;
+    s[3]=ulCount>>8;
+    s[4]=ulCount;
+    s[5]=0x00;
+    s[6]=0x04;
+    kdf_derive(kasme, s, 7, keNB, 32);
+}
+
+void kdf_nh(const KDFKey *kasme, const uint8_t *sync, uint8_t *nh){
+    /*
+    FC = 0x12
+    P0 = SYNC-input
+    L0 = length of SYNC-input (i.e. 0x00 0x20)
+    */
+    uint8_t s[35];
+
+    s[0]=KDF_FC_NH;
+    memcpy(s+1, sync, 32);
+    s[33]=0x00;
+    s[34]=0x20;
+    kdf_derive(kasme, s, 35, nh, 32);
+}
+
+void kdf_keNBStar(const uint8_t *key, uint16_t pci, uint32_t earfcn,
+                  uint8_t *keNBStar){
+    /*
+    FC = 0x13
+    P0 = Target physical cell id (PCI)
+    L0 = length of PCI (i.e. 0x00 0x02)
+    P1 = EARFCN-DL (target physical cell downlink frequency)
+    L1 = length of EARFCN-DL (i.e. 0x00 0x02, 0x00 0x03 above 65535)
+    */
+    KDFKey k;
+    uint8_t s[10], *p = s;
+
+    *p++ = KDF_FC_KENB_STAR;
+    *p++ = pci>>8;
+    *p++ = pci;
+    *p++ = 0x00;
+    *p++ = 0x02;
+    if(earfcn > 0xFFFF){
+        *p++ = earfcn>>16;
+    }
+    *p++ = earfcn>>8;
+    *p++ = earfcn;
+    *p++ = 0x00;
+    *p++ = earfcn > 0xFFFF ? 0x03 : 0x02;
+
+    kdf_setKey(&k, key, 32);
+    kdf_derive(&k, s, p-s, keNBStar, 32);
+    kdf_clearKey(&k);
+}
+
+void kdf_algKey(const KDFKey *kasme, uint8_t distinguisher, uint8_t algId,
+                uint8_t *k){
+    /*
+    FC = 0x15,
+    P0 = algorithm type distinguisher,
+    L0 = length of algorithm type distinguisher (i.e. 0x00 0x01)
+    P1 = algorithm identity
+    L1 = length of algorithm identity (i.e. 0x00 0x01)
+     */
+    uint8_t s[7];
+
+    s[0]=KDF_FC_ALG_KEY;
+    s[1]=distinguisher;
+    s[2]=0x00;
+    s[3]=0x01;
+    s[4]=algId;
+    s[5]=0x00;
+    s[6]=0x01;
+    kdf_derive(kasme, s, 7, k, 16);
+}
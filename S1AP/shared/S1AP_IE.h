@@ -150,6 +150,46 @@ extern const char *CNDomainName[];
 CNDomain_t* new_CNDomain();
 
 
+/** @brief OverloadResponse
+ *
+ * Clause 9.2.3.19, action the eNB applies on the MME overload
+ *
+ * ASN.1
+ * OverloadResponse ::= CHOICE {
+ *    overloadAction                  OverloadAction,
+ *    ...
+ * }
+ *
+ * OverloadAction ::= ENUMERATED {
+ *    reject-non-emergency-mo-dt,
+ *    reject-rrc-cr-signalling,
+ *    permit-emergency-sessions-and-mobile-terminated-services-only,
+ *    ...,
+ *    permit-high-priority-sessions-and-mobile-terminated-services-only,
+ *    reject-delay-tolerant-access
+ * }
+ */
+typedef struct OverloadResponse_e{
+    void    (*freeIE)(void*);
+    void    (*showIE)(void*);
+    enum{
+        reject_non_emergency_mo_dt,
+        reject_rrc_cr_signalling,
+        permit_emergency_sessions_and_mobile_terminated_services_only,
+        /* Extension values*/
+        permit_high_priority_sessions_and_mobile_terminated_services_only,
+        reject_delay_tolerant_access
+    }overloadAction;
+}OverloadResponse_t;
+
+extern const char *OverloadActionName[];
+
+/** @brief Constructor of OverloadResponse type
+ *  @return OverloadResponse_t allocated  and initialized structure
+ * */
+OverloadResponse_t* new_OverloadResponse();
+
+
 /**@brief PLMN identity structure
  *
  * Clause 9.2.3.8
@@ -35,6 +35,7 @@
 /* Dictionaries*/
 const char *PagingDRXName []  = {"v32", "v64", "v128", "v256"};
 const char *CNDomainName []   = {"ps", "cs"};
+const char *OverloadActionName [] = {"reject-non-emergency-mo-dt", "reject-rrc-cr-signalling", "permit-emergency-sessions-and-mobile-terminated-services-only", "permit-high-priority-sessions-and-mobile-terminated-services-only", "reject-delay-tolerant-access"};
 const char *TypeOfErrorName [] = {"not_understood", "missing" };
 
 /* Cause dictionaries*/
@@ -163,7 +164,7 @@ iEconstructor getconstructor[]={
         (iEconstructor)NULL, /*new_RequestType,*/ /* Not implemented*/
         (iEconstructor)new_UE_S1AP_IDs,
         (iEconstructor)new_EUTRAN_CGI,
-        (iEconstructor)NULL, /*new_OverloadResponse,*/ /* Not implemented*/
+        (iEconstructor)new_OverloadResponse,
         (iEconstructor)NULL, /*new_cdma2000OneXSRVCCInfo,*/ /* Not implemented*/
         (iEconstructor)NULL, /*new_E_RABFailedToBeReleasedList,*/ /* Not implemented*/
         (iEconstructor)new_Unconstrained_Octed_String, /* new_Source_ToTarget_TransparentContainer,*/
@@ -992,6 +993,51 @@ CNDomain_t *new_CNDomain(){
 }
 
 
+/* ********************* OverloadResponse ********************* */
+/** @brief OverloadResponse IE Destructor
+ *
+ * Deallocate the OverloadResponse_t structure.
+ * */
+void free_OverloadResponse(void * data){
+    OverloadResponse_t *self = (OverloadResponse_t*)data;
+    if(!self){
+        return;
+    }
+
+    free(self);
+}
+
+/** @brief Show IE information
+ *
+ * Tool function to print the information on stdout
+ * */
+
+void show_OverloadResponse(void * data){
+    OverloadResponse_t *self = (OverloadResponse_t*)data;
+    printf("\t\t\tOverloadAction = %s\n", OverloadActionName[self->overloadAction]);
+}
+
+/** @brief Constructor of OverloadResponse type
+ *  @return OverloadResponse_t allocated  and initialized structure
+ * */
+
+OverloadResponse_t *new_OverloadResponse(){
+    OverloadResponse_t *self;
+
+    self = malloc(sizeof(OverloadResponse_t));
+    if(!self){
+        s1ap_msg(ERROR, 0, "S1AP OverloadResponse_t not allocated correctly");
+        return NULL;
+    }
+    memset(self, 0, sizeof(OverloadResponse_t));
+
+    self->freeIE=free_OverloadResponse;
+    self->showIE=show_OverloadResponse;
+
+    return self;
+}
+
+
 /* ************************** CSG-Id ************************** */
 
 
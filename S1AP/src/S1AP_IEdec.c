@@ -43,6 +43,7 @@ void dec_MME_UE_S1AP_ID(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes);
 void dec_Global_ENB_ID(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes);
 void dec_TAI(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes);
 void dec_LAI(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes);
+void dec_S_TMSI(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes);
 
 /* ******************** IE decoder functions ******************** */
 
@@ -886,6 +887,37 @@ void dec_PagingDRX(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
     v->pagingDRX = decode_enumerated(bytes, 0, 3);
 }
 
+void dec_OverloadResponse(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
+    OverloadResponse_t *v;
+    uint8_t ext;
+
+    v = new_OverloadResponse();
+
+    /*Link functions*/
+    ie->showValue = v->showIE;
+    ie->freeValue = v->freeIE;
+    ie->value=v;
+
+    /*Get choice extension flag, only overloadAction is known*/
+    getbit(bytes, &ext);
+    if(ext==1){
+        s1ap_msg(WARN, 0, "OverloadResponse extension detected. Not available in current version.");
+        return;
+    }
+
+    /*Get enum extension flag*/
+    getbit(bytes, &ext);
+    if(ext==0){
+        v->overloadAction = decode_enumerated(bytes, 0, 2);
+    }else{
+        v->overloadAction = decode_small_number(bytes) + 3;
+        if(v->overloadAction > reject_delay_tolerant_access){
+            s1ap_msg(WARN, 0, "Unknown OverloadAction extension value");
+            v->overloadAction = reject_non_emergency_mo_dt;
+        }
+    }
+}
+
 void dec_CNDomain(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
     CNDomain_t *v;
 
@@ -2025,6 +2057,7 @@ void dec_SecurityContext(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
 }
 
 void dec_UEPagingID(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
+    S1AP_PROTOCOL_IES_t fakeIE;
     UEPagingID_t *v = new_UEPagingID();
     ie->value=v;
 
@@ -2042,7 +2075,8 @@ void dec_UEPagingID(S1AP_PROTOCOL_IES_t * ie, struct BinaryData *bytes){
     //align_dec(bytes);
     switch(v->choice+v->ext*2){
     case 0: /*S-TMSI*/
-        v->id.s_TMSI;
+        dec_S_TMSI(&fakeIE, bytes);
+        v->id.s_TMSI = (S_TMSI_t*)fakeIE.value;
         break;
     case 1: /* IMSI*/
         s1ap_msg(ERROR, 0, "Paging IMSI decoder not implemented\n");
@@ -2380,7 +2414,7 @@ const getDecS1AP_IE getdec_S1AP_IE[] = {
         NULL,/*"id-RequestType"*/
         dec_UE_S1AP_IDs,/*"id-UE-S1AP-IDs"*/
         dec_EUTRAN_CGI,/*"id-EUTRAN-CGI"*/
-        NULL,/*"id-OverloadResponse"*/
+        dec_OverloadResponse,/*"id-OverloadResponse"*/
         NULL,/*"id-cdma2000OneXSRVCCInfo"*/
         NULL,/*"id-E-RABFailedToBeReleasedList"*/
         dec_Unconstrained_Octed_String,/*"id-Source-ToTarget-TransparentContainer"*/
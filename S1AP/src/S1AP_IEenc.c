@@ -683,6 +683,22 @@ void enc_CNDomain(struct BinaryData *bytes, S1AP_PROTOCOL_IES_t * ie){
     encode_constrained_number(bytes, v->domain, 0, 1);
 }
 
+void enc_OverloadResponse(struct BinaryData *bytes, S1AP_PROTOCOL_IES_t * ie){
+    OverloadResponse_t *v =  (OverloadResponse_t *)ie->value;
+
+    /*Choice overloadAction, root alternative*/
+    set_choice_ext(bytes, 0, 1, 0);
+
+    /*Set extension flag & set enum value*/
+    if(v->overloadAction <= permit_emergency_sessions_and_mobile_terminated_services_only){
+        setbits(bytes, 1, 0);
+        encode_constrained_number(bytes, v->overloadAction, 0, 2);
+    }else{
+        setbits(bytes, 1, 1);
+        encode_small_number(bytes, v->overloadAction - 3);
+    }
+}
+
 void enc_CSGid(struct BinaryData *bytes, S1AP_PROTOCOL_IES_t * ie){
     cSG_id_t *v = (cSG_id_t*)ie->value;
     setbits(bytes, 27, v->id);
@@ -1872,7 +1888,7 @@ const getEncS1AP_IE getenc_S1AP_IE[] = {
         NULL,/*"id-RequestType"*/
         enc_UE_S1AP_IDs,/*"id-UE-S1AP-IDs"*/
         enc_EUTRAN_CGI,/*"id-EUTRAN-CGI"*/
-        NULL,/*"id-OverloadResponse"*/
+        enc_OverloadResponse,/*"id-OverloadResponse"*/
         NULL,/*"id-cdma2000OneXSRVCCInfo"*/
         NULL,/*"id-E-RABFailedToBeReleasedList"*/
         enc_Unconstrained_Octed_String,/*"id-Source-ToTarget-TransparentContainer"*/
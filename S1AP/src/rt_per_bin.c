@@ -411,17 +411,19 @@ uint16_t decode_length_undef(struct BinaryData *bytes){
 
 
 uint32_t decode_semi_constrained_number (struct BinaryData *bytes, uint8_t Lb){
-    uint32_t val = 0;
+    uint32_t val = 0, i;
+    uint8_t buffer[sizeof(val)] = {0};
     struct BinaryData bits;
     uint16_t len = decode_length_undef(bytes);
+    if(len > sizeof(val)){
+        s1ap_msg(ERROR, 0, "Semi-constrained number of %u bytes not supported", len);
+        return Lb;
+    }
+    bits.data = buffer;
     getoctets(&bits, bytes, len);
-    if(bits.length<=32){
-        if(bits.length%8){
-            memcpy(&val, &bits, bits.length/8);
-        }
-        else{
-            memcpy(&val, &bits, bits.length/8 +1);
-        }
+    /* Big endian octets*/
+    for(i=0; i<len; i++){
+        val = val<<8 | buffer[i];
     }
     return val + Lb;
     /*
@@ -456,19 +458,10 @@ uint32_t getchoice(struct BinaryData *bytes, uint8_t numChoices, uint8_t ext){
 
 uint32_t decode_small_number(struct BinaryData *bytes){
     uint8_t bit;
-    uint32_t res, len;
-    struct BinaryData bits;
+    uint32_t res;
     getbit(bytes, &bit);
     if( bit == 0){
-        getbits(&bits, bytes, 6);
-        if((bits.length%8 == 0))
-            len= (bits.length/8);
-        else
-            len = (bits.length/8) + 1;
-        memcpy(&res, &bits, len);
-        if(bits.pos!=0){
-            res<<=bits.pos;
-        }
+        res = decode_constrained_number(bytes, 0, 63);
     }else{
             res = decode_semi_constrained_number(bytes, 0);
     }
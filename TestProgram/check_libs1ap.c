@@ -217,6 +217,129 @@ START_TEST (enc_UEAggregateMaximumBitrate_tc2)
 }
 END_TEST
 
+START_TEST (enc_dec_OverloadStart_tc)
+{
+    S1AP_Message_t *msg, *dec;
+    OverloadResponse_t *rsp;
+    uint8_t data[50];
+    uint32_t len;
+    int action;
+
+    /* The last two actions are extension values*/
+    for(action = reject_non_emergency_mo_dt;
+        action <= reject_delay_tolerant_access; action++){
+        memset(data, 0, 50);
+        len = 0;
+        msg = S1AP_newMsg();
+        msg->choice = initiating_message;
+        msg->pdu->procedureCode = id_OverloadStart;
+        msg->pdu->criticality = ignore;
+        rsp = s1ap_newIE(msg, id_OverloadResponse, mandatory, reject);
+        rsp->overloadAction = action;
+
+        s1ap_encode(data, &len, msg);
+        msg->freemsg(msg);
+        ck_assert_msg(len > 0, "Overload Start not encoded");
+
+        dec = s1ap_decode(data, len);
+        ck_assert_msg(dec != NULL, "Overload Start not decoded");
+        ck_assert_msg(dec->pdu->procedureCode == id_OverloadStart,
+                      "Procedure code %u != %u", dec->pdu->procedureCode,
+                      id_OverloadStart);
+        rsp = s1ap_findIe(dec, id_OverloadResponse);
+        ck_assert_msg(rsp != NULL, "OverloadResponse not decoded");
+        ck_assert_msg(rsp->overloadAction == action,
+                      "OverloadAction %u != %u", rsp->overloadAction, action);
+        dec->freemsg(dec);
+    }
+}
+END_TEST
+
+START_TEST (enc_dec_OverloadStop_tc)
+{
+    S1AP_Message_t *msg, *dec;
+    uint8_t data[50];
+    uint32_t len = 0;
+
+    memset(data, 0, 50);
+    msg = S1AP_newMsg();
+    msg->choice = initiating_message;
+    msg->pdu->procedureCode = id_OverloadStop;
+    msg->pdu->criticality = reject;
+
+    s1ap_encode(data, &len, msg);
+    msg->freemsg(msg);
+    ck_assert_msg(len > 0, "Overload Stop not encoded");
+
+    dec = s1ap_decode(data, len);
+    ck_assert_msg(dec != NULL, "Overload Stop not decoded");
+    ck_assert_msg(dec->choice == initiating_message, "Not an initiating message");
+    ck_assert_msg(dec->pdu->procedureCode == id_OverloadStop,
+                  "Procedure code %u != %u", dec->pdu->procedureCode,
+                  id_OverloadStop);
+    ck_assert_msg(s1ap_findIe(dec, id_OverloadResponse) == NULL,
+                  "Unexpected OverloadResponse");
+    dec->freemsg(dec);
+}
+END_TEST
+
+START_TEST (enc_dec_Paging_STMSI_tc)
+{
+    S1AP_Message_t *msg, *dec;
+    UEIdentityIndexValue_t *ueId;
+    UEPagingID_t *pagingId;
+    CNDomain_t *dom;
+    TAIList_t *tais;
+    TAIItem_t *tai;
+    uint8_t data[100];
+    uint32_t len = 0;
+    const uint8_t mtmsi[] = {0xC0, 0x00, 0x12, 0x34};
+
+    memset(data, 0, 100);
+    msg = S1AP_newMsg();
+    msg->choice = initiating_message;
+    msg->pdu->procedureCode = id_Paging;
+    msg->pdu->criticality = ignore;
+
+    ueId = s1ap_newIE(msg, id_UEIdentityIndexValue, mandatory, ignore);
+    ueId->id = 1;
+    pagingId = s1ap_newIE(msg, id_UEPagingID, mandatory, ignore);
+    pagingId->choice = 0;
+    pagingId->id.s_TMSI = new_S_TMSI();
+    pagingId->id.s_TMSI->mMEC->s[0] = 0x5a;
+    memcpy(pagingId->id.s_TMSI->m_TMSI.s, mtmsi, 4);
+    dom = s1ap_newIE(msg, id_CNDomain, mandatory, ignore);
+    dom->domain = ps;
+    tais = s1ap_newIE(msg, id_TAIList, mandatory, ignore);
+    tai = tais->newItem(tais);
+    tai->tAI->pLMNidentity = new_PLMNidentity();
+    tai->tAI->pLMNidentity->MCC = 1;
+    tai->tAI->pLMNidentity->MNC = 1;
+    tai->tAI->tAC->s[1] = 0x01;
+
+    s1ap_encode(data, &len, msg);
+    msg->freemsg(msg);
+    ck_assert_msg(len > 0, "Paging not encoded");
+
+    dec = s1ap_decode(data, len);
+    ck_assert_msg(dec != NULL, "Paging not decoded");
+    pagingId = s1ap_findIe(dec, id_UEPagingID);
+    ck_assert_msg(pagingId != NULL, "UEPagingID not decoded");
+    ck_assert_msg(pagingId->choice == 0, "UEPagingID choice %u != S-TMSI",
+                  pagingId->choice);
+    ck_assert_msg(pagingId->id.s_TMSI != NULL, "S-TMSI not decoded");
+    ck_assert_msg(pagingId->id.s_TMSI->mMEC->s[0] == 0x5a,
+                  "MMEC %#x != 0x5a", pagingId->id.s_TMSI->mMEC->s[0]);
+    ck_assert_msg(memcmp(pagingId->id.s_TMSI->m_TMSI.s, mtmsi, 4) == 0,
+                  "M-TMSI %02x%02x%02x%02x != c0001234",
+                  pagingId->id.s_TMSI->m_TMSI.s[0],
+                  pagingId->id.s_TMSI->m_TMSI.s[1],
+                  pagingId->id.s_TMSI->m_TMSI.s[2],
+                  pagingId->id.s_TMSI->m_TMSI.s[3]);
+    dec->freemsg(dec);
+}
+END_TEST
+
 Suite *
 s1p_suite (void)
 {
@@ -228,18 +351,25 @@ s1p_suite (void)
     TCase *tc_UE_MME_ID = tcase_create ("MME_UE_S1AP_ID_tc");
     TCase *tc_UEAggregateMaximumBitrate1 = tcase_create ("UEAggregateMaximumBitrate_tc1");
     TCase *tc_UEAggregateMaximumBitrate2 = tcase_create ("UEAggregateMaximumBitrate_tc2");
+    TCase *tc_Overload = tcase_create ("Overload_tc");
+    TCase *tc_Paging = tcase_create ("Paging_tc");
 
     tcase_add_test (tc_Global_ENB_ID, dec_Global_ENB_ID_tc);
     tcase_add_test (tc_ENBname, dec_ENBname_tc);
     tcase_add_test (tc_UE_MME_ID, enc_MME_UE_S1AP_ID_tc);
     tcase_add_test (tc_UEAggregateMaximumBitrate1, enc_UEAggregateMaximumBitrate_tc1);
     tcase_add_test (tc_UEAggregateMaximumBitrate2, enc_UEAggregateMaximumBitrate_tc2);
+    tcase_add_test (tc_Overload, enc_dec_OverloadStart_tc);
+    tcase_add_test (tc_Overload, enc_dec_OverloadStop_tc);
+    tcase_add_test (tc_Paging, enc_dec_Paging_STMSI_tc);
 
     suite_add_tcase (s, tc_Global_ENB_ID);
     suite_add_tcase (s, tc_ENBname);
     suite_add_tcase (s, tc_UE_MME_ID);
     suite_add_tcase (s, tc_UEAggregateMaximumBitrate1);
     suite_add_tcase (s, tc_UEAggregateMaximumBitrate2);
+    suite_add_tcase (s, tc_Overload);
+    suite_add_tcase (s, tc_Paging);
 
     return s;
 }
@@ -25,6 +25,7 @@
 #include "check_nas.h"
 
 #include "NAS.h"
+#include "NASConstants.h"
 
 /* strcmp*/
 #include <string.h>
@@ -98,6 +99,109 @@ START_TEST (temp)
 }
 END_TEST
 
+static const uint8_t kasme[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+
+/* Integrity protected message of one direction, checked by a peer handler*/
+static void check_secMsg(NAS_Direction direction){
+    NAS enc, peer;
+    NAS_EIA i;
+    NAS_EEA e;
+    uint8_t out[50], isAuth = 0;
+    uint8_t plain[] = {0x07, 0x46};   /* Detach Accept*/
+    uint32_t count[2];
+    size_t len = 0;
+
+    enc = nas_newHandler();
+    peer = nas_newHandler();
+    nas_setSecurity(enc, NAS_EIA2, NAS_EEA0, kasme);
+    nas_setSecurity(peer, NAS_EIA2, NAS_EEA0, kasme);
+
+    ck_assert_msg(newNASMsg_sec(enc, out, &len, EPSMobilityManagementMessages,
+                                IntegrityProtected, direction,
+                                plain, sizeof(plain)) == 1,
+                  "Message not encoded");
+    ck_assert_msg(len == 6 + sizeof(plain), "Length %u != %u", len,
+                  6 + sizeof(plain));
+    ck_assert_msg(out[0] == (IntegrityProtected<<4 | EPSMobilityManagementMessages),
+                  "Security header %#x", out[0]);
+    ck_assert_msg(out[5] == 0, "NAS SQN %u != 0", out[5]);
+    ck_assert_msg(memcmp(out+6, plain, sizeof(plain)) == 0, "Payload changed");
+
+    /* Only the COUNT of the direction used is incremented*/
+    nas_getSecurity(enc, &i, &e, count);
+    ck_assert_msg(count[direction] == 1, "COUNT %u != 1", count[direction]);
+    ck_assert_msg(count[!direction] == 0, "COUNT of the other direction %u != 0",
+                  count[!direction]);
+
+    /* The direction is part of the MAC*/
+    ck_assert_msg(nas_authenticateMsg(peer, out, len, !direction, &isAuth) == 1,
+                  "Not checked");
+    ck_assert_msg(isAuth == 0, "MAC valid on the other direction");
+    ck_assert_msg(nas_authenticateMsg(peer, out, len, direction, &isAuth) == 1,
+                  "Not checked");
+    ck_assert_msg(isAuth == 1, "MAC not valid");
+
+    nas_freeHandler(enc);
+    nas_freeHandler(peer);
+}
+
+START_TEST (test_secMsg_uplink)
+{
+    check_secMsg(NAS_UpLink);
+}
+END_TEST
+
+START_TEST (test_secMsg_downlink)
+{
+    check_secMsg(NAS_DownLink);
+}
+END_TEST
+
+START_TEST (test_serviceRequest_enc)
+{
+    NAS ue, mme;
+    NAS_EIA i;
+    NAS_EEA e;
+    uint8_t out[4], isAuth = 0;
+    uint32_t count[2];
+    size_t len = 0;
+    int n;
+
+    ue = nas_newHandler();
+    mme = nas_newHandler();
+    nas_setSecurity(ue, NAS_EIA2, NAS_EEA0, kasme);
+    nas_setSecurity(mme, NAS_EIA2, NAS_EEA0, kasme);
+
+    /* The short NAS SQN has 5 bits*/
+    for(n=0; n<34; n++){
+        ck_assert_msg(newNASMsg_service(ue, out, &len, 3) == 1,
+                      "Service Request not encoded");
+        ck_assert_msg(len == 4, "Length %u != 4", len);
+        ck_assert_msg(out[0] == (SecurityHeaderForServiceRequestMessage<<4
+                                 | EPSMobilityManagementMessages),
+                      "Security header %#x", out[0]);
+        ck_assert_msg(out[1]>>5 == 3, "KSI %u != 3", out[1]>>5);
+        ck_assert_msg((out[1]&0x1F) == (n&0x1F), "Short SQN %u != %u",
+                      out[1]&0x1F, n&0x1F);
+        ck_assert_msg(nas_authenticateMsg(mme, out, len, NAS_UpLink,
+                                          &isAuth) == 1, "Not checked");
+        ck_assert_msg(isAuth == 1, "Short MAC not valid on COUNT %u", n);
+    }
+    nas_getSecurity(ue, &i, &e, count);
+    ck_assert_msg(count[NAS_UpLink] == 34, "Uplink COUNT %u != 34",
+                  count[NAS_UpLink]);
+    ck_assert_msg(count[NAS_DownLink] == 0, "Downlink COUNT %u != 0",
+                  count[NAS_DownLink]);
+
+    nas_freeHandler(ue);
+    nas_freeHandler(mme);
+}
+END_TEST
+
 
 Suite *
 nas_suite (void)
@@ -107,10 +211,15 @@ nas_suite (void)
     /* Version test case */
     TCase *tc_IE_lv_t6 = tcase_create ("IE lv type 6");
     TCase *tc_tmp = tcase_create ("temp");
+    TCase *tc_sec = tcase_create ("Security header");
     tcase_add_test (tc_IE_lv_t6, test_IE_lv_t6_enc);
     tcase_add_test (tc_tmp, temp);
+    tcase_add_test (tc_sec, test_secMsg_uplink);
+    tcase_add_test (tc_sec, test_secMsg_downlink);
+    tcase_add_test (tc_sec, test_serviceRequest_enc);
     suite_add_tcase (s, tc_IE_lv_t6);
     suite_add_tcase (s, tc_tmp);
+    suite_add_tcase (s, tc_sec);
 
 
     return s;
@@ -242,6 +242,38 @@ START_TEST (decode_constrained_number2_tc)
 }
 END_TEST
 
+START_TEST (decode_small_number1_tc)
+{
+    struct BinaryData bytes;
+    uint8_t data[1]={0x0a};
+    uint32_t c;
+    bytes.pos=0;
+    bytes.length=8;
+    bytes.data=data;
+    c = decode_small_number(&bytes);
+
+    ck_assert_msg(c == 5, "%u != 5", c);
+    ck_assert_msg(bytes.pos == 7, "pos %u != 7", bytes.pos);
+
+}
+END_TEST
+
+START_TEST (decode_small_number2_tc)
+{
+    struct BinaryData bytes;
+    uint8_t data[4]={0x80, 0x02, 0x01, 0x2c};
+    uint32_t c;
+    bytes.pos=0;
+    bytes.length=32;
+    bytes.data=data;
+    c = decode_small_number(&bytes);
+
+    ck_assert_msg(c == 300, "%u != 300", c);
+    ck_assert_msg(bytes.length == 0, "%u bits left != 0", bytes.length);
+
+}
+END_TEST
+
 START_TEST (decode_bit_string_tc)
 {
     uint32_t res=0;
@@ -268,6 +300,7 @@ per_suite (void)
     TCase *tc_string = tcase_create ("decode_octet_string_tc");
     TCase *tc_getbits = tcase_create ("getbits_tc");
     TCase *tc_decode_constrained_number = tcase_create ("decode_constrained_number_tc");
+    TCase *tc_decode_small_number = tcase_create ("decode_small_number_tc");
     TCase *tc_decode_bit_string = tcase_create ("decode_bit_string_tc");
 
     tcase_add_test (tc_string, decode_octet_string_tc);
@@ -282,11 +315,14 @@ per_suite (void)
 
     tcase_add_test (tc_decode_constrained_number, decode_constrained_number1_tc);
     tcase_add_test (tc_decode_constrained_number, decode_constrained_number2_tc);
+    tcase_add_test (tc_decode_small_number, decode_small_number1_tc);
+    tcase_add_test (tc_decode_small_number, decode_small_number2_tc);
     tcase_add_test (tc_decode_bit_string, decode_bit_string_tc);
 
     suite_add_tcase (s, tc_string);
     suite_add_tcase (s, tc_getbits);
     suite_add_tcase (s, tc_decode_constrained_number);
+    suite_add_tcase (s, tc_decode_small_number);
     suite_add_tcase (s, tc_decode_bit_string);
 
 
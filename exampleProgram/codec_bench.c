@@ -0,0 +1,607 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   codec_bench.c
+ * @brief  S1AP, NAS and GTPv2-C codec micro-benchmarks
+ *
+ * Times the decoding and encoding of a corpus of messages with the contents
+ * the MME and the eNBs use during an attach: InitialUEMessage, Initial
+ * Context Setup Request and Paging (libs1ap), Attach Request (libnas) and
+ * Create Session Request and Response (libgtp). The corpus is built with the
+ * same library calls used by the MME, so it follows the encoders.
+ *
+ * Decoding includes releasing the decoded message, encoding starts from the
+ * structures the MME fills in. Each case is calibrated to run at least the
+ * minimum time and repeated, the median run is reported. The allocations
+ * are counted replacing malloc, calloc and realloc (glibc only, -1
+ * otherwise).
+ *
+ * One CSV line per case is written to stdout:
+ *   version,codec,message,op,bytes,iterations,ns_per_msg,allocs_per_msg
+ *
+ * Usage: codec_bench [-c s1ap|nas|gtp] [-t min_ms] [-r runs] [-H]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "S1AP.h"
+#include "NAS.h"
+#include "NASConstants.h"
+#include "gtp.h"
+#include "gtpie.h"
+
+#ifndef MME_VERSION
+#define MME_VERSION "unknown"
+#endif
+
+#define MAX_PDU   2000
+#define MAX_RUNS  15
+
+/* ====================================================================== */
+/* Allocation counter                                                     */
+
+static uint64_t allocs = 0;
+
+#ifdef __GLIBC__
+#define HAVE_ALLOC_COUNT 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size){
+    allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size){
+    allocs++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size){
+    allocs++;
+    return __libc_realloc(p, size);
+}
+#endif
+
+static uint64_t now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* ====================================================================== */
+/* Corpus                                                                 */
+
+typedef struct{
+    const char *codec;
+    const char *name;
+    uint8_t    buf[MAX_PDU];    /**< Encoded message*/
+    uint32_t   len;
+    void       *ctx;            /**< Encoder input, owned by the case*/
+    void       (*decode)(void *c);
+    void       (*encode)(void *c);
+}Case_t;
+
+static uint8_t out[MAX_PDU];
+static uint32_t outLen;
+static volatile uint32_t sink;  /**< Keeps the results alive*/
+
+static void set_plmn(PLMNidentity_t **p){
+    *p = new_PLMNidentity();
+    (*p)->MCC = 1;
+    (*p)->MNC = 1;
+}
+
+/**
+ * Attach Request with a PDN Connectivity Request, as sent by the UEs*/
+static uint32_t nas_attachRequest(uint8_t *buf){
+    uint8_t esm[50], *pointer = buf, *pointer2 = esm;
+    static const uint8_t imsi[] = {0x09, 0x10, 0x10, 0x00, 0x00,
+                                   0x00, 0x00, 0x10};
+    static const uint8_t netCap[] = {0xe0, 0xe0, 0xc0, 0xc0};
+    static const uint8_t drx[] = {0x00, 0x0a};
+
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, AttachRequest);
+    nasIe_v_t1_l(&pointer, 1);
+    nasIe_v_t1_h(&pointer, 7);
+    nasIe_lv_t4(&pointer, imsi, sizeof(imsi));
+    nasIe_lv_t4(&pointer, netCap, sizeof(netCap));
+
+    newNASMsg_ESM(&pointer2, EPSSessionManagementMessages, 0);
+    encaps_ESM(&pointer2, 1, PDNConnectivityRequest);
+    nasIe_v_t1_l(&pointer2, 1);
+    nasIe_v_t1_h(&pointer2, 1);
+    nasIe_lv_t6(&pointer, esm, pointer2-esm);
+
+    /* DRX parameter*/
+    nasIe_tv_t3(&pointer, 0x5C, drx, sizeof(drx));
+    return pointer - buf;
+}
+
+static S1AP_Message_t *s1_initialUEMessage(){
+    S1AP_Message_t *s1msg;
+    ENB_UE_S1AP_ID_t *eNBUEId;
+    Unconstrained_Octed_String_t *nAS_PDU;
+    TAI_t *tAI;
+    EUTRAN_CGI_t *ecgi;
+    RRC_Establishment_Cause_t *cause;
+    static uint8_t nas[200];
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_initialUEMessage;
+    s1msg->pdu->criticality = ignore;
+
+    eNBUEId = s1ap_newIE(s1msg, id_eNB_UE_S1AP_ID, mandatory, reject);
+    eNBUEId->eNB_id = 1;
+
+    nAS_PDU = s1ap_newIE(s1msg, id_NAS_PDU, mandatory, reject);
+    nAS_PDU->len = nas_attachRequest(nas);
+    nAS_PDU->str = nas;
+
+    tAI = s1ap_newIE(s1msg, id_TAI, mandatory, reject);
+    set_plmn(&tAI->pLMNidentity);
+    tAI->tAC->s[0] = 0x00;
+    tAI->tAC->s[1] = 0x01;
+
+    ecgi = s1ap_newIE(s1msg, id_EUTRAN_CGI, mandatory, ignore);
+    set_plmn(&ecgi->pLMNidentity);
+    ecgi->cell_ID.id = 0x0000101;
+
+    cause = s1ap_newIE(s1msg, id_RRC_Establishment_Cause, mandatory, ignore);
+    cause->cause.noext = RRC_mo_Signalling;
+    return s1msg;
+}
+
+/**
+ * Initial Context Setup Request as built by ecm_sendCtxtSUReq, with the
+ * Attach Accept*/
+static S1AP_Message_t *s1_initialContextSetup(){
+    S1AP_Message_t *s1msg;
+    MME_UE_S1AP_ID_t *mmeUEId;
+    ENB_UE_S1AP_ID_t *eNBUEId;
+    UEAggregateMaximumBitrate_t *ambr;
+    E_RABToBeSetupListCtxtSUReq_t *list;
+    E_RABToBeSetupItemCtxtSUReq_t *eRABitem;
+    UESecurityCapabilities_t *sec;
+    SecurityKey_t *key;
+    uint32_t addr = htonl(0x7F000002), teid = htonl(0x1001);
+    static uint8_t nas[100];
+    uint32_t i;
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_InitialContextSetup;
+    s1msg->pdu->criticality = reject;
+
+    mmeUEId = s1ap_newIE(s1msg, id_MME_UE_S1AP_ID, mandatory, reject);
+    mmeUEId->mme_id = 1;
+    eNBUEId = s1ap_newIE(s1msg, id_eNB_UE_S1AP_ID, mandatory, reject);
+    eNBUEId->eNB_id = 1;
+
+    ambr = s1ap_newIE(s1msg, id_uEaggregateMaximumBitrate, mandatory, reject);
+    ambr->uEaggregateMaximumBitRateDL.rate = 100000;
+    ambr->uEaggregateMaximumBitRateUL.rate = 100000;
+
+    list = s1ap_newIE(s1msg, id_E_RABToBeSetupListCtxtSUReq, mandatory, reject);
+    eRABitem = list->newItem(list);
+    eRABitem->eRABlevelQoSParameters = new_E_RABLevelQoSParameters();
+    eRABitem->transportLayerAddress = new_TransportLayerAddress();
+    eRABitem->eRABlevelQoSParameters->allocationRetentionPriority =
+        new_AllocationAndRetentionPriority();
+
+    /* Secured Attach Accept sized payload*/
+    for(i=0; i<sizeof(nas); i++){
+        nas[i] = i;
+    }
+    eRABitem->opt |= 0x80;
+    eRABitem->nAS_PDU = new_Unconstrained_Octed_String();
+    eRABitem->nAS_PDU->str = nas;
+    eRABitem->nAS_PDU->len = 78;
+
+    eRABitem->eRAB_ID.id = 5;
+    eRABitem->eRABlevelQoSParameters->qCI = 9;
+    eRABitem->eRABlevelQoSParameters->allocationRetentionPriority->priorityLevel = 15;
+    memcpy(eRABitem->transportLayerAddress->addr, &addr, 4);
+    eRABitem->transportLayerAddress->len = 32;
+    memcpy(eRABitem->gTP_TEID.teid, &teid, 4);
+
+    sec = s1ap_newIE(s1msg, id_UESecurityCapabilities, mandatory, reject);
+    sec->encryptionAlgorithms.v = 0xe0<<8;
+    sec->integrityProtectionAlgorithms.v = 0xe0<<8;
+
+    key = s1ap_newIE(s1msg, id_SecurityKey, mandatory, reject);
+    for(i=0; i<32; i++){
+        key->key[i] = 0xA0 + i;
+    }
+    return s1msg;
+}
+
+/**
+ * Paging as built by the S1 association*/
+static S1AP_Message_t *s1_paging(){
+    S1AP_Message_t *s1msg;
+    UEIdentityIndexValue_t *ue_id;
+    UEPagingID_t *p_id;
+    CNDomain_t *dom;
+    TAIList_t *tais;
+    TAIItem_t *tai;
+    static const uint8_t mtmsi[] = {0xC0, 0x00, 0x12, 0x34};
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_Paging;
+    s1msg->pdu->criticality = ignore;
+
+    ue_id = s1ap_newIE(s1msg, id_UEIdentityIndexValue, mandatory, ignore);
+    ue_id->id = 1010000000001ULL%1024;
+
+    p_id = s1ap_newIE(s1msg, id_UEPagingID, mandatory, ignore);
+    p_id->choice = 0;
+    p_id->id.s_TMSI = new_S_TMSI();
+    p_id->id.s_TMSI->mMEC->s[0] = 1;
+    memcpy(p_id->id.s_TMSI->m_TMSI.s, mtmsi, 4);
+
+    dom = s1ap_newIE(s1msg, id_CNDomain, mandatory, ignore);
+    dom->domain = ps;
+
+    tais = s1ap_newIE(s1msg, id_TAIList, mandatory, ignore);
+    tai = tais->newItem(tais);
+    set_plmn(&tai->tAI->pLMNidentity);
+    tai->tAI->tAC->s[0] = 0x00;
+    tai->tAI->tAC->s[1] = 0x01;
+    return s1msg;
+}
+
+static void s1_decode(void *c){
+    Case_t *k = (Case_t *)c;
+    S1AP_Message_t *s1msg = s1ap_decode(k->buf, k->len);
+    sink += s1msg->pdu->procedureCode;
+    s1msg->freemsg(s1msg);
+}
+
+static void s1_encode(void *c){
+    Case_t *k = (Case_t *)c;
+    outLen = 0;
+    s1ap_encode(out, &outLen, (S1AP_Message_t *)k->ctx);
+    sink += outLen;
+}
+
+static void s1_case(Case_t *k, const char *name, S1AP_Message_t *s1msg){
+    k->codec = "s1ap";
+    k->name = name;
+    k->len = 0;
+    s1ap_encode(k->buf, &k->len, s1msg);
+    s1msg->freemsg(s1msg);
+    /* The encoder input is the decoded corpus message*/
+    k->ctx = s1ap_decode(k->buf, k->len);
+    k->decode = s1_decode;
+    k->encode = s1_encode;
+}
+
+static void nas_decode(void *c){
+    Case_t *k = (Case_t *)c;
+    GenericNASMsg_t msg;
+    dec_NAS(&msg, k->buf, k->len);
+    sink += msg.plain.eMM.messageType;
+}
+
+static void nas_encode(void *c){
+    sink += nas_attachRequest(out);
+}
+
+static void nas_case(Case_t *k){
+    k->codec = "nas";
+    k->name = "AttachRequest";
+    k->len = nas_attachRequest(k->buf);
+    k->ctx = NULL;
+    k->decode = nas_decode;
+    k->encode = nas_encode;
+}
+
+/* GTPv2-C messages are encoded from an array of IEs, as in S11_User.c*/
+typedef struct{
+    uint8_t             type;
+    union gtpie_member  ie[16];
+    uint32_t            n;
+}GtpMsg_t;
+
+static void gtp_fteid(union gtpie_member *ie, uint8_t instance,
+                      uint8_t iface, uint32_t teid, uint32_t addr){
+    struct fteid_t fteid;
+
+    memset(&fteid, 0, sizeof(fteid));
+    fteid.ipv4 = 1;
+    fteid.ipv6 = 0;
+    fteid.iface = hton8(iface);
+    fteid.teid = hton32(teid);
+    fteid.addr.addrv4 = htonl(addr);
+    ie->tliv.i = instance;
+    ie->tliv.t = GTPV2C_IE_FTEID;
+    ie->tliv.l = hton16(FTEID_IP4_SIZE);
+    memcpy(ie->tliv.v, &fteid, FTEID_IP4_SIZE);
+}
+
+static void gtp_ie(union gtpie_member *ie, uint8_t type, uint8_t instance,
+                   const void *v, uint16_t len){
+    ie->tliv.i = instance;
+    ie->tliv.t = type;
+    ie->tliv.l = hton16(len);
+    memcpy(ie->tliv.v, v, len);
+}
+
+static void gtp_createSessionReq(GtpMsg_t *m){
+    union gtpie_member bc[2];
+    struct qos_t qos;
+    uint32_t len, ambr[2] = {htonl(100000), htonl(100000)};
+    static const uint8_t sn[] = {0x00, 0xf1, 0x10};
+    static const uint8_t apn[] = {8, 'i','n','t','e','r','n','e','t'};
+    static const uint8_t paa[] = {0x01, 0, 0, 0, 0};
+    uint8_t b;
+
+    memset(m, 0, sizeof(GtpMsg_t));
+    memset(bc, 0, sizeof(bc));
+    m->type = GTP2_CREATE_SESSION_REQ;
+
+    m->ie[m->n].tliv.t = GTPV2C_IE_IMSI;
+    dec2tbcd(m->ie[m->n].tliv.v, &len, 1010000000001ULL);
+    m->ie[m->n++].tliv.l = hton16(len);
+    m->ie[m->n].tliv.t = GTPV2C_IE_MSISDN;
+    dec2tbcd(m->ie[m->n].tliv.v, &len, 358507777001ULL);
+    m->ie[m->n++].tliv.l = hton16(len);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_SERVING_NETWORK, 0, sn, 3);
+    b = 6;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_RAT_TYPE, 0, &b, 1);
+    gtp_fteid(&m->ie[m->n++], 0, S11_MME, 1, 0x7F000001);
+    gtp_fteid(&m->ie[m->n++], 1, S5S8C_PGW, 0, 0x7F000003);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_APN, 0, apn, sizeof(apn));
+    b = 1;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_SELECTION_MODE, 0, &b, 1);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_PDN_TYPE, 0, &b, 1);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_PAA, 0, paa, sizeof(paa));
+    b = 0;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_APN_RESTRICTION, 0, &b, 1);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_AMBR, 0, ambr, 8);
+
+    b = 5;
+    gtp_ie(&bc[0], GTPV2C_IE_EBI, 0, &b, 1);
+    memset(&qos, 0, sizeof(qos));
+    qos.qci = 9;
+    gtp_ie(&bc[1], GTPV2C_IE_BEARER_LEVEL_QOS, 0, &qos, sizeof(qos));
+    gtp2ie_encaps_group(GTPV2C_IE_BEARER_CONTEXT, 0, &m->ie[m->n++], bc, 2);
+
+    b = 1;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_RECOVERY, 0, &b, 1);
+}
+
+static void gtp_createSessionRsp(GtpMsg_t *m){
+    union gtpie_member bc[3];
+    static const uint8_t cause[] = {GTPV2C_CAUSE_REQUEST_ACCEPTED, 0};
+    static const uint8_t paa[] = {0x01, 10, 0, 0, 1};
+    uint8_t b;
+
+    memset(m, 0, sizeof(GtpMsg_t));
+    memset(bc, 0, sizeof(bc));
+    m->type = GTP2_CREATE_SESSION_RSP;
+
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_CAUSE, 0, cause, 2);
+    gtp_fteid(&m->ie[m->n++], 0, S11S4_SGW, 0x1001, 0x7F000002);
+    gtp_fteid(&m->ie[m->n++], 1, S5S8C_PGW, 0x2001, 0x7F000003);
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_PAA, 0, paa, sizeof(paa));
+    b = 0;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_APN_RESTRICTION, 0, &b, 1);
+
+    b = 5;
+    gtp_ie(&bc[0], GTPV2C_IE_EBI, 0, &b, 1);
+    gtp_ie(&bc[1], GTPV2C_IE_CAUSE, 0, cause, 2);
+    gtp_fteid(&bc[2], 0, S1U_SGW, 0x3001, 0x7F000002);
+    gtp2ie_encaps_group(GTPV2C_IE_BEARER_CONTEXT, 0, &m->ie[m->n++], bc, 3);
+
+    b = 1;
+    gtp_ie(&m->ie[m->n++], GTPV2C_IE_RECOVERY, 0, &b, 1);
+}
+
+static void gtp_encodeMsg(GtpMsg_t *m, union gtp_packet *pkt, uint32_t *len){
+    *len = get_default_gtp(2, m->type, pkt);
+    pkt->gtp2l.h.tei = hton32(0x1001);
+    pkt->gtp2l.h.seq = hton24(1);
+    gtp2ie_encaps(m->ie, m->n, pkt, len);
+}
+
+/**
+ * Decoding as done by the S11 stack: IE index and the Bearer Context group*/
+static void gtp_decode(void *c){
+    Case_t *k = (Case_t *)c;
+    static union gtpie_member *ie[GTPIE_SIZE], *bc[GTPIE_SIZE];
+    static uint8_t value[GTP2IE_MAX];
+    uint16_t vsize = 0;
+    uint32_t numIE = 0;
+
+    memset(ie, 0, sizeof(ie));
+    memset(bc, 0, sizeof(bc));
+    gtp2ie_decap(ie, (union gtp_packet *)k->buf, k->len);
+    if(gtp2ie_gettliv(ie, GTPV2C_IE_BEARER_CONTEXT, 0, value, &vsize) == 0){
+        gtp2ie_decaps_group(bc, &numIE, value, vsize);
+    }
+    sink += numIE;
+}
+
+static void gtp_encode(void *c){
+    static union gtp_packet pkt;
+    Case_t *k = (Case_t *)c;
+
+    gtp_encodeMsg((GtpMsg_t *)k->ctx, &pkt, &outLen);
+    sink += outLen;
+}
+
+static void gtp_case(Case_t *k, const char *name,
+                     void (*build)(GtpMsg_t *)){
+    static union gtp_packet pkt;
+    GtpMsg_t *m = malloc(sizeof(GtpMsg_t));
+
+    k->codec = "gtp";
+    k->name = name;
+    build(m);
+    gtp_encodeMsg(m, &pkt, &k->len);
+    memcpy(k->buf, &pkt, k->len);
+    k->ctx = m;
+    k->decode = gtp_decode;
+    k->encode = gtp_encode;
+}
+
+/* ====================================================================== */
+/* Measurement                                                            */
+
+typedef struct{
+    uint64_t iterations;
+    double   ns;
+    double   allocs;
+}Result_t;
+
+static int cmp_double(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static Result_t measure(void (*fn)(void *), void *arg,
+                        uint64_t minNs, unsigned runs){
+    Result_t r;
+    double ns[MAX_RUNS];
+    uint64_t i, n = 1, t0, t, a0;
+    unsigned j;
+
+    /* Calibration, the iterations of a run take at least minNs*/
+    for(;;){
+        t0 = now_ns();
+        for(i=0; i<n; i++){
+            fn(arg);
+        }
+        t = now_ns() - t0;
+        if(t >= minNs){
+            break;
+        }
+        n = t < minNs/100 ? n*10 : (uint64_t)(n*1.2*minNs/t) + 1;
+    }
+
+    a0 = allocs;
+    fn(arg);
+    r.allocs = (double)(allocs - a0);
+
+    for(j=0; j<runs; j++){
+        t0 = now_ns();
+        for(i=0; i<n; i++){
+            fn(arg);
+        }
+        ns[j] = (double)(now_ns() - t0)/n;
+    }
+    qsort(ns, runs, sizeof(double), cmp_double);
+    r.iterations = n;
+    r.ns = ns[runs/2];
+#ifndef HAVE_ALLOC_COUNT
+    r.allocs = -1;
+#endif
+    return r;
+}
+
+static void report(const Case_t *k, const char *op, const Result_t *r){
+    printf("%s,%s,%s,%s,%u,%llu,%.1f,%.1f\n",
+           MME_VERSION, k->codec, k->name, op, k->len,
+           (unsigned long long)r->iterations, r->ns, r->allocs);
+    fflush(stdout);
+}
+
+static void usage(const char *prog){
+    fprintf(stderr,
+            "Usage: %s [-c s1ap|nas|gtp] [-t min_ms] [-r runs] [-H]\n"
+            "  -c codec   Only the cases of a codec\n"
+            "  -t ms      Minimum duration of each run (100)\n"
+            "  -r runs    Runs per case, the median is reported (5)\n"
+            "  -H         Don't print the CSV header\n", prog);
+}
+
+int main(int argc, char **argv){
+    Case_t *cases;
+    Result_t r;
+    const char *only = NULL;
+    uint64_t minNs = 100000000ULL;
+    unsigned runs = 5, n = 0, i;
+    int opt, header = 1;
+
+    while((opt = getopt(argc, argv, "c:t:r:H")) != -1){
+        switch(opt){
+        case 'c':
+            only = optarg;
+            break;
+        case 't':
+            minNs = strtoull(optarg, NULL, 10)*1000000ULL;
+            break;
+        case 'r':
+            runs = strtoul(optarg, NULL, 10);
+            break;
+        case 'H':
+            header = 0;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(runs == 0 || runs > MAX_RUNS || minNs == 0){
+        usage(argv[0]);
+        return 1;
+    }
+
+    cases = calloc(6, sizeof(Case_t));
+    s1_case(&cases[n++], "InitialUEMessage", s1_initialUEMessage());
+    s1_case(&cases[n++], "InitialContextSetupRequest", s1_initialContextSetup());
+    s1_case(&cases[n++], "Paging", s1_paging());
+    nas_case(&cases[n++]);
+    gtp_case(&cases[n++], "CreateSessionRequest", gtp_createSessionReq);
+    gtp_case(&cases[n++], "CreateSessionResponse", gtp_createSessionRsp);
+
+    if(header){
+        printf("version,codec,message,op,bytes,iterations,ns_per_msg,allocs_per_msg\n");
+    }
+    for(i=0; i<n; i++){
+        if(only && strcmp(only, cases[i].codec) != 0){
+            continue;
+        }
+        r = measure(cases[i].decode, &cases[i], minNs, runs);
+        report(&cases[i], "decode", &r);
+        r = measure(cases[i].encode, &cases[i], minNs, runs);
+        report(&cases[i], "encode", &r);
+    }
+
+    for(i=0; i<n; i++){
+        if(strcmp(cases[i].codec, "s1ap") == 0){
+            ((S1AP_Message_t *)cases[i].ctx)->freemsg(cases[i].ctx);
+        }else{
+            free(cases[i].ctx);
+        }
+    }
+    free(cases);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   log_bench.c
+ * @brief  Logger benchmark
+ *
+ * Measures the cost of a LOG_DEBUG message when the log level is LOG_INFO,
+ * through the log_msg macro and calling log_msg_ directly, which formats
+ * the message before the level is checked.
+ *
+ * Usage: log_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "logmgr.h"
+
+static uint64_t now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* Argument only needed by the message, as a PLMN conversion would be*/
+static const char *expensiveArg(unsigned i){
+    static char buf[16];
+    snprintf(buf, sizeof(buf), "%06u", i%1000000);
+    return buf;
+}
+
+int main(int argc, char **argv){
+    unsigned long i, n = 10000000;
+    uint64_t t0, tMacro, tCall;
+
+    if(argc > 1){
+        n = strtoul(argv[1], NULL, 10);
+    }
+
+    init_logger("log_bench", LOG_INFO);
+
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        log_msg(LOG_DEBUG, 0, "Benchmark message %lu, PLMN %s", i, expensiveArg(i));
+    }
+    tMacro = now_ns() - t0;
+
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        log_msg_(LOG_DEBUG, __FILE__, __func__, __LINE__, 0,
+                 "Benchmark message %lu, PLMN %s", i, expensiveArg(i));
+    }
+    tCall = now_ns() - t0;
+
+    printf("iterations %lu, LOG_DEBUG disabled\n", n);
+    printf("log_msg macro:  %8.2f ns/msg\n", (double)tMacro/n);
+    printf("log_msg_ call:  %8.2f ns/msg\n", (double)tCall/n);
+    return 0;
+}
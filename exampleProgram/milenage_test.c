@@ -0,0 +1,218 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   milenage_test.c
+ * @brief  Milenage EVP backend test program
+ *
+ * Checks milenage_evp.h against the 3GPP TS 35.208 test sets and against
+ * the table based milenage.h for batches of vectors, then compares the time
+ * per authentication vector of both.
+ *
+ * Usage: milenage_test [iterations]
+ * Returns the number of failed checks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "milenage.h"
+#include "milenage_evp.h"
+#include "milenage_test_sets.h"
+
+#define BATCH 1000
+
+static int ret = 0;
+
+static void check(const char *name, int set, const uint8_t *a,
+                  const uint8_t *b, size_t len){
+    if(memcmp(a, b, len) != 0){
+        printf("- Test Set %d: %s failed\n", set, name);
+        ret++;
+    }
+}
+
+static uint64_t now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static void testSets(){
+    uint8_t opc[16], f1[8], f1s[8], f2[8], f3[16], f4[16], f5[6], f5s[6];
+    const struct milenage_test_set *t;
+    MilenageKey *key;
+    MilenageVector v;
+    size_t i, resLen = 8;
+    uint8_t autn[16], ik[16], ck[16], res[8], sqn[6];
+    uint8_t auts[14];
+
+    for(i=0; i<NUM_TESTS; i++){
+        t = &test_sets[i];
+        key = milenage_key_new(t->k, t->op, NULL);
+        if(!key){
+            printf("- Test Set %zu: key failed\n", i+1);
+            ret++;
+            continue;
+        }
+        milenage_key_opc(key, opc);
+        check("OPc", i+1, opc, t->opc, 16);
+
+        milenage_key_f1(key, t->rand, t->sqn, t->amf, f1, f1s);
+        check("f1", i+1, f1, t->f1, 8);
+        check("f1*", i+1, f1s, t->f1star, 8);
+
+        milenage_key_f2345(key, t->rand, f2, f3, f4, f5, f5s);
+        check("f2", i+1, f2, t->f2, 8);
+        check("f3", i+1, f3, t->f3, 16);
+        check("f4", i+1, f4, t->f4, 16);
+        check("f5", i+1, f5, t->f5, 6);
+        check("f5*", i+1, f5s, t->f5star, 6);
+
+        memcpy(v.rand, t->rand, 16);
+        memcpy(v.sqn, t->sqn, 6);
+        milenage_key_generate(key, t->amf, &v, 1);
+        milenage_generate(t->opc, t->amf, t->k, t->sqn, t->rand,
+                          autn, ik, ck, res, &resLen);
+        check("AUTN", i+1, v.autn, autn, 16);
+        check("IK", i+1, v.ik, ik, 16);
+        check("CK", i+1, v.ck, ck, 16);
+        check("RES", i+1, v.res, res, 8);
+
+        /* AUTS = SQN XOR AK* || MAC-S*/
+        for(resLen=0; resLen<6; resLen++){
+            auts[resLen] = t->sqn[resLen] ^ t->f5star[resLen];
+        }
+        resLen = 8;
+        milenage_key_f1(key, t->rand, t->sqn, (const uint8_t *)"\0\0",
+                        NULL, auts + 6);
+        if(milenage_key_auts(key, t->rand, auts, sqn) != 0){
+            printf("- Test Set %zu: AUTS failed\n", i+1);
+            ret++;
+        }else{
+            check("AUTS SQN", i+1, sqn, t->sqn, 6);
+        }
+        milenage_key_free(key);
+    }
+}
+
+static void fill(MilenageVector *v, size_t n){
+    size_t i, j;
+
+    for(i=0; i<n; i++){
+        for(j=0; j<16; j++){
+            v[i].rand[j] = rand();
+        }
+        for(j=0; j<6; j++){
+            v[i].sqn[j] = rand();
+        }
+    }
+}
+
+static void testBatch(){
+    static MilenageVector v[BATCH];
+    const struct milenage_test_set *t = &test_sets[0];
+    uint8_t autn[16], ik[16], ck[16], res[8];
+    size_t i, resLen = 8;
+    MilenageKey *key;
+
+    fill(v, BATCH);
+    key = milenage_key_new(t->k, NULL, t->opc);
+    milenage_key_generate(key, t->amf, v, BATCH);
+    for(i=0; i<BATCH; i++){
+        milenage_generate(t->opc, t->amf, t->k, v[i].sqn, v[i].rand,
+                          autn, ik, ck, res, &resLen);
+        if(memcmp(v[i].autn, autn, 16) || memcmp(v[i].ik, ik, 16)
+           || memcmp(v[i].ck, ck, 16) || memcmp(v[i].res, res, 8)){
+            printf("- Batch vector %zu differs\n", i);
+            ret++;
+            break;
+        }
+    }
+    milenage_key_free(key);
+}
+
+static void bench(unsigned long n){
+    static MilenageVector v[MILENAGE_BATCH];
+    const struct milenage_test_set *t = &test_sets[0];
+    uint8_t autn[16], ik[16], ck[16], res[8];
+    size_t resLen = 8;
+    unsigned long i;
+    MilenageKey *key;
+    uint64_t t0;
+
+    fill(v, MILENAGE_BATCH);
+
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        milenage_generate(t->opc, t->amf, t->k, v[0].sqn, v[0].rand,
+                          autn, ik, ck, res, &resLen);
+    }
+    printf("milenage_generate:          %8.1f ns/vector\n",
+           (double)(now_ns() - t0)/n);
+
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        key = milenage_key_new(t->k, NULL, t->opc);
+        milenage_key_generate(key, t->amf, v, 1);
+        milenage_key_free(key);
+    }
+    printf("EVP, key per vector:        %8.1f ns/vector\n",
+           (double)(now_ns() - t0)/n);
+
+    key = milenage_key_new(t->k, NULL, t->opc);
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        milenage_key_generate(key, t->amf, v, 1);
+    }
+    printf("EVP, expanded key:          %8.1f ns/vector\n",
+           (double)(now_ns() - t0)/n);
+
+    t0 = now_ns();
+    for(i=0; i<n/MILENAGE_BATCH; i++){
+        milenage_key_generate(key, t->amf, v, MILENAGE_BATCH);
+    }
+    printf("EVP, batch of %2d:           %8.1f ns/vector\n", MILENAGE_BATCH,
+           (double)(now_ns() - t0)/(n/MILENAGE_BATCH*MILENAGE_BATCH));
+    milenage_key_free(key);
+}
+
+int main(int argc, char **argv){
+    unsigned long n = 100000;
+
+    if(argc > 1){
+        n = strtoul(argv[1], NULL, 10);
+    }
+
+    printf("TS 35.208 test sets\n");
+    testSets();
+    printf("Batch against milenage_generate\n");
+    testBatch();
+
+    if(ret){
+        printf("Something failed\n");
+        return ret;
+    }
+    printf("OK\n");
+    if(n >= MILENAGE_BATCH){
+        bench(n);
+    }
+    return 0;
+}
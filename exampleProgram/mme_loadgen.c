@@ -0,0 +1,1607 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mme_loadgen.c
+ * @brief  Multi-threaded eNB/UE/SGW load generator
+ *
+ * Emulates N eNBs connected to the MME over local SCTP, M UEs with Milenage
+ * authentication and NAS integrity protection, and a stub SGW answering the
+ * S11 requests of the MME on a loopback address. Everything runs on one host.
+ *
+ * The eNBs are distributed over the worker threads, each one with its own
+ * event loop. A UE camps on a single eNB and belongs to the worker of that
+ * eNB, so the UE state is never shared between threads. The workers start
+ * the procedures of the call model at the target rates, open loop: when no
+ * UE is in the state required by a procedure the start is counted as skipped.
+ *
+ * Procedures and the point where the latency is taken:
+ *  - attach: Attach Request to the Initial Context Setup with Attach Accept
+ *  - detach: Detach Request (not switch off) to Detach Accept
+ *  - idle:   UE Context Release Request to UE Context Release Command
+ *  - sr:     Service Request to Initial Context Setup Request
+ *  - tau:    Tracking Area Update Request from idle to TAU Accept
+ *  - paging: Downlink Data Notification from the SGW to the Initial Context
+ *            Setup Request of the Service Request answering the paging
+ *
+ * The MME still authenticates against its MySQL HSS. The -S option prints the
+ * SQL to provision the emulated subscribers with the K and OPc used here.
+ * The MME configuration has to point the S11 interface to the stub SGW:
+ * the MME ipv4 is the -m address and the SGW ipv4 the -s address.
+ *
+ * Usage: mme_loadgen [options], see usage()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/sctp.h>
+#include <event2/event.h>
+#include <glib.h>
+
+#include "S1AP.h"
+#include "NAS.h"
+#include "NASConstants.h"
+#include "gtp.h"
+#include "gtpie.h"
+#include "kdf.h"
+#include "milenage.h"
+#include "hdrhist.h"
+
+#define GTP2C_PORT          2123
+#define MAX_PDU             10000
+#define UE_STREAM           1
+#define TICK_US             1000
+#define WARMUP_WINDOW       64      /**< Attaches in flight per worker in -A*/
+#define WARMUP_MAX_S        300
+
+typedef enum{
+    P_ATTACH,
+    P_DETACH,
+    P_IDLE,
+    P_SR,
+    P_TAU,
+    P_PAGING,
+    P_NUM,
+    P_NONE = P_NUM
+}Proc;
+
+typedef enum{
+    UE_DEREG,
+    UE_CONNECTED,
+    UE_IDLE,
+    UE_BUSY,        /**< Running a procedure*/
+    UE_NUM
+}UeState;
+
+static const char *procName[P_NUM] = {
+    "attach", "detach", "idle", "sr", "tau", "paging"};
+
+/** State required to start each procedure*/
+static const UeState procFrom[P_NUM] = {
+    UE_DEREG, UE_CONNECTED, UE_CONNECTED, UE_IDLE, UE_IDLE, UE_IDLE};
+
+struct Worker_c;
+
+typedef struct{
+    guint           idx;
+    int             fd;
+    guint32         nextUeId;   /**< eNB UE S1AP ID, 24 bits*/
+    GHashTable      *ues;       /**< eNB UE S1AP ID -> Ue_t*/
+    struct event    *ev;
+    struct Worker_c *w;
+}Enb_t;
+
+typedef struct{
+    GList       link;       /**< Node in the queue of the current state*/
+    guint       idx;
+    guint64     imsi;
+    Enb_t       *enb;
+    UeState     state;
+    Proc        proc;
+    guint64     t0;         /**< Start of the procedure, ns*/
+    gboolean    measure;    /**< Started in the measurement phase*/
+    gboolean    marked;     /**< Latency already recorded*/
+    gboolean    hasCtx;     /**< eNB UE S1AP ID allocated*/
+    guint32     enbUeId;
+    guint32     mmeUeId;
+    NAS         nas;
+    guint8      ksi;
+    guint8      kasme[32];
+    gboolean    hasGuti;
+    guint8      guti[10];   /**< PLMN, MMEGI, MMEC, M-TMSI*/
+}Ue_t;
+
+typedef struct{
+    HdrHist hist;           /**< us*/
+    guint64 started;
+    guint64 done;
+    guint64 failed;
+    guint64 timeouts;
+    guint64 skipped;
+}ProcStat_t;
+
+typedef struct Worker_c{
+    guint               idx;
+    pthread_t           th;
+    struct event_base   *evbase;
+    struct event        *tick;
+    GPtrArray           *enbs;
+    GQueue              q[UE_NUM];
+    GHashTable          *byTmsi;    /**< M-TMSI -> Ue_t, for paging*/
+    guint64             t0;         /**< Start of the measurement*/
+    gboolean            measuring;
+    gint                ready;      /**< Warm up finished*/
+    guint32             ddnSeq;
+    ProcStat_t          st[P_NUM];
+    guint64             macFail;
+    guint64             unexpected;
+}Worker_t;
+
+static struct{
+    /* Options*/
+    const char  *mmeAddr;
+    const char  *sgwAddr;
+    guint       nEnb;
+    guint       nUe;
+    guint       nWorker;
+    guint64     firstImsi;
+    guint16     tac;
+    guint8      k[16];
+    guint8      opc[16];
+    double      rate[P_NUM];    /**< Per second, all workers*/
+    guint       duration;
+    guint64     timeout;        /**< ns*/
+    gboolean    preattach;
+    gboolean    imeisv;
+    /* Derived*/
+    guint16     mcc;
+    guint16     mnc;
+    guint8      sn[3];          /**< Serving network TBCD*/
+    /* State*/
+    Ue_t        *ues;
+    Enb_t       *enbs;
+    Worker_t    *workers;
+    gint        phase;          /**< 0 warm up, 1 measuring, 2 stop*/
+    gint        *mmeTeid;       /**< MME S11 TEID per UE, network order*/
+    int         sgwFd;
+    struct sockaddr_in mmeS11;
+    pthread_t   sgwTh;
+    guint64     sgwMsgs;
+}lg;
+
+static guint64 now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* ====================================================================== */
+/* UE state                                                               */
+
+static void ue_move(Worker_t *w, Ue_t *ue, UeState s){
+    g_queue_unlink(&w->q[ue->state], &ue->link);
+    g_queue_push_tail_link(&w->q[s], &ue->link);
+    ue->state = s;
+}
+
+static void enb_bind(Ue_t *ue){
+    Enb_t *enb = ue->enb;
+
+    ue->enbUeId = enb->nextUeId;
+    enb->nextUeId = (enb->nextUeId + 1) & 0xFFFFFF;
+    ue->mmeUeId = 0;
+    ue->hasCtx = TRUE;
+    g_hash_table_insert(enb->ues, GUINT_TO_POINTER(ue->enbUeId), ue);
+}
+
+static void enb_unbind(Ue_t *ue){
+    if(ue->hasCtx){
+        g_hash_table_remove(ue->enb->ues, GUINT_TO_POINTER(ue->enbUeId));
+        ue->hasCtx = FALSE;
+    }
+}
+
+static void proc_start(Worker_t *w, Ue_t *ue, Proc p){
+    ue->proc = p;
+    ue->t0 = now_ns();
+    ue->measure = w->measuring;
+    ue->marked = FALSE;
+    ue_move(w, ue, UE_BUSY);
+    if(ue->measure){
+        w->st[p].started++;
+    }
+}
+
+/**
+ * Records the latency of the running procedure, only the first time*/
+static void proc_mark(Worker_t *w, Ue_t *ue){
+    if(ue->marked || ue->proc == P_NONE){
+        return;
+    }
+    ue->marked = TRUE;
+    if(ue->measure){
+        hdr_record(&w->st[ue->proc].hist, (now_ns() - ue->t0)/1000);
+    }
+}
+
+static void proc_end(Worker_t *w, Ue_t *ue, UeState s){
+    proc_mark(w, ue);
+    if(ue->measure){
+        w->st[ue->proc].done++;
+    }
+    ue->proc = P_NONE;
+    ue_move(w, ue, s);
+}
+
+/**
+ * The procedure failed or timed out, the UE starts again detached.
+ * The MME context is left behind, the next attach replaces it.*/
+static void ue_reset(Worker_t *w, Ue_t *ue, gboolean timeout){
+    guint32 mtmsi;
+
+    if(ue->proc != P_NONE && ue->measure){
+        if(timeout){
+            w->st[ue->proc].timeouts++;
+        }else{
+            w->st[ue->proc].failed++;
+        }
+    }
+    enb_unbind(ue);
+    if(ue->hasGuti){
+        memcpy(&mtmsi, ue->guti+6, 4);
+        if(g_hash_table_lookup(w->byTmsi, GUINT_TO_POINTER(mtmsi)) == ue){
+            g_hash_table_remove(w->byTmsi, GUINT_TO_POINTER(mtmsi));
+        }
+        ue->hasGuti = FALSE;
+    }
+    ue->proc = P_NONE;
+    ue_move(w, ue, UE_DEREG);
+}
+
+/* ====================================================================== */
+/* UE security                                                            */
+
+/**
+ * USIM side of the AKA. The SQN is not checked, RES, CK and IK don't
+ * depend on it.*/
+static void ue_aka(Ue_t *ue, const guint8 *rand, const guint8 *autn,
+                   guint8 *res, guint8 *kasme){
+    guint8 ik[16], ck[16], autnx[16], sqn[6] = {0}, amf[2] = {0};
+    size_t resLen = 8;
+
+    milenage_generate(lg.opc, amf, lg.k, sqn, rand, autnx, ik, ck,
+                      res, &resLen);
+    kdf_kasme(ck, ik, lg.sn, autn, kasme);
+}
+
+/**
+ * Checks the MAC of a downlink message and returns the plain NAS*/
+static const guint8 *ue_nasPlain(Worker_t *w, Ue_t *ue,
+                                 const guint8 *nas, guint32 len,
+                                 guint32 *plen){
+    guint8 sh, isAuth = 0;
+
+    if(len < 2){
+        return NULL;
+    }
+    sh = nas[0]>>4;
+    if(sh == PlainNAS){
+        *plen = len;
+        return nas;
+    }
+    if(len < 8){
+        return NULL;
+    }
+    if(nas_authenticateMsg(ue->nas, nas, len, NAS_DownLink, &isAuth) != 1
+       || !isAuth){
+        w->macFail++;
+    }
+    *plen = len - 6;
+    return nas + 6;
+}
+
+/* ====================================================================== */
+/* S1AP encoding                                                          */
+
+static void enb_send(Enb_t *enb, S1AP_Message_t *s1msg, guint16 stream){
+    guint8 buf[MAX_PDU];
+    guint32 len = 0;
+
+    s1ap_encode(buf, &len, s1msg);
+    s1msg->freemsg(s1msg);
+    if(sctp_sendmsg(enb->fd, buf, len, NULL, 0, SCTP_S1AP_PPID,
+                    0, stream, 0, 0) < 0){
+        fprintf(stderr, "eNB %u: sctp_sendmsg: %s\n",
+                enb->idx, strerror(errno));
+    }
+}
+
+static void set_plmn(PLMNidentity_t **p){
+    *p = new_PLMNidentity();
+    (*p)->MCC = lg.mcc;
+    (*p)->MNC = lg.mnc;
+}
+
+static S1AP_Message_t *new_ueMsg(Ue_t *ue, guint8 procedureCode,
+                                 guint8 criticality){
+    S1AP_Message_t *s1msg;
+    MME_UE_S1AP_ID_t *mmeUEId;
+    ENB_UE_S1AP_ID_t *eNBUEId;
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = procedureCode;
+    s1msg->pdu->criticality = criticality;
+
+    mmeUEId = s1ap_newIE(s1msg, id_MME_UE_S1AP_ID, mandatory, reject);
+    mmeUEId->mme_id = ue->mmeUeId;
+    eNBUEId = s1ap_newIE(s1msg, id_eNB_UE_S1AP_ID, mandatory, reject);
+    eNBUEId->eNB_id = ue->enbUeId;
+    return s1msg;
+}
+
+static void send_initUEMsg(Ue_t *ue, guint8 *nas, guint32 nasLen,
+                           gboolean sTmsi, guint8 cause){
+    S1AP_Message_t *s1msg;
+    ENB_UE_S1AP_ID_t *eNBUEId;
+    Unconstrained_Octed_String_t *nAS_PDU;
+    TAI_t *tAI;
+    EUTRAN_CGI_t *ecgi;
+    RRC_Establishment_Cause_t *rrcCause;
+    S_TMSI_t *s_tmsi;
+
+    enb_bind(ue);
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_initialUEMessage;
+    s1msg->pdu->criticality = ignore;
+
+    eNBUEId = s1ap_newIE(s1msg, id_eNB_UE_S1AP_ID, mandatory, reject);
+    eNBUEId->eNB_id = ue->enbUeId;
+
+    nAS_PDU = s1ap_newIE(s1msg, id_NAS_PDU, mandatory, reject);
+    nAS_PDU->len = nasLen;
+    nAS_PDU->str = nas;
+
+    tAI = s1ap_newIE(s1msg, id_TAI, mandatory, reject);
+    set_plmn(&tAI->pLMNidentity);
+    tAI->tAC->s[0] = lg.tac>>8;
+    tAI->tAC->s[1] = lg.tac&0xFF;
+
+    ecgi = s1ap_newIE(s1msg, id_EUTRAN_CGI, mandatory, ignore);
+    set_plmn(&ecgi->pLMNidentity);
+    ecgi->cell_ID.id = (ue->enb->idx + 1)<<8 | 1;
+
+    rrcCause = s1ap_newIE(s1msg, id_RRC_Establishment_Cause, mandatory, ignore);
+    rrcCause->cause.noext = cause;
+
+    if(sTmsi){
+        s_tmsi = s1ap_newIE(s1msg, id_S_TMSI, optional, reject);
+        s_tmsi->mMEC->s[0] = ue->guti[5];
+        memcpy(s_tmsi->m_TMSI.s, ue->guti+6, 4);
+    }
+
+    enb_send(ue->enb, s1msg, UE_STREAM);
+}
+
+static void send_ulNAS(Ue_t *ue, guint8 *nas, guint32 nasLen){
+    S1AP_Message_t *s1msg;
+    Unconstrained_Octed_String_t *nAS_PDU;
+
+    s1msg = new_ueMsg(ue, id_uplinkNASTransport, ignore);
+    nAS_PDU = s1ap_newIE(s1msg, id_NAS_PDU, mandatory, reject);
+    nAS_PDU->len = nasLen;
+    nAS_PDU->str = nas;
+    enb_send(ue->enb, s1msg, UE_STREAM);
+}
+
+static void send_ICSRsp(Ue_t *ue){
+    S1AP_Message_t *s1msg;
+    E_RABSetupListCtxtSURes_t *eRABlist;
+    E_RABSetupItemCtxtSURes_t *eRABitem;
+    S1AP_PROTOCOL_IES_t *ie;
+    guint32 addr = htonl(0x7F000100 | (ue->enb->idx & 0xFF));
+    guint32 teid = htonl(ue->idx + 1);
+
+    s1msg = new_ueMsg(ue, id_InitialContextSetup, reject);
+    s1msg->choice = successful_outcome;
+
+    eRABlist = s1ap_newIE(s1msg, id_E_RABSetupListCtxtSURes, mandatory, ignore);
+    ie = newProtocolIE();
+    eRABitem = new_E_RABSetupItemCtxtSURes();
+    ie->value = eRABitem;
+    ie->showValue = eRABitem->showIE;
+    ie->freeValue = eRABitem->freeIE;
+    ie->id = id_E_RABSetupItemCtxtSURes;
+    ie->presence = mandatory;
+    ie->criticality = ignore;
+    eRABlist->additem(eRABlist, ie);
+
+    eRABitem->eRAB_ID.id = 5;
+    eRABitem->transportLayerAddress = new_TransportLayerAddress();
+    memcpy(eRABitem->transportLayerAddress->addr, &addr, 4);
+    eRABitem->transportLayerAddress->len = 32;
+    memcpy(eRABitem->gTP_TEID.teid, &teid, 4);
+
+    enb_send(ue->enb, s1msg, UE_STREAM);
+}
+
+static void send_releaseReq(Ue_t *ue){
+    S1AP_Message_t *s1msg;
+    Cause_t *cause;
+
+    s1msg = new_ueMsg(ue, id_UEContextReleaseRequest, ignore);
+    cause = s1ap_newIE(s1msg, id_Cause, mandatory, ignore);
+    cause->choice = CauseRadioNetwork;
+    cause->cause.radioNetwork.cause.noext = CauseRadioNetwork_user_inactivity;
+    enb_send(ue->enb, s1msg, UE_STREAM);
+}
+
+static void send_releaseComplete(Ue_t *ue){
+    S1AP_Message_t *s1msg;
+
+    s1msg = new_ueMsg(ue, id_UEContextRelease, reject);
+    s1msg->choice = successful_outcome;
+    enb_send(ue->enb, s1msg, UE_STREAM);
+}
+
+/* ====================================================================== */
+/* NAS encoding                                                           */
+
+/**
+ * IMSI as EPS mobile identity, TS 24.301 9.9.3.12*/
+static void imsi_mobileId(guint64 imsi, guint8 *to){
+    guint8 d[15];
+    int i;
+
+    for(i=14; i>=0; i--){
+        d[i] = imsi%10;
+        imsi /= 10;
+    }
+    to[0] = d[0]<<4 | 0x09;   /* Odd number of digits, IMSI*/
+    for(i=0; i<7; i++){
+        to[1+i] = d[1+2*i] | d[2+2*i]<<4;
+    }
+}
+
+static void ue_sendSec(Ue_t *ue, SecurityHeaderType_t s,
+                       const guint8 *plain, guint32 plen){
+    guint8 out[MAX_PDU];
+    size_t len = 0;
+
+    newNASMsg_sec(ue->nas, out, &len, EPSMobilityManagementMessages,
+                  s, NAS_UpLink, plain, plen);
+    send_ulNAS(ue, out, len);
+}
+
+static void ue_attach(Worker_t *w, Ue_t *ue){
+    guint8 nas[200], esm[50], tmp[20], *pointer, *pointer2;
+
+    proc_start(w, ue, P_ATTACH);
+    ue->ksi = 7;
+
+    pointer = nas;
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, AttachRequest);
+    /* EPS attach type, NAS key set identifier: no key available*/
+    nasIe_v_t1_l(&pointer, 1);
+    nasIe_v_t1_h(&pointer, 7);
+    imsi_mobileId(ue->imsi, tmp);
+    nasIe_lv_t4(&pointer, tmp, 8);
+    /* UE network capability: EEA0-2, EIA1-2*/
+    tmp[0] = 0xe0;
+    tmp[1] = 0x60;
+    nasIe_lv_t4(&pointer, tmp, 2);
+
+    /* ESM: PDN connectivity request*/
+    pointer2 = esm;
+    newNASMsg_ESM(&pointer2, EPSSessionManagementMessages, 0);
+    encaps_ESM(&pointer2, 1, PDNConnectivityRequest);
+    nasIe_v_t1_l(&pointer2, 1);     /* Request type: initial*/
+    nasIe_v_t1_h(&pointer2, 1);     /* PDN type: IPv4*/
+    nasIe_lv_t6(&pointer, esm, pointer2-esm);
+
+    send_initUEMsg(ue, nas, pointer-nas, FALSE, RRC_mo_Signalling);
+}
+
+static void ue_detach(Worker_t *w, Ue_t *ue){
+    guint8 plain[20], tmp[11], *pointer = plain;
+
+    proc_start(w, ue, P_DETACH);
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, DetachRequest);
+    /* Detach type EPS detach, not switch off*/
+    nasIe_v_t1_l(&pointer, 1);
+    nasIe_v_t1_h(&pointer, ue->ksi);
+    tmp[0] = 0xF6;
+    memcpy(tmp+1, ue->guti, 10);
+    nasIe_lv_t4(&pointer, tmp, 11);
+    ue_sendSec(ue, IntegrityProtectedAndCiphered, plain, pointer-plain);
+}
+
+static void ue_idle(Worker_t *w, Ue_t *ue){
+    proc_start(w, ue, P_IDLE);
+    send_releaseReq(ue);
+}
+
+static void ue_serviceRequest(Ue_t *ue, guint8 cause){
+    guint8 nas[4];
+    size_t len = 0;
+
+    newNASMsg_service(ue->nas, nas, &len, ue->ksi);
+    send_initUEMsg(ue, nas, len, TRUE, cause);
+}
+
+static void ue_tau(Worker_t *w, Ue_t *ue){
+    guint8 plain[30], out[60], tmp[11], *pointer = plain;
+    size_t len = 0;
+
+    proc_start(w, ue, P_TAU);
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, TrackingAreaUpdateRequest);
+    /* EPS update type: TA updating, no active flag*/
+    nasIe_v_t1_l(&pointer, 0);
+    nasIe_v_t1_h(&pointer, ue->ksi);
+    tmp[0] = 0xF6;
+    memcpy(tmp+1, ue->guti, 10);
+    nasIe_lv_t4(&pointer, tmp, 11);
+    /* EPS bearer context status, EBI 5*/
+    tmp[0] = 0x20;
+    tmp[1] = 0x00;
+    nasIe_tlv_t4(&pointer, 0x57, tmp, 2);
+
+    newNASMsg_sec(ue->nas, out, &len, EPSMobilityManagementMessages,
+                  IntegrityProtectedAndCiphered, NAS_UpLink,
+                  plain, pointer-plain);
+    send_initUEMsg(ue, out, len, TRUE, RRC_mo_Signalling);
+}
+
+/**
+ * Sends a Downlink Data Notification to the MME on behalf of the SGW*/
+static void ue_paging(Worker_t *w, Ue_t *ue){
+    static __thread union gtpie_member ie[1];
+    union gtp_packet pkt;
+    guint32 len;
+
+    proc_start(w, ue, P_PAGING);
+
+    memset(&pkt, 0, sizeof(pkt));
+    len = get_default_gtp(2, GTP2_DOWNLINK_DATA_NOTIFICATION, &pkt);
+    pkt.gtp2l.h.tei = g_atomic_int_get(&lg.mmeTeid[ue->idx]);
+    pkt.gtp2l.h.seq = hton24(w->idx<<20 | (w->ddnSeq++ & 0xFFFFF));
+
+    memset(ie, 0, sizeof(union gtpie_member));
+    ie[0].tliv.i = 0;
+    ie[0].tliv.t = GTPV2C_IE_EBI;
+    ie[0].tliv.l = hton16(1);
+    ie[0].tliv.v[0] = 5;
+    gtp2ie_encaps(ie, 1, &pkt, &len);
+
+    if(sendto(lg.sgwFd, &pkt, len, 0, (struct sockaddr*)&lg.mmeS11,
+              sizeof(lg.mmeS11)) < 0){
+        fprintf(stderr, "DDN sendto: %s\n", strerror(errno));
+    }
+}
+
+/* ====================================================================== */
+/* Downlink processing                                                    */
+
+static void ue_dlNAS(Worker_t *w, Ue_t *ue, const guint8 *nas, guint32 len){
+    guint8 out[100], tmp[20], *pointer, *pointer2;
+    guint8 res[8], alg, sh;
+    const guint8 *p;
+    guint32 plen;
+
+    if(len < 2){
+        return;
+    }
+    sh = nas[0]>>4;
+
+    /* The security context is taken into use with the Security Mode
+     * Command, check it with the new keys*/
+    if(sh == IntegrityProtectedWithNewEPSSecurityContext && len > 8
+       && nas[7] == SecurityModeCommand){
+        alg = nas[8];
+        nas_setSecurity(ue->nas, alg&0x07, (alg>>4)&0x07, ue->kasme);
+        ue->ksi = nas[9]&0x07;
+    }
+
+    p = ue_nasPlain(w, ue, nas, len, &plen);
+    if(!p || (p[0]&0x0f) != EPSMobilityManagementMessages){
+        w->unexpected++;
+        return;
+    }
+
+    switch(p[1]){
+    case AuthenticationRequest:
+        if(ue->proc != P_ATTACH || plen < 36){
+            break;
+        }
+        ue->ksi = p[2]&0x07;
+        ue_aka(ue, p+3, p+20, res, ue->kasme);
+        pointer = out;
+        newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+        encaps_EMM(&pointer, AuthenticationResponse);
+        nasIe_lv_t4(&pointer, res, 8);
+        send_ulNAS(ue, out, pointer-out);
+        return;
+    case SecurityModeCommand:
+        if(ue->proc != P_ATTACH){
+            break;
+        }
+        pointer = tmp;
+        newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+        encaps_EMM(&pointer, SecurityModeComplete);
+        if(lg.imeisv){
+            /* IMEISV 3534900699999901*/
+            static const guint8 imeisv[] = {0x33, 0x55, 0x94, 0x00, 0x96,
+                                            0x99, 0x99, 0x09, 0xF1};
+            nasIe_tlv_t4(&pointer, 0x23, imeisv, sizeof(imeisv));
+        }
+        ue_sendSec(ue, IntegrityProtectedAndCipheredWithNewEPSSecurityContext,
+                   tmp, pointer-tmp);
+        return;
+    case DetachAccept:
+        if(ue->proc == P_DETACH){
+            proc_mark(w, ue);
+            return;
+        }
+        break;
+    case TrackingAreaUpdateAccept:
+        if(ue->proc != P_TAU){
+            break;
+        }
+        proc_mark(w, ue);
+        pointer2 = tmp;
+        newNASMsg_EMM(&pointer2, EPSMobilityManagementMessages, PlainNAS);
+        encaps_EMM(&pointer2, TrackingAreaUpdateComplete);
+        ue_sendSec(ue, IntegrityProtectedAndCiphered, tmp, pointer2-tmp);
+        return;
+    case AttachReject:
+    case AuthenticationReject:
+    case TrackingAreaUpdateReject:
+    case ServiceReject:
+        if(ue->proc != P_NONE){
+            ue_reset(w, ue, FALSE);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    w->unexpected++;
+}
+
+/**
+ * GUTI of the Attach Accept, TS 24.301 8.2.1*/
+static gboolean ue_attachAccept(Worker_t *w, Ue_t *ue,
+                                const guint8 *nas, guint32 len){
+    const guint8 *p;
+    guint32 plen, off, mtmsi;
+
+    p = ue_nasPlain(w, ue, nas, len, &plen);
+    if(!p || (p[0]&0x0f) != EPSMobilityManagementMessages
+       || p[1] != AttachAccept || plen < 5){
+        return FALSE;
+    }
+    /* Result, T3412, TAI list (LV), ESM container (LV-E)*/
+    off = 4 + 1 + p[4];
+    if(off + 2 > plen){
+        return FALSE;
+    }
+    off += 2 + (p[off]<<8 | p[off+1]);
+    /* GUTI is the first optional IE, tag 0x50 length 11*/
+    if(off + 13 > plen || p[off] != 0x50 || p[off+1] != 11){
+        return FALSE;
+    }
+    memcpy(ue->guti, p+off+3, 10);
+    ue->hasGuti = TRUE;
+    memcpy(&mtmsi, ue->guti+6, 4);
+    g_hash_table_insert(w->byTmsi, GUINT_TO_POINTER(mtmsi), ue);
+    return TRUE;
+}
+
+static void ue_attachComplete(Ue_t *ue){
+    guint8 plain[20], esm[10], *pointer = plain, *pointer2 = esm;
+
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, AttachComplete);
+    newNASMsg_ESM(&pointer2, EPSSessionManagementMessages, 5);
+    encaps_ESM(&pointer2, 0, ActivateDefaultEPSBearerContextAccept);
+    nasIe_lv_t6(&pointer, esm, pointer2-esm);
+    ue_sendSec(ue, IntegrityProtectedAndCiphered, plain, pointer-plain);
+}
+
+static void ue_ICSReq(Worker_t *w, Ue_t *ue, S1AP_Message_t *s1msg){
+    E_RABToBeSetupListCtxtSUReq_t *list;
+    E_RABToBeSetupItemCtxtSUReq_t *item;
+
+    switch(ue->proc){
+    case P_ATTACH:
+        list = s1ap_findIe(s1msg, id_E_RABToBeSetupListCtxtSUReq);
+        if(!list || list->size == 0){
+            ue_reset(w, ue, FALSE);
+            return;
+        }
+        item = (E_RABToBeSetupItemCtxtSUReq_t*)list->item[0]->value;
+        if(!item->nAS_PDU ||
+           !ue_attachAccept(w, ue, item->nAS_PDU->str, item->nAS_PDU->len)){
+            ue_reset(w, ue, FALSE);
+            return;
+        }
+        proc_mark(w, ue);
+        send_ICSRsp(ue);
+        ue_attachComplete(ue);
+        proc_end(w, ue, UE_CONNECTED);
+        break;
+    case P_SR:
+    case P_PAGING:
+        proc_mark(w, ue);
+        send_ICSRsp(ue);
+        proc_end(w, ue, UE_CONNECTED);
+        break;
+    default:
+        w->unexpected++;
+    }
+}
+
+static void ue_releaseCommand(Worker_t *w, Ue_t *ue){
+    send_releaseComplete(ue);
+    enb_unbind(ue);
+
+    switch(ue->proc){
+    case P_DETACH:
+        proc_end(w, ue, UE_DEREG);
+        /* Forget the GUTI, nothing is counted without a procedure*/
+        ue_reset(w, ue, FALSE);
+        break;
+    case P_IDLE:
+    case P_TAU:
+        proc_end(w, ue, UE_IDLE);
+        break;
+    case P_NONE:
+        /* Released by the MME*/
+        if(ue->state == UE_CONNECTED){
+            ue_move(w, ue, UE_IDLE);
+        }
+        break;
+    default:
+        ue_reset(w, ue, FALSE);
+    }
+}
+
+static void enb_paging(Worker_t *w, Enb_t *enb, S1AP_Message_t *s1msg){
+    UEPagingID_t *pagingId;
+    guint32 mtmsi;
+    Ue_t *ue;
+
+    pagingId = s1ap_findIe(s1msg, id_UEPagingID);
+    if(!pagingId || pagingId->choice != 0){
+        return;
+    }
+    memcpy(&mtmsi, pagingId->id.s_TMSI->m_TMSI.s, 4);
+    ue = g_hash_table_lookup(w->byTmsi, GUINT_TO_POINTER(mtmsi));
+    /* Answer only on the serving eNB, the paging goes to all the TA*/
+    if(!ue || ue->enb != enb || ue->proc != P_PAGING || ue->hasCtx){
+        return;
+    }
+    ue_serviceRequest(ue, RRC_mt_Access);
+}
+
+static Ue_t *enb_findUe(Enb_t *enb, S1AP_Message_t *s1msg){
+    ENB_UE_S1AP_ID_t *eNBUEId;
+    MME_UE_S1AP_ID_t *mmeUEId;
+    UE_S1AP_IDs_t *ids;
+    Ue_t *ue;
+    guint32 id, mmeId;
+
+    eNBUEId = s1ap_findIe(s1msg, id_eNB_UE_S1AP_ID);
+    if(eNBUEId){
+        id = eNBUEId->eNB_id;
+        mmeUEId = s1ap_findIe(s1msg, id_MME_UE_S1AP_ID);
+        mmeId = mmeUEId ? mmeUEId->mme_id : 0;
+    }else{
+        ids = s1ap_findIe(s1msg, id_UE_S1AP_IDs);
+        if(!ids || ids->choice != 0){
+            return NULL;
+        }
+        id = ids->uE_S1AP_ID.uE_S1AP_ID_pair->eNB_UE_S1AP_ID->eNB_id;
+        mmeId = ids->uE_S1AP_ID.uE_S1AP_ID_pair->mME_UE_S1AP_ID->mme_id;
+    }
+    ue = g_hash_table_lookup(enb->ues, GUINT_TO_POINTER(id));
+    if(ue){
+        ue->mmeUeId = mmeId;
+    }
+    return ue;
+}
+
+static void enb_process(Worker_t *w, Enb_t *enb, guint8 *buf, guint32 len){
+    S1AP_Message_t *s1msg;
+    Unconstrained_Octed_String_t *nAS_PDU;
+    Ue_t *ue;
+
+    s1msg = s1ap_decode(buf, len);
+    if(!s1msg){
+        w->unexpected++;
+        return;
+    }
+
+    if(s1msg->choice == initiating_message
+       && s1msg->pdu->procedureCode == id_Paging){
+        enb_paging(w, enb, s1msg);
+        s1msg->freemsg(s1msg);
+        return;
+    }
+
+    ue = enb_findUe(enb, s1msg);
+    if(!ue || s1msg->choice != initiating_message){
+        w->unexpected++;
+        s1msg->freemsg(s1msg);
+        return;
+    }
+
+    switch(s1msg->pdu->procedureCode){
+    case id_downlinkNASTransport:
+        nAS_PDU = s1ap_findIe(s1msg, id_NAS_PDU);
+        if(nAS_PDU){
+            ue_dlNAS(w, ue, nAS_PDU->str, nAS_PDU->len);
+        }
+        break;
+    case id_InitialContextSetup:
+        ue_ICSReq(w, ue, s1msg);
+        break;
+    case id_UEContextRelease:
+        ue_releaseCommand(w, ue);
+        break;
+    default:
+        w->unexpected++;
+    }
+    s1msg->freemsg(s1msg);
+}
+
+static void enb_recv(evutil_socket_t fd, short event, void *arg){
+    Enb_t *enb = (Enb_t *)arg;
+    struct sctp_sndrcvinfo sinfo;
+    guint8 buf[MAX_PDU];
+    int n, flags;
+
+    for(;;){
+        flags = 0;
+        n = sctp_recvmsg(fd, buf, sizeof(buf), NULL, 0, &sinfo, &flags);
+        if(n <= 0){
+            if(n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)){
+                fprintf(stderr, "eNB %u: association lost\n", enb->idx);
+                event_del(enb->ev);
+            }
+            return;
+        }
+        if(flags & MSG_NOTIFICATION){
+            continue;
+        }
+        enb_process(enb->w, enb, buf, n);
+    }
+}
+
+/* ====================================================================== */
+/* Workers                                                                */
+
+static void (*procStart[P_NUM])(Worker_t*, Ue_t*) = {
+    ue_attach, ue_detach, ue_idle, NULL, ue_tau, ue_paging};
+
+static void worker_start(Worker_t *w, Proc p){
+    GList *l;
+    Ue_t *ue;
+
+    l = g_queue_peek_head_link(&w->q[procFrom[p]]);
+    if(!l){
+        w->st[p].skipped++;
+        return;
+    }
+    ue = l->data;
+    if(p == P_SR){
+        proc_start(w, ue, P_SR);
+        ue_serviceRequest(ue, RRC_mo_Data);
+    }else{
+        procStart[p](w, ue);
+    }
+}
+
+static void worker_sweep(Worker_t *w, guint64 now){
+    GList *l;
+    Ue_t *ue;
+
+    while((l = g_queue_peek_head_link(&w->q[UE_BUSY]))){
+        ue = l->data;
+        if(now - ue->t0 < lg.timeout){
+            break;
+        }
+        ue_reset(w, ue, TRUE);
+    }
+}
+
+static void worker_tick(evutil_socket_t fd, short event, void *arg){
+    Worker_t *w = (Worker_t *)arg;
+    guint64 now = now_ns(), due;
+    gint phase = g_atomic_int_get(&lg.phase);
+    guint p;
+
+    worker_sweep(w, now);
+
+    if(phase == 2){
+        event_base_loopbreak(w->evbase);
+        return;
+    }
+
+    if(phase == 0){
+        while(w->q[UE_DEREG].length > 0
+              && w->q[UE_BUSY].length < WARMUP_WINDOW){
+            ue_attach(w, g_queue_peek_head(&w->q[UE_DEREG]));
+        }
+        if(w->q[UE_DEREG].length == 0 && w->q[UE_BUSY].length == 0){
+            g_atomic_int_set(&w->ready, 1);
+        }
+        return;
+    }
+
+    if(!w->measuring){
+        w->measuring = TRUE;
+        w->t0 = now;
+    }
+    for(p=0; p<P_NUM; p++){
+        due = (guint64)(lg.rate[p] / lg.nWorker * (now - w->t0) / 1e9);
+        while(w->st[p].started + w->st[p].skipped < due){
+            worker_start(w, p);
+        }
+    }
+}
+
+static void *worker_run(void *arg){
+    Worker_t *w = (Worker_t *)arg;
+    struct timeval tv = {0, TICK_US};
+
+    w->tick = event_new(w->evbase, -1, EV_PERSIST, worker_tick, w);
+    event_add(w->tick, &tv);
+    event_base_dispatch(w->evbase);
+    event_free(w->tick);
+    return NULL;
+}
+
+/* ====================================================================== */
+/* Stub SGW                                                               */
+
+static void sgw_fteid(union gtpie_member *ie, guint8 instance,
+                      guint8 iface, guint32 teid){
+    struct fteid_t fteid;
+
+    memset(&fteid, 0, sizeof(fteid));
+    fteid.ipv4 = 1;
+    fteid.iface = hton8(iface);
+    fteid.teid = hton32(teid);
+    inet_pton(AF_INET, lg.sgwAddr, &fteid.addr.addrv4);
+    ie->tliv.i = instance;
+    ie->tliv.t = GTPV2C_IE_FTEID;
+    ie->tliv.l = hton16(FTEID_IP4_SIZE);
+    memcpy(ie->tliv.v, &fteid, FTEID_IP4_SIZE);
+}
+
+static void sgw_cause(union gtpie_member *ie){
+    ie->tliv.i = 0;
+    ie->tliv.t = GTPV2C_IE_CAUSE;
+    ie->tliv.l = hton16(2);
+    ie->tliv.v[0] = GTPV2C_CAUSE_REQUEST_ACCEPTED;
+    ie->tliv.v[1] = 0;
+}
+
+static void sgw_ebi(union gtpie_member *ie){
+    ie->tliv.i = 0;
+    ie->tliv.t = GTPV2C_IE_EBI;
+    ie->tliv.l = hton16(1);
+    ie->tliv.v[0] = 5;
+}
+
+static void sgw_recovery(union gtpie_member *ie){
+    ie->tliv.i = 0;
+    ie->tliv.t = GTPV2C_IE_RECOVERY;
+    ie->tliv.l = hton16(1);
+    ie->tliv.v[0] = 1;
+}
+
+static void *sgw_run(void *arg){
+    /* The IE unions are large, keep them out of the stack*/
+    static union gtpie_member ie[6], bc[3];
+    static union gtpie_member *in[GTPIE_SIZE];
+    static guint8 value[GTP2IE_MAX];
+    union gtp_packet pkt, rsp;
+    struct sockaddr_storage peer;
+    socklen_t peerLen;
+    guint32 len, teid, idx, n;
+    guint64 imsi;
+    guint16 vsize;
+    guint8 rspType;
+    ssize_t r;
+
+    while(g_atomic_int_get(&lg.phase) != 2){
+        peerLen = sizeof(peer);
+        r = recvfrom(lg.sgwFd, &pkt, sizeof(pkt), 0,
+                     (struct sockaddr*)&peer, &peerLen);
+        if(r < 12){
+            continue;
+        }
+        lg.sgwMsgs++;
+        memset(in, 0, sizeof(in));
+        memset(ie, 0, sizeof(ie));
+        memset(bc, 0, sizeof(bc));
+        memset(&rsp, 0, sizeof(rsp));
+        n = 0;
+
+        switch(pkt.gtp2l.h.type){
+        case GTP2_ECHO_REQ:
+            len = get_default_gtp(2, GTP2_ECHO_RSP, &rsp);
+            rsp.gtp2s.h.seq = pkt.gtp2s.h.seq;
+            sgw_recovery(&ie[n++]);
+            gtp2ie_encaps(ie, n, &rsp, &len);
+            sendto(lg.sgwFd, &rsp, len, 0, (struct sockaddr*)&peer, peerLen);
+            continue;
+        case GTP2_CREATE_SESSION_REQ:
+            gtp2ie_decap(in, &pkt, r);
+            gtp2ie_gettliv(in, GTPV2C_IE_IMSI, 0, value, &vsize);
+            imsi = 0;
+            tbcd2dec(&imsi, value, vsize);
+            if(vsize == 0 || imsi < lg.firstImsi
+               || imsi - lg.firstImsi >= lg.nUe){
+                continue;
+            }
+            idx = imsi - lg.firstImsi;
+            gtp2ie_gettliv(in, GTPV2C_IE_FTEID, 0, value, &vsize);
+            if(vsize < FTEID_IP4_SIZE){
+                continue;
+            }
+            g_atomic_int_set(&lg.mmeTeid[idx],
+                             ((struct fteid_t*)value)->teid);
+            rspType = GTP2_CREATE_SESSION_RSP;
+            sgw_cause(&ie[n++]);
+            sgw_fteid(&ie[n++], 0, S11S4_SGW, idx + 1);
+            sgw_fteid(&ie[n++], 1, S5S8C_PGW, idx + 1);
+            /* PAA, IPv4 from 10.0.0.0/8*/
+            ie[n].tliv.i = 0;
+            ie[n].tliv.t = GTPV2C_IE_PAA;
+            ie[n].tliv.l = hton16(5);
+            ie[n].tliv.v[0] = 0x01;
+            teid = htonl(0x0A000000 | (idx + 1));
+            memcpy(ie[n].tliv.v+1, &teid, 4);
+            n++;
+            sgw_ebi(&bc[0]);
+            sgw_cause(&bc[1]);
+            sgw_fteid(&bc[2], 0, S1U_SGW, idx + 1);
+            gtp2ie_encaps_group(GTPV2C_IE_BEARER_CONTEXT, 0, &ie[n++], bc, 3);
+            sgw_recovery(&ie[n++]);
+            break;
+        case GTP2_MODIFY_BEARER_REQ:
+            rspType = GTP2_MODIFY_BEARER_RSP;
+            sgw_cause(&ie[n++]);
+            sgw_ebi(&bc[0]);
+            sgw_cause(&bc[1]);
+            gtp2ie_encaps_group(GTPV2C_IE_BEARER_CONTEXT, 0, &ie[n++], bc, 2);
+            break;
+        case GTP2_DELETE_SESSION_REQ:
+            rspType = GTP2_DELETE_SESSION_RSP;
+            sgw_cause(&ie[n++]);
+            break;
+        case GTP2_RELEASE_ACCESS_BEARERS_REQ:
+            rspType = GTP2_RELEASE_ACCESS_BEARERS_RSP;
+            sgw_cause(&ie[n++]);
+            break;
+        default:
+            /* Downlink Data Notification Acks and the rest*/
+            continue;
+        }
+
+        if(pkt.gtp2l.h.type != GTP2_CREATE_SESSION_REQ){
+            idx = ntohl(pkt.gtp2l.h.tei) - 1;
+            if(idx >= lg.nUe){
+                continue;
+            }
+        }
+        len = get_default_gtp(2, rspType, &rsp);
+        rsp.gtp2l.h.tei = g_atomic_int_get(&lg.mmeTeid[idx]);
+        rsp.gtp2l.h.seq = pkt.gtp2l.h.seq;
+        gtp2ie_encaps(ie, n, &rsp, &len);
+        sendto(lg.sgwFd, &rsp, len, 0, (struct sockaddr*)&peer, peerLen);
+    }
+    return NULL;
+}
+
+static int sgw_init(){
+    struct sockaddr_in addr;
+    struct timeval tv = {0, 100000};
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(GTP2C_PORT);
+    if(fd < 0 || inet_pton(AF_INET, lg.sgwAddr, &addr.sin_addr) != 1
+       || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0){
+        fprintf(stderr, "SGW bind %s:%u: %s\n",
+                lg.sgwAddr, GTP2C_PORT, strerror(errno));
+        return -1;
+    }
+    /* Wake up to check the end of the test*/
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    memset(&lg.mmeS11, 0, sizeof(lg.mmeS11));
+    lg.mmeS11.sin_family = AF_INET;
+    lg.mmeS11.sin_port = htons(GTP2C_PORT);
+    inet_pton(AF_INET, lg.mmeAddr, &lg.mmeS11.sin_addr);
+    return fd;
+}
+
+/* ====================================================================== */
+/* eNB setup                                                              */
+
+static int enb_connect(Enb_t *enb){
+    struct sctp_initmsg initmsg;
+    struct sctp_event_subscribe events;
+    struct sockaddr_in peer;
+    int fd, on = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM, IPPROTO_SCTP);
+    if(fd < 0){
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_SCTP, SCTP_NODELAY, &on, sizeof(on));
+    memset(&initmsg, 0, sizeof(initmsg));
+    initmsg.sinit_num_ostreams = 5;
+    initmsg.sinit_max_instreams = 5;
+    initmsg.sinit_max_attempts = 4;
+    setsockopt(fd, IPPROTO_SCTP, SCTP_INITMSG, &initmsg, sizeof(initmsg));
+
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(S1AP_PORT);
+    inet_pton(AF_INET, lg.mmeAddr, &peer.sin_addr);
+    if(connect(fd, (struct sockaddr*)&peer, sizeof(peer)) < 0){
+        close(fd);
+        return -1;
+    }
+    memset(&events, 0, sizeof(events));
+    events.sctp_data_io_event = 1;
+    setsockopt(fd, SOL_SCTP, SCTP_EVENTS, &events, sizeof(events));
+    return fd;
+}
+
+/**
+ * S1 Setup, waits for the answer before the test starts*/
+static gboolean enb_setup(Enb_t *enb){
+    S1AP_Message_t *s1msg;
+    Global_ENB_ID_t *globalId;
+    ENBname_t *name;
+    SupportedTAs_t *tas;
+    SupportedTAs_Item_t *ta;
+    PagingDRX_t *drx;
+    PLMNidentity_t *plmn;
+    struct sctp_sndrcvinfo sinfo;
+    guint8 buf[MAX_PDU];
+    gboolean ok;
+    int n, flags = 0;
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_S1Setup;
+    s1msg->pdu->criticality = reject;
+
+    globalId = s1ap_newIE(s1msg, id_Global_ENB_ID, mandatory, reject);
+    set_plmn(&globalId->pLMNidentity);
+    globalId->eNBid->choice = 0;
+    globalId->eNBid->id.macroENB_ID = enb->idx + 1;
+
+    name = s1ap_newIE(s1msg, id_eNBname, optional, ignore);
+    snprintf((char*)name->name, sizeof(name->name), "loadgen-%u", enb->idx);
+
+    tas = s1ap_newIE(s1msg, id_SupportedTAs, mandatory, reject);
+    ta = new_SupportedTAs_Item();
+    ta->tAC->s[0] = lg.tac>>8;
+    ta->tAC->s[1] = lg.tac&0xFF;
+    ta->broadcastPLMNs = new_BPLMNs();
+    set_plmn(&plmn);
+    ta->broadcastPLMNs->addPLMNid(ta->broadcastPLMNs, plmn);
+    tas->additem(tas, ta);
+
+    drx = s1ap_newIE(s1msg, id_DefaultPagingDRX, mandatory, ignore);
+    drx->pagingDRX = v128;
+
+    enb_send(enb, s1msg, 0);
+
+    do{
+        n = sctp_recvmsg(enb->fd, buf, sizeof(buf), NULL, 0, &sinfo, &flags);
+    }while(n > 0 && (flags & MSG_NOTIFICATION));
+    if(n <= 0){
+        return FALSE;
+    }
+    s1msg = s1ap_decode(buf, n);
+    ok = s1msg && s1msg->pdu->procedureCode == id_S1Setup
+        && s1msg->choice == successful_outcome;
+    if(s1msg){
+        s1msg->freemsg(s1msg);
+    }
+    return ok;
+}
+
+/* ====================================================================== */
+/* Report                                                                 */
+
+static void report(double elapsed){
+    ProcStat_t tot;
+    Worker_t *w;
+    guint64 macFail = 0, unexpected = 0;
+    guint p, i, b;
+
+    printf("\n%-8s %9s %9s %9s %7s %7s %8s %9s %9s %9s %9s\n",
+           "proc", "target/s", "done/s", "done", "failed", "timeout",
+           "skipped", "p50 us", "p99 us", "p99.9 us", "max us");
+    for(p=0; p<P_NUM; p++){
+        memset(&tot, 0, sizeof(tot));
+        for(i=0; i<lg.nWorker; i++){
+            w = &lg.workers[i];
+            for(b=0; b<HDR_BUCKETS; b++){
+                tot.hist.count[b] += w->st[p].hist.count[b];
+            }
+            tot.hist.total += w->st[p].hist.total;
+            if(w->st[p].hist.max > tot.hist.max){
+                tot.hist.max = w->st[p].hist.max;
+            }
+            tot.started += w->st[p].started;
+            tot.done += w->st[p].done;
+            tot.failed += w->st[p].failed;
+            tot.timeouts += w->st[p].timeouts;
+            tot.skipped += w->st[p].skipped;
+        }
+        if(lg.rate[p] == 0 && tot.started == 0){
+            continue;
+        }
+        printf("%-8s %9.1f %9.1f %9" G_GUINT64_FORMAT " %7" G_GUINT64_FORMAT
+               " %7" G_GUINT64_FORMAT " %8" G_GUINT64_FORMAT
+               " %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+               " %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT "\n",
+               procName[p], lg.rate[p], tot.done/elapsed, tot.done,
+               tot.failed, tot.timeouts, tot.skipped,
+               hdr_percentile(&tot.hist, 50.0),
+               hdr_percentile(&tot.hist, 99.0),
+               hdr_percentile(&tot.hist, 99.9),
+               tot.hist.max);
+    }
+    for(i=0; i<lg.nWorker; i++){
+        macFail += lg.workers[i].macFail;
+        unexpected += lg.workers[i].unexpected;
+    }
+    printf("\n%.1f s, %u eNBs, %u UEs, %u threads, %" G_GUINT64_FORMAT
+           " S11 requests, %" G_GUINT64_FORMAT " downlink MAC failures, %"
+           G_GUINT64_FORMAT " unexpected messages\n",
+           elapsed, lg.nEnb, lg.nUe, lg.nWorker, lg.sgwMsgs,
+           macFail, unexpected);
+}
+
+/* ====================================================================== */
+/* Options                                                                */
+
+static gboolean parse_key(const char *hex, guint8 *out){
+    guint i;
+    unsigned int b;
+
+    if(strlen(hex) != 32){
+        return FALSE;
+    }
+    for(i=0; i<16; i++){
+        if(sscanf(hex+2*i, "%2x", &b) != 1){
+            return FALSE;
+        }
+        out[i] = b;
+    }
+    return TRUE;
+}
+
+static gboolean parse_rates(char *arg){
+    char *tok, *save = NULL, *eq;
+    guint p;
+
+    for(tok = strtok_r(arg, ",", &save); tok; tok = strtok_r(NULL, ",", &save)){
+        eq = strchr(tok, '=');
+        if(!eq){
+            return FALSE;
+        }
+        *eq = '\0';
+        for(p=0; p<P_NUM; p++){
+            if(strcmp(tok, procName[p]) == 0){
+                lg.rate[p] = strtod(eq+1, NULL);
+                break;
+            }
+        }
+        if(p == P_NUM){
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void hex(const guint8 *v, guint n, char *out){
+    guint i;
+    for(i=0; i<n; i++){
+        sprintf(out+2*i, "%02X", v[i]);
+    }
+}
+
+/**
+ * Subscribers for the HSS database, see S6a/scripts/userdata.sql*/
+static void print_sql(){
+    char k[33], opc[33];
+    guint64 msin;
+    guint i;
+
+    hex(lg.k, 16, k);
+    hex(lg.opc, 16, opc);
+    printf("INSERT IGNORE INTO operators VALUES (%u,%u,"
+           "0x01020304050607080910111213141516,0x8000,'Load generator');\n",
+           lg.mcc, lg.mnc);
+    for(i=0; i<lg.nUe; i++){
+        msin = (lg.firstImsi + i)%10000000000ULL;
+        printf("REPLACE INTO subscriber_profile VALUES (%u,%u,x'%.10llu',"
+               "%llu,x'%s',x'%s',0x000000000000,0x0000000000000000,"
+               "NULL,NULL,NULL,100000,100000,NULL,NULL);\n",
+               lg.mcc, lg.mnc, (unsigned long long)msin,
+               358500000000ULL + i, k, opc);
+        printf("REPLACE INTO pdn_subscription_ctx VALUES (%u,%u,x'%.10llu',"
+               "0,'internet',0x00,0x00,0x0000,0x00,0x000000000000000000000000,"
+               "100000,100000,1,1,0x00,0x00);\n",
+               lg.mcc, lg.mnc, (unsigned long long)msin);
+    }
+}
+
+static void usage(const char *prog){
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -m addr    MME address, S1 and S11 (127.0.0.1)\n"
+            "  -s addr    Stub SGW address (127.0.0.2)\n"
+            "  -e n       eNBs (4)\n"
+            "  -u n       UEs (1000)\n"
+            "  -t n       Worker threads (2)\n"
+            "  -i imsi    First IMSI, the PLMN is taken from it, 2 digit MNC\n"
+            "             (001010000000001)\n"
+            "  -T tac     Tracking area code (1)\n"
+            "  -k K -o OPc  Subscriber keys, hex\n"
+            "  -r rates   Procedures per second, comma separated\n"
+            "             attach,detach,idle,sr,tau,paging (attach=10)\n"
+            "  -d s       Duration (10)\n"
+            "  -w s       Procedure timeout (5)\n"
+            "  -A         Attach all the UEs before the measurement\n"
+            "  -I         Send the IMEISV in the Security Mode Complete\n"
+            "  -S         Print the SQL to provision the subscribers and exit\n"
+            "The MME configuration must use the -m address as MME ipv4 and the\n"
+            "-s address as SGW ipv4.\n", prog);
+}
+
+/* ====================================================================== */
+
+int main(int argc, char **argv){
+    PLMNidentity_t plmn;
+    gboolean sql = FALSE;
+    guint64 t0, tw;
+    guint i;
+    int opt;
+    Worker_t *w;
+    Enb_t *enb;
+    Ue_t *ue;
+
+    lg.mmeAddr = "127.0.0.1";
+    lg.sgwAddr = "127.0.0.2";
+    lg.nEnb = 4;
+    lg.nUe = 1000;
+    lg.nWorker = 2;
+    lg.firstImsi = 1010000000001ULL;
+    lg.tac = 1;
+    lg.duration = 10;
+    lg.timeout = 5ULL*1000000000ULL;
+    lg.rate[P_ATTACH] = 10;
+    parse_key("00112233445566778899AABBCCDDEEFF", lg.k);
+
+    while((opt = getopt(argc, argv, "m:s:e:u:t:i:T:k:o:r:d:w:AIS")) != -1){
+        switch(opt){
+        case 'm':
+            lg.mmeAddr = optarg;
+            break;
+        case 's':
+            lg.sgwAddr = optarg;
+            break;
+        case 'e':
+            lg.nEnb = strtoul(optarg, NULL, 10);
+            break;
+        case 'u':
+            lg.nUe = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            lg.nWorker = strtoul(optarg, NULL, 10);
+            break;
+        case 'i':
+            lg.firstImsi = strtoull(optarg, NULL, 10);
+            break;
+        case 'T':
+            lg.tac = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            if(!parse_key(optarg, lg.k)){
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            if(!parse_key(optarg, lg.opc)){
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            memset(lg.rate, 0, sizeof(lg.rate));
+            if(!parse_rates(optarg)){
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            lg.duration = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            lg.timeout = strtoull(optarg, NULL, 10)*1000000000ULL;
+            break;
+        case 'A':
+            lg.preattach = TRUE;
+            break;
+        case 'I':
+            lg.imeisv = TRUE;
+            break;
+        case 'S':
+            sql = TRUE;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(lg.nEnb == 0 || lg.nUe == 0 || lg.nWorker == 0
+       || lg.nEnb < lg.nWorker || lg.duration == 0){
+        usage(argv[0]);
+        return 1;
+    }
+
+    lg.mcc = lg.firstImsi/1000000000000ULL;
+    lg.mnc = (lg.firstImsi/10000000000ULL)%100;
+    memset(&plmn, 0, sizeof(plmn));
+    plmn.MCC = lg.mcc;
+    plmn.MNC = lg.mnc;
+    plmnId_MccMnc2tbcd(&plmn);
+    memcpy(lg.sn, plmn.tbc.s, 3);
+
+    if(sql){
+        print_sql();
+        return 0;
+    }
+
+    lg.mmeTeid = g_new0(gint, lg.nUe);
+    lg.sgwFd = sgw_init();
+    if(lg.sgwFd < 0){
+        return 1;
+    }
+    pthread_create(&lg.sgwTh, NULL, sgw_run, NULL);
+
+    /* Workers and eNBs*/
+    lg.workers = g_new0(Worker_t, lg.nWorker);
+    for(i=0; i<lg.nWorker; i++){
+        w = &lg.workers[i];
+        w->idx = i;
+        w->evbase = event_base_new();
+        w->enbs = g_ptr_array_new();
+        w->byTmsi = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+    lg.enbs = g_new0(Enb_t, lg.nEnb);
+    for(i=0; i<lg.nEnb; i++){
+        enb = &lg.enbs[i];
+        enb->idx = i;
+        enb->nextUeId = 1;
+        enb->ues = g_hash_table_new(g_direct_hash, g_direct_equal);
+        enb->w = &lg.workers[i % lg.nWorker];
+        enb->fd = enb_connect(enb);
+        if(enb->fd < 0 || !enb_setup(enb)){
+            fprintf(stderr, "eNB %u: S1 Setup with %s failed\n",
+                    i, lg.mmeAddr);
+            return 1;
+        }
+        evutil_make_socket_nonblocking(enb->fd);
+        enb->ev = event_new(enb->w->evbase, enb->fd, EV_READ|EV_PERSIST,
+                            enb_recv, enb);
+        event_add(enb->ev, NULL);
+        g_ptr_array_add(enb->w->enbs, enb);
+    }
+
+    /* UEs*/
+    lg.ues = g_new0(Ue_t, lg.nUe);
+    for(i=0; i<lg.nUe; i++){
+        ue = &lg.ues[i];
+        ue->idx = i;
+        ue->imsi = lg.firstImsi + i;
+        ue->enb = &lg.enbs[i % lg.nEnb];
+        ue->proc = P_NONE;
+        ue->nas = nas_newHandler();
+        ue->link.data = ue;
+        ue->state = UE_DEREG;
+        g_queue_push_tail_link(&ue->enb->w->q[UE_DEREG], &ue->link);
+    }
+
+    g_atomic_int_set(&lg.phase, lg.preattach ? 0 : 1);
+    for(i=0; i<lg.nWorker; i++){
+        pthread_create(&lg.workers[i].th, NULL, worker_run, &lg.workers[i]);
+    }
+
+    if(lg.preattach){
+        printf("Attaching %u UEs\n", lg.nUe);
+        tw = now_ns();
+        for(i=0; i<lg.nWorker; i++){
+            while(!g_atomic_int_get(&lg.workers[i].ready)
+                  && now_ns() - tw < WARMUP_MAX_S*1000000000ULL){
+                usleep(10000);
+            }
+        }
+        printf("Attached in %.1f s\n", (now_ns() - tw)/1e9);
+        g_atomic_int_set(&lg.phase, 1);
+    }
+
+    t0 = now_ns();
+    sleep(lg.duration);
+    g_atomic_int_set(&lg.phase, 2);
+    for(i=0; i<lg.nWorker; i++){
+        pthread_join(lg.workers[i].th, NULL);
+    }
+    pthread_join(lg.sgwTh, NULL);
+
+    report((now_ns() - t0)/1e9);
+
+    for(i=0; i<lg.nEnb; i++){
+        event_free(lg.enbs[i].ev);
+        close(lg.enbs[i].fd);
+        g_hash_table_destroy(lg.enbs[i].ues);
+    }
+    for(i=0; i<lg.nUe; i++){
+        nas_freeHandler(lg.ues[i].nas);
+    }
+    for(i=0; i<lg.nWorker; i++){
+        event_base_free(lg.workers[i].evbase);
+        g_hash_table_destroy(lg.workers[i].byTmsi);
+        g_ptr_array_free(lg.workers[i].enbs, TRUE);
+    }
+    close(lg.sgwFd);
+    g_free(lg.ues);
+    g_free(lg.enbs);
+    g_free(lg.workers);
+    g_free(lg.mmeTeid);
+    return 0;
+}
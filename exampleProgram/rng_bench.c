@@ -0,0 +1,106 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rng_bench.c
+ * @brief  Random number generator benchmark
+ *
+ * Measures the cost of a RAND (16 bytes) and an M-TMSI (4 bytes) read from
+ * /dev/urandom opening the file on each call, as the HSS did, with a
+ * getrandom() call each and with the buffered generator of rng.h.
+ *
+ * Usage: rng_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/random.h>
+
+#include "logmgr.h"
+#include "rng.h"
+
+static uint64_t now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static int urandom_fopen(uint8_t *buf, size_t len){
+    FILE *f;
+    size_t rc;
+
+    f = fopen("/dev/urandom", "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    rc = fread(buf, 1, len, f);
+    fclose(f);
+    return rc != len ? -1 : 0;
+}
+
+static int urandom_getrandom(uint8_t *buf, size_t len){
+    return getrandom(buf, len, 0) == (ssize_t)len ? 0 : -1;
+}
+
+static int urandom_rng(uint8_t *buf, size_t len){
+    rng_bytes(buf, len);
+    return 0;
+}
+
+static volatile uint8_t sink;
+
+static void run(const char *name, int (*f)(uint8_t*, size_t),
+                size_t len, unsigned long n){
+    uint8_t buf[16];
+    unsigned long i;
+    uint64_t t0, t;
+
+    t0 = now_ns();
+    for(i=0; i<n; i++){
+        if(f(buf, len) != 0){
+            fprintf(stderr, "%s failed: %s\n", name, strerror(errno));
+            exit(1);
+        }
+        sink ^= buf[0];
+    }
+    t = now_ns() - t0;
+    printf("%-10s %2zu bytes: %8.2f ns/call\n", name, len, (double)t/n);
+}
+
+int main(int argc, char **argv){
+    unsigned long n = 200000;
+
+    if(argc > 1){
+        n = strtoul(argv[1], NULL, 10);
+    }
+
+    init_logger("rng_bench", LOG_INFO);
+
+    printf("iterations %lu\n", n);
+    run("fopen", urandom_fopen, 16, n);
+    run("getrandom", urandom_getrandom, 16, n);
+    run("rng", urandom_rng, 16, n);
+    run("fopen", urandom_fopen, 4, n);
+    run("getrandom", urandom_getrandom, 4, n);
+    run("rng", urandom_rng, 4, n);
+    rng_free();
+    return 0;
+}
@@ -0,0 +1,921 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   s1_replay.c
+ * @brief  S1AP/NAS replay benchmark
+ *
+ * Replays the eNB to MME S1AP messages of a pcap capture through the MME
+ * S1 stack in-process: s1ap_decode, the S1Assoc state machine and the
+ * ECM/EMM/ESM handlers. The messages are injected with s1Assoc_processPDU
+ * and the MME answers on a local socket pair instead of SCTP.
+ *
+ * The binary is linked with the MME sources except the HSS and the S11
+ * stack, which are replaced by the fakes below:
+ *  - The HSS returns the authentication vectors seen in the capture,
+ *    recomputed with Milenage from the K and OPc given on the command line,
+ *    so the NAS security of the captured UEs is valid.
+ *  - The S11 sessions are answered locally on the next event loop turn.
+ *
+ * The MME UE S1AP IDs and the S-TMSIs of the captured uplink messages are
+ * rewritten with the values allocated by the MME under test. GUTIs inside
+ * integrity protected NAS messages can't be rewritten, so the TAUs and GUTI
+ * attaches of UEs attached in the same capture are not found.
+ *
+ * The MME configuration is read from MME_CONFIG as usual, the S1, S11 and
+ * S6a settings are not used.
+ *
+ * Usage: s1_replay [-n passes] [-k K -o OPc] [-l loglevel] capture.pcap
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <event2/event.h>
+#include <glib.h>
+
+#include "MME.h"
+#include "MME_S1_priv.h"
+#include "MME_S11.h"
+#include "S11_User.h"
+#include "S1Assoc.h"
+#include "S1AP.h"
+#include "HSS.h"
+#include "EMMCtx.h"
+#include "EPS_Session_priv.h"
+#include "ESM_BearerContext.h"
+#include "NASConstants.h"
+#include "kdf.h"
+#include "milenage.h"
+#include "hdrhist.h"
+#include "logmgr.h"
+
+#define S1AP_PORT       36412
+#define S1AP_PPID       18
+#define MAX_PDU         10000
+
+#define LINKTYPE_NULL       0
+#define LINKTYPE_ETHERNET   1
+#define LINKTYPE_RAW        101
+#define LINKTYPE_LINUX_SLL  113
+#define LINKTYPE_LINUX_SLL2 276
+
+typedef struct{
+    gboolean uplink;     /**< eNB to MME*/
+    guint16  stream;
+    guint32  len;
+    guint8   *data;
+}Pdu_t;
+
+typedef struct{
+    guint8 rand[16];
+    guint8 autn[16];
+}CapturedVector_t;
+
+/** Latency of a message type*/
+typedef struct{
+    char     name[64];
+    HdrHist  hist;       /**< ns*/
+    guint64  sum;
+}MsgStat_t;
+
+static struct{
+    struct event_base *evbase;
+    struct mme_t      *mme;
+    GPtrArray         *pdus;
+    GArray            *vectors;      /**< Captured authentication vectors*/
+    guint             nextVector;
+    gboolean          haveKeys;
+    guint8            k[16];
+    guint8            opc[16];
+    guint             pending;       /**< Fake S11 answers not run yet*/
+    guint32           nextTEID;
+    GHashTable        *liveMMEId;    /**< eNB UE S1AP ID -> MME UE S1AP ID*/
+    GHashTable        *liveMTMSI;    /**< eNB UE S1AP ID -> live M-TMSI*/
+    GHashTable        *mtmsi;        /**< Captured M-TMSI -> live M-TMSI*/
+    GHashTable        *stats;        /**< Name -> MsgStat_t*/
+    guint64           msgs;
+    guint64           busy;          /**< ns spent in the MME*/
+    guint64           rejected;      /**< Messages closing the association*/
+    guint64           downlink;
+}replay;
+
+static guint64 now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+/* ====================================================================== */
+/* NAS helpers                                                            */
+
+static const struct{
+    guint8     type;
+    const char *name;
+}nasNames[] = {
+    {AttachRequest, "AttachRequest"},
+    {AttachAccept, "AttachAccept"},
+    {AttachComplete, "AttachComplete"},
+    {DetachRequest, "DetachRequest"},
+    {DetachAccept, "DetachAccept"},
+    {TrackingAreaUpdateRequest, "TAURequest"},
+    {TrackingAreaUpdateComplete, "TAUComplete"},
+    {ExtendedServiceRequest, "ExtendedServiceRequest"},
+    {GUTIReallocationComplete, "GUTIReallocationComplete"},
+    {AuthenticationRequest, "AuthenticationRequest"},
+    {AuthenticationResponse, "AuthenticationResponse"},
+    {AuthenticationFailure, "AuthenticationFailure"},
+    {IdentityResponse, "IdentityResponse"},
+    {SecurityModeComplete, "SecurityModeComplete"},
+    {SecurityModeReject, "SecurityModeReject"},
+    {EMMStatus, "EMMStatus"},
+    {UplinkNASTransport, "UplinkNASTransport"},
+    {ESMInformationResponse, "ESMInformationResponse"},
+    {PDNConnectivityRequest, "PDNConnectivityRequest"},
+    {PDNDisconnectRequest, "PDNDisconnectRequest"},
+    {ActivateDefaultEPSBearerContextAccept, "ActivateDefaultBearerAccept"},
+    {DeactivateEPSBearerContextAccept, "DeactivateBearerAccept"},
+    {ESMStatus, "ESMStatus"},
+};
+
+/**
+ * Plain NAS message of a PDU, skipping the security header.
+ * The ciphering is not supported by the MME, only EEA0 is expected.*/
+static const guint8 *nas_plain(const guint8 *nas, guint32 len, guint32 *plen){
+    guint8 sh = nas[0]>>4;
+
+    if(len < 2){
+        return NULL;
+    }
+    if((nas[0]&0x0f) == EPSMobilityManagementMessages
+       && sh != PlainNAS){
+        if(sh == SecurityHeaderForServiceRequestMessage || len < 8){
+            return NULL;
+        }
+        nas += 6;
+        len -= 6;
+    }
+    *plen = len;
+    return nas;
+}
+
+static const char *nas_name(const guint8 *nas, guint32 len){
+    const guint8 *p;
+    guint32 plen, i;
+    guint8 type;
+
+    if(len > 0 && nas[0]>>4 == SecurityHeaderForServiceRequestMessage){
+        return "ServiceRequest";
+    }
+    p = nas_plain(nas, len, &plen);
+    if(!p){
+        return "NAS";
+    }
+    if((p[0]&0x0f) == EPSSessionManagementMessages){
+        type = plen > 2 ? p[2] : 0;
+    }else{
+        type = p[1];
+    }
+    for(i=0; i<sizeof(nasNames)/sizeof(nasNames[0]); i++){
+        if(nasNames[i].type == type)
+            return nasNames[i].name;
+    }
+    return "NAS";
+}
+
+/**
+ * M-TMSI of the GUTI in an Attach Accept, TS 24.301 8.2.1*/
+static gboolean nas_attachAcceptMTMSI(const guint8 *nas, guint32 len,
+                                      guint32 *mtmsi){
+    const guint8 *p;
+    guint32 plen, off;
+
+    p = nas_plain(nas, len, &plen);
+    if(!p || (p[0]&0x0f) != EPSMobilityManagementMessages
+       || p[1] != AttachAccept || plen < 5){
+        return FALSE;
+    }
+    /* Result, T3412, TAI list (LV), ESM container (LV-E)*/
+    off = 4 + 1 + p[4];
+    if(off + 2 > plen){
+        return FALSE;
+    }
+    off += 2 + (p[off]<<8 | p[off+1]);
+    /* GUTI is the first optional IE, tag 0x50 length 11*/
+    if(off + 13 > plen || p[off] != 0x50 || p[off+1] != 11){
+        return FALSE;
+    }
+    memcpy(mtmsi, p+off+9, 4);
+    return TRUE;
+}
+
+/**
+ * RAND and AUTN of an Authentication Request, TS 24.301 8.2.7*/
+static gboolean nas_authRequest(const guint8 *nas, guint32 len,
+                                CapturedVector_t *v){
+    const guint8 *p;
+    guint32 plen;
+
+    p = nas_plain(nas, len, &plen);
+    if(!p || (p[0]&0x0f) != EPSMobilityManagementMessages
+       || p[1] != AuthenticationRequest || plen < 36 || p[19] != 16){
+        return FALSE;
+    }
+    memcpy(v->rand, p+3, 16);
+    memcpy(v->autn, p+20, 16);
+    return TRUE;
+}
+
+static Unconstrained_Octed_String_t *s1_nas(S1AP_Message_t *s1msg){
+    return (Unconstrained_Octed_String_t*)s1ap_findIe(s1msg, id_NAS_PDU);
+}
+
+/* ====================================================================== */
+/* pcap loading                                                           */
+
+static guint32 rd32(const guint8 *p, gboolean swap){
+    guint32 v;
+    memcpy(&v, p, 4);
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+/**
+ * Extracts the S1AP DATA chunks of a SCTP packet*/
+static void parse_sctp(const guint8 *p, guint32 len, GHashTable *seen){
+    guint16 sport, dport, clen, stream;
+    guint32 off = 12, tsn, ppid;
+    guint64 key;
+    Pdu_t *pdu;
+
+    if(len < 12){
+        return;
+    }
+    sport = p[0]<<8 | p[1];
+    dport = p[2]<<8 | p[3];
+    if(sport != S1AP_PORT && dport != S1AP_PORT){
+        return;
+    }
+    while(off + 4 <= len){
+        clen = p[off+2]<<8 | p[off+3];
+        if(clen < 4 || off + clen > len){
+            break;
+        }
+        /* Unfragmented DATA chunk*/
+        if(p[off] == 0 && (p[off+1]&0x03) == 0x03 && clen > 16){
+            tsn = rd32(p+off+4, FALSE);
+            stream = p[off+8]<<8 | p[off+9];
+            ppid = ntohl(rd32(p+off+12, FALSE));
+            /* Skip retransmissions*/
+            key = (guint64)(sport ^ dport<<16)<<32 | ntohl(tsn);
+            if(ppid == S1AP_PPID && !g_hash_table_contains(seen, &key)){
+                g_hash_table_add(seen, g_memdup(&key, sizeof(key)));
+                pdu = g_new0(Pdu_t, 1);
+                pdu->uplink = dport == S1AP_PORT;
+                pdu->stream = stream;
+                pdu->len = clen - 16;
+                pdu->data = g_memdup(p+off+16, pdu->len);
+                g_ptr_array_add(replay.pdus, pdu);
+            }
+        }
+        off += (clen + 3) & ~3;
+    }
+}
+
+static void parse_ip(const guint8 *p, guint32 len, GHashTable *seen){
+    guint32 hl;
+
+    if(len < 1){
+        return;
+    }
+    if(p[0]>>4 == 4 && len >= 20){
+        hl = (p[0]&0x0f)*4;
+        if(p[9] == IPPROTO_SCTP && hl < len){
+            parse_sctp(p+hl, len-hl, seen);
+        }
+    }else if(p[0]>>4 == 6 && len >= 40){
+        if(p[6] == IPPROTO_SCTP){
+            parse_sctp(p+40, len-40, seen);
+        }
+    }
+}
+
+static gboolean load_pcap(const char *path){
+    guint8 hdr[24], rec[16], *buf = NULL;
+    guint32 link, caplen, off;
+    guint16 proto;
+    gboolean swap;
+    GHashTable *seen;
+    FILE *f;
+
+    f = fopen(path, "rb");
+    if(!f){
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return FALSE;
+    }
+    if(fread(hdr, 1, 24, f) != 24){
+        fclose(f);
+        return FALSE;
+    }
+    switch(rd32(hdr, FALSE)){
+    case 0xa1b2c3d4:
+    case 0xa1b23c4d:
+        swap = FALSE;
+        break;
+    case 0xd4c3b2a1:
+    case 0x4d3cb2a1:
+        swap = TRUE;
+        break;
+    default:
+        fprintf(stderr, "%s is not a pcap file (pcapng is not supported)\n", path);
+        fclose(f);
+        return FALSE;
+    }
+    link = rd32(hdr+20, swap);
+    seen = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    buf = g_malloc(65536);
+
+    while(fread(rec, 1, 16, f) == 16){
+        caplen = rd32(rec+8, swap);
+        if(caplen > 65536 || fread(buf, 1, caplen, f) != caplen){
+            break;
+        }
+        switch(link){
+        case LINKTYPE_ETHERNET:
+            off = 14;
+            proto = buf[12]<<8 | buf[13];
+            if(proto == 0x8100 && caplen > 18){
+                proto = buf[16]<<8 | buf[17];
+                off = 18;
+            }
+            break;
+        case LINKTYPE_LINUX_SLL:
+            off = 16;
+            proto = buf[14]<<8 | buf[15];
+            break;
+        case LINKTYPE_LINUX_SLL2:
+            off = 20;
+            proto = buf[0]<<8 | buf[1];
+            break;
+        case LINKTYPE_NULL:
+        case LINKTYPE_RAW:
+            off = link == LINKTYPE_NULL ? 4 : 0;
+            proto = 0x0800;
+            break;
+        default:
+            fprintf(stderr, "Link type %u not supported\n", link);
+            goto out;
+        }
+        if(off < caplen && (proto == 0x0800 || proto == 0x86dd)){
+            parse_ip(buf+off, caplen-off, seen);
+        }
+    }
+ out:
+    g_free(buf);
+    g_hash_table_destroy(seen);
+    fclose(f);
+    return TRUE;
+}
+
+/**
+ * Collects the authentication vectors sent in the capture, in order*/
+static void scan_vectors(){
+    S1AP_Message_t *s1msg;
+    Unconstrained_Octed_String_t *nas;
+    CapturedVector_t v;
+    Pdu_t *pdu;
+    guint i;
+
+    for(i=0; i<replay.pdus->len; i++){
+        pdu = g_ptr_array_index(replay.pdus, i);
+        if(pdu->uplink){
+            continue;
+        }
+        s1msg = s1ap_decode(pdu->data, pdu->len);
+        if(!s1msg){
+            continue;
+        }
+        nas = s1_nas(s1msg);
+        if(nas && nas_authRequest(nas->str, nas->len, &v)){
+            g_array_append_val(replay.vectors, v);
+        }
+        s1msg->freemsg(s1msg);
+    }
+}
+
+/* ====================================================================== */
+/* Fake HSS, replaces S6a/HSS.c                                           */
+
+G_DEFINE_QUARK(diameter, diameter);
+
+int init_hss(const char *host, const char *db, const char *usr, const char *pw){
+    return 0;
+}
+
+void disconnect_hss(){
+}
+
+void HSS_getAuthVec(EMMCtx emm, GError **err){
+    AuthQuadruplet *a = g_new0(AuthQuadruplet, 1);
+    CapturedVector_t *v = NULL;
+    guint8 sqn[6] = {0}, amf[2] = {0x80, 0x00}, ak[16], ik[16], ck[16], res[8];
+    size_t resLen = 8;
+    guint i;
+
+    if(replay.vectors->len > 0){
+        v = &g_array_index(replay.vectors, CapturedVector_t,
+                           replay.nextVector++ % replay.vectors->len);
+    }
+    if(v){
+        memcpy(a->rAND, v->rand, 16);
+        /* AK is the SQN^AK field of a vector generated with SQN 0*/
+        milenage_generate(replay.opc, amf, replay.k, sqn, a->rAND,
+                          ak, ik, ck, res, &resLen);
+        for(i=0; i<6; i++){
+            sqn[i] = v->autn[i] ^ ak[i];
+        }
+        memcpy(amf, v->autn+6, 2);
+    }else{
+        for(i=0; i<16; i++){
+            a->rAND[i] = g_random_int();
+        }
+    }
+    resLen = 8;
+    milenage_generate(replay.opc, amf, replay.k, sqn, a->rAND,
+                      a->aUTN, ik, ck, a->xRES, &resLen);
+    kdf_kasme(ck, ik, emmCtx_getServingNetwork_TBCD(emm),
+              a->aUTN, a->kASME);
+    emmCtx_setNewAuthQuadruplet(emm, a);
+}
+
+void HSS_syncAuthVec(EMMCtx emm, uint8_t *auts, GError **err){
+    g_set_error(err, DIAMETER, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE,
+                "Resynchronization not supported by the replay HSS");
+}
+
+void HSS_UpdateLocation(EMMCtx emm, const ServedGUMMEIs_t *sGUMMEIs){
+    const guint64 imsi = emmCtx_getIMSI(emm);
+    Subscription subs = emmCtx_getSubscription(emm);
+    PDNCtx pdn = subs_newPDNCtx(subs);
+    struct qos_t qos;
+    char apn[100];
+
+    emmCtx_setMSISDN(emm, imsi % 10000000000ULL);
+    subs_setUEAMBR(subs, 50000000, 100000000);
+
+    memset(&qos, 0, sizeof(qos));
+    qos.qci = 9;
+    qos.pl = 15;
+    pdnCtx_setDefaultBearerQoS(pdn, &qos);
+    pdnCtx_setPDNtype(pdn, 1);
+    snprintf(apn, sizeof(apn), "internet.mnc%.3u.mcc%.3u.gprs",
+             (guint)((imsi/10000000000ULL)%100), (guint)(imsi/1000000000000ULL));
+    pdnCtx_setAPN(pdn, apn);
+}
+
+/* ====================================================================== */
+/* Fake S11, replaces the S11 directory                                   */
+
+typedef struct{
+    void     (*cb)(gpointer);
+    gpointer args;
+}FakeAnswer_t;
+
+static void fake_run(evutil_socket_t fd, short event, void *arg){
+    FakeAnswer_t *a = (FakeAnswer_t *)arg;
+    replay.pending--;
+    a->cb(a->args);
+    g_free(a);
+}
+
+/**
+ * The answer runs on the next event loop turn, as a SGW response would*/
+static void fake_answer(void (*cb)(gpointer), gpointer args){
+    struct timeval zero = {0, 0};
+    FakeAnswer_t *a;
+
+    if(!cb){
+        return;
+    }
+    a = g_new(FakeAnswer_t, 1);
+    a->cb = cb;
+    a->args = args;
+    replay.pending++;
+    event_base_once(replay.evbase, -1, EV_TIMEOUT, fake_run, a, &zero);
+}
+
+gpointer s11_init(gpointer mme){
+    return &replay;
+}
+
+void s11_free(gpointer s11){
+}
+
+GList *S11_getPeers(gpointer s11_h){
+    return NULL;
+}
+
+gpointer S11_newUserAttach(gpointer s11_h, EMMCtx emm, EPS_Session s,
+                           void(*cb)(gpointer), gpointer args){
+    guint8 paa[5];
+    struct fteid_t fteid;
+    guint32 teid = ++replay.nextTEID;
+
+    paa[0] = 1;  /* IPv4*/
+    paa[1] = 10;
+    paa[2] = (teid>>16) & 0xff;
+    paa[3] = (teid>>8) & 0xff;
+    paa[4] = teid & 0xff;
+    ePSsession_setPDNAddress(s, paa, sizeof(paa));
+
+    memset(&fteid, 0, sizeof(fteid));
+    fteid.iface = S1U_SGW;
+    fteid.ipv4 = 1;
+    fteid.teid = htonl(teid);
+    fteid.addr.addrv4 = htonl(INADDR_LOOPBACK);
+    esm_bc_setS1uSGWfteid(ePSsession_getDefaultBearer(s), &fteid, FTEID_IP4_SIZE);
+
+    fake_answer(cb, args);
+    return GUINT_TO_POINTER(teid);
+}
+
+void S11_Attach_ModifyBearerReq(gpointer s11_user, void(*cb)(gpointer), gpointer args){
+    fake_answer(cb, args);
+}
+
+void S11_ReleaseAccessBearers(gpointer s11_user, void(*cb)(gpointer), gpointer args){
+    fake_answer(cb, args);
+}
+
+void S11_detach(gpointer s11_user, void(*cb)(gpointer), gpointer args){
+    fake_answer(cb, args);
+}
+
+/* The fake users are TEIDs, they have no objects to count*/
+void s11u_footprint(gpointer self, MemAcctUE *ue){
+}
+
+/* The snapshots and the replication are not used by the replay, the users
+ * are not saved*/
+gboolean s11u_snapshot(const gpointer self, SnapSession_t *snap){
+    return FALSE;
+}
+
+gpointer S11_restoreUser(gpointer s11_h, EMMCtx emm, EPS_Session s,
+                         const SnapSession_t *snap){
+    return GUINT_TO_POINTER(++replay.nextTEID);
+}
+
+const guint8 getRestartCounter(gpointer s11_h){
+    return 0;
+}
+
+void S11_keepRestartCounter(gpointer s11_h, guint8 restartCounter){
+}
+
+/* ====================================================================== */
+/* Replay                                                                 */
+
+static MsgStat_t *stat_get(const char *name){
+    MsgStat_t *st = g_hash_table_lookup(replay.stats, name);
+    if(!st){
+        st = g_new0(MsgStat_t, 1);
+        g_strlcpy(st->name, name, sizeof(st->name));
+        g_hash_table_insert(replay.stats, st->name, st);
+    }
+    return st;
+}
+
+/**
+ * Learns the identifiers allocated by the MME from its messages*/
+static void learn_live(const guint8 *buf, guint32 len){
+    S1AP_Message_t *s1msg = s1ap_decode((void *)buf, len);
+    MME_UE_S1AP_ID_t *mmeId;
+    ENB_UE_S1AP_ID_t *enbId;
+    Unconstrained_Octed_String_t *nas;
+    guint32 mtmsi;
+
+    if(!s1msg){
+        return;
+    }
+    mmeId = s1ap_findIe(s1msg, id_MME_UE_S1AP_ID);
+    enbId = s1ap_findIe(s1msg, id_eNB_UE_S1AP_ID);
+    nas = s1_nas(s1msg);
+    if(mmeId && enbId){
+        g_hash_table_insert(replay.liveMMEId, GUINT_TO_POINTER(enbId->eNB_id),
+                            GUINT_TO_POINTER(mmeId->mme_id));
+        if(nas && nas_attachAcceptMTMSI(nas->str, nas->len, &mtmsi)){
+            g_hash_table_insert(replay.liveMTMSI, GUINT_TO_POINTER(enbId->eNB_id),
+                                GUINT_TO_POINTER(mtmsi));
+        }
+    }
+    s1msg->freemsg(s1msg);
+}
+
+/**
+ * Maps the captured M-TMSI to the one allocated by the MME under test*/
+static void learn_captured(const Pdu_t *pdu){
+    S1AP_Message_t *s1msg = s1ap_decode(pdu->data, pdu->len);
+    ENB_UE_S1AP_ID_t *enbId;
+    Unconstrained_Octed_String_t *nas;
+    guint32 mtmsi;
+    gpointer live;
+
+    if(!s1msg){
+        return;
+    }
+    enbId = s1ap_findIe(s1msg, id_eNB_UE_S1AP_ID);
+    nas = s1_nas(s1msg);
+    if(enbId && nas && nas_attachAcceptMTMSI(nas->str, nas->len, &mtmsi)
+       && g_hash_table_lookup_extended(replay.liveMTMSI,
+                                       GUINT_TO_POINTER(enbId->eNB_id),
+                                       NULL, &live)){
+        g_hash_table_insert(replay.mtmsi, GUINT_TO_POINTER(mtmsi), live);
+    }
+    s1msg->freemsg(s1msg);
+}
+
+static void drain(int fd){
+    guint8 buf[MAX_PDU];
+    ssize_t n;
+
+    while((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0){
+        replay.downlink++;
+        learn_live(buf, n);
+    }
+}
+
+/**
+ * Rewrites the MME allocated identifiers of a captured uplink message
+ * @param [out] name Message type
+ * @return Length of the message to inject in buf*/
+static guint32 prepare(const Pdu_t *pdu, guint8 *buf, char *name, gsize nameLen){
+    S1AP_Message_t *s1msg = s1ap_decode(pdu->data, pdu->len);
+    MME_UE_S1AP_ID_t *mmeId;
+    ENB_UE_S1AP_ID_t *enbId;
+    S_TMSI_t *sTMSI;
+    Unconstrained_Octed_String_t *nas;
+    gboolean changed = FALSE;
+    gpointer v;
+    guint32 mtmsi, len = pdu->len;
+
+    if(!s1msg || !s1msg->pdu){
+        g_strlcpy(name, "undecodable", nameLen);
+        memcpy(buf, pdu->data, pdu->len);
+        return pdu->len;
+    }
+
+    nas = s1_nas(s1msg);
+    snprintf(name, nameLen, "%s%s%s",
+               elementaryProcedureName[s1msg->pdu->procedureCode],
+               nas ? "/" : "",
+               nas ? nas_name(nas->str, nas->len) : "");
+
+    mmeId = s1ap_findIe(s1msg, id_MME_UE_S1AP_ID);
+    enbId = s1ap_findIe(s1msg, id_eNB_UE_S1AP_ID);
+    if(mmeId && enbId
+       && g_hash_table_lookup_extended(replay.liveMMEId,
+                                       GUINT_TO_POINTER(enbId->eNB_id),
+                                       NULL, &v)
+       && mmeId->mme_id != GPOINTER_TO_UINT(v)){
+        mmeId->mme_id = GPOINTER_TO_UINT(v);
+        changed = TRUE;
+    }
+
+    sTMSI = s1ap_findIe(s1msg, id_S_TMSI);
+    if(sTMSI){
+        memcpy(&mtmsi, sTMSI->m_TMSI.s, 4);
+        if(g_hash_table_lookup_extended(replay.mtmsi, GUINT_TO_POINTER(mtmsi),
+                                        NULL, &v)){
+            mtmsi = GPOINTER_TO_UINT(v);
+            memcpy(sTMSI->m_TMSI.s, &mtmsi, 4);
+            changed = TRUE;
+        }
+    }
+
+    if(changed){
+        s1ap_encode(buf, &len, s1msg);
+    }else{
+        memcpy(buf, pdu->data, pdu->len);
+    }
+    s1msg->freemsg(s1msg);
+    return len;
+}
+
+/**
+ * Removes the association as if the eNB had disconnected*/
+static void teardown(S1Assoc assoc, int fd){
+    if(g_hash_table_lookup(replay.mme->s1_by_GeNBid, s1Assoc_getID_p(assoc))){
+        mme_deregisterS1Assoc(replay.mme, assoc);
+    }
+    s1_deregisterAssoc(replay.mme->s1, assoc);
+    close(fd);
+}
+
+static void run_pass(){
+    S1Assoc assoc;
+    guint8 buf[MAX_PDU];
+    char name[64];
+    guint64 t0, dt;
+    guint32 len;
+    MsgStat_t *st;
+    Pdu_t *pdu;
+    gboolean up;
+    int sv[2];
+    guint i;
+
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) != 0){
+        fprintf(stderr, "socketpair: %s\n", strerror(errno));
+        exit(1);
+    }
+    assoc = s1Assoc_init(replay.mme->s1);
+    s1Assoc_connect(assoc, sv[0]);
+    g_hash_table_remove_all(replay.liveMMEId);
+    g_hash_table_remove_all(replay.liveMTMSI);
+
+    for(i=0; i<replay.pdus->len; i++){
+        pdu = g_ptr_array_index(replay.pdus, i);
+        if(!pdu->uplink){
+            learn_captured(pdu);
+            continue;
+        }
+        len = prepare(pdu, buf, name, sizeof(name));
+
+        t0 = now_ns();
+        up = s1Assoc_processPDU(assoc, buf, len, pdu->stream);
+        while(replay.pending > 0){
+            event_base_loop(replay.evbase, EVLOOP_ONCE);
+        }
+        dt = now_ns() - t0;
+
+        st = stat_get(name);
+        hdr_record(&st->hist, dt);
+        st->sum += dt;
+        replay.msgs++;
+        replay.busy += dt;
+
+        drain(sv[1]);
+        /* Timers due*/
+        event_base_loop(replay.evbase, EVLOOP_NONBLOCK);
+
+        if(!up){
+            /* The association was rejected, start again with the next
+             * S1 Setup*/
+            replay.rejected++;
+            teardown(assoc, sv[1]);
+            assoc = s1Assoc_init(replay.mme->s1);
+            if(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) != 0){
+                exit(1);
+            }
+            s1Assoc_connect(assoc, sv[0]);
+        }
+    }
+
+    teardown(assoc, sv[1]);
+}
+
+static gint stat_cmp(gconstpointer a, gconstpointer b){
+    return strcmp((*(MsgStat_t**)a)->name, (*(MsgStat_t**)b)->name);
+}
+
+static void report(guint64 wall){
+    GPtrArray *l = g_ptr_array_new();
+    GHashTableIter it;
+    gpointer v;
+    MsgStat_t *st;
+    guint i;
+
+    g_hash_table_iter_init(&it, replay.stats);
+    while(g_hash_table_iter_next(&it, NULL, &v)){
+        g_ptr_array_add(l, v);
+    }
+    g_ptr_array_sort(l, stat_cmp);
+
+    printf("%-58s %8s %9s %9s %9s %9s\n",
+           "message", "count", "mean us", "p50 us", "p99 us", "max us");
+    for(i=0; i<l->len; i++){
+        st = g_ptr_array_index(l, i);
+        printf("%-58s %8" G_GUINT64_FORMAT " %9.2f %9.2f %9.2f %9.2f\n",
+               st->name, st->hist.total,
+               st->sum/1000.0/st->hist.total,
+               hdr_percentile(&st->hist, 50.0)/1000.0,
+               hdr_percentile(&st->hist, 99.0)/1000.0,
+               st->hist.max/1000.0);
+    }
+    printf("\nmessages %" G_GUINT64_FORMAT ", MME responses %" G_GUINT64_FORMAT
+           ", associations rejected %" G_GUINT64_FORMAT "\n",
+           replay.msgs, replay.downlink, replay.rejected);
+    if(replay.busy > 0){
+        printf("throughput %.0f msg/s in the MME, %.0f msg/s wall clock\n",
+               replay.msgs*1e9/replay.busy, replay.msgs*1e9/wall);
+    }
+    g_ptr_array_free(l, TRUE);
+}
+
+static gboolean parse_key(const char *hex, guint8 *out){
+    guint i;
+    unsigned int b;
+
+    if(strlen(hex) != 32){
+        return FALSE;
+    }
+    for(i=0; i<16; i++){
+        if(sscanf(hex+2*i, "%2x", &b) != 1){
+            return FALSE;
+        }
+        out[i] = b;
+    }
+    return TRUE;
+}
+
+static void usage(const char *prog){
+    fprintf(stderr, "Usage: %s [-n passes] [-k K -o OPc] [-l loglevel] capture.pcap\n"
+            "  The MME configuration is read from MME_CONFIG\n", prog);
+}
+
+int main(int argc, char **argv){
+    guint passes = 1, p;
+    int opt, lvl = LOG_ERR;
+    gboolean k = FALSE, o = FALSE;
+    guint64 t0;
+
+    while((opt = getopt(argc, argv, "n:k:o:l:")) != -1){
+        switch(opt){
+        case 'n':
+            passes = strtoul(optarg, NULL, 10);
+            break;
+        case 'k':
+            k = parse_key(optarg, replay.k);
+            break;
+        case 'o':
+            o = parse_key(optarg, replay.opc);
+            break;
+        case 'l':
+            lvl = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(optind >= argc || passes == 0){
+        usage(argv[0]);
+        return 1;
+    }
+    replay.haveKeys = k && o;
+
+    replay.pdus = g_ptr_array_new();
+    replay.vectors = g_array_new(FALSE, FALSE, sizeof(CapturedVector_t));
+    if(!load_pcap(argv[optind])){
+        return 1;
+    }
+    scan_vectors();
+    printf("%u S1AP messages loaded, %u authentication vectors\n",
+           replay.pdus->len, replay.vectors->len);
+    if(!replay.haveKeys){
+        printf("No K/OPc given, the captured NAS security will be rejected\n");
+        g_array_set_size(replay.vectors, 0);
+    }
+
+    init_logger("s1_replay", lvl);
+    replay.evbase = event_base_new();
+    replay.mme = (struct mme_t *)mme_init(replay.evbase);
+    if(!replay.mme){
+        fprintf(stderr, "MME initialization failed, check MME_CONFIG\n");
+        return 1;
+    }
+    replay.liveMMEId = g_hash_table_new(g_direct_hash, g_direct_equal);
+    replay.liveMTMSI = g_hash_table_new(g_direct_hash, g_direct_equal);
+    replay.mtmsi = g_hash_table_new(g_direct_hash, g_direct_equal);
+    replay.stats = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+    t0 = now_ns();
+    for(p=0; p<passes; p++){
+        run_pass();
+    }
+    report(now_ns() - t0);
+
+    mme_free(replay.mme);
+    event_base_free(replay.evbase);
+    close_logger();
+    return 0;
+}
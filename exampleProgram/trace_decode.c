@@ -0,0 +1,213 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   trace_decode.c
+ * @brief  Trace file decoder
+ *
+ * Prints the records of a mme.trace file from the oldest to the newest.
+ * The S11 requests are matched with their responses by TEID and sequence
+ * number to show the procedure latency.
+ *
+ * Usage: trace_decode <file>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tracemgr.h"
+#include "EMM_FSMConfig.h"
+#include "ECMSession_FSMConfig.h"
+#include "S1Assoc_FSMConfig.h"
+
+#define PENDING_SIZE 4096
+
+/** S11 transaction waiting for its response*/
+typedef struct{
+    uint64_t teid;
+    uint32_t seq;
+    uint64_t ts;
+    int      used;
+}Pending;
+
+static Pending pending[PENDING_SIZE];
+
+static const char *eventName[] = {"none",
+                                  "EMM",
+                                  "ECM",
+                                  "S1",
+                                  "S11 tx req",
+                                  "S11 rx rsp",
+                                  "S11 rx req",
+                                  "S11 tx rsp"};
+
+static const char *gtpName(uint16_t type){
+    switch(type){
+    case 32:  return "CreateSessionReq";
+    case 33:  return "CreateSessionRsp";
+    case 34:  return "ModifyBearerReq";
+    case 35:  return "ModifyBearerRsp";
+    case 36:  return "DeleteSessionReq";
+    case 37:  return "DeleteSessionRsp";
+    case 170: return "ReleaseAccessBearersReq";
+    case 171: return "ReleaseAccessBearersRsp";
+    case 176: return "DownlinkDataNotification";
+    case 177: return "DownlinkDataNotificationAck";
+    default:  return "GTPv2";
+    }
+}
+
+static const char *stateName(const char **names, size_t len, uint16_t s){
+    return s < len ? names[s] : "?";
+}
+
+#define STATE(names, s) stateName(names, sizeof(names)/sizeof(names[0]), s)
+
+static Pending *pending_find(uint64_t teid, uint32_t seq, int insert){
+    uint32_t i, h = (uint32_t)(teid*2654435761u ^ seq) % PENDING_SIZE;
+
+    for(i=0; i<PENDING_SIZE; i++){
+        Pending *p = &pending[(h+i)%PENDING_SIZE];
+        if(!p->used)
+            return insert ? p : NULL;
+        if(p->teid == teid && p->seq == seq)
+            return p;
+    }
+    /* Table full, reuse the home slot*/
+    return insert ? &pending[h] : NULL;
+}
+
+static void pending_remove(Pending *p){
+    uint32_t i, j, h;
+    Pending *q;
+
+    p->used = 0;
+    /* Reinsert the rest of the cluster to keep lookups correct*/
+    i = p - pending;
+    for(j=(i+1)%PENDING_SIZE; pending[j].used; j=(j+1)%PENDING_SIZE){
+        Pending tmp = pending[j];
+        pending[j].used = 0;
+        h = (uint32_t)(tmp.teid*2654435761u ^ tmp.seq) % PENDING_SIZE;
+        for(q=&pending[h]; q->used; q=&pending[(q-pending+1)%PENDING_SIZE]);
+        *q = tmp;
+    }
+}
+
+static void printRecord(const TraceFileHeader *hdr, const TraceRecord *r){
+    char date[32];
+    time_t sec;
+    uint64_t real = r->ts + hdr->realOffset;
+    Pending *p;
+
+    sec = real/1000000000ULL;
+    strftime(date, sizeof(date), "%H:%M:%S", localtime(&sec));
+    printf("%s.%06" PRIu64 " %-10s ", date,
+           (uint64_t)((real%1000000000ULL)/1000),
+           r->event < TRACE_NUM_EVENTS ? eventName[r->event] : "?");
+
+    switch(r->event){
+    case TRACE_EMM_STATE:
+        printf("imsi %" PRIu64 " %s -> %s\n", r->ue,
+               STATE(EMMStateName, r->from), STATE(EMMStateName, r->proc));
+        break;
+    case TRACE_ECM_STATE:
+        printf("mmeUEId %" PRIu64 " eNBUEId %u %s -> %s\n", r->ue, r->arg,
+               STATE(ECMStateName, r->from), STATE(ECMStateName, r->proc));
+        break;
+    case TRACE_S1ASSOC_STATE:
+        printf("eNB %#" PRIx64 " %s -> %s\n", r->ue,
+               STATE(S1AssocStateName, r->from),
+               STATE(S1AssocStateName, r->proc));
+        break;
+    case TRACE_S11_TX_REQ:
+    case TRACE_S11_RX_REQ:
+        printf("teid %#" PRIx64 " seq %u %s\n", r->ue, r->arg,
+               gtpName(r->proc));
+        p = pending_find(r->ue, r->arg, 1);
+        p->teid = r->ue;
+        p->seq = r->arg;
+        p->ts = r->ts;
+        p->used = 1;
+        break;
+    case TRACE_S11_RX_RSP:
+    case TRACE_S11_TX_RSP:
+        printf("teid %#" PRIx64 " seq %u %s", r->ue, r->arg, gtpName(r->proc));
+        p = pending_find(r->ue, r->arg, 0);
+        if(p){
+            printf(" (%.3f ms)", (r->ts - p->ts)/1e6);
+            pending_remove(p);
+        }
+        printf("\n");
+        break;
+    default:
+        printf("ue %" PRIu64 " proc %u from %u arg %u\n",
+               r->ue, r->proc, r->from, r->arg);
+    }
+}
+
+int main(int argc, char **argv){
+    int fd;
+    struct stat st;
+    const TraceFileHeader *hdr;
+    const TraceRecord *ring;
+    uint64_t i, first;
+
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+    fd = open(argv[1], O_RDONLY);
+    if(fd < 0 || fstat(fd, &st) != 0){
+        perror(argv[1]);
+        return 1;
+    }
+    if(st.st_size < (off_t)sizeof(TraceFileHeader)){
+        fprintf(stderr, "%s: file too short\n", argv[1]);
+        return 1;
+    }
+    hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(hdr == MAP_FAILED){
+        perror("mmap");
+        return 1;
+    }
+    if(hdr->magic != TRACE_MAGIC || hdr->version != TRACE_VERSION
+       || hdr->recordSize != sizeof(TraceRecord)
+       || st.st_size < (off_t)(sizeof(TraceFileHeader)
+                               + hdr->capacity*sizeof(TraceRecord))){
+        fprintf(stderr, "%s: not a valid trace file\n", argv[1]);
+        return 1;
+    }
+    ring = (const TraceRecord *)(hdr + 1);
+
+    first = hdr->head > hdr->capacity ? hdr->head - hdr->capacity : 0;
+    for(i=first; i<hdr->head; i++){
+        printRecord(hdr, &ring[i % hdr->capacity]);
+    }
+    fprintf(stderr, "%" PRIu64 " records, %" PRIu64 " overwritten\n",
+            hdr->head - first, first);
+    munmap((void *)hdr, st.st_size);
+    return 0;
+}
@@ -51,6 +51,14 @@
 #include "ECMSession.h"
 #include "NAS_EMM.h"
 #include "nodemgr.h"
+#include "tracemgr.h"
+#include "uetrace.h"
+#include "snapshot.h"
+#include "tmsi.h"
+#include "overload.h"
+#include "admission.h"
+#include "rng.h"
+#include "metrics.h"
 
 
 /**@brief Simple UDP creation
@@ -148,6 +156,7 @@ bool mme_init_ifaces(struct mme_t *self){
     /*LibEvent structures*/
     struct event_base *base;
     uint32_t addr = 0;
+    gboolean restored;
 
     self->s6a = s6a_init((gpointer)self);
     if(!(self->s6a)){
@@ -166,6 +175,11 @@ bool mme_init_ifaces(struct mme_t *self){
         goto err_s11;
     }
 
+    /*Restore the UEs before the eNBs connect. After a takeover the snapshot
+     * on disk may be older than the replica*/
+    restored = replica_restore();
+    snapshot_init(self, self->stateDir, self->snapshotInterval, !restored);
+
     /*Init S1 server*/
     self->s1 = s1_init((gpointer)self);
     if(!(self->s1)){
@@ -177,12 +191,15 @@ bool mme_init_ifaces(struct mme_t *self){
     if(!(self->sdnCtrl)){
         goto err_sdnCtrl;
     }
+
+    replica_serve();
     return true;
 
  err_sdnCtrl:
     sdnCtrl_free(self->sdnCtrl);
  err_s1:
     s1_free(self->s1);
+    snapshot_free();
  err_s11:
     s11_free(self->s11);
  err_cmd:
@@ -194,20 +211,47 @@ void mme_close_ifaces(struct mme_t *self){
     sdnCtrl_free(self->sdnCtrl);
     s6a_free(self->s6a);
     servcommand_stop(self->cmd);
+    snapshot_free();
     s11_free(self->s11);
     s1_free(self->s1);
 }
 
 
-void mme_registerRead(struct mme_t *self, int fd, event_callback_fn cb, void * args){
-    struct event *ev;
+/**
+ * Read event of a registered socket*/
+typedef struct{
+    struct event      *ev;
+    event_callback_fn cb;
+    void              *args;
+    LoopProfSlot      slot;
+}ReadEvent_t;
+
+static void mme_readCb(evutil_socket_t fd, short event, void *arg){
+    ReadEvent_t *r = (ReadEvent_t *)arg;
+    /* r is not accessed after the callback, it may deregister the fd*/
+    loopprof_enter(r->slot);
+    r->cb(fd, event, r->args);
+    loopprof_leave();
+}
+
+static void mme_freeReadEvent(ReadEvent_t *r){
+    event_free(r->ev);
+    g_free(r);
+}
+
+void mme_registerRead(struct mme_t *self, int fd, LoopProfSlot slot,
+                      event_callback_fn cb, void * args){
+    ReadEvent_t *r = g_new(ReadEvent_t, 1);
     int *_fd = g_new(gint, 1);
     *_fd = fd;
     log_msg(LOG_DEBUG, 0, "ENTER, fd %u", fd);
-    ev = event_new(self->evbase, fd, EV_READ|EV_PERSIST, (event_callback_fn)cb, args);
+    r->cb = cb;
+    r->args = args;
+    r->slot = slot;
+    r->ev = event_new(self->evbase, fd, EV_READ|EV_PERSIST, mme_readCb, r);
     evutil_make_socket_nonblocking(fd);
-    event_add(ev, NULL);
-    g_hash_table_insert(self->ev_readers, _fd, ev);
+    event_add(r->ev, NULL);
+    g_hash_table_insert(self->ev_readers, _fd, r);
 }
 
 void test_lprint(gpointer data, gpointer user){
@@ -238,9 +282,16 @@ void freeMsg(void *msg){
     free((struct t_message *)msg);
 }
 
+static uint32_t nextTeid = 1;
+
 unsigned int newTeid(){
-    static uint32_t i = 1;
-    return i++;
+    return nextTeid++;
+}
+
+void mme_reserveTeid(uint32_t teid){
+    if(teid >= nextTeid){
+        nextTeid = teid + 1;
+    }
 }
 
 uint32_t mme_newLocalUEid(struct mme_t *self){
@@ -276,6 +327,13 @@ const char *mme_getStateDir(const struct mme_t *mme){
     return mme->stateDir;
 }
 
+void mme_getS11PathCfg(const struct mme_t *mme, guint *echoInterval,
+                       guint *t3, guint *n3){
+    *echoInterval = mme->s11_echoInterval;
+    *t3 = mme->s11_t3;
+    *n3 = mme->s11_n3;
+}
+
 TimerMgr mme_getTimerMgr(struct mme_t *self){
     return self->tm;
 }
@@ -303,15 +361,22 @@ void mme_registerEMMCtxt(struct mme_t *self, gpointer emm){
 }
 
 void mme_deregisterEMMCtxt(struct mme_t *self, gpointer emm){
-    if(g_hash_table_remove(self->emm_sessions, emm_getM_TMSI_p(emm)) != TRUE){
+    guint32 mtmsi = *emm_getM_TMSI_p(emm);
+    if(g_hash_table_remove(self->emm_sessions, &mtmsi) != TRUE){
         log_msg(LOG_ERR, 0, "Unable to find EMM session");
+        return;
     }
+    tmsi_release(mtmsi);
 }
 
 void mme_lookupEMMCtxt(struct mme_t *self, const guint32 m_tmsi, gpointer *emm){
     *emm = g_hash_table_lookup(self->emm_sessions, &m_tmsi);
 }
 
+void mme_foreachEMMCtxt(struct mme_t *self, GHFunc func, gpointer user_data){
+    g_hash_table_foreach(self->emm_sessions, func, user_data);
+}
+
 void mme_lookupEMMCtxt_byIMSI(struct mme_t *self, const guint64 imsi, gpointer *emm){
     GHashTableIter iter;
     gpointer key, value;
@@ -445,6 +510,18 @@ void kill_handler(evutil_socket_t listener, short event, void *arg){
     mme_stop(mme);
 }
 
+/* The active MME is lost, the standby opens the interfaces*/
+static void mme_takeover(gpointer mme){
+    struct mme_t *self = (struct mme_t *)mme;
+
+    if(!mme_init_ifaces(self)){
+        log_msg(LOG_ERR, 0, "Takeover failed, stopping");
+        /* Freed by mme_init_ifaces*/
+        self->s1 = NULL;
+        event_base_loopbreak(self->evbase);
+    }
+}
+
 MME mme_init(struct event_base *evbase){
     struct mme_t *self;
     GError *err = NULL;
@@ -485,11 +562,15 @@ MME mme_init(struct event_base *evbase){
         goto err1;
     }
 
+    init_tracer(self->stateDir, self->traceRecords);
+    init_loopprof(self->watchdogMs*1000);
+    uetrace_init(self->stateDir);
+
     self->ev_readers =
         g_hash_table_new_full(g_int_hash,
                               g_int_equal,
                               g_free,
-                              (GDestroyNotify) event_free);
+                              (GDestroyNotify) mme_freeReadEvent);
     self->s1_localIDs =
         g_hash_table_new_full(g_int_hash,
                               g_int_equal,
@@ -510,17 +591,36 @@ MME mme_init(struct event_base *evbase){
                               (GEqualFunc) globaleNBID_Equal,
                               NULL,
                               NULL);
+
+    metrics_init(self, self->metricsAddr, self->metricsPort);
+    overload_init(self);
+    admission_init(self);
+
+    if(!replica_init(self, self->replicaRole, self->replicaAddr,
+                     self->replicaFlushMs, mme_takeover)){
+        goto err_ifaces;
+    }
+    /* The standby opens the interfaces when it takes over*/
+    if(self->replicaRole == REPLICA_STANDBY){
+        return self;
+    }
+
     if(!mme_init_ifaces(self)){
         goto err_ifaces;
     };
     return self;
 
  err_ifaces:
+    replica_free();
+    overload_free();
+    metrics_free();
     g_hash_table_destroy(self->s1_by_GeNBid);
     g_hash_table_destroy(self->emm_sessions);
     g_hash_table_destroy(self->ecm_sessions_by_localID);
     g_hash_table_destroy(self->s1_localIDs);
     g_hash_table_destroy(self->ev_readers);
+    uetrace_free();
+    close_tracer();
     freeMMEinfo(self);
 
  err1:
@@ -533,7 +633,13 @@ MME mme_init(struct event_base *evbase){
 
 void mme_free(MME mme){
     struct mme_t *self = (struct mme_t *)mme;
-    mme_close_ifaces(self);
+    /* The last changes are sent while the S11 users exist*/
+    replica_free();
+    if(self->s1){
+        mme_close_ifaces(self);
+    }
+    overload_free();
+    metrics_free();
 
     event_free(self->kill_event);
 
@@ -542,7 +648,11 @@ void mme_free(MME mme){
     g_hash_table_destroy(self->ecm_sessions_by_localID);
     g_hash_table_destroy(self->s1_localIDs);
     g_hash_table_destroy(self->ev_readers);
+    tmsi_free();
+    rng_free();
 
+    uetrace_free();
+    close_tracer();
     freeMMEinfo(self);
     free_nodemgr();
     free_timerMgr(self->tm);
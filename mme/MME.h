@@ -43,6 +43,7 @@
 #include <glib.h>
 
 #include "Subscription.h"
+#include "loopprof.h"
 
 #include "gtp.h"
 #include "NAS_Definitions.h"
@@ -50,6 +51,9 @@
 #include "S6a.h"
 #include "EMM_FSMConfig.h"
 #include "timermgr.h"
+#include "replica.h"
+#include "overload.h"
+#include "admission.h"
 
 #define MAX_UE 500000 /*< Max number of active users on this MME*/
 #define FIRST_UE_SCTP_STREAM 1 /*< The minimum UE SCTP stream value*/
@@ -86,6 +90,19 @@ struct mme_t{
     char                    ipv4[INET_ADDRSTRLEN];
     char                    ipv6[INET6_ADDRSTRLEN]; /* Not used*/
     gchar                   *stateDir;
+    guint                   s11_echoInterval;                /*< S11 Echo Request interval (s)*/
+    guint                   s11_t3;                          /*< S11 Echo response timeout (s)*/
+    guint                   s11_n3;                          /*< S11 Echo retransmissions*/
+    guint                   traceRecords;                    /*< Trace ring size, 0 disabled*/
+    guint16                 metricsPort;                     /*< Metrics HTTP port, 0 disabled*/
+    gchar                   *metricsAddr;                    /*< Metrics HTTP address, NULL loopback*/
+    guint                   watchdogMs;                      /*< Event loop watchdog (ms), 0 disabled*/
+    guint                   snapshotInterval;                /*< UE snapshot interval (s), 0 disabled*/
+    ReplicaRole             replicaRole;                     /*< Hot-standby role on start*/
+    gchar                   *replicaAddr;                    /*< Replication socket path or ip:port*/
+    guint                   replicaFlushMs;                  /*< Replication update period (ms)*/
+    OverloadCfg             overload;                        /*< Overload control thresholds*/
+    AdmissionCfg            admission;                       /*< NAS procedure rate limits*/
     ServedGUMMEIs_t         *servedGUMMEIs;
     RelativeMMECapacity_t   *relativeCapacity;
     gchar                   *s6a_db_host;
@@ -118,6 +135,12 @@ extern void kill_handler(evutil_socket_t listener, short event, void *arg);
 
 extern unsigned int newTeid();
 
+/**
+ * @brief Keep newTeid from allocating a TEID already in use
+ * @param [in] teid TEID of a restored session
+ */
+extern void mme_reserveTeid(uint32_t teid);
+
 extern uint32_t mme_newLocalUEid(struct mme_t *self);
 
 extern void mme_freeLocalUEid(struct mme_t *self, uint32_t id);
@@ -133,6 +156,9 @@ extern const char *mme_getLocalAddress(const struct mme_t *mme);
 
 extern const char *mme_getStateDir(const struct mme_t *mme);
 
+extern void mme_getS11PathCfg(const struct mme_t *mme, guint *echoInterval,
+                              guint *t3, guint *n3);
+
 /**************************************************/
 /* API towards state machines                     */
 /**************************************************/
@@ -151,13 +177,14 @@ TimerMgr mme_getTimerMgr(struct mme_t *self);
  * @brief Register a read callback for a socket
  * @param [in] self MME pointer
  * @param [in] fd   File descriptor to register
+ * @param [in] slot Profiler slot accounting the callback
  * @param [in] cb   Callback invoked when the fd becomes active
  * @param [in] args Arguments used in the callback
  *
  * The socket needs to be deregistered before exiting the program with
  * the function mme_deregisterRead
  */
-void mme_registerRead(struct mme_t *self, int fd,
+void mme_registerRead(struct mme_t *self, int fd, LoopProfSlot slot,
                       event_callback_fn cb, void * args);
 
 /**
@@ -187,6 +214,11 @@ void mme_lookupEMMCtxt(struct mme_t *self, const guint32 m_tmsi, gpointer *emm);
 
 void mme_lookupEMMCtxt_byIMSI(struct mme_t *self, const guint64 imsi, gpointer *emm);
 
+/**
+ * @brief Call func for each EMM context registered with a GUTI
+ */
+void mme_foreachEMMCtxt(struct mme_t *self, GHFunc func, gpointer user_data);
+
 
 void mme_registerECM(struct mme_t *self, gpointer ecm);
 
@@ -32,12 +32,16 @@
 #include "ECMSession_FSMConfig.h"
 #include "S1AP.h"
 #include "logmgr.h"
+#include "tracemgr.h"
 #include "NAS_EMM.h"
+#include "EMMCtx_iface.h"
+#include "metrics.h"
+#include "slab.h"
 #include "MME_S1_priv.h"
 #include "EPS_Session.h"
 #include "ESM_BearerContext.h"
+#include "tmsi.h"
 
-#include "hmac_sha2.h"
 #include <string.h>
 
 
@@ -47,7 +51,7 @@ void ecm_log_(ECMSession ecm, int pri, char *fn, const char *func, int ln,
     va_list args;
     char buf[SYSERR_MSGSIZE];
     size_t len;
-    bzero(buf, SYSERR_MSGSIZE);
+    buf[0] = '\0';
 
     if(self){
         snprintf(buf, SYSERR_MSGSIZE, "%s %s (%u/%u): ",
@@ -60,27 +64,45 @@ void ecm_log_(ECMSession ecm, int pri, char *fn, const char *func, int ln,
 
     len = strlen(buf);
     va_start(args, fmt);
-    vsnprintf(buf+len, SYSERR_MSGSIZE, fmt, args);
+    vsnprintf(buf+len, SYSERR_MSGSIZE-len, fmt, args);
     buf[SYSERR_MSGSIZE-1] = 0; /* Make sure it is null terminated */
     log_msg_s(pri, fn, func, ln, en, buf);
     va_end(args);
 }
 
 
+static void ecmSession_captureRx(ECMSession_t *self){
+    S1Assoc_t *assoc = (S1Assoc_t *)self->assoc;
+    if(assoc->rxPDU)
+        emmCtx_capture(self->emm, UETRACE_S1AP, assoc->rxPDU, assoc->rxPDULen);
+}
+
+static Slab ecmPool = NULL;
+
 /* API to S1AP */
 ECMSession ecmSession_init(S1Assoc s1, S1AP_Message_t *s1msg, int r_sid){
-    ECMSession_t *self = g_new0(ECMSession_t, 1);
+    ECMSession_t *self;
     struct mme_t * mme = s1_getMME(s1Assoc_getS1(s1));
+
+    if(!ecmPool){
+        ecmPool = slab_new("ecm_session", sizeof(ECMSession_t), MA_ECM_SESSION);
+    }
+    self = slab_alloc0(ecmPool);
     self->assoc = s1;
     self->mmeUEId = mme_newLocalUEid(mme);
     self->r_sid = r_sid;
     self->r_sid_valid = FALSE;
+    metrics.ecmUEs[self->stateName]++;
 
     /* Initial state for ECM FSM*/
     ecm_ChangeState(self, ECM_Idle);
 
     self->state->processMsg(self, s1msg, r_sid);
 
+    /* The UE identity is known after processing the Initial UE Message*/
+    if(G_UNLIKELY(self->flags & ECM_FLAG_TRACE))
+        ecmSession_captureRx(self);
+
     s1Assoc_registerECMSession(s1, self);
 
     mme_registerECM(mme, self);
@@ -89,11 +111,15 @@ ECMSession ecmSession_init(S1Assoc s1, S1AP_Message_t *s1msg, int r_sid){
 
 void ecmSession_free(ECMSession h){
     ECMSession_t *self = (ECMSession_t *)h;
-    emm_deregister(self->emm);
     struct mme_t * mme = s1_getMME(s1Assoc_getS1(self->assoc));
 
+    /* The UEs rejected on admission have no EMM context*/
+    if(self->emm)
+        emm_deregister(self->emm);
+
     mme_freeLocalUEid(mme, self->mmeUEId);
-    g_free(self);
+    metrics.ecmUEs[self->stateName]--;
+    slab_free(ecmPool, self);
 }
 
 S1Assoc ecmSession_getS1Assoc(ECMSession h){
@@ -103,7 +129,8 @@ S1Assoc ecmSession_getS1Assoc(ECMSession h){
 
 void ecmSession_reset(ECMSession h){
     ECMSession_t *self = (ECMSession_t *)h;
-    emm_stop(self->emm);
+    if(self->emm)
+        emm_stop(self->emm);
 }
 
 void ecmSession_setEMM(ECMSession h, gpointer emm){
@@ -113,6 +140,8 @@ void ecmSession_setEMM(ECMSession h, gpointer emm){
 
 void ecmSession_processMsg(ECMSession h, S1AP_Message_t *s1msg, int r_sid){
     ECMSession_t *self = (ECMSession_t *)h;
+    if(G_UNLIKELY(self->flags & ECM_FLAG_TRACE))
+        ecmSession_captureRx(self);
     self->state->processMsg(self, s1msg, r_sid);
 }
 
@@ -183,7 +212,7 @@ static void ecmSession_sendPathSwitchReqAck(ECMSession h){
 
     /* Send Response*/
     /*s1out->showmsg(s1out);*/
-    s1Assoc_send(self->assoc, self->l_sid, s1out);
+    ecm_s1Send(self, s1out);
     s1out->freemsg(s1out);
 }
 
@@ -224,6 +253,9 @@ void ecmSession_pathSwitchReq(ECMSession h, S1Assoc newAssoc,
 
 void ecmSession_setState(ECMSession ecm, ECMSession_State *s, ECMSessionState name){
     ECMSession_t *self = (ECMSession_t *)ecm;
+    trace_event(TRACE_ECM_STATE, self->mmeUEId, name, self->stateName,
+                self->eNBUEId);
+    metric_ecmState(self->stateName, name);
     self->state = s;
     self->stateName = name;
 }
@@ -252,6 +284,12 @@ const guint32 ecmSession_getLocalSid(const ECMSession h){
 }
 
 
+void ecm_s1Send(ECMSession h, S1AP_Message_t *s1msg){
+    ECMSession_t *self = (ECMSession_t *)h;
+    s1Assoc_sendUE(self->assoc, self->l_sid, s1msg,
+                   G_UNLIKELY(self->flags & ECM_FLAG_TRACE) ? self->emm : NULL);
+}
+
 /* API to NAS */
 void ecm_send(ECMSession h, gpointer msg, size_t len){
     S1AP_Message_t *s1out;
@@ -267,6 +305,9 @@ void ecm_send(ECMSession h, gpointer msg, size_t len){
         return;
     }
 
+    if(G_UNLIKELY(self->flags & ECM_FLAG_TRACE))
+        emmCtx_capture(self->emm, UETRACE_NAS, msg, len);
+
     s1out = S1AP_newMsg();
     s1out->choice = initiating_message;
     s1out->pdu->procedureCode = id_downlinkNASTransport;
@@ -286,7 +327,7 @@ void ecm_send(ECMSession h, gpointer msg, size_t len){
     nAS_PDU->str = msg;
 
     /*s1out->showmsg(s1out);*/
-    s1Assoc_send(self->assoc, self->l_sid, s1out);
+    ecm_s1Send(self, s1out);
     s1out->freemsg(s1out);
 }
 
@@ -345,6 +386,8 @@ void ecm_sendCtxtSUReq(ECMSession h, gpointer msg, size_t len, GList *bearers){
     /* NAS-PDU*/
     /* NAS PDU is optional */
     if(msg && len>0){
+        if(G_UNLIKELY(self->flags & ECM_FLAG_TRACE))
+            emmCtx_capture(self->emm, UETRACE_NAS, msg, len);
         eRABitem->opt |=0x80;
         eRABitem->nAS_PDU = new_Unconstrained_Octed_String();
         eRABitem->nAS_PDU->str = msg;
@@ -383,7 +426,7 @@ void ecm_sendCtxtSUReq(ECMSession h, gpointer msg, size_t len, GList *bearers){
 
 
     /*s1out->showmsg(s1out);*/
-    s1Assoc_send(self->assoc, self->l_sid, s1out);
+    ecm_s1Send(self, s1out);
     s1out->freemsg(s1out);
 }
 
@@ -445,10 +488,9 @@ void ecmSession_getGUMMEI(const ECMSession h, guint32* sn, guint16 *mmegi, guint
 
 void ecmSession_newGUTI(ECMSession h, guti_t *guti){
     ECMSession_t *self = (ECMSession_t *)h;
-    guint32 sn, r;
+    guint32 sn;
     guint16 mmegi;
     guint8 mmec;
-    guint64 n;
     struct mme_t *mme = s1_getMME(s1Assoc_getS1(self->assoc));
 
     ecmSession_getGUMMEI(self, &sn, &mmegi, &mmec);
@@ -456,11 +498,7 @@ void ecmSession_newGUTI(ECMSession h, guti_t *guti){
     guti->mmegi = mmegi;
     guti->mmec = mmec;
 
-    /* M-TMSI IMSI hash salted with random number*/
-    srand(time(NULL));
-    r = rand();
-    n =  emm_getIMSI(self->emm) ^ ((guint64)r & ((guint64)r)<<32);
-    guti->mtmsi = g_int64_hash(&n);
+    guti->mtmsi = tmsi_new(mme);
 
     mme_registerEMMCtxt(mme, self->emm);
 }
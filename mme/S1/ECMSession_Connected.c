@@ -90,6 +90,7 @@ static void processMsg(gpointer _ecm, S1AP_Message_t *s1msg, int r_sid){
             return;
         }
         ecm_log(ecm, LOG_DEBUG, 0, "Received InitialContextSetupResponse");
+        emmCtx_procEnd(ecm->emm, MP_SERVICE_REQ);
         list = s1ap_findIe(s1msg, id_E_RABSetupListCtxtSURes);
         emm_modifyE_RABList(ecm->emm, list, NULL, NULL);
     }else if(s1msg->pdu->procedureCode ==  id_InitialContextSetup &&
@@ -105,6 +106,10 @@ static void processMsg(gpointer _ecm, S1AP_Message_t *s1msg, int r_sid){
             ecm_log(ecm, LOG_WARNING, 0, "Received id_uplinkNASTransport with incorrect IDs");
             return;
         }
+        if(!ecm->emm){
+            ecm_log(ecm, LOG_INFO, 0, "Ignoring NAS message, UE not admitted");
+            return;
+        }
         nASPDU = (Unconstrained_Octed_String_t*)s1ap_findIe(s1msg, id_NAS_PDU);
         emm_processMsg(ecm->emm, nASPDU->str, nASPDU->len);
     }else if(s1msg->pdu->procedureCode == id_HandoverNotification &&
@@ -177,10 +182,11 @@ static void release(gpointer _ecm, cause_choice_t choice, uint32_t cause){
     case CauseProtocol:
         break;
     case CauseMisc:
+        c->cause.misc.cause.noext = cause;
         break;
     }
     /*s1out->showmsg(s1out);*/
-    s1Assoc_send(ecm->assoc, ecm->l_sid, s1out);
+    ecm_s1Send(ecm, s1out);
     s1out->freemsg(s1out);
 }
 
@@ -209,7 +215,7 @@ static void sendUEContextReleaseCommand(gpointer _ecm){
     s1ap_setValueOnNewIE(s1out, id_Cause, mandatory, ignore, (GenericVal_t *)(ecm->causeRelease));
 
     /*s1out->showmsg(s1out);*/
-    s1Assoc_send(ecm->assoc, ecm->l_sid, s1out);
+    ecm_s1Send(ecm, s1out);
     s1out->freemsg(s1out);
 }
 
@@ -232,5 +238,9 @@ void ecm_UEContextRelease(gpointer ecm_h, S1AP_Message_t *s1msg){
       "UE Not Available for PS Service"
     */
     ecm->causeRelease = c;
+    if(!ecm->emm){
+        sendUEContextReleaseCommand(ecm);
+        return;
+    }
     emm_UEContextReleaseReq(ecm->emm, sendUEContextReleaseCommand, ecm);
 }
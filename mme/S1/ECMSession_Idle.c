@@ -33,6 +33,22 @@
 #include "NAS_EMM.h"
 #include "S1Assoc_priv.h"
 #include "NAS_Definitions.h"
+#include "admission.h"
+
+/* Rejects a request over the admission limits without an EMM context, the
+ * S1 connection is released after the NAS Reject*/
+static void ecm_rejectAdmission(ECMSession_t *ecm, AdmissionClass c){
+    guint8 buf[16];
+    gsize len;
+
+    ecm_log(ecm, LOG_INFO, 0, "%s Request over the admission limit, rejected",
+            admissionClassName[c]);
+    len = admission_reject(c, buf);
+    ecm_ChangeState(ecm, ECM_Connected);
+    ecm_send(ecm, buf, len);
+    ecm_sendUEContextReleaseCommand(ecm, CauseMisc,
+                                    CauseMisc_control_processing_overload);
+}
 
 static void ecm_processMsg(gpointer _ecm, S1AP_Message_t *s1msg, int r_sid){
     ECMSession_t *ecm = (ECMSession_t *)_ecm;
@@ -46,6 +62,8 @@ static void ecm_processMsg(gpointer _ecm, S1AP_Message_t *s1msg, int r_sid){
     S_TMSI_t *sTMSI = NULL;
     guint32 mtmsi;
     guint64 imsi;
+    AdmissionClass adm;
+    gboolean emergency;
     struct mme_t * mme = s1_getMME(s1Assoc_getS1(ecm->assoc));
     memset(&guti, 0, sizeof(guti_t));
 
@@ -70,6 +88,16 @@ static void ecm_processMsg(gpointer _ecm, S1AP_Message_t *s1msg, int r_sid){
             ecm->r_sid = r_sid;
         }
 
+        /* Before the EMM context and the HSS query*/
+        adm = admission_classify(nASPDU->str, nASPDU->len,
+                                 cause && !cause->ext &&
+                                 cause->cause.noext == RRC_emergency,
+                                 &emergency);
+        if(!admission_check(s1Assoc_getAdmission(ecm->assoc), adm, emergency)){
+            ecm_rejectAdmission(ecm, adm);
+            return;
+        }
+
         sTMSI = (S_TMSI_t*)s1ap_findIe(s1msg, id_S_TMSI);
         if(sTMSI){
             memcpy(&mtmsi, sTMSI->m_TMSI.s, 4);
@@ -29,6 +29,7 @@
 #define ECMSESSION_PRIV_HFILE
 
 #include <glib.h>
+#include "logmgr.h"
 #include "NAS.h"
 #include "ECMSession.h"
 #include "ECMSession_State.h"
@@ -37,11 +38,15 @@
 /*API HACK*/
 typedef  E_RABSetupListCtxtSURes_t E_RABsToBeModified_t;
 
+/* ECMSession_t flags*/
+#define ECM_FLAG_TRACE  0x01       /**< UE trace active, see emmCtx_updateTrace*/
+
 typedef struct{
     S1Assoc          assoc;        /**< Lower layer*/
     gpointer         emm;          /**< Higher layer*/
     ECMSession_State *state;       /**< FSM */
     ECMSessionState  stateName;
+    guint8           flags;        /**< ECM_FLAG_* */
     guint32          l_sid;        /**< SCTP local  Stream ID*/
     gboolean         r_sid_valid;  /**< SCTP remote sid valid flag*/
     guint32          r_sid;        /**< SCTP remote Stream ID*/
@@ -63,7 +68,10 @@ typedef struct{
     Cause_t     *causeRelease;
 }ECMSession_t;
 
-#define ecm_log(self, p, en, ...) ecm_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__)
+#define ecm_log(self, p, en, ...) do{                                  \
+        if(log_enabled(p))                                              \
+            ecm_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__); \
+    }while(0)
 
 void ecm_log_(ECMSession ecm, int pri, char *fn, const char *func, int ln,
               int en, char *fmt, ...);
@@ -82,6 +90,14 @@ void ecmSession_setState(ECMSession ecm, ECMSession_State *s, ECMSessionState na
  * */
 void ecm_send(ECMSession h, gpointer msg, size_t len);
 
+/**@brief Send an UE associated S1AP message
+ * @param [in] h        ECM Session handler
+ * @param [in] s1msg    Message to be sent
+ *
+ * The message is captured if the UE is traced
+ * */
+void ecm_s1Send(ECMSession h, S1AP_Message_t *s1msg);
+
 void ecm_sendCtxtSUReq(ECMSession h, gpointer msg, size_t len, GList *bearers);
 
 const guint8 *ecmSession_getServingNetwork_TBCD(const ECMSession h);
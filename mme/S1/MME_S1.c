@@ -34,7 +34,6 @@
 #include "MME_S1.h"
 #include "MME_S1_priv.h"
 #include "logmgr.h"
-#include "hmac_sha2.h"
 #include "S1Assoc.h"
 #include "S1Assoc_FSMConfig.h"
 
@@ -77,7 +76,7 @@ gpointer s1_init(gpointer mme){
     log_msg(LOG_INFO, 0, "Open S1 server on file descriptor %d, port %d",
             self->fd, S1AP_PORT);
 
-    mme_registerRead(self->mme, self->fd, s1_accept_new_eNB, self);
+    mme_registerRead(self->mme, self->fd, LP_S1_ACCEPT, s1_accept_new_eNB, self);
 
     self->assocs = g_hash_table_new_full( g_int_hash,
                                           g_int_equal,
@@ -112,42 +111,3 @@ void s1_deregisterAssoc(S1 s1_h, gpointer assoc){
 struct mme_t *s1_getMME(S1_t *self){
     return self->mme;
 }
-
-/* ======================================================================
- * S1 Private Tool functions
- * ====================================================================== */
-
-/**
- * @brief generate_NH -
- * @param [inout]  sec      security context
- *
- * fill the security context with a new derived NH (next hop) parameter with
- * the KDF function
- */
-static void refresh_NH(SecurityCtx_t* sec){
-
-    /*
-    -    FC = 0x12
-    -    P0 = SYNC-input
-    -    L0 = length of SYNC-input (i.e. 0x00 0x20)
-    The SYNC-input parameter shall be the newly derived K eNB  for the initial NH derivation, and the previous NH for all
-    subsequent derivations. This results in a NH chain, where the next NH is always fresh and derived from the previous
-    NH.
-     */
-
-    uint8_t s[35], zero[32];
-    memset(zero, 0, 32);
-
-    s[0]=0x12;
-    if(memcmp(sec->nh, zero, 32)==0){
-        /*First hop*/
-        memcpy(s+1, sec->keNB, 32);
-    }else{
-        memcpy(s+1, sec->nh, 32);
-        sec->ncc++;
-    }
-    s[33]=0;
-    s[34]=0x20;
-
-    hmac_sha256(sec->kASME, 32, s, 35, sec->nh, 32);
-}
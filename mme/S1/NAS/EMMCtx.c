@@ -27,8 +27,14 @@
 #include <string.h>
 #include "EMMCtx.h"
 #include "logmgr.h"
+#include "tracemgr.h"
+#include "metrics.h"
+#include "memacct.h"
+#include "slab.h"
+#include "replica.h"
 #include "ECMSession_priv.h"
 #include "EMM_FSMConfig.h"
+#include "NAS_ESM.h"
 
 #include <time.h>
 #include <stdlib.h>
@@ -40,7 +46,7 @@ void emm_log_(EMMCtx s, int pri, char *fn, const char *func, int ln,
     va_list args;
     char buf[SYSERR_MSGSIZE];
     size_t len;
-    bzero(buf, SYSERR_MSGSIZE);
+    buf[0] = '\0';
 
     snprintf(buf, SYSERR_MSGSIZE, "%s %" PRIu64": ",
              EMMStateName[self->stateName],
@@ -48,7 +54,7 @@ void emm_log_(EMMCtx s, int pri, char *fn, const char *func, int ln,
 
     len = strlen(buf);
     va_start(args, fmt);
-    vsnprintf(buf+len, SYSERR_MSGSIZE, fmt, args);
+    vsnprintf(buf+len, SYSERR_MSGSIZE-len, fmt, args);
     buf[SYSERR_MSGSIZE-1] = 0; /* Make sure it is null terminated */
     log_msg_s(pri, fn, func, ln, en, buf);
     va_end(args);
@@ -59,15 +65,27 @@ void freeESMmsg(gpointer msg){
     g_byte_array_free(array, TRUE);
 }
 
+static Slab emmPool = NULL;
+
+static void freeAuthQuadruplet(gpointer a){
+    ma_free(MA_AUTH_VECTOR, AuthQuadruplet, a);
+}
+
 EMMCtx emmCtx_init(){
-    EMMCtx_t *self = g_new0(EMMCtx_t, 1);
+    EMMCtx_t *self;
+
+    if(!emmPool){
+        emmPool = slab_new("emm_ctx", sizeof(EMMCtx_t), MA_EMM_CTX);
+    }
+    self = slab_alloc0(emmPool);
 
+    metrics.emmUEs[self->stateName]++;
+    self->proc = MP_NUM;
     self->subs = subs_init();
 
-    self->authQuadrs = g_ptr_array_new_full (5, g_free);
-    self->authQuints = g_ptr_array_new_full (5, g_free);
+    self->authQuadrs = g_ptr_array_new_full (5, freeAuthQuadruplet);
 
-    self->pendingESMmsg = g_ptr_array_new_full (5, freeESMmsg);
+    /* pendingESMmsg is allocated with the first ESM message*/
     self->attachStarted = FALSE;
 
     self->ksi = 7;
@@ -90,11 +108,47 @@ EMMCtx emmCtx_init(){
 void emmCtx_free(EMMCtx s){
     EMMCtx_t *self = (EMMCtx_t*)s;
     g_ptr_array_free (self->authQuadrs, TRUE);
-    g_ptr_array_free (self->authQuints, TRUE);
-    g_ptr_array_free (self->pendingESMmsg, TRUE);
+    if(self->pendingESMmsg)
+        g_ptr_array_free (self->pendingESMmsg, TRUE);
 
+    if(self->trace)
+        uetrace_unref(self->trace);
+    metrics.emmUEs[self->stateName]--;
     subs_free(self->subs);
-    g_free(self);
+    kdf_clearKey(&(self->kasmeKdf));
+    slab_free(emmPool, self);
+}
+
+void emmCtx_footprint(const EMMCtx emm, MemAcctUE *ue, guint *state,
+                      gboolean *connected){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    guint i;
+
+    ue->objects[MA_EMM_CTX]++;
+    ue->objects[MA_NAS_PARSER]++;
+    ue->objects[MA_SUBSCRIPTION] += 2;  /* Subs_t and its PDN context*/
+    ue->objects[MA_AUTH_VECTOR] += self->authQuadrs->len;
+    for(i=0; i<EMM_NUM_TIMERS; i++){
+        if(self->timers[i].tm){
+            ue->objects[MA_TIMER]++;
+        }
+    }
+    if(self->ecm){
+        ue->objects[MA_ECM_SESSION]++;
+    }
+    esm_footprint(self->esm, ue);
+
+    *state = self->stateName;
+    *connected = self->ecm != NULL;
+}
+
+void emmCtx_compact(EMMCtx emm){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+
+    if(self->pendingESMmsg && self->pendingESMmsg->len == 0){
+        g_ptr_array_free(self->pendingESMmsg, TRUE);
+        self->pendingESMmsg = NULL;
+    }
 }
 
 void emm_setState(EMMCtx emm_h, EMM_State *s, EMMState stateName){
@@ -103,6 +157,9 @@ void emm_setState(EMMCtx emm_h, EMM_State *s, EMMState stateName){
     self->state = s;
     self->stateName = stateName;
     emm_log(self, LOG_INFO, 0, "state change from %s", EMMStateName[old]);
+    trace_event(TRACE_EMM_STATE, self->imsi, stateName, old, 0);
+    metric_emmState(old, stateName);
+    replica_touch(self->guti.mtmsi);
 }
 
 const guint64 emmCtx_getIMSI(const EMMCtx emm){
@@ -117,6 +174,7 @@ const guint64 emmCtx_getMSISDN(const EMMCtx emm){
 
 void emmCtx_setNewAuthQuadruplet(EMMCtx emm, AuthQuadruplet *a){
     EMMCtx_t *self = (EMMCtx_t*)emm;
+    memacct_add(MA_AUTH_VECTOR, sizeof(AuthQuadruplet));
     g_ptr_array_add(self->authQuadrs, a);
     self->authQuadrsLen++;
 }
@@ -160,6 +218,8 @@ void emmCtx_newGUTI(EMMCtx emm, guti_t *guti){
 
     if(self->guti.mtmsi==0){
         ecmSession_newGUTI(self->ecm, &(self->guti));
+        emmCtx_updateTrace(self);
+        replica_touch(self->guti.mtmsi);
     }
 
     if(guti!=NULL)
@@ -177,6 +237,73 @@ void emmCtx_getTAI(const EMMCtx emm, guint8 (*sn)[3], guint16 *tac){
     memcpy(sn, self->sn, 3);
 }
 
+void emmCtx_updateTrace(EMMCtx emm){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    UETrace t = uetrace_lookup(self->imsi, self->guti.mtmsi);
+
+    if(t && !self->trace)
+        emm_log(self, LOG_NOTICE, 0, "UE trace active");
+    if(self->trace)
+        uetrace_unref(self->trace);
+    self->trace = t;
+
+    if(t){
+        self->flags |= EMM_FLAG_TRACE;
+        if(self->ecm)
+            ((ECMSession_t *)self->ecm)->flags |= ECM_FLAG_TRACE;
+    }else{
+        self->flags &= ~EMM_FLAG_TRACE;
+        if(self->ecm)
+            ((ECMSession_t *)self->ecm)->flags &= ~ECM_FLAG_TRACE;
+    }
+}
+
+void emmCtx_capture(EMMCtx emm, UETraceProto proto, gconstpointer buf, gsize len){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+
+    if(uetrace_write(self->trace, proto, buf, len))
+        return;
+
+    /* Trace stopped from the command shell*/
+    uetrace_unref(self->trace);
+    self->trace = NULL;
+    self->flags &= ~EMM_FLAG_TRACE;
+    if(self->ecm)
+        ((ECMSession_t *)self->ecm)->flags &= ~ECM_FLAG_TRACE;
+}
+
+void emmCtx_procStart(EMMCtx emm, MetricProc p){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    self->proc = p;
+    self->procStart = metric_now();
+    memset(self->procSeg, 0, sizeof(self->procSeg));
+}
+
+void emmCtx_procSegment(EMMCtx emm, MetricSegment s, guint64 us){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    if(self->proc != MP_NUM)
+        self->procSeg[s] += us;
+}
+
+void emmCtx_procEnd(EMMCtx emm, MetricProc p){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    guint64 total, peers;
+
+    if(self->proc != p)
+        return;
+    total = metric_now() - self->procStart;
+    peers = self->procSeg[MS_HSS] + self->procSeg[MS_SGW];
+    self->procSeg[MS_TOTAL] = total;
+    self->procSeg[MS_RAN] = total > peers ? total - peers : 0;
+    metric_procRecord(p, self->procSeg);
+    self->proc = MP_NUM;
+}
+
+void emmCtx_procAbort(EMMCtx emm){
+    EMMCtx_t *self = (EMMCtx_t*)emm;
+    self->proc = MP_NUM;
+}
+
 guint32 *emmCtx_getM_TMSI_p(const EMMCtx emm){
     EMMCtx_t *self = (EMMCtx_t*)emm;
     return &(self->guti.mtmsi);
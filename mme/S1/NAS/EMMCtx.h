@@ -30,12 +30,36 @@
 #include "EMMCtx_iface.h"
 #include "Subscription.h"
 #include "glib.h"
+#include "logmgr.h"
 #include "NAS_Definitions.h"
 #include "EMM_State.h"
 #include "EMM_FSMConfig.h"
 #include "timermgr.h"
+#include "kdf.h"
 
-#define emm_log(self, p, en, ...) emm_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__)
+#define emm_log(self, p, en, ...) do{                                  \
+        if(log_enabled(p))                                              \
+            emm_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__); \
+    }while(0)
+
+#define EMM_NUM_TIMERS (22)
+
+/* EMMCtx_t flags*/
+#define EMM_FLAG_TRACE  0x01    /**< UE trace active*/
+
+/**
+ * Checks the trace flag, a single branch when the UE is not traced*/
+#define emmCtx_isTraced(emm)                                            \
+    G_UNLIKELY(((EMMCtx_t *)(emm))->flags & EMM_FLAG_TRACE)
+
+/**
+ * EMM timer slot, one per timer code. See EMM_Timers.h*/
+typedef struct{
+    gpointer     emm;
+    guint        code;
+    Timer        tm;            /**< NULL when the timer is not running */
+    GBytes       *msg;          /**< Message to retransmit, may be NULL */
+}EMM_TimerSlot;
 
 typedef struct{
     guint8       rAND[16];
@@ -58,9 +82,16 @@ typedef struct{
     gpointer     s6a;
     EMM_State    *state;
     EMMState     stateName;
+    guint8       flags;         /**< EMM_FLAG_* */
+    UETrace      trace;         /**< Set with EMM_FLAG_TRACE */
+
+    /* Procedure latency, see emmCtx_procStart*/
+    MetricProc   proc;          /**< Running procedure, MP_NUM if none */
+    guint64      procStart;
+    guint64      procSeg[MS_NUM];
 
     TimerMgr     tm;
-    Timer        *activeTimers;
+    EMM_TimerSlot timers[EMM_NUM_TIMERS];
 
     guint64      imsi;
     guint64      msisdn;
@@ -84,7 +115,7 @@ typedef struct{
     gboolean     s1BearersActive;
     guint8       attachResult;
     guint8       updateResult;
-    GPtrArray    *pendingESMmsg;
+    GPtrArray    *pendingESMmsg; /**< NULL when there is none */
     /* Message processing helpers */
     guint8       msg_attachType;
     guint8       msg_detachType;
@@ -114,10 +145,9 @@ typedef struct{
     gboolean     sci;          /**< Security Context indicator */
     guint32      nasUlCountForSC;
     guint8       kasme[32];
+    KDFKey       kasmeKdf;      /**< HMAC states of the KASME*/
     gsize        authQuadrsLen;
     GPtrArray    *authQuadrs;
-    gsize        authQuintsLen;
-    GPtrArray    *authQuints;
 
     guint8       drx[2];
     guint8       nh[32];
@@ -154,12 +184,22 @@ typedef struct{
 void emm_log_(EMMCtx s, int pri, char *fn, const char *func, int ln,
               int en, char *fmt, ...);
 
+void freeESMmsg(gpointer msg);
+
 EMMCtx emmCtx_init();
 
 void emmCtx_free(EMMCtx s);
 
 void emm_setState(EMMCtx emm_h, EMM_State *s, EMMState stateName);
 
+/**
+ * @brief Release the parts of the context only used while ECM connected
+ *
+ * Called when the ECM session is released. They are allocated again on
+ * demand.
+ */
+void emmCtx_compact(EMMCtx emm);
+
 void emmCtx_setNewAuthQuadruplet(EMMCtx emm, AuthQuadruplet *a);
 
 const AuthQuadruplet *emmCtx_getFirstAuthQuadruplet(EMMCtx emm);
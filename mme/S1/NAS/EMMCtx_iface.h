@@ -29,6 +29,9 @@
 
 #include <glib.h>
 #include "NAS_Definitions.h"
+#include "uetrace.h"
+#include "metrics.h"
+#include "memacct.h"
 
 typedef void* EMMCtx;
 
@@ -40,5 +43,56 @@ const guti_t *emmCtx_getGUTI(const EMMCtx emm);
 
 void emmCtx_getTAI(const EMMCtx emm, guint8 (*sn)[3], guint16 *tac);
 
+/**
+ * @brief Match the UE identity against the active UE traces
+ *
+ * Sets the trace flag of the EMM context and its ECM session when the IMSI
+ * or M-TMSI is traced. Called when the identity or the ECM session changes.
+ */
+void emmCtx_updateTrace(EMMCtx emm);
+
+/**
+ * @brief Write a message to the UE trace
+ *
+ * Only called when the trace flag is set. The flag is cleared if the trace
+ * has been stopped.
+ */
+void emmCtx_capture(EMMCtx emm, UETraceProto proto, gconstpointer buf, gsize len);
+
+/**
+ * @brief Start measuring the latency of a procedure
+ *
+ * A procedure already running is discarded.
+ */
+void emmCtx_procStart(EMMCtx emm, MetricProc p);
+
+/**
+ * @brief Account time spent waiting for a peer in the running procedure
+ * @param [in] s   MS_HSS or MS_SGW
+ * @param [in] us  Time, microseconds
+ */
+void emmCtx_procSegment(EMMCtx emm, MetricSegment s, guint64 us);
+
+/**
+ * @brief Record the latency of the procedure, if it is the running one
+ */
+void emmCtx_procEnd(EMMCtx emm, MetricProc p);
+
+/**
+ * @brief Discard the running procedure, used when it is rejected
+ */
+void emmCtx_procAbort(EMMCtx emm);
+
+/**
+ * @brief Count the objects that make up the UE context
+ * @param [inout] ue    Object counts, the UE objects are added
+ * @param [out] state   EMM state, index of EMMStateName
+ * @param [out] connected TRUE if the UE has an ECM session
+ *
+ * Covers the EMM context and the ESM and S11 objects under it.
+ */
+void emmCtx_footprint(const EMMCtx emm, MemAcctUE *ue, guint *state,
+                      gboolean *connected);
+
 
 #endif /* EMM_CTX_IFACE_H*/
@@ -218,7 +218,7 @@ static void emm_processTimeout(gpointer emm_h, gpointer buf, gsize len,
         emm_log(emm, LOG_ERR, 0, "%s expiration. Setting Implicit detach timer",
                 EMM_TimerStr[c]);
         emm_stopTimer(emm, TMOBILE_REACHABLE);
-        emm_setTimer(emm, TIMPLICIT_DETACH, NULL, 0);
+        emm_setTimer(emm, TIMPLICIT_DETACH, NULL);
         break;
     case TIMPLICIT_DETACH:
         emm_stopTimer(emm, TIMPLICIT_DETACH);
@@ -382,6 +382,7 @@ static void processIdentityRsp(EMMCtx_t *emm, GenericNASMsg_t *msg){
             mobid = mobid*10 + ((idRsp->mobileId.v[i])>>4);
         }
         emm->imsi = mobid;
+        emmCtx_updateTrace(emm);
     }
 
     /* Create a new guti if empty*/
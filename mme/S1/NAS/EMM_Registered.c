@@ -227,7 +227,7 @@ static void emm_processTimeout(gpointer emm_h, gpointer buf, gsize len,
         emm_log(emm, LOG_ERR, 0, "%s expiration. Setting Implicit detach timer",
                 EMM_TimerStr[c]);
         emm_stopTimer(emm, TMOBILE_REACHABLE);
-        emm_setTimer(emm, TIMPLICIT_DETACH, NULL, 0);
+        emm_setTimer(emm, TIMPLICIT_DETACH, NULL);
         break;
     case TIMPLICIT_DETACH:
         emm_stopTimer(emm, TIMPLICIT_DETACH);
@@ -158,6 +158,7 @@ static void emmAttachAccept(gpointer emm_h, gpointer esm_msg, gsize msgLen, GLis
     gsize len, tlen;
     NAS_tai_list_t tAIl;
     EMMCause_t cause;
+    GBytes *msg;
 
     memset(out, 0, 156);
     memset(plain, 0, 150);
@@ -240,7 +241,9 @@ static void emmAttachAccept(gpointer emm_h, gpointer esm_msg, gsize msgLen, GLis
         return;
     }
     emm->s1BearersActive = TRUE;
-    emm_setTimer(emm, T3450, plain, pointer-plain);
+    msg = g_bytes_new(plain, pointer-plain);
+    emm_setTimer(emm, T3450, msg);
+    g_bytes_unref(msg);
     ecm_sendCtxtSUReq(emm->ecm, out, len, bearers);
 }
 
@@ -281,7 +284,7 @@ static void emm_processTimeout(gpointer emm_h, gpointer buf, gsize len,
         emm_log(emm, LOG_ERR, 0, "%s expiration. Setting Implicit detach timer",
                 EMM_TimerStr[c]);
         emm_stopTimer(emm, TMOBILE_REACHABLE);
-        emm_setTimer(emm, TIMPLICIT_DETACH, NULL, 0);
+        emm_setTimer(emm, TIMPLICIT_DETACH, NULL);
         break;
     case TIMPLICIT_DETACH:
         emm_stopTimer(emm, TIMPLICIT_DETACH);
@@ -345,6 +348,7 @@ static void processAttachComplete(EMMCtx_t *emm, GenericNASMsg_t *msg){
             complete->eSM_MessageContainer.l);
     emm->attachStarted = FALSE;
     emm_log(emm, LOG_INFO, 0, "NAS Attach");
+    emmCtx_procEnd(emm, MP_ATTACH);
     emmChangeState(emm, EMM_Registered);
     esm_processMsg(emm->esm, &(esm_msg.plain.eSM));
 }
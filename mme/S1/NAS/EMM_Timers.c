@@ -27,84 +27,99 @@
 #include "timermgr.h"
 #include "logmgr.h"
 
-typedef struct{
-    EMMCtx_t      *emm;
-    EMM_TimerCode code;
-    GByteArray    *msg;
-}EMM_Timer;
-
-
-static void emm_timer_free_cb(Timer tm_t, EMM_Timer *t){
-    t->emm->activeTimers[t->code] = NULL;
-    g_byte_array_free(t->msg, TRUE);
-    g_free(t);
+static void emm_timer_free_cb(Timer tm_t, EMM_TimerSlot *t){
+    t->tm = NULL;
+    if(t->msg){
+        g_bytes_unref(t->msg);
+        t->msg = NULL;
+    }
 }
 
 
-static void emm_timer_cb(Timer tm_t, EMM_Timer *t){
-    t->emm->state->processTimeout(t->emm,
-                                  t->msg->data, t->msg->len,
-                                  t->code);
+static void emm_timer_cb(Timer tm_t, EMM_TimerSlot *t){
+    EMMCtx_t *emm = t->emm;
+    GBytes *msg = t->msg ? g_bytes_ref(t->msg) : NULL;
+    gconstpointer data = NULL;
+    gsize len = 0;
+
+    /* The slot message can be replaced from the callback, keep a reference*/
+    if(msg){
+        data = g_bytes_get_data(msg, &len);
+    }
+    emm->state->processTimeout(emm, (gpointer)data, len, t->code);
+    if(msg){
+        g_bytes_unref(msg);
+    }
 }
 
 
-static void emm_timer_max_cb(Timer tm_t, EMM_Timer *t){
-    t->emm->state->processTimeoutMax(t->emm,
-                                     t->msg->data, t->msg->len,
-                                     t->code);
+static void emm_timer_max_cb(Timer tm_t, EMM_TimerSlot *t){
+    EMMCtx_t *emm = t->emm;
+    GBytes *msg = t->msg ? g_bytes_ref(t->msg) : NULL;
+    gconstpointer data = NULL;
+    gsize len = 0;
+
+    if(msg){
+        data = g_bytes_get_data(msg, &len);
+    }
+    emm->state->processTimeoutMax(emm, (gpointer)data, len, t->code);
+    if(msg){
+        g_bytes_unref(msg);
+    }
 }
 
 
-void emm_setTimer(EMMCtx_t *emm, EMM_TimerCode c, guint8 *msg, gsize len){
-    EMM_Timer *t;
-    Timer tm_t;
+void emm_setTimer(EMMCtx_t *emm, EMM_TimerCode c, GBytes *msg){
+    EMM_TimerSlot *t = &(emm->timers[c]);
 
     emm_log(emm, LOG_DEBUG, 0,"Setting EMM timer: %s",
             EMM_TimerStr[c]);
 
-    t = g_new0(EMM_Timer, 1);
+    if(msg){
+        g_bytes_ref(msg);
+    }
+    if(t->msg){
+        g_bytes_unref(t->msg);
+    }
+    t->msg = msg;
+
+    if(t->tm){
+        emm_log(emm, LOG_DEBUG, 0,"Timer %s already running. Restarting",
+                EMM_TimerStr[c]);
+        tm_restart_timer(t->tm);
+        return;
+    }
+
     t->emm = emm;
     t->code = c;
-    t->msg = g_byte_array_new();
-    g_byte_array_append(t->msg, msg, len);
-
-    tm_t = tm_add_timer(emm->tm, &(EMM_tv[t->code]), EMM_rtx[t->code],
-                        (Timer_cb)emm_timer_cb,
-                        (Timer_cb)emm_timer_max_cb,
-                        (Timer_cb)emm_timer_free_cb,
-                        (void*)t);
-    if(!tm_t){
+    t->tm = tm_add_timer(emm->tm, &(EMM_tv[c]), EMM_rtx[c],
+                         (Timer_cb)emm_timer_cb,
+                         (Timer_cb)emm_timer_max_cb,
+                         (Timer_cb)emm_timer_free_cb,
+                         (void*)t);
+    if(!t->tm){
         g_error("Failed to create timer.");
     }
-    if(emm->activeTimers[t->code] != NULL){
-        emm_log(emm, LOG_WARNING, 0,"Failed to add Timer %s: Already exists. Replacing",
-                EMM_TimerStr[t->code]);
-        tm_stop_timer(emm->activeTimers[t->code]);
-    }
-    emm->activeTimers[t->code] = tm_t;
 }
 
 void emm_stopTimer(EMMCtx_t *emm, EMM_TimerCode c){
-    Timer tm_t = emm->activeTimers[c];
+    EMM_TimerSlot *t = &(emm->timers[c]);
 
-    if(!tm_t){
+    if(!t->tm){
         emm_log(emm, LOG_DEBUG, 0,"Failed to Stop Timer %s: not found",
                 EMM_TimerStr[c]);
         return;
     }
-    tm_stop_timer(tm_t);
-    emm->activeTimers[c] = NULL;
+    /* The free callback clears the slot*/
+    tm_stop_timer(t->tm);
 }
 
 void emm_stopAllTimers(EMMCtx_t *emm){
-    Timer tm_t;
     guint i;
 
     for(i=0; i< EMM_NUM_TIMERS ; i++){
-        tm_t = emm->activeTimers[i];
-        if(tm_t){
-            tm_stop_timer(tm_t);
-            emm->activeTimers[i] = NULL;
+        if(emm->timers[i].tm){
+            tm_stop_timer(emm->timers[i].tm);
         }
     }
 }
@@ -28,8 +28,6 @@
 
 #include "EMMCtx.h"
 
-#define EMM_NUM_TIMERS (22)
-
 typedef enum{
     TNULL,
     /* UE side*/
@@ -138,7 +136,16 @@ static const struct timeval EMM_tv[] = {
     {1, 0},       /* TIMPLICIT_DETACH */  /* Network dependent ISR? T3423+4min, T3324? T3412+4min*/
 };
 
-void emm_setTimer(EMMCtx_t *emm, EMM_TimerCode t, guint8 *msg, gsize len);
+/**
+ * @brief Start or restart an EMM timer
+ * @param [in] emm  EMM context
+ * @param [in] t    Timer code
+ * @param [in] msg  Message passed to the timeout callbacks, can be NULL
+ *
+ * A reference to msg is kept until the timer is stopped. Starting a running
+ * timer restarts it with the new message.
+ */
+void emm_setTimer(EMMCtx_t *emm, EMM_TimerCode t, GBytes *msg);
 
 void emm_stopTimer(EMMCtx_t *emm, EMM_TimerCode t);
 
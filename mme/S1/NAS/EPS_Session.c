@@ -30,11 +30,22 @@
 #include "NAS_ESM_priv.h"
 #include "NAS_EMM_priv.h"
 #include "logmgr.h"
+#include "memacct.h"
+#include "slab.h"
 #include "MME_S11.h"
+#include "S11_User.h"
 #include "S1AP.h"
 
+static Slab sessionPool = NULL;
+
 EPS_Session ePSsession_init(ESM esm, Subscription _subs, ESM_BearerContext b){
-    EPS_Session_t *self = g_new0(EPS_Session_t, 1);
+    EPS_Session_t *self;
+
+    if(!sessionPool){
+        sessionPool = slab_new("eps_session", sizeof(EPS_Session_t),
+                               MA_EPS_SESSION);
+    }
+    self = slab_alloc0(sessionPool);
     self->esm = esm;
     self->subs = _subs;
     self->defaultBearer = b;
@@ -42,6 +53,7 @@ EPS_Session ePSsession_init(ESM esm, Subscription _subs, ESM_BearerContext b){
                                            g_int_equal,
                                            NULL,
                                            esm_bc_free);
+    memacct_add(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
     self->current_pti = 0;
     return self;
 }
@@ -58,7 +70,8 @@ void ePSsession_free(EPS_Session s){
         g_string_free(self->apn_io_replacement, TRUE);
     }
     g_hash_table_destroy(self->bearers);
-    g_free(self);
+    memacct_sub(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+    slab_free(sessionPool, self);
 }
 
 void ePSsession_parsePDNConnectivityRequest(EPS_Session s, ESM_Message_t *msg,
@@ -303,3 +316,25 @@ void ePSsession_errorESM(EPS_Session s){
     self->esm=NULL;
     S11_detach(self->s11, NULL, NULL);
 }
+
+gboolean ePSsession_snapshot(const EPS_Session s, SnapSession_t *snap){
+    EPS_Session_t *self = (EPS_Session_t*)s;
+
+    if(!self->s11 || !s11u_snapshot(self->s11, snap)){
+        return FALSE;
+    }
+    snap->pdn_addr_type = self->pdn_addr_type;
+    memcpy(snap->pdn_addr, self->pdn_addr, 20);
+    esm_bc_snapshot(self->defaultBearer, snap);
+    return TRUE;
+}
+
+void ePSsession_restore(EPS_Session s, const SnapSession_t *snap){
+    EPS_Session_t *self = (EPS_Session_t*)s;
+
+    self->pdn_addr_type = snap->pdn_addr_type;
+    memcpy(self->pdn_addr, snap->pdn_addr, 20);
+    esm_bc_restore(self->defaultBearer, snap);
+    self->s11 = S11_restoreUser(esm_getS11iface(self->esm),
+                                self->esm->emm, self, snap);
+}
@@ -67,5 +67,18 @@ void ePSsession_detach(EPS_Session s, void(*cb)(gpointer), gpointer args);
 
 void ePSsession_errorESM(EPS_Session s);
 
+/**
+ * @brief Save the session, its default bearer and S11 session
+ * @return FALSE when the session is not established, nothing is saved
+ */
+gboolean ePSsession_snapshot(const EPS_Session s, SnapSession_t *snap);
+
+/**
+ * @brief Restore the session saved with ePSsession_snapshot
+ * @param [in]  s     Session from ePSsession_init with the default bearer
+ * @param [in]  snap  Saved session
+ */
+void ePSsession_restore(EPS_Session s, const SnapSession_t *snap);
+
 
 #endif /* EPS_SESSION_H*/
@@ -27,6 +27,7 @@
 #include "ESM_BearerContext.h"
 #include "NAS.h"
 #include "logmgr.h"
+#include "slab.h"
 #include "ESM_FSMConfig.h"
 
 typedef struct{
@@ -36,13 +37,17 @@ typedef struct{
 	struct fteid_t s1u_sgw;
 	struct fteid_t s1u_enb;
 	struct fteid_t s5s8u_pgw; 
-
-	uint8_t        oMsg[500];
-	size_t         oLen;
 }ESM_BearerContext_t;
 
+static Slab bearerPool = NULL;
+
 ESM_BearerContext esm_bc_init(gpointer esm, uint8_t ebi){
-	ESM_BearerContext_t *self = g_new0(ESM_BearerContext_t, 1);
+	ESM_BearerContext_t *self;
+
+	if(!bearerPool){
+		bearerPool = slab_new("bearer", sizeof(ESM_BearerContext_t), MA_BEARER);
+	}
+	self = slab_alloc0(bearerPool);
 	self->esm = esm;
 	self->ebi = ebi;
 	esmChangeState(self, Inactive);
@@ -51,7 +56,7 @@ ESM_BearerContext esm_bc_init(gpointer esm, uint8_t ebi){
 
 void esm_bc_free(ESM_BearerContext bc_h){
 	ESM_BearerContext_t *self = (ESM_BearerContext_t*)bc_h;
-	g_free(self);
+	slab_free(bearerPool, self);
 }
 
 
@@ -212,3 +217,18 @@ void esm_bc_getS1ueNBfteid(const ESM_BearerContext bc_h, gpointer fteid_h, gsize
     }
     memcpy(fteid, &(self->s1u_enb), *len);
 }
+
+void esm_bc_snapshot(const ESM_BearerContext bc_h, SnapSession_t *snap){
+    ESM_BearerContext_t *self = (ESM_BearerContext_t*)bc_h;
+    snap->ebi = self->ebi;
+    memcpy(&(snap->s1u_sgw), &(self->s1u_sgw), sizeof(struct fteid_t));
+    memcpy(&(snap->s5s8u_pgw), &(self->s5s8u_pgw), sizeof(struct fteid_t));
+}
+
+void esm_bc_restore(ESM_BearerContext bc_h, const SnapSession_t *snap){
+    ESM_BearerContext_t *self = (ESM_BearerContext_t*)bc_h;
+    memcpy(&(self->s1u_sgw), &(snap->s1u_sgw), sizeof(struct fteid_t));
+    memcpy(&(self->s5s8u_pgw), &(snap->s5s8u_pgw), sizeof(struct fteid_t));
+    /* The eNB F-TEID is given again by the next Initial Context Setup*/
+    esmChangeState(self, Active);
+}
@@ -30,6 +30,7 @@
 #include "MME.h"
 #include "ESM_State.h"
 #include "NAS.h"
+#include "snapshot.h"
 
 #include <stdint.h>
 #include <glib.h>
@@ -78,4 +79,8 @@ void esm_bc_setS5S8uPGWfteid(ESM_BearerContext bc_h, gpointer fteid_h, gsize len
 
 void esm_bc_getS1ueNBfteid(const ESM_BearerContext bc_h, gpointer fteid_h, gsize *len);
 
+void esm_bc_snapshot(const ESM_BearerContext bc_h, SnapSession_t *snap);
+
+void esm_bc_restore(ESM_BearerContext bc_h, const SnapSession_t *snap);
+
 #endif /* ESM_Bearer_Context_H */
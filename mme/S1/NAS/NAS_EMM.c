@@ -39,8 +39,10 @@
 
 #include "gtp.h" /* GTP2C_PORT*/
 #include "nodemgr.h"
+#include "metrics.h"
+#include "memacct.h"
+#include "replica.h"
 
-#include "hmac_sha2.h"
 
 gpointer emm_init(gpointer ecm, TimerMgr tm){
     EMMCtx_t *self = emmCtx_init();
@@ -48,10 +50,10 @@ gpointer emm_init(gpointer ecm, TimerMgr tm){
     emmChangeState(self, EMM_Deregistered);
     self->ecm = ecm;
     self->s6a = ecmSession_getS6a(ecm);
+    self->s11 = ecmSession_getS11(ecm);
     self->esm = esm_init(self);
     self->parser = nas_newHandler();
-
-    self->activeTimers = g_new0(Timer, EMM_NUM_TIMERS);
+    memacct_add(MA_NAS_PARSER, nas_getHandlerSize());
 
     return self;
 }
@@ -59,10 +61,13 @@ gpointer emm_init(gpointer ecm, TimerMgr tm){
 void emm_free(gpointer emm_h){
     EMMCtx_t *self = (EMMCtx_t*)emm_h;
 
+    /* Removed from the standby*/
+    replica_touch(self->guti.mtmsi);
+
     emm_stopAllTimers(self);
-    g_free(self->activeTimers);
 
     nas_freeHandler(self->parser);
+    memacct_sub(MA_NAS_PARSER, nas_getHandlerSize());
     esm_free(self->esm);
     emmCtx_free(self);
 }
@@ -73,12 +78,13 @@ void emm_registerECM(EMMCtx emm_h, gpointer ecm){
         ecm_sendUEContextReleaseCommand(self->ecm, CauseNas, CauseNas_normal_release);
     }
     self->ecm = ecm;
+    emmCtx_updateTrace(self);
 }
 
 void emm_deregister(EMMCtx emm_h){
     EMMCtx_t *self = (EMMCtx_t*)emm_h;
     if(self->stateName != EMM_Deregistered){
-        emm_setTimer(self, TMOBILE_REACHABLE, NULL, 0);
+        emm_setTimer(self, TMOBILE_REACHABLE, NULL);
     }
 
     bzero(self->nh, 32);
@@ -87,6 +93,7 @@ void emm_deregister(EMMCtx emm_h){
     self->old_ncc = 0;
 
     self->ecm = NULL;
+    emmCtx_compact(self);
 }
 
 void emm_stop(EMMCtx emm_h){
@@ -104,7 +111,98 @@ void emm_stop(EMMCtx emm_h){
 
 gpointer emm_getS11(gpointer emm_h){
     EMMCtx_t *self = (EMMCtx_t*)emm_h;
-    return ecmSession_getS11(self->ecm);
+    return self->s11;
+}
+
+gboolean emm_snapshot(EMMCtx emm_h, SnapUE_t *snap){
+    EMMCtx_t *self = (EMMCtx_t*)emm_h;
+    SnapEMM_t *e = &(snap->emm);
+    NAS_EIA eia;
+    NAS_EEA eea;
+
+    if(self->stateName != EMM_Registered || !self->sci){
+        return FALSE;
+    }
+    if(!nas_getSecurity(self->parser, &eia, &eea, e->nasCount)){
+        return FALSE;
+    }
+    if(!esm_snapshot(self->esm, &(snap->session))){
+        return FALSE;
+    }
+    e->eia = eia;
+    e->eea = eea;
+    e->imsi = self->imsi;
+    e->msisdn = self->msisdn;
+    e->imeisv = self->imeisv;
+    memcpy(&(e->guti), &(self->guti), sizeof(guti_t));
+    memcpy(e->sn, self->sn, 3);
+    e->tac = self->tac;
+    e->t3412 = self->t3412;
+    e->ksi = self->ksi;
+    memcpy(e->kasme, self->kasme, 32);
+    e->nasUlCountForSC = self->nasUlCountForSC;
+    memcpy(e->drx, self->drx, 2);
+    e->ueCapabilitiesLen = self->ueCapabilitiesLen;
+    memcpy(e->ueCapabilities, self->ueCapabilities, 15);
+    e->msNetCapLen = self->msNetCapLen;
+    memcpy(e->msNetCap, self->msNetCap, 10);
+    memcpy(&(e->sgwIP), &(self->sgwIP), sizeof(struct sockaddr));
+    e->sgwIPLen = self->sgwIPLen;
+    memcpy(&(e->pgwIP), &(self->pgwIP), sizeof(struct sockaddr));
+    e->pgwIPLen = self->pgwIPLen;
+
+    subs_snapshot(self->subs, &(snap->subs));
+    return TRUE;
+}
+
+gpointer emm_restore(struct mme_t *mme, TimerMgr tm, const SnapUE_t *snap){
+    EMMCtx_t *self = emmCtx_init();
+    const SnapEMM_t *e = &(snap->emm);
+    guint32 count[2];
+
+    self->tm = tm;
+    self->s6a = mme_getS6a(mme);
+    self->s11 = mme_getS11(mme);
+
+    self->imsi = e->imsi;
+    self->msisdn = e->msisdn;
+    self->imeisv = e->imeisv;
+    memcpy(&(self->guti), &(e->guti), sizeof(guti_t));
+    memcpy(self->sn, e->sn, 3);
+    self->tac = e->tac;
+    self->t3412 = e->t3412;
+    self->ksi = e->ksi;
+    memcpy(self->kasme, e->kasme, 32);
+    kdf_setKey(&(self->kasmeKdf), self->kasme, 32);
+    self->nasUlCountForSC = e->nasUlCountForSC;
+    memcpy(self->drx, e->drx, 2);
+    self->ueCapabilitiesLen = e->ueCapabilitiesLen;
+    memcpy(self->ueCapabilities, e->ueCapabilities, 15);
+    self->msNetCapLen = e->msNetCapLen;
+    memcpy(self->msNetCap, e->msNetCap, 10);
+    memcpy(&(self->sgwIP), &(e->sgwIP), sizeof(struct sockaddr));
+    self->sgwIPLen = e->sgwIPLen;
+    memcpy(&(self->pgwIP), &(e->pgwIP), sizeof(struct sockaddr));
+    self->pgwIPLen = e->pgwIPLen;
+
+    /* The downlink COUNT may have been used after the last pass, it is
+     * moved forward so no COUNT is reused with the same key*/
+    self->sci = TRUE;
+    self->parser = nas_newHandler();
+    memacct_add(MA_NAS_PARSER, nas_getHandlerSize());
+    count[0] = e->nasCount[0];
+    count[1] = e->nasCount[1] + SNAPSHOT_COUNT_MARGIN;
+    nas_restoreSecurity(self->parser, e->eia, e->eea, e->kasme, count);
+
+    subs_restore(self->subs, &(snap->subs));
+    self->esm = esm_init(self);
+    esm_restore(self->esm, &(snap->session));
+
+    emmChangeState(self, EMM_Registered);
+    emm_setTimer(self, TMOBILE_REACHABLE, NULL);
+    emmCtx_updateTrace(self);
+    mme_registerEMMCtxt(mme, self);
+    return self;
 }
 
 
@@ -115,6 +213,11 @@ void emm_processMsg(gpointer emm_h, gpointer buffer, gsize len){
     ProtocolDiscriminator_t p;
 
     emm_stopTimer(self, TMOBILE_REACHABLE);
+    /* The NAS COUNTs change*/
+    replica_touch(self->guti.mtmsi);
+
+    if(emmCtx_isTraced(self))
+        emmCtx_capture(self, UETRACE_NAS, buffer, len);
 
     if (!nas_getHeader(buffer, len, &s, &p))
         g_error("Empty NAS message buffer");
@@ -125,6 +228,8 @@ void emm_processMsg(gpointer emm_h, gpointer buffer, gsize len){
     }else if(s > PlainNAS && s <= IntegrityProtectedAndCipheredWithNewEPSSecurityContext){
         self->state->processSecMsg(self, buffer, len);
     }else if(s == SecurityHeaderForServiceRequestMessage){
+        metric_inc(MC_SERVICE_REQ);
+        emmCtx_procStart(self, MP_SERVICE_REQ);
         self->state->processSrvReq(self, buffer, len);
     }else{
         emm_log(self, LOG_INFO, 0, "Invalid Security Header received: Ignoring");
@@ -251,6 +356,9 @@ void processAttach(gpointer emm_h,  GenericNASMsg_t* msg){
     guint16 cap;
     union nAS_ie_member const *optIE=NULL;
 
+    metric_inc(MC_ATTACH_REQ);
+    emmCtx_procStart(emm, MP_ATTACH);
+
     attachMsg = (AttachRequest_t*)&(msg->plain.eMM);
     emm->attachStarted = TRUE;
     emm->msg_attachType = attachMsg->ePSAttachType.v;
@@ -261,6 +369,9 @@ void processAttach(gpointer emm_h,  GenericNASMsg_t* msg){
                         (guint8*)attachMsg->eSM_MessageContainer.v,
                         attachMsg->eSM_MessageContainer.l);
 
+    if(!emm->pendingESMmsg){
+        emm->pendingESMmsg = g_ptr_array_new_full(1, freeESMmsg);
+    }
     g_ptr_array_add(emm->pendingESMmsg, esmRaw);
 
     if(((ePSMobileId_header_t*)attachMsg->ePSMobileId.v)->type == 1 ){  /* IMSI*/
@@ -272,6 +383,7 @@ void processAttach(gpointer emm_h,  GenericNASMsg_t* msg){
             mobid = mobid*10 + ((attachMsg->ePSMobileId.v[i])>>4);
         }
         emm->imsi = mobid;
+        emmCtx_updateTrace(emm);
         emm_log(emm, LOG_DEBUG, 0,"Attach Received");
     }else if(((ePSMobileId_header_t*)attachMsg->ePSMobileId.v)->type == 6 ){    /*GUTI*/
         memcpy(&(emm->msg_guti), (guti_t *)(attachMsg->ePSMobileId.v+1), 10);
@@ -350,6 +462,9 @@ void emm_sendAttachReject(EMMCtx emm_h, EMMCause_t eMMcause,
     gsize len, tlen;
     NAS_tai_list_t tAIl;
 
+    metric_inc(MC_ATTACH_REJECT);
+    emmCtx_procAbort(emm);
+
     memset(out, 0, 156);
     memset(plain, 0, 150);
     pointer = plain;
@@ -391,6 +506,9 @@ void emm_sendServiceReject(EMMCtx emm_h, EMMCause_t eMMcause){
     guint8 *pointer, out[256], plain[250];
     gsize len;
 
+    metric_inc(MC_SERVICE_REJECT);
+    emmCtx_procAbort(emm);
+
     memset(out, 0, 156);
     memset(plain, 0, 150);
     pointer = plain;
@@ -423,6 +541,7 @@ void emm_sendAuthRequest(EMMCtx emm_h){
     guint8 buffer[150];
     const AuthQuadruplet *sec;
     guint8 old_ksi;
+    GBytes *msg;
 
     memset(buffer, 0, 150);
 
@@ -449,7 +568,9 @@ void emm_sendAuthRequest(EMMCtx emm_h){
     nasIe_lv_t4(&pointer, sec->aUTN, 16); /* 256 bits */
 
     ecm_send(emm->ecm, buffer, pointer-buffer);
-    emm_setTimer(emm, T3460, buffer, pointer-buffer);
+    msg = g_bytes_new(buffer, pointer-buffer);
+    emm_setTimer(emm, T3460, msg);
+    g_bytes_unref(msg);
     emmChangeState(emm, EMM_CommonProcedureInitiated);
 }
 
@@ -464,6 +585,7 @@ void emm_setSecurityQuadruplet(EMMCtx emm_h){
     /* memcpy(emm->old_nh, emm->nh, 32); */
 
     memcpy(emm->kasme, sec->kASME, 32);
+    kdf_setKey(&(emm->kasmeKdf), emm->kasme, 32);
 
     emmCtx_removeFirstAuthQuadruplet(emm);
 }
@@ -474,6 +596,7 @@ void emm_sendSecurityModeCommand(EMMCtx emm_h){
     guint8 capabilities[5];
     gsize len;
     guint8 count, out[156], plain[150], req;
+    GBytes *msg;
     memset(out, 0, 156);
     memset(plain, 0, 150);
 
@@ -526,7 +649,10 @@ void emm_sendSecurityModeCommand(EMMCtx emm_h){
                   plain, pointer-plain);
 
     ecm_send(emm->ecm, out, len);
-    emm_setTimer(emm, T3460, plain, pointer-plain);
+    /* Keep the plain message, the retransmission is protected again*/
+    msg = g_bytes_new(plain, pointer-plain);
+    emm_setTimer(emm, T3460, msg);
+    g_bytes_unref(msg);
     emmChangeState(emm, EMM_CommonProcedureInitiated);
 }
 
@@ -537,7 +663,7 @@ void emm_selectGateways(EMMCtx emm_h){
     struct sockaddr_in *peer;
 
     /*Get SGW addr*/
-    getNode(&sgw, SGW, emm->subs);
+    selectNode(&sgw, SGW, emm->tac, subs_getAPN(emm->subs));
     peer = (struct sockaddr_in *)&emm->sgwIP;
     peer->sin_family = AF_INET;
     peer->sin_port = htons(GTP2C_PORT);
@@ -545,7 +671,7 @@ void emm_selectGateways(EMMCtx emm_h){
     emm->sgwIPLen = sizeof(struct sockaddr_in);
 
     /*Get PGW addr*/
-    getNode(&pgw, PGW, emm->subs);
+    selectNode(&pgw, PGW, emm->tac, subs_getAPN(emm->subs));
     peer = (struct sockaddr_in *)&emm->pgwIP;
     peer->sin_family = AF_INET;
     peer->sin_port = htons(GTP2C_PORT);
@@ -560,6 +686,9 @@ void emm_processFirstESMmsg(EMMCtx emm_h){
     GByteArray *esmRaw;
     GenericNASMsg_t msg;
 
+    if(!emm->pendingESMmsg || emm->pendingESMmsg->len == 0){
+        return;
+    }
     esmRaw = g_ptr_array_index(emm->pendingESMmsg, 0);
 
     dec_NAS(&msg, esmRaw->data, esmRaw->len);
@@ -571,58 +700,28 @@ void emm_processFirstESMmsg(EMMCtx emm_h){
 void emm_attachAccept(EMMCtx emm_h, gpointer esm_msg, gsize len, GList *bearers){
     EMMCtx_t *emm = (EMMCtx_t*)emm_h;
 
+    metric_inc(MC_ATTACH_ACCEPT);
+
     emm->state->attachAccept(emm, esm_msg, len, bearers);
 }
 
 
-/**
- * @brief generate_KeNB - KDF function to derive the K_eNB
- * @param [in]  kasme       derived key - 256 bits
- * @param [in]  ulNASCount  Uplink NAS COUNT
- * @param [out] keNB        eNB result key - 256 bits
- */
-static void generate_KeNB(const uint8_t *kasme, const uint32_t ulNASCount, uint8_t *keNB){
-
-    /*
-    FC = 0x11,
-    P0 = Uplink NAS COUNT,
-    L0 = length of uplink NAS COUNT (i.e. 0x00 0x04)
-     */
-    uint32_t count;
-    uint8_t s[7];
-    s[0]=0x11;
-    count = htonl(ulNASCount);
-    memcpy(s+1, &count, 4);
-    s[5]=0x00;
-    s[6]=0x04;
-
-    hmac_sha256(kasme, 32, s, 7, keNB, 32);
-}
-
 void emm_getKeNB(const EMMCtx emm, uint8_t *keNB){
     EMMCtx_t *self = (EMMCtx_t*)emm;
-    generate_KeNB(self->kasme, self->nasUlCountForSC, keNB);
+    kdf_keNB(&(self->kasmeKdf), self->nasUlCountForSC, keNB);
 }
 
 void emm_getNH(const EMMCtx emm, guint8 *nh, guint8 *ncc){
     EMMCtx_t *self = (EMMCtx_t*)emm;
     /*
-    -    FC = 0x12
-    -    P0 = SYNC-input
-    -    L0 = length of SYNC-input (i.e. 0x00 0x20)
     The SYNC-input parameter shall be the newly derived K eNB  for the initial
     NH derivation, and the previous NH for all subsequent derivations. This
     results in a NH chain, where the next NH is always fresh and derived from
     the previous NH.
     */
-
-    uint8_t s[35], keNB[32], zero[32];
+    uint8_t zero[32];
     bzero(zero, 32);
 
-    s[0]=0x12;
-    s[33]=0;
-    s[34]=0x20;
-
     if(memcmp(self->nh, zero, 32)==0){
         /*First hop*/
         emm_getKeNB(self, self->old_nh);
@@ -633,8 +732,7 @@ void emm_getNH(const EMMCtx emm, guint8 *nh, guint8 *ncc){
         self->old_ncc = self->ncc;
     }
 
-    memcpy(s+1, self->old_nh, 32);
-    hmac_sha256(self->kasme, 32, s, 35, self->nh, 32);
+    kdf_nh(&(self->kasmeKdf), self->old_nh, self->nh);
     self->ncc++;
 
     memcpy(nh, self->old_nh, 32);
@@ -708,6 +806,9 @@ void processDetachReq(EMMCtx_t *emm, GenericNASMsg_t *msg){
     /*ePSAttachType*/
     gboolean switchoff;
     guint8 detachType;
+
+    metric_inc(MC_DETACH_REQ);
+    emmCtx_procStart(emm, MP_DETACH);
     emm->msg_detachType = detachMsg->detachType.v;
 
     /*nASKeySetId*/
@@ -746,6 +847,9 @@ void emm_processTAUReq(EMMCtx emm_h, GenericNASMsg_t *msg){
 
     TrackingAreaUpdateRequest_t *tau_msg = (TrackingAreaUpdateRequest_t*)&(msg->plain.eMM);
 
+    metric_inc(MC_TAU_REQ);
+    emmCtx_procStart(emm, MP_TAU);
+
     /* EPS update type */
     emm->msg_updateType = (tau_msg->ePSUpdateType.v&0x07);
     emm->msg_activeFlag = (gboolean)(tau_msg->ePSUpdateType.v&0x08)>>3;
@@ -796,6 +900,10 @@ void emm_sendTAUAccept(EMMCtx emm_h){
     const guti_t *guti;
     uint8_t lAI[5], addRes;
     Cause_t *cause;
+    GBytes *msg;
+
+    metric_inc(MC_TAU_ACCEPT);
+    emmCtx_procEnd(emm, MP_TAU);
 
     memset(out, 0, 156);
     memset(plain, 0, 150);
@@ -869,7 +977,9 @@ void emm_sendTAUAccept(EMMCtx emm_h){
                   NAS_DownLink,
                   plain, pointer-plain);
 
-    emm_setTimer(emm, T3450, plain, pointer-plain);
+    msg = g_bytes_new(plain, pointer-plain);
+    emm_setTimer(emm, T3450, msg);
+    g_bytes_unref(msg);
     ecm_send(emm->ecm, out, len);
 }
 
@@ -882,6 +992,9 @@ void emm_sendTAUReject(EMMCtx emm_h, EMMCause_t cause){
     NAS_tai_list_t tAIl;
     guti_t guti;
 
+    metric_inc(MC_TAU_REJECT);
+    emmCtx_procAbort(emm);
+
     memset(out, 0, 156);
     memset(plain, 0, 150);
 
@@ -995,6 +1108,7 @@ void emm_sendIdentityReq(EMMCtx emm_h){
     EMMCtx_t *emm = (EMMCtx_t*)emm_h;
     guint8 *pointer;
     guint8 buffer[150];
+    GBytes *msg;
     bzero(buffer, 150);
 
     emm_log(emm, LOG_DEBUG, 0, "Building Identity Request");
@@ -1008,7 +1122,9 @@ void emm_sendIdentityReq(EMMCtx emm_h){
     nasIe_v_t1_l(&pointer, 1); /*Get Imsi*/
     pointer++; /*Spare half octet*/
 
-    emm_setTimer(emm, T3470, buffer, pointer-buffer);
+    msg = g_bytes_new(buffer, pointer-buffer);
+    emm_setTimer(emm, T3470, msg);
+    g_bytes_unref(msg);
     ecm_send(emm->ecm, buffer, pointer-buffer);
 }
 
@@ -1042,6 +1158,7 @@ void emm_detachAccept(gpointer emm_h){
     }
 
     emm_log(emm, LOG_INFO, 0, "Detach", emm->imsi);
+    emmCtx_procEnd(emm, MP_DETACH);
     emmChangeState(emm, EMM_Deregistered);
     ecm_sendUEContextReleaseCommand(emm->ecm, CauseNas, CauseNas_detach);
 }
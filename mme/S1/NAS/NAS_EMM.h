@@ -32,6 +32,7 @@
 #include "ECMSession_priv.h"
 #include "timermgr.h"
 #include "EMMCtx_iface.h"
+#include "snapshot.h"
 #include <glib.h>
 
 /**
@@ -50,6 +51,26 @@ gpointer emm_init(gpointer ecm, TimerMgr tm);
  */
 void emm_free(gpointer emm_h);
 
+/**
+ * @brief Save the UE on a snapshot record
+ * @param [in]  emm_h EMM stack handler
+ * @param [out] snap  Record to fill, zeroed by the caller
+ * @return FALSE when the UE is not registered with a security context and
+ *         an established PDN connection, nothing to save
+ */
+gboolean emm_snapshot(EMMCtx emm_h, SnapUE_t *snap);
+
+/**
+ * @brief Restore a UE saved with emm_snapshot
+ * @param [in]  mme   MME handler
+ * @param [in]  tm    Timer manager
+ * @param [in]  snap  Record to restore
+ * @return emm stack handler, registered on the MME
+ *
+ * The UE is restored EMM-Registered and ECM-IDLE.
+ */
+gpointer emm_restore(struct mme_t *mme, TimerMgr tm, const SnapUE_t *snap);
+
 
 void emm_registerECM(EMMCtx emm_h, gpointer ecm);
 
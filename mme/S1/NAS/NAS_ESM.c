@@ -28,6 +28,9 @@
 #include "NAS_EMM_priv.h"
 #include "NAS.h"
 #include "logmgr.h"
+#include "memacct.h"
+#include "slab.h"
+#include "S11_User.h"
 #include "ESM_BearerContext.h"
 #include "EPS_Session_priv.h"
 #include "ECMSession_priv.h"
@@ -39,8 +42,15 @@
 
 void parse_PDNConnectivityRequest(ESM_t *self, GenericNASMsg_t *msg);
 
+static Slab esmPool = NULL;
+
 gpointer esm_init(gpointer emm){
-    ESM_t *self = g_new0(ESM_t, 1);
+    ESM_t *self;
+
+    if(!esmPool){
+        esmPool = slab_new("esm", sizeof(ESM_t), MA_ESM);
+    }
+    self = slab_alloc0(esmPool);
     self->emm = emm;
     self->next_ebi = 5;
     self->bearers =  g_hash_table_new_full(g_int_hash,
@@ -51,6 +61,8 @@ gpointer esm_init(gpointer emm){
                                            NULL,
                                            NULL,
                                            (GDestroyNotify) ePSsession_free);
+    memacct_add(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+    memacct_add(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
     self->s11_iface = emm_getS11(emm);
     return self;
 }
@@ -59,7 +71,57 @@ void esm_free(gpointer esm_h){
     ESM_t *self = (ESM_t*)esm_h;
     g_hash_table_destroy(self->sessions);
     g_hash_table_destroy(self->bearers);
-    g_free(self);
+    memacct_sub(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+    memacct_sub(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+    slab_free(esmPool, self);
+}
+
+void esm_footprint(ESM esm_h, MemAcctUE *ue){
+    ESM_t *self = (ESM_t*)esm_h;
+    GHashTableIter iter;
+    gpointer v;
+    EPS_Session_t *s;
+
+    ue->objects[MA_ESM]++;
+    ue->objects[MA_HASH_TABLE] += 2;
+    /* The default bearers are only in the ESM table*/
+    ue->objects[MA_BEARER] += g_hash_table_size(self->bearers);
+    g_hash_table_iter_init(&iter, self->sessions);
+    while(g_hash_table_iter_next(&iter, NULL, &v)){
+        s = (EPS_Session_t*)v;
+        ue->objects[MA_EPS_SESSION]++;
+        ue->objects[MA_HASH_TABLE]++;
+        if(s->s11){
+            s11u_footprint(s->s11, ue);
+        }
+    }
+}
+
+gboolean esm_snapshot(ESM esm_h, SnapSession_t *snap){
+    ESM_t *self = (ESM_t*)esm_h;
+    GHashTableIter iter;
+    gpointer s;
+
+    g_hash_table_iter_init(&iter, self->sessions);
+    if(!g_hash_table_iter_next(&iter, &s, NULL)){
+        return FALSE;
+    }
+    snap->next_ebi = self->next_ebi;
+    return ePSsession_snapshot(s, snap);
+}
+
+void esm_restore(ESM esm_h, const SnapSession_t *snap){
+    ESM_t *self = (ESM_t*)esm_h;
+    gpointer bearer;
+    EPS_Session s;
+
+    bearer = esm_bc_init(self->emm, snap->ebi);
+    g_hash_table_insert(self->bearers, esm_bc_getEBIp(bearer), bearer);
+    self->next_ebi = snap->next_ebi;
+
+    s = ePSsession_init(self, emmCtx_getSubscription(self->emm), bearer);
+    g_hash_table_add(self->sessions, s);
+    ePSsession_restore(s, snap);
 }
 
 static gboolean esm_errorEMMToSessions(gpointer unused,
@@ -30,6 +30,8 @@
 #include "MME.h"
 #include "ECMSession_priv.h"
 #include "ESM_State.h"
+#include "memacct.h"
+#include "snapshot.h"
 
 #include <stdint.h>
 #include <glib.h>
@@ -73,5 +75,23 @@ void esm_getSessions(ESM esm_h, GList **sessions);
 
 void esm_getBearers(ESM esm_h, GList **bearers);
 
+/**
+ * @brief Count the ESM objects of the UE, see emmCtx_footprint
+ */
+void esm_footprint(ESM esm_h, MemAcctUE *ue);
+
+/**
+ * @brief Save the PDN connection of the UE
+ * @return FALSE when there is no established PDN connection
+ *
+ * Only the first connection is saved, the MME handles a single one.
+ */
+gboolean esm_snapshot(ESM esm_h, SnapSession_t *snap);
+
+/**
+ * @brief Restore the PDN connection saved with esm_snapshot
+ */
+void esm_restore(ESM esm_h, const SnapSession_t *snap);
+
 
 #endif /* NAS_ESM_H */
@@ -39,6 +39,8 @@
 #include "S1Assoc_FSMConfig.h"
 #include "S1AP.h"
 #include "logmgr.h"
+#include "tracemgr.h"
+#include "metrics.h"
 #include "MMEutils.h"
 #include "ECMSession.h"
 #include "MME.h"
@@ -51,7 +53,7 @@ void s1Assoc_log_(S1Assoc assoc, int pri, char *fn, const char *func, int ln,
     va_list args;
     char buf[SYSERR_MSGSIZE];
     size_t len;
-    bzero(buf, SYSERR_MSGSIZE);
+    buf[0] = '\0';
 
     if(self){
         snprintf(buf, SYSERR_MSGSIZE, "%s %s: ",
@@ -61,7 +63,7 @@ void s1Assoc_log_(S1Assoc assoc, int pri, char *fn, const char *func, int ln,
 
     len = strlen(buf);
     va_start(args, fmt);
-    vsnprintf(buf+len, SYSERR_MSGSIZE, fmt, args);
+    vsnprintf(buf+len, SYSERR_MSGSIZE-len, fmt, args);
     buf[SYSERR_MSGSIZE-1] = 0; /* Make sure it is null terminated */
     log_msg_s(pri, fn, func, ln, en, buf);
     va_end(args);
@@ -132,8 +134,6 @@ static void s1_accept(evutil_socket_t fd, short event, void *arg){
     /*SCTP variables*/
     struct sctp_sndrcvinfo sndrcvinfo;
 
-    S1AP_Message_t *s1msg;
-    GError *error = NULL;
     struct mme_t * mme = s1_getMME(self->s1);
 
     memset(&sndrcvinfo, 0, sizeof(struct sctp_sndrcvinfo));
@@ -183,18 +183,40 @@ static void s1_accept(evutil_socket_t fd, short event, void *arg){
             msg->length,
             sndrcvinfo.sinfo_stream);
 
-    s1msg = s1ap_decode((void *)msg->packet.raw, msg->length);
-
-    /* Process message*/
-    self->state->processMsg(self, s1msg, sndrcvinfo.sinfo_stream, &error);
-    if (error != NULL){
+    if(!s1Assoc_processPDU(self, msg->packet.raw, msg->length,
+                           sndrcvinfo.sinfo_stream)){
         mme_deregisterRead(mme, s1Assoc_getfd(self));
         mme_deregisterS1Assoc(mme, self);
         s1_deregisterAssoc(self->s1, self);
     }
+    freeMsg(msg);
+}
 
+gboolean s1Assoc_processPDU(S1Assoc h, guint8 *pdu, guint32 len, guint16 stream){
+    S1Assoc_t *self = (S1Assoc_t *)h;
+    S1AP_Message_t *s1msg;
+    GError *error = NULL;
+
+    s1msg = s1ap_decode((void *)pdu, len);
+    self->rxPDU = pdu;
+    self->rxPDULen = len;
+
+    /* Process message*/
+    self->state->processMsg(self, s1msg, stream, &error);
+    self->rxPDU = NULL;
     s1msg->freemsg(s1msg);
-    freeMsg(msg);
+
+    if (error != NULL){
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void s1Assoc_connect(S1Assoc h, int fd){
+    S1Assoc_t *self = (S1Assoc_t *)h;
+    self->fd = fd;
+    s1_registerAssoc(self->s1, self);
 }
 
 void s1Assoc_accept(S1Assoc h, int ss){
@@ -239,7 +261,7 @@ void s1Assoc_accept(S1Assoc h, int ss){
     /* setsockopt(self->fd, IPPROTO_SCTP, SCTP_RECVRCVINFO, */
     /*                &on, sizeof(on)); */
 
-    mme_registerRead(mme, self->fd, s1_accept, self);
+    mme_registerRead(mme, self->fd, LP_S1, s1_accept, self);
     s1_registerAssoc(self->s1, self);
 }
 
@@ -270,6 +292,8 @@ gpointer *s1Assoc_getECMSession(const S1Assoc h, guint32 id){
 
 void s1Assoc_setState(S1Assoc s1, S1Assoc_State *s, S1AssocState name){
     S1Assoc_t *self = (S1Assoc_t *)s1;
+    trace_event(TRACE_S1ASSOC_STATE, globaleNB_getCI(&self->global_eNB_ID),
+                name, self->stateName, 0);
     self->state = s;
     self->stateName = name;
 }
@@ -291,6 +315,11 @@ void s1Assoc_resetECM(S1Assoc s1, gpointer ecm){
  * This function send the S1 message using the SCTP protocol
  * */
 void s1Assoc_send(gpointer s1, uint32_t streamId, S1AP_Message_t *s1msg){
+    s1Assoc_sendUE(s1, streamId, s1msg, NULL);
+}
+
+void s1Assoc_sendUE(gpointer s1, uint32_t streamId, S1AP_Message_t *s1msg,
+                    gpointer emm){
     uint8_t buf[10000];
     uint32_t bsize, ret;
     S1Assoc_t *self = (S1Assoc_t *)s1;
@@ -300,6 +329,8 @@ void s1Assoc_send(gpointer s1, uint32_t streamId, S1AP_Message_t *s1msg){
     s1ap_encode(buf, &bsize, s1msg);
 
     /*printfbuffer(buf, bsize);*/
+    if(emm)
+        emmCtx_capture(emm, UETRACE_S1AP, buf, bsize);
 
     /* sctp_sendmsg*/
     ret = sctp_sendmsg( self->fd, (void *)buf, (size_t)bsize, NULL, 0, SCTP_S1AP_PPID, 0, streamId, 0, 0 );
@@ -353,6 +384,11 @@ const char *s1Assoc_getName(const S1Assoc h){
     return self->eNBname->str;
 }
 
+AdmissionENB *s1Assoc_getAdmission(const S1Assoc h){
+    S1Assoc_t *self = (S1Assoc_t *)h;
+    return &self->admission;
+}
+
 S1 s1Assoc_getS1(gpointer h){
     S1Assoc_t *self = (S1Assoc_t *)h;
     return self->s1;
@@ -363,6 +399,7 @@ static gboolean s1Assoc_containsTA(const S1Assoc_t *self, const guint8 sn[3], co
     BPLMNs_t *bc_l;
     SupportedTAs_t *tas = self->supportedTAs;
     PLMNidentity_t *plmn_eNB;
+    gboolean match;
     
     for(i=0; i<tas->size; i++){      
         if(memcmp(tas->item[i]->tAC->s, &tac, 2)!=0){
@@ -375,20 +412,19 @@ static gboolean s1Assoc_containsTA(const S1Assoc_t *self, const guint8 sn[3], co
         bc_l = tas->item[i]->broadcastPLMNs;
         for(j=0; j<bc_l->n ; j++){
 	    plmn_eNB = bc_l->pLMNidentity[j];
-	    
-            // Get PLMN from UE and eNB and convert from TBCD to human-readable output
-            guint8 plmn_UE_printable [7] = {0};
-            guint8 plmn_eNB_printable [7] = {0};
-            plmn_FillPLMNFromTBCD (plmn_UE_printable, sn);
-            plmn_FillPLMNFromTBCD (plmn_eNB_printable, plmn_eNB->tbc.s);
-	    
-            if(memcmp(sn, plmn_eNB->tbc.s, 3)==0){
-	        log_msg(LOG_DEBUG, 0, "UE SN (%s) == Supported PLMN (%s) in eNB",
-                        plmn_UE_printable, plmn_eNB_printable);
+	    match = memcmp(sn, plmn_eNB->tbc.s, 3)==0;
+
+            if(log_enabled(LOG_DEBUG)){
+                // Get PLMN from UE and eNB and convert from TBCD to human-readable output
+                guint8 plmn_UE_printable [7] = {0};
+                guint8 plmn_eNB_printable [7] = {0};
+                plmn_FillPLMNFromTBCD (plmn_UE_printable, sn);
+                plmn_FillPLMNFromTBCD (plmn_eNB_printable, plmn_eNB->tbc.s);
+                log_msg(LOG_DEBUG, 0, "UE SN (%s) %s Supported PLMN (%s) in eNB",
+                        plmn_UE_printable, match?"==":"!=", plmn_eNB_printable);
+            }
+            if(match){
                 return TRUE;
-            }else{	       
-                log_msg(LOG_DEBUG, 0, "UE SN (%s) != Supported PLMN (%s) in eNB",
-                        plmn_UE_printable, plmn_eNB_printable);
             }
         }
     }
@@ -442,6 +478,7 @@ static void sendPaging(S1Assoc_t *self, EMMCtx emm){
 
     /* Send Response*/
     s1Assoc_sendNonUE(self, s1msg);
+    metric_inc(MC_PAGING);
 
     /*s1msg->showmsg(s1msg);*/
 
@@ -460,3 +497,35 @@ void s1Assoc_paging(S1Assoc h, gpointer emm){
         sendPaging(self, emm);
     }
 }
+
+void s1Assoc_overloadStart(S1Assoc h, guint action){
+    S1Assoc_t *self = (S1Assoc_t *)h;
+    S1AP_Message_t *s1msg;
+    OverloadResponse_t *rsp;
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_OverloadStart;
+    s1msg->pdu->criticality = ignore;
+
+    rsp = s1ap_newIE(s1msg, id_OverloadResponse, mandatory, reject);
+    rsp->overloadAction = action;
+
+    /* Without GUMMEI List the overload applies to all the served GUMMEIs*/
+
+    s1Assoc_sendNonUE(self, s1msg);
+    s1msg->freemsg(s1msg);
+}
+
+void s1Assoc_overloadStop(S1Assoc h){
+    S1Assoc_t *self = (S1Assoc_t *)h;
+    S1AP_Message_t *s1msg;
+
+    s1msg = S1AP_newMsg();
+    s1msg->choice = initiating_message;
+    s1msg->pdu->procedureCode = id_OverloadStop;
+    s1msg->pdu->criticality = reject;
+
+    s1Assoc_sendNonUE(self, s1msg);
+    s1msg->freemsg(s1msg);
+}
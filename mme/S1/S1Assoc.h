@@ -54,6 +54,24 @@ void s1Assoc_free(gpointer h);
  */
 void s1Assoc_accept(S1Assoc h, int ss);
 
+/**@brief Use an already connected socket
+ * @param [in] h  S1 association handler
+ * @param [in] fd Socket where the messages towards the eNB are sent
+ *
+ * The socket is not read by the MME, the received messages are passed with
+ * s1Assoc_processPDU. Used to inject traffic in-process, e.g. on benchmarks.
+ */
+void s1Assoc_connect(S1Assoc h, int fd);
+
+/**@brief Process a S1AP PDU received from the eNB
+ * @param [in] h      S1 association handler
+ * @param [in] pdu    Encoded S1AP PDU
+ * @param [in] len    PDU length
+ * @param [in] stream SCTP stream
+ * @return FALSE if the association has to be removed
+ */
+gboolean s1Assoc_processPDU(S1Assoc h, guint8 *pdu, guint32 len, guint16 stream);
+
 void s1Assoc_disconnect(S1Assoc h);
 
 void s1Assoc_registerECMSession(S1Assoc h, gpointer ecm);
@@ -90,4 +108,20 @@ mme_GlobaleNBid *s1Assoc_getID(const S1Assoc h, mme_GlobaleNBid *out);
 
 void s1Assoc_paging(S1Assoc h, gpointer emm);
 
+/**@brief Send an Overload Start
+ * @param [in] h       S1 association handler
+ * @param [in] action  OverloadAction the eNB applies
+ */
+void s1Assoc_overloadStart(S1Assoc h, guint action);
+
+/**@brief Send an Overload Stop
+ * @param [in] h  S1 association handler
+ */
+void s1Assoc_overloadStop(S1Assoc h);
+
+/**@brief Admission state of the eNB
+ * @param [in] h  S1 association handler
+ */
+AdmissionENB *s1Assoc_getAdmission(const S1Assoc h);
+
 #endif /* S1ASSOC_HFILE */
@@ -30,6 +30,7 @@
 #include "S1Assoc_FSMConfig.h"
 #include "MME_S1_priv.h"
 #include "S1AP.h"
+#include "overload.h"
 
 static void sendS1SetupReject_UnknownPLMN(S1Assoc_t *assoc);
 static void sendS1SetupResponse(S1Assoc_t *assoc);
@@ -80,6 +81,7 @@ static void processMsg(gpointer _assoc, S1AP_Message_t *s1msg, int r_sid, GError
     s1Assoc_log(assoc, LOG_INFO, 0, "S1-Setup : new eNB \"%s\", connection added", assoc->eNBname->str);
     sendS1SetupResponse(assoc);
     s1ChangeState(assoc, S1_Active);
+    overload_newAssoc(assoc);
 }
 
 
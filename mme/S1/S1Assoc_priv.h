@@ -29,6 +29,7 @@
 #define S1ASSOC_PRIV_HFILE
 
 #include <glib.h>
+#include "logmgr.h"
 #include <event2/event.h>
 #include <netinet/in.h>
 
@@ -59,11 +60,17 @@ typedef struct{
     SupportedTAs_t      *supportedTAs;
     CSG_IdList_t        *cSG_IdList;
     GHashTable          *ecm_sessions;  /**< ECM sessions allocated in this association*/
+    const guint8        *rxPDU;         /**< Encoded message being processed, for UE traces*/
+    gsize               rxPDULen;
+    AdmissionENB        admission;      /**< Token buckets of the NAS procedures*/
     void                (*cb)(gpointer);
     gpointer            args;
 }S1Assoc_t;
 
-#define s1Assoc_log(self, p, en, ...) s1Assoc_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__)
+#define s1Assoc_log(self, p, en, ...) do{                                  \
+        if(log_enabled(p))                                              \
+            s1Assoc_log_(self, p, __FILE__, __func__, __LINE__, en, __VA_ARGS__); \
+    }while(0)
 
 void s1Assoc_log_(S1Assoc assoc, int pri, char *fn, const char *func, int ln,
                   int en, char *fmt, ...);
@@ -87,6 +94,16 @@ void s1Assoc_sendNonUE(gpointer s1, S1AP_Message_t *s1msg);
  * */
 void s1Assoc_send(gpointer s1, guint32 streamId, S1AP_Message_t *s1msg);
 
+/**@brief S1 Send UE associated message
+ * @param [in] s1       S1 Association used to send the message
+ * @param [in] streamId Strem to send the message
+ * @param [in] s1msg    Message to be sent
+ * @param [in] emm      EMM context to capture the encoded message on its UE
+ *                      trace, NULL if the UE is not traced
+ * */
+void s1Assoc_sendUE(gpointer s1, guint32 streamId, S1AP_Message_t *s1msg,
+                    gpointer emm);
+
 /**
  * @brief S1 get ECM session
  * @param [in] h  S1 Association handler
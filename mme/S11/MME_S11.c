@@ -41,6 +41,12 @@
 #include "S11_FSMConfig.h"
 #include "S11_User.h"
 #include "S11_Peer.h"
+#include "nodemgr.h"
+
+typedef struct{
+    S11_PathCb  cb;
+    gpointer    arg;
+}S11_PathListener_t;
 
 typedef struct{
     gpointer    mme;   /**< mme handler*/
@@ -50,10 +56,24 @@ typedef struct{
     GHashTable  *users; /**< s11 users by TEID*/
     GHashTable  *peers;
     guint8      restartCounter;
+    S11_PathCfg pathCfg;
+    struct event *pathEv;    /**< Periodic path supervision sweep*/
+    GPtrArray   *pathListeners;
+    GHashTable  *pgwSessions;   /**< Sessions by PGW IPv4 address*/
 }S11_t;
 
 void s11_accept(evutil_socket_t listener, short event, void *arg);
 
+static void s11_pathSweep(evutil_socket_t fd, short event, void *arg);
+
+/* Keep the SGW selection informed of the sessions on each peer*/
+static void s11_reportLoad(const Peer_t *p){
+    if(p->addr.sa_family == AF_INET){
+        setNodeLoad(SGW, &((const struct sockaddr_in*)&p->addr)->sin_addr,
+                    p->num_sessions);
+    }
+}
+
 /* ======================================================================*/
 
 static gpointer s11_newSession(S11_t *s11, EMMCtx emm, EPS_Session s){
@@ -67,6 +87,23 @@ void s11_deleteSession(gpointer s11_h, gpointer u){
     g_hash_table_remove(self->users, s11u_getTEIDp(u));
 }
 
+static int setLocalRestartCounter(const char *stateDir, const char *ipAddr, guint8 r){
+    int fd = 0;
+    char filename[512];
+    bzero(filename, 512);
+
+    strcat(strcat(strcpy(filename, stateDir), "/recovery-"), ipAddr);
+    fd = open(filename, O_TRUNC | O_RDWR | O_CREAT, 0644);
+    if(fd == -1){
+        log_msg(LOG_ERR, errno,"Couldn't write/create file %s", filename);
+        return -1;
+    }
+    log_msg(LOG_DEBUG, 0,"Updating restart Counter %d", r);
+    write(fd, &r, sizeof(guint8));
+    close(fd);
+    return 0;
+}
+
 static int getLocalRestartCounter(const char *stateDir, const char *ipAddr, guint8 *restartCounter){
     int fd = 0;
     guint8 r=0;
@@ -87,14 +124,9 @@ static int getLocalRestartCounter(const char *stateDir, const char *ipAddr, guin
         r++;
         close(fd);
     }
-    fd = open(filename, O_TRUNC | O_RDWR | O_CREAT, 0644);
-    if(fd == -1){
-        log_msg(LOG_ERR, errno,"Couldn't write/create file %s", filename);
+    if(setLocalRestartCounter(stateDir, ipAddr, r) == -1){
         return -1;
     }
-    log_msg(LOG_DEBUG, 0,"Updating restart Counter %d", r);
-    write(fd, &r, sizeof(guint8));
-    close(fd);
 
     *restartCounter = r;
     return 0;
@@ -103,10 +135,15 @@ static int getLocalRestartCounter(const char *stateDir, const char *ipAddr, guin
 gpointer s11_init(gpointer mme){
     S11_t *self = g_new0(S11_t, 1);
     struct stat st = {0};
+    const struct timeval tick = {.tv_sec = 1, .tv_usec = 0};
 
     self->mme = mme;
     self->tm = mme_getTimerMgr(mme);
     self->seq = 0;
+    mme_getS11PathCfg(mme,
+                      &self->pathCfg.echoInterval,
+                      &self->pathCfg.t3,
+                      &self->pathCfg.n3);
 
     if (stat(mme_getStateDir(self->mme), &st) == -1) {
         mkdir(mme_getStateDir(self->mme), 0755);
@@ -131,13 +168,20 @@ gpointer s11_init(gpointer mme){
     log_msg(LOG_INFO, 0, "Open S11 server on file descriptor %d, port %d",
             self->fd, GTP2C_PORT);
 
-    mme_registerRead(self->mme, self->fd, s11_accept, self);
+    mme_registerRead(self->mme, self->fd, LP_S11, s11_accept, self);
 
     self->users = g_hash_table_new_full( g_int_hash,
                                          g_int_equal,
                                          NULL,
                                          (GDestroyNotify)s11u_freeUser);
     self->peers = s11peer_buildTable();
+    self->pathListeners = g_ptr_array_new_full(2, g_free);
+    self->pgwSessions = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    /* One sweep per second supervises the path of all the peers*/
+    self->pathEv = event_new(mme_getEventBase(self->mme), -1, EV_PERSIST,
+                             s11_pathSweep, self);
+    evtimer_add(self->pathEv, &tick);
 
     return self;
 }
@@ -145,8 +189,11 @@ gpointer s11_init(gpointer mme){
 void s11_free(gpointer s11_h){
     S11_t *self = (S11_t *) s11_h;
 
+    event_free(self->pathEv);
+    g_ptr_array_free(self->pathListeners, TRUE);
     s11peer_destroyTable(self->peers);
     g_hash_table_destroy(self->users);
+    g_hash_table_destroy(self->pgwSessions);
     mme_deregisterRead(self->mme, self->fd);
     close(self->fd);
     s11DestroyFSM();
@@ -155,7 +202,7 @@ void s11_free(gpointer s11_h){
 
 void s11_register_fd(gpointer s11_h, int fd, s11_event_cb cb, s11_event_arg arg){
     S11_t *self = (S11_t *) s11_h;
-    mme_registerRead(self->mme, fd, cb, arg);
+    mme_registerRead(self->mme, fd, LP_S11, cb, arg);
 }
 
 void s11_send(gpointer s11_h,
@@ -181,6 +228,20 @@ const guint8 getRestartCounter(gpointer s11_h){
     return self->restartCounter;
 }
 
+void S11_keepRestartCounter(gpointer s11_h, guint8 restartCounter){
+    S11_t *self = (S11_t *) s11_h;
+
+    if(self->restartCounter == restartCounter){
+        return;
+    }
+    log_msg(LOG_INFO, 0, "Keeping the S11 restart counter %u of the "
+            "restored sessions", restartCounter);
+    self->restartCounter = restartCounter;
+    setLocalRestartCounter(mme_getStateDir(self->mme),
+                           mme_getLocalAddress(self->mme),
+                           restartCounter);
+}
+
 gboolean S11_isFirstSession(gpointer  s11_h,
                             const struct sockaddr *rAddr,
                             const socklen_t rAddrLen){
@@ -188,10 +249,11 @@ gboolean S11_isFirstSession(gpointer  s11_h,
     Peer_t *p = NULL;
     if(s11peer_isFirstSession(self->peers, rAddr, rAddrLen, &p)){
         p->s11 = self;
-        p->tm = self->tm;
-        s11peer_track(p);
+        s11peer_track(p, g_get_monotonic_time());
+        s11_reportLoad(p);
         return TRUE;
     }
+    s11_reportLoad(p);
     return FALSE;
 }
 
@@ -203,16 +265,38 @@ void S11_unrefSession(gpointer  s11_h,
     Peer_t * p = s11peer_get(self->peers, rAddr, rAddrLen);
     if(!p){
         log_msg(LOG_ERR, 0,"S11 Peer was not tracked");
+        return;
     }
     p->num_sessions--;
+    s11_reportLoad(p);
 
     if(p->num_sessions==0){
+        /* The node status follows the path, a peer down is supervised
+         * until it recovers*/
+        if(p->pathState == PEER_PATH_DOWN){
+            log_msg(LOG_INFO, 0,"S11 Peer last session, path down, "
+                    "supervising until it recovers");
+            return;
+        }
         log_msg(LOG_INFO, 0,"S11 Peer last session, untracking");
-        s11peer_untrack(p);
         g_hash_table_remove(self->peers, p);
     }
 }
 
+void S11_addPGWSession(gpointer s11_h, const struct in_addr *pgw, gint delta){
+    S11_t *self = (S11_t *)s11_h;
+    gpointer key = GUINT_TO_POINTER(pgw->s_addr);
+    guint n = GPOINTER_TO_UINT(g_hash_table_lookup(self->pgwSessions, key));
+
+    n = delta < 0 && n < (guint)-delta ? 0 : n + delta;
+    if(n == 0){
+        g_hash_table_remove(self->pgwSessions, key);
+    }else{
+        g_hash_table_insert(self->pgwSessions, key, GUINT_TO_POINTER(n));
+    }
+    setNodeLoad(PGW, pgw, n);
+}
+
 void S11_checkPeerRestart(gpointer  s11_h,
                           const struct sockaddr *rAddr,
                           const socklen_t rAddrLen,
@@ -231,6 +315,51 @@ void S11_checkPeerRestart(gpointer  s11_h,
     }
 }
 
+void S11_registerPathCb(gpointer s11_h, S11_PathCb cb, gpointer arg){
+    S11_t *self = (S11_t *)s11_h;
+    S11_PathListener_t *l = g_new0(S11_PathListener_t, 1);
+    l->cb = cb;
+    l->arg = arg;
+    g_ptr_array_add(self->pathListeners, l);
+}
+
+void S11_notifyPath(gpointer s11_h, gpointer peer, PeerPathState old){
+    S11_t *self = (S11_t *)s11_h;
+    Peer_t *p = (Peer_t *)peer;
+    S11_PathListener_t *l;
+    char addrStr[INET6_ADDRSTRLEN];
+    guint i;
+
+    if(p->pathState == PEER_PATH_UP && old == PEER_PATH_DOWN){
+        log_msg(LOG_WARNING, 0, "S11 path towards %s restored",
+                inet_ntop(p->addr.sa_family,
+                          &((struct sockaddr_in*)&p->addr)->sin_addr,
+                          addrStr,
+                          INET6_ADDRSTRLEN));
+    }
+    if(p->addr.sa_family == AF_INET){
+        setNodeStatus(SGW, &((struct sockaddr_in*)&p->addr)->sin_addr,
+                      p->pathState == PEER_PATH_DOWN ? down : up);
+    }
+
+    for(i=0; i<self->pathListeners->len; i++){
+        l = g_ptr_array_index(self->pathListeners, i);
+        l->cb(l->arg, &p->addr, p->len, p->pathState == PEER_PATH_UP);
+    }
+}
+
+GList *S11_getPeers(gpointer s11_h){
+    S11_t *self = (S11_t *)s11_h;
+    return g_hash_table_get_values(self->peers);
+}
+
+static void s11_pathSweep(evutil_socket_t fd, short event, void *arg){
+    S11_t *self = (S11_t *)arg;
+    loopprof_enter(LP_S11_PATH);
+    s11peer_sweep(self->peers, &self->pathCfg, g_get_monotonic_time());
+    loopprof_leave();
+}
+
 void S11_paging(gpointer s11_h, gpointer emm){
     S11_t *self = (S11_t *)s11_h;
     mme_paging(self->mme, emm);
@@ -307,7 +436,8 @@ void s11_accept(evutil_socket_t listener, short event, void *arg){
     }else if(msg->packet.gtp.gtp2s.h.type == GTP2_ECHO_RSP){
         s11peer_processEchoRsp(self->peers,
                                &msg->peer, msg->peerlen,
-                               &msg->packet.gtp, msg->length);
+                               &msg->packet.gtp, msg->length,
+                               g_get_monotonic_time());
     }else if(msg->packet.gtp.gtp2s.h.type<4){
         /* TODO @Vicent:
            Manage echo request, echo response or version not suported*/
@@ -352,6 +482,19 @@ gpointer S11_newUserAttach(gpointer s11_h, EMMCtx emm, EPS_Session s,
     return u;
 }
 
+gpointer S11_restoreUser(gpointer s11_h, EMMCtx emm, EPS_Session s,
+                         const SnapSession_t *snap){
+    S11_t *self = (S11_t *) s11_h;
+    gpointer u = s11u_restoreUser(self, emm, s, snap);
+
+    g_hash_table_insert(self->users, s11u_getTEIDp(u), u);
+    S11_isFirstSession(self, &snap->rAddr, snap->rAddrLen);
+    if(snap->connected){
+        /* The UE is idle now, the S-GW must drop the old eNB F-TEID*/
+        releaseAccess(u, NULL, NULL);
+    }
+    return u;
+}
 
 void S11_Attach_ModifyBearerReq(gpointer s11_user, void(*cb)(gpointer), gpointer args){
     log_msg(LOG_DEBUG, 0, "enter");
@@ -31,10 +31,23 @@
 #include "MME.h"
 #include "EPS_Session.h"
 #include "EMMCtx_iface.h"
+#include "S11_Peer.h"
 
 typedef event_callback_fn s11_event_cb;
 typedef void*             s11_event_arg;
 
+/**
+ * @brief Path state change callback
+ * @param [in]  arg       Argument given on registration
+ * @param [in]  rAddr     Peer address
+ * @param [in]  rAddrLen  Peer address length
+ * @param [in]  up        TRUE when the path is up, FALSE on path failure
+ */
+typedef void (*S11_PathCb)(gpointer arg,
+                           const struct sockaddr *rAddr,
+                           const socklen_t rAddrLen,
+                           gboolean up);
+
 /**
  * @brief initiates the S11 stack
  * @param [in]  mme   pointer to mme structure to access the MME API
@@ -86,6 +99,16 @@ void s11_deleteSession(gpointer s11_h, gpointer u);
 const guint8 getRestartCounter(gpointer s11_h);
 
 
+/**
+ * @brief Keep the restart counter of a previous run
+ * @param [in]  s11_h          Engine reference
+ * @param [in]  restartCounter Counter of the restored sessions
+ *
+ * Used when the sessions are restored from a snapshot, the S-GW would
+ * remove them when seeing a new counter.
+ */
+void S11_keepRestartCounter(gpointer s11_h, guint8 restartCounter);
+
 /**
  * @brief Check if this is the first session for that peer
  * @param [in] s11_h s11 stack handler
@@ -111,12 +134,47 @@ void S11_unrefSession(gpointer  s11_h,
                       const struct sockaddr *rAddr,
                       const socklen_t rAddrLen);
 
+/**
+ * @brief Update the sessions of a PGW
+ * @param [in] s11_h  s11 stack handler
+ * @param [in] pgw    PGW IPv4 address
+ * @param [in] delta  Sessions added, negative when removed
+ *
+ * The PGW selection is informed of the new load
+ */
+void S11_addPGWSession(gpointer s11_h, const struct in_addr *pgw, gint delta);
+
 void S11_checkPeerRestart(gpointer  s11_h,
                           const struct sockaddr *rAddr,
                           const socklen_t rAddrLen,
                           guint8 restartCounter,
                           gpointer ongoingUser);
 
+/**
+ * @brief Register a callback for the S11 path state changes
+ * @param [in] s11_h s11 stack handler
+ * @param [in] cb    Callback run on path failure and recovery
+ * @param [in] arg   Argument passed to the callback
+ */
+void S11_registerPathCb(gpointer s11_h, S11_PathCb cb, gpointer arg);
+
+/**
+ * @brief Notify a path state change of a peer
+ * @param [in] s11_h s11 stack handler
+ * @param [in] peer  Peer_t with the new state
+ * @param [in] old   Previous path state
+ *
+ * Used by the peer path supervision.
+ */
+void S11_notifyPath(gpointer s11_h, gpointer peer, PeerPathState old);
+
+/**
+ * @brief Get the tracked S11 peers
+ * @param [in] s11_h s11 stack handler
+ * @return List of Peer_t, to be freed with g_list_free
+ */
+GList *S11_getPeers(gpointer s11_h);
+
 void S11_paging(gpointer s11_h, gpointer emm);
 
 /**
@@ -150,6 +208,20 @@ const char *s11_getLocalAddress(gpointer s11_h);
 gpointer S11_newUserAttach(gpointer s11_h, EMMCtx emm, EPS_Session s,
                        void(*cb)(gpointer), gpointer args);
 
+/**
+ * @brief Restore a user saved on a snapshot
+ * @param [in]  s11_h Engine reference
+ * @param [in]  emm   Mobility Manamegent Handler
+ * @param [in]  s     EPS session Handler
+ * @param [in]  snap  Session saved with s11u_snapshot
+ * @return the S11 user, idle
+ *
+ * The user keeps its TEIDs, a Release Access Bearers Request is sent when
+ * the UE was connected.
+ */
+gpointer S11_restoreUser(gpointer s11_h, EMMCtx emm, EPS_Session s,
+                         const SnapSession_t *snap);
+
 /**
  * @brief Modify Bearer on Attach procedure
  * @param [in]  s11_user  User structure
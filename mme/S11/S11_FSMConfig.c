@@ -56,3 +56,7 @@ void s11DestroyFSM(){
 void s11changeState(gpointer session, S11State s){
     s11u_setState(session, &(s11_states[s]));
 }
+
+gboolean s11isState(const S11_State *state, S11State s){
+    return state == &(s11_states[s]);
+}
@@ -45,4 +45,6 @@ void s11DestroyFSM();
 
 void s11changeState(gpointer, S11State);
 
+gboolean s11isState(const S11_State *state, S11State s);
+
 #endif /* S11_FSMCONFIG_HFILE */
@@ -28,6 +28,16 @@
 #include "MME_S11.h"
 #include "logmgr.h"
 
+/* GTPv2-C sequence numbers are 24 bits*/
+#define GTP2C_SEQ_MASK 0xFFFFFF
+
+/** Upper bound (ms, exclusive) of each RTT bucket, the last one is open*/
+static const guint S11_PEER_RTT_BOUND[S11_PEER_RTT_BUCKETS] = {
+    1, 2, 5, 10, 20, 50, 100, G_MAXUINT
+};
+
+const char *PeerPathStateName[] = {"UNKNOWN", "UP", "DOWN"};
+
 static guint s11peer_hash(gconstpointer key){
     Peer_t* k = (Peer_t*)key;
     guint res = 0;
@@ -66,13 +76,14 @@ gboolean s11peer_isFirstSession(GHashTable *peers,
         (*p)->num_sessions++;
         return FALSE;
     }
-    _p = malloc(sizeof(Peer_t));
+    _p = calloc(1, sizeof(Peer_t));
 
     _p->len = rAddrLen;
     memcpy(&_p->addr, rAddr, rAddrLen);
     _p->num_sessions=1;
     _p->restartCounter = 0;
     _p->restartValid = FALSE;
+    _p->pathState = PEER_PATH_UNKNOWN;
     g_hash_table_insert(peers, _p, _p);
     *p = _p;
     return TRUE;
@@ -111,63 +122,163 @@ Peer_t *s11peer_get(GHashTable *peers,
     return g_hash_table_lookup(peers, &key);
 }
 
-static void _s11peer_processEchoRsp(Peer_t *p, union gtp_packet *msg, size_t msg_len){
-    union gtpie_member *echo_ie[GTPIE_SIZE];
-    guint8             value[GTP2IE_MAX] = {0};
-    guint16            vsize = 0;
-    char               addrStr[INET6_ADDRSTRLEN];
+static const char *s11peer_addrStr(const Peer_t *p, char *addrStr){
+    return inet_ntop(p->addr.sa_family,
+                     &((struct sockaddr_in*)&p->addr)->sin_addr,
+                     addrStr,
+                     INET6_ADDRSTRLEN);
+}
 
-    /*Restart timer*/
-    s11peer_untrack(p);
-    s11peer_track(p);
+static void s11peer_recordRtt(Peer_t *p, guint32 rtt){
+    guint i;
 
-    gtp2ie_decap(echo_ie, msg, msg_len);
-    gtp2ie_gettliv(echo_ie,  GTPV2C_IE_RECOVERY, 0, value, &vsize);
-    log_msg(LOG_INFO, 0, "Received ECHO RSP from %s, recovery %u",
-            inet_ntop(p->addr.sa_family,
-                      &((struct sockaddr_in*)&p->addr)->sin_addr,
-                      addrStr,
-                      p->len),
-            value[0]);
+    p->lastRtt = rtt;
+    /* Same smoothing as the TCP SRTT (RFC 6298) */
+    p->srtt = p->srtt == 0 ? rtt : p->srtt - (p->srtt>>3) + (rtt>>3);
 
-    S11_checkPeerRestart(p->s11, &p->addr, p->len, value[0], NULL);
+    for(i=0; i<S11_PEER_RTT_BUCKETS-1; i++){
+        if(rtt < S11_PEER_RTT_BOUND[i]*1000){
+            break;
+        }
+    }
+    p->rttHist[i]++;
 }
 
-void s11peer_processEchoRsp(GHashTable *peers,
-                            const struct sockaddr *rAddr,
-                            const socklen_t rAddrLen,
-                            union gtp_packet *msg,
-                            size_t msg_len){
-    Peer_t *p = s11peer_get(peers, rAddr, rAddrLen);
-    _s11peer_processEchoRsp(p, msg, msg_len);
-}
+static void s11peer_sendEcho(Peer_t *p, const S11_PathCfg *cfg, gint64 now){
+    union gtp_packet   oMsg = {0};
+    uint32_t           oMsglen = 0;
+    union gtpie_member ie[1] = {0};
+    GError *err = NULL;
 
+    if(!p->echoPending){
+        p->echoSeq = getNextSeq(p->s11) & GTP2C_SEQ_MASK;
+        p->echoPending = TRUE;
+        p->echoRtx = 0;
+        p->nextEcho = now + (gint64)cfg->echoInterval*G_USEC_PER_SEC;
+    }else{
+        p->echoRtx++;
+    }
 
-void s11peer_sendEcho(Timer t, void* arg){
-    Peer_t *p = (Peer_t *)arg;
-    int fd;
-    const struct timeval tv = {.tv_sec = 20, .tv_usec = 0};
+    oMsglen = get_default_gtp(2, GTP2_ECHO_REQ, &oMsg);
+    oMsg.gtp2s.h.seq = p->echoSeq;
 
-    log_msg(LOG_INFO, 0, "Sending S11 ECHO REQ (test), sessions %u", p->num_sessions);
+    /* Recovery IE*/
+    ie[0].tliv.i=0;
+    ie[0].tliv.l=hton16(1);
+    ie[0].tliv.t=GTPV2C_IE_RECOVERY;
+    ie[0].tliv.v[0]=getRestartCounter(p->s11);
+    gtp2ie_encaps(ie, 1, &oMsg, &oMsglen);
 
-    /* Open UDP socket*/
-    /* if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) { */
-    /*     log_msg(LOG_ERR, errno, */
-    /*             "socket(domain=%d, type=%d, protocol=%d) failed", AF_INET, SOCK_DGRAM, 0); */
-    /*     return; */
-    /* } */
-    /* Send Echo Req*/
+    log_msg(LOG_DEBUG, 0, "Sending S11 ECHO REQ, seq %u, rtx %u, sessions %u",
+            p->echoSeq, p->echoRtx, p->num_sessions);
 
-    /* Next iteration*/
-    p->t = tm_add_timer(p->tm, &tv, 1, s11peer_sendEcho, NULL, NULL, p);
+    s11_send(p->s11, &oMsg, oMsglen, &p->addr, p->len, &err);
+    if(err != NULL){
+        log_msg(LOG_ERR, 0, "s11_send error");
+        g_error_free(err);
+    }
+    p->echoSent = now;
 }
 
+static void s11peer_pathFailure(Peer_t *p, const S11_PathCfg *cfg, gint64 now){
+    char addrStr[INET6_ADDRSTRLEN];
+    PeerPathState old = p->pathState;
+
+    p->echoPending = FALSE;
+    p->nextEcho = now + (gint64)cfg->echoInterval*G_USEC_PER_SEC;
 
-void s11peer_track(Peer_t *p){
-    const struct timeval tv = {.tv_sec = 20, .tv_usec = 0};
-    p->t = tm_add_timer(p->tm, &tv, 1, s11peer_sendEcho, NULL, NULL, p);
+    if(old == PEER_PATH_DOWN){
+        return;
+    }
+    p->pathState = PEER_PATH_DOWN;
+    p->pathFailures++;
+    log_msg(LOG_WARNING, 0, "S11 path failure towards %s, no ECHO RSP after %u"
+            " retransmissions", s11peer_addrStr(p, addrStr), cfg->n3);
+    S11_notifyPath(p->s11, p, old);
 }
 
-void s11peer_untrack(Peer_t *p){
-    tm_stop_timer(p->t);
+void s11peer_track(Peer_t *p, gint64 now){
+    p->echoPending = FALSE;
+    p->nextEcho = now;
+}
+
+typedef struct{
+    const S11_PathCfg *cfg;
+    gint64            now;
+}SweepArgs_t;
+
+/* Returns TRUE to stop tracking a peer without sessions once its path is
+ * not down*/
+static gboolean s11peer_sweepPeer(gpointer key, gpointer value, gpointer data){
+    Peer_t *p = (Peer_t *)value;
+    const S11_PathCfg *cfg = ((SweepArgs_t *)data)->cfg;
+    gint64 now = ((SweepArgs_t *)data)->now;
+    char addrStr[INET6_ADDRSTRLEN];
+
+    if(p->num_sessions == 0 && p->pathState != PEER_PATH_DOWN){
+        log_msg(LOG_INFO, 0, "S11 Peer %s without sessions, untracking",
+                s11peer_addrStr(p, addrStr));
+        return TRUE;
+    }
+    if(p->echoPending){
+        if(now - p->echoSent < (gint64)cfg->t3*G_USEC_PER_SEC){
+            return FALSE;
+        }
+        if(p->echoRtx >= cfg->n3){
+            s11peer_pathFailure(p, cfg, now);
+        }else{
+            s11peer_sendEcho(p, cfg, now);
+        }
+        return FALSE;
+    }
+    if(now >= p->nextEcho){
+        s11peer_sendEcho(p, cfg, now);
+    }
+    return FALSE;
+}
+
+void s11peer_sweep(GHashTable *peers, const S11_PathCfg *cfg, gint64 now){
+    SweepArgs_t args = {.cfg = cfg, .now = now};
+    g_hash_table_foreach_remove(peers, s11peer_sweepPeer, &args);
+}
+
+void s11peer_processEchoRsp(GHashTable *peers,
+                            const struct sockaddr *rAddr,
+                            const socklen_t rAddrLen,
+                            union gtp_packet *msg,
+                            size_t msg_len,
+                            gint64 now){
+    union gtpie_member *echo_ie[GTPIE_SIZE];
+    guint8             value[GTP2IE_MAX] = {0};
+    guint16            vsize = 0;
+    char               addrStr[INET6_ADDRSTRLEN];
+    Peer_t             *p;
+    PeerPathState      old;
+
+    p = s11peer_get(peers, rAddr, rAddrLen);
+    if(!p){
+        log_msg(LOG_INFO, 0, "Received ECHO RSP from a peer not tracked. Ignoring");
+        return;
+    }
+    if(!p->echoPending || msg->gtp2s.h.seq != p->echoSeq){
+        log_msg(LOG_INFO, 0, "Received ECHO RSP from %s with unexpected"
+                " sequence number. Ignoring", s11peer_addrStr(p, addrStr));
+        return;
+    }
+
+    s11peer_recordRtt(p, (guint32)MIN(now - p->echoSent, G_MAXUINT32));
+    p->echoPending = FALSE;
+
+    gtp2ie_decap(echo_ie, msg, msg_len);
+    gtp2ie_gettliv(echo_ie,  GTPV2C_IE_RECOVERY, 0, value, &vsize);
+    log_msg(LOG_DEBUG, 0, "Received ECHO RSP from %s, recovery %u, rtt %u us",
+            s11peer_addrStr(p, addrStr), value[0], p->lastRtt);
+
+    old = p->pathState;
+    p->pathState = PEER_PATH_UP;
+    if(old != PEER_PATH_UP){
+        S11_notifyPath(p->s11, p, old);
+    }
+
+    S11_checkPeerRestart(p->s11, &p->addr, p->len, value[0], NULL);
 }
@@ -28,17 +28,44 @@
 #include <glib.h>
 
 #include "gtp.h"
-#include "timermgr.h"
+
+/** Number of buckets of the per peer Echo RTT histogram*/
+#define S11_PEER_RTT_BUCKETS 8
+
+typedef enum{
+    PEER_PATH_UNKNOWN,      /**< No Echo Response received yet*/
+    PEER_PATH_UP,
+    PEER_PATH_DOWN,         /**< N3 Echo Requests without response*/
+}PeerPathState;
+
+extern const char *PeerPathStateName[];
+
+/** GTPv2-C path management parameters (3GPP TS 29.274 clause 7.6)*/
+typedef struct{
+    guint           echoInterval;   /**< Seconds between Echo Requests*/
+    guint           t3;             /**< Seconds to wait for an Echo Response*/
+    guint           n3;             /**< Echo Request retransmissions*/
+}S11_PathCfg;
 
 typedef struct{
     gpointer        s11;
-    TimerMgr        tm;
-    Timer           t;
     struct sockaddr addr;
     socklen_t       len;
     guint32         num_sessions;
     gboolean        restartValid;
     guint8          restartCounter;
+
+    /* Path management, driven by s11peer_sweep */
+    PeerPathState   pathState;
+    gboolean        echoPending;    /**< Echo Request waiting for response*/
+    guint32         echoSeq;        /**< Sequence number of the pending Echo, 24 bits*/
+    guint32         echoRtx;        /**< Retransmissions of the pending Echo*/
+    gint64          echoSent;       /**< Monotonic time of the last Echo sent*/
+    gint64          nextEcho;       /**< Monotonic time of the next Echo*/
+    guint32         pathFailures;
+    guint32         lastRtt;        /**< Last Echo RTT in us*/
+    guint32         srtt;           /**< Smoothed Echo RTT in us*/
+    guint64         rttHist[S11_PEER_RTT_BUCKETS];
 }Peer_t;
 
 GHashTable *s11peer_buildTable();
@@ -83,14 +110,44 @@ Peer_t *s11peer_get(GHashTable *peers,
                     const struct sockaddr *rAddr,
                     const socklen_t rAddrLen);
 
-void s11peer_track(Peer_t *p);
-
-
-void s11peer_untrack(Peer_t *p);
+/**
+ *@brief Start the path supervision of the peer
+ *@param [in]  p    Peer struct
+ *@param [in]  now  Current monotonic time (us)
+ *
+ * The first Echo Request is sent on the next sweep.
+ */
+void s11peer_track(Peer_t *p, gint64 now);
 
+/**
+ *@brief Run the path supervision of all the peers
+ *@param [in]  peers
+ *@param [in]  cfg   Path management parameters
+ *@param [in]  now   Current monotonic time (us)
+ *
+ * Single periodic sweep used for all the peers instead of one timer
+ * each. It sends the Echo Requests that are due, retransmits the ones
+ * not answered after T3 and declares the path failure after N3
+ * retransmissions. The peers without sessions are kept until their path
+ * is not down, so the node status recovers with the path.
+ */
+void s11peer_sweep(GHashTable *peers, const S11_PathCfg *cfg, gint64 now);
 
+/**
+ *@brief Process a received Echo Response
+ *@param [in]  peers
+ *@param [in]  rAddr
+ *@paran [in]  rAddrLen
+ *@param [in]  msg       Echo Response
+ *@param [in]  msg_len
+ *@param [in]  now       Current monotonic time (us)
+ *
+ * Echo Responses from peers not tracked or not matching the pending
+ * sequence number are ignored.
+ */
 void s11peer_processEchoRsp(GHashTable *peers,
                             const struct sockaddr *rAddr,
                             const socklen_t rAddrLen,
                             union gtp_packet *msg,
-                            size_t msg_len);
+                            size_t msg_len,
+                            gint64 now);
@@ -27,6 +27,11 @@
 #include "S11_FSMConfig.h"
 #include "MME_S11.h"
 #include "logmgr.h"
+#include "tracemgr.h"
+#include "metrics.h"
+#include "memacct.h"
+#include "slab.h"
+#include "replica.h"
 #include "EMMCtx.h"
 #include "EPS_Session_priv.h"
 #include "ESM_BearerContext.h"
@@ -39,6 +44,7 @@
 
 typedef struct{
     guint32            seq;
+    guint64            sent;     /**< Request send time, metric_now()*/
     int                fd;
     union gtp_packet   oMsg;
     guint32            oMsglen;
@@ -55,6 +61,7 @@ typedef struct{
     struct sockaddr    rAddr;    /**<Peer IP address, IPv4 or IPv6*/
     socklen_t          rAddrLen; /**<Peer Socket length returned by recvfrom*/
     struct fteid_t     s5s8;     /**< F-TEID PGW S5/S8 (Control Plane)*/
+    struct in_addr     pgw;      /**< PGW counted on its load, 0 if none*/
     EMMCtx             emm;
     EPS_Session        session;
     Subscription       subs;     /**< Subscription information*/
@@ -73,21 +80,52 @@ parse_error (void)
   return g_quark_from_static_string ("gtpv2-parse-error");
 }
 
+static Slab userPool = NULL;
+static Slab trxnPool = NULL;
+
+/* User of the message being processed, cleared if the state removes it*/
+static S11_user_t *processing = NULL;
+
 /* Trxn functions*/
 static S11_TrxnT *s11uTrxn_new(guint32 seq){
-    S11_TrxnT *trxn =  g_new(S11_TrxnT, 1);
+    S11_TrxnT *trxn;
+
+    if(!trxnPool){
+        trxnPool = slab_new("s11_trxn", sizeof(S11_TrxnT), MA_S11_TRXN);
+    }
+    trxn = slab_alloc0(trxnPool);
     trxn->seq = seq;
     return trxn;
 }
 
 static void s11uTrxn_destroy(void *t){
     S11_TrxnT *trxn = (S11_TrxnT *)t;
-    g_free(trxn);
+    slab_free(trxnPool, trxn);
+}
+
+/* Counts the session on the load of the PGW selected for the UE*/
+static void s11u_refPGW(S11_user_t *self){
+    struct sockaddr pgw = {0};
+    socklen_t pgwLen = 0;
+
+    emmCtx_getPGW(self->emm, &pgw, &pgwLen);
+    if(pgw.sa_family != AF_INET){
+        return;
+    }
+    self->pgw = ((struct sockaddr_in *)&pgw)->sin_addr;
+    if(self->pgw.s_addr){
+        S11_addPGWSession(self->s11, &self->pgw, 1);
+    }
 }
 
 /* User functions*/
 gpointer s11u_newUser(gpointer s11, EMMCtx emm, EPS_Session s){
-    S11_user_t *self = g_new0(S11_user_t, 1);
+    S11_user_t *self;
+
+    if(!userPool){
+        userPool = slab_new("s11_user", sizeof(S11_user_t), MA_S11_USER);
+    }
+    self = slab_alloc0(userPool);
     self->lTEID   = newTeid();
     self->rTEID   = 0;
     self->emm     = emm;
@@ -99,9 +137,11 @@ gpointer s11u_newUser(gpointer s11, EMMCtx emm, EPS_Session s){
                                          g_int_equal,
                                          NULL,
                                          (GDestroyNotify)s11uTrxn_destroy);
+    memacct_add(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
 
     /*Get SGW addr*/
     emmCtx_getSGW(emm, &self->rAddr, &self->rAddrLen);
+    s11u_refPGW(self);
 
     /*Initial state noCtx*/
     s11changeState(self, noCtx);
@@ -112,21 +152,125 @@ gpointer s11u_newUser(gpointer s11, EMMCtx emm, EPS_Session s){
 void s11u_freeUser(gpointer u){
     S11_user_t *self = (S11_user_t*)u;
     S11_unrefSession(self->s11, &self->rAddr, self->rAddrLen);
+    if(self->pgw.s_addr){
+        S11_addPGWSession(self->s11, &self->pgw, -1);
+    }
     log_msg(LOG_INFO, 0, "Removing S11 session");
+    if(self == processing){
+        processing = NULL;
+    }
+    metrics.s11Pending -= g_hash_table_size(self->trxns);
     g_hash_table_destroy(self->trxns);
-    g_free(self);
+    memacct_sub(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+    slab_free(userPool, self);
+}
+
+void s11u_footprint(gpointer u, MemAcctUE *ue){
+    S11_user_t *self = (S11_user_t*)u;
+    ue->objects[MA_S11_USER]++;
+    ue->objects[MA_HASH_TABLE]++;
+    ue->objects[MA_S11_TRXN] += g_hash_table_size(self->trxns);
+}
+
+gboolean s11u_snapshot(const gpointer u, SnapSession_t *snap){
+    S11_user_t *self = (S11_user_t*)u;
+
+    if(s11isState(self->state, ctx)){
+        snap->connected = 1;
+    }else if(s11isState(self->state, ulCtx)){
+        snap->connected = 0;
+    }else{
+        return FALSE;
+    }
+    snap->lTEID = self->lTEID;
+    snap->rTEID = self->rTEID;
+    memcpy(&(snap->rAddr), &(self->rAddr), sizeof(struct sockaddr));
+    snap->rAddrLen = self->rAddrLen;
+    memcpy(&(snap->s5s8), &(self->s5s8), sizeof(struct fteid_t));
+    return TRUE;
+}
+
+gpointer s11u_restoreUser(gpointer s11, EMMCtx emm, EPS_Session s,
+                          const SnapSession_t *snap){
+    S11_user_t *self;
+
+    if(!userPool){
+        userPool = slab_new("s11_user", sizeof(S11_user_t), MA_S11_USER);
+    }
+    self = slab_alloc0(userPool);
+    self->lTEID   = snap->lTEID;
+    self->rTEID   = snap->rTEID;
+    self->emm     = emm;
+    self->session = s;
+    self->subs    = emmCtx_getSubscription(emm);
+    self->s11     = s11;
+    memcpy(&(self->rAddr), &(snap->rAddr), sizeof(struct sockaddr));
+    self->rAddrLen = snap->rAddrLen;
+    memcpy(&(self->s5s8), &(snap->s5s8), sizeof(struct fteid_t));
+    s11u_refPGW(self);
+
+    self->trxns = g_hash_table_new_full( g_int_hash,
+                                         g_int_equal,
+                                         NULL,
+                                         (GDestroyNotify)s11uTrxn_destroy);
+    memacct_add(MA_HASH_TABLE, MEMACCT_GHASH_BYTES);
+
+    s11changeState(self, snap->connected ? ctx : ulCtx);
+    log_msg(LOG_INFO, 0, "Restored S11 session");
+    return self;
 }
 
 static void s11u_newTrxn(S11_user_t *self){
      S11_TrxnT *t = s11uTrxn_new(getNextSeq(self->s11));
      g_hash_table_insert(self->trxns, &t->seq, t);
      self->active_trxn = t;
+     metrics.s11Pending++;
 }
 
 static gboolean s11u_hasPendingResp(S11_user_t *self, guint32 seq, S11_TrxnT **t){
     return g_hash_table_lookup_extended(self->trxns, &seq, NULL, (void**)t);
 }
 
+/* Response and acknowledge types, TS 29.274 Table 6.1-1*/
+static gboolean isResponse(guint8 type){
+    switch(type){
+    case GTP2_ECHO_RSP:
+    case GTP2_CREATE_SESSION_RSP:
+    case GTP2_MODIFY_BEARER_RSP:
+    case GTP2_DELETE_SESSION_RSP:
+    case GTP2_CHANGE_NOTIFICATION_RSP:
+    case GTP2_CREATE_BEARER_RSP:
+    case GTP2_UPDATE_BEARER_RSP:
+    case GTP2_DELETE_BEARER_RSP:
+    case GTP2_DELETE_PDN_CONNECTION_SET_RSP:
+    case GTP2_PGW_DOWNLINK_TRIGGERING_ACK:
+    case GTP2_IDENTIFICATION_RSP:
+    case GTP2_CONTEXT_RSP:
+    case GTP2_CONTEXT_ACK:
+    case GTP2_FORWARD_RELOCATION_RSP:
+    case GTP2_FORWARD_RELOCATION_COMPLETE_ACK:
+    case GTP2_FORWARD_ACCESS_CONTEXT_ACK:
+    case GTP2_RELOCATION_CANCEL_RSP:
+    case GTP2_DETACH_ACK:
+    case GTP2_ALERT_MME_ACK:
+    case GTP2_UE_ACTIVITY_ACK:
+    case GTP2_CREATE_FORWARDING_TUNNEL_RSP:
+    case GTP2_SUSPEND_ACK:
+    case GTP2_RESUME_ACK:
+    case GTP2_CREATE_INDIRECT_DATA_FORWARDING_TUNNEL_RSP:
+    case GTP2_DELETE_INDIRECT_DATA_FORWARDING_TUNNEL_RSP:
+    case GTP2_RELEASE_ACCESS_BEARERS_RSP:
+    case GTP2_DOWNLINK_DATA_NOTIFICATION_ACK:
+    case GTP2_UPDATE_PDN_CONNECTION_SET_RSP:
+    case GTP2_MBMS_SESSION_START_RSP:
+    case GTP2_MBMS_SESSION_UPDATE_RSP:
+    case GTP2_MBMS_SESSION_STOP_RSP:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
 static gboolean validateSourceAddr(S11_user_t* self,
                                    const struct sockaddr *src,
                                    const socklen_t peerlen){
@@ -137,30 +281,65 @@ void processMsg(gpointer u, const struct t_message *msg){
     S11_user_t *self = (S11_user_t*)u;
     S11_TrxnT *t = NULL;
     char addrStr[INET6_ADDRSTRLEN];
+    guint64 lat;
+    gboolean rsp;
+    const guint8 type = msg->packet.gtp.gtp2l.h.type;
+
+    if(!validateSourceAddr(self, &msg->peer, msg->peerlen)){
+        log_msg(LOG_WARNING, 0, "S11 - Wrong S-GW source (%s)."
+                "Ignoring packet", inet_ntop(msg->peer.sa_family,
+                                             &((struct sockaddr_in*)&msg->peer)->sin_addr,
+                                             addrStr,
+                                             msg->peerlen));
+        return;
+    }
 
-    if (s11u_hasPendingResp(self, msg->packet.gtp.gtp2l.h.seq, &t)){
+    rsp = s11u_hasPendingResp(self, msg->packet.gtp.gtp2l.h.seq, &t);
+    if (rsp){
         log_msg(LOG_DEBUG, 0, "Received pending S11 reply");
         self->active_trxn = t;
+        trace_event(TRACE_S11_RX_RSP, self->lTEID,
+                    msg->packet.gtp.gtp2l.h.type, 0, t->seq);
+        metric_inc(MC_S11_RX_RSP);
+        lat = metric_now() - t->sent;
+        metric_observe(MH_S11_LATENCY, lat);
+        emmCtx_procSegment(self->emm, MS_SGW, lat);
+    }
+    else if(isResponse(type)){
+        /* Retransmitted or late, the transaction was already answered*/
+        log_msg(LOG_DEBUG, 0, "Ignoring S11 response %u without request",
+                type);
+        return;
     }
     else{
         log_msg(LOG_DEBUG, 0, "Received new S11 request");
         self->active_trxn = s11uTrxn_new(msg->packet.gtp.gtp2l.h.seq);
         t = self->active_trxn;
+        trace_event(TRACE_S11_RX_REQ, self->lTEID,
+                    msg->packet.gtp.gtp2l.h.type, 0, t->seq);
+        metric_inc(MC_S11_RX_REQ);
     }
 
     t->iMsglen = msg->length;
     memcpy(&(t->iMsg), &(msg->packet.gtp), msg->length);
 
-    if(!validateSourceAddr(self, &msg->peer, msg->peerlen)){
-        log_msg(LOG_WARNING, 0, "S11 - Wrong S-GW source (%s)."
-                "Ignoring packet", inet_ntop(msg->peer.sa_family,
-                                             &((struct sockaddr_in*)&msg->peer)->sin_addr,
-                                             addrStr,
-                                             msg->peerlen));
-        return;
-    }
+    if(emmCtx_isTraced(self->emm))
+        emmCtx_capture(self->emm, UETRACE_GTPV2, &t->iMsg, t->iMsglen);
 
+    /* The transaction is released after processing the message, answered
+     * or not, it would be kept until the user is removed otherwise. The
+     * state may remove the user, so it is taken out of the table first*/
+    if(rsp){
+        g_hash_table_steal(self->trxns, &t->seq);
+        metrics.s11Pending--;
+    }
+    processing = self;
     self->state->processMsg(self);
+    if(processing){
+        self->active_trxn = NULL;
+    }
+    processing = NULL;
+    s11uTrxn_destroy(t);
 }
 
 void attach(gpointer session, void(*cb)(gpointer), gpointer args){
@@ -199,6 +378,7 @@ int *s11u_getTEIDp(gpointer u){
 void s11u_setState(gpointer u, S11_State *s){
     S11_user_t *self = (S11_user_t*)u;
     self->state = s;
+    replica_touch(emmCtx_getGUTI(self->emm)->mtmsi);
 }
 
 
@@ -208,6 +388,10 @@ static void s11__send(S11_user_t* self){
     self->active_trxn->oMsg.gtp2l.h.seq = self->active_trxn->seq;
     self->active_trxn->oMsg.gtp2l.h.tei = self->rTEID;
 
+    if(emmCtx_isTraced(self->emm))
+        emmCtx_capture(self->emm, UETRACE_GTPV2, &(self->active_trxn->oMsg),
+                       self->active_trxn->oMsglen);
+
     s11_send(self->s11, &(self->active_trxn->oMsg), self->active_trxn->oMsglen,
              &(self->rAddr), self->rAddrLen, &err);
     if(err != NULL){
@@ -216,12 +400,18 @@ static void s11__send(S11_user_t* self){
 }
 
 static void s11u_send(S11_user_t* self){
+    trace_event(TRACE_S11_TX_REQ, self->lTEID,
+                self->active_trxn->oMsg.gtp2l.h.type, 0, self->active_trxn->seq);
+    metric_inc(MC_S11_TX_REQ);
+    self->active_trxn->sent = metric_now();
     s11__send(self);
 }
 
 static void s11_send_resp(S11_user_t* self){
+    trace_event(TRACE_S11_TX_RSP, self->lTEID,
+                self->active_trxn->oMsg.gtp2l.h.type, 0, self->active_trxn->seq);
+    metric_inc(MC_S11_TX_RSP);
     s11__send(self);
-    s11uTrxn_destroy(self->active_trxn);
 }
 
 static gboolean isFirstSessionForSGW(S11_user_t* self){
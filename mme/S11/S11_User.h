@@ -38,6 +38,23 @@ gpointer s11u_newUser(gpointer s11, EMMCtx emm, EPS_Session s);
 
 void s11u_freeUser(gpointer self);
 
+/**
+ * @brief Count the S11 objects of the UE, see emmCtx_footprint
+ */
+void s11u_footprint(gpointer self, MemAcctUE *ue);
+
+/**
+ * @brief Save the user on a snapshot record
+ * @return FALSE when the session is not established, nothing is saved
+ */
+gboolean s11u_snapshot(const gpointer self, SnapSession_t *snap);
+
+/**
+ * @brief Create a user from a snapshot record, see S11_restoreUser
+ */
+gpointer s11u_restoreUser(gpointer s11, EMMCtx emm, EPS_Session s,
+                          const SnapSession_t *snap);
+
 
 void processMsg(gpointer self, const struct t_message *msg);
 
@@ -26,11 +26,12 @@
 
 #include "HSS.h"
 #include "logmgr.h"
+#include "rng.h"
 #include "SQLqueries.h"
 #include "MME.h"
 #include "EMMCtx.h"
-#include "hmac_sha2.h"
-#include "milenage.h"
+#include "kdf.h"
+#include "milenage_evp.h"
 
 #include <mysql.h>
 #include <stdlib.h>
@@ -40,6 +41,69 @@ MYSQL                   *HSSConnection;
 
 G_DEFINE_QUARK(diameter, diameter);
 
+/** Subscribers with an expanded Milenage key, the cache is emptied when full*/
+#define HSS_KEY_CACHE 65536
+
+typedef struct{
+    guint64     imsi;
+    uint8_t     k[16];
+    uint8_t     op[16];     /**< OPc if hasOPc*/
+    gboolean    hasOPc;
+    MilenageKey *key;
+}HSSKey_t;
+
+/* Milenage keys by IMSI*/
+static GHashTable *hssKeys = NULL;
+
+static void HSS_freeKey(HSSKey_t *e){
+    milenage_key_free(e->key);
+    memset(e, 0, sizeof(HSSKey_t));
+    g_free(e);
+}
+
+/**
+ * @brief Milenage key of a subscriber
+ * @param [in] imsi  Subscriber IMSI
+ * @param [in] k     K on the database
+ * @param [in] op    OP on the database
+ * @param [in] opc   OPc on the database, NULL if not provisioned
+ * @return key, NULL on failure
+ *
+ * The key is expanded again when K, OP or OPc change on the database.
+ */
+static MilenageKey *HSS_getKey(guint64 imsi, const uint8_t *k,
+                               const uint8_t *op, const uint8_t *opc){
+    HSSKey_t *e;
+    const uint8_t *o = opc ? opc : op;
+
+    if(!hssKeys){
+        hssKeys = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                        (GDestroyNotify)HSS_freeKey);
+    }
+    e = g_hash_table_lookup(hssKeys, &imsi);
+    if(e && memcmp(e->k, k, 16) == 0 && memcmp(e->op, o, 16) == 0
+       && e->hasOPc == (opc != NULL)){
+        return e->key;
+    }
+    if(g_hash_table_size(hssKeys) >= HSS_KEY_CACHE){
+        g_hash_table_remove_all(hssKeys);
+    }
+    e = g_new0(HSSKey_t, 1);
+    e->key = milenage_key_new(k, op, opc);
+    if(!e->key){
+        g_free(e);
+        g_hash_table_remove(hssKeys, &imsi);
+        log_msg(LOG_ERR, 0, "Unable to expand the Milenage key");
+        return NULL;
+    }
+    e->imsi = imsi;
+    memcpy(e->k, k, 16);
+    memcpy(e->op, o, 16);
+    e->hasOPc = opc != NULL;
+    g_hash_table_replace(hssKeys, &e->imsi, e);
+    return e->key;
+}
+
 
 static char *bin_to_strhex(uint8_t *hexbuf, uint32_t size, char *result){
     char          hex_str[]= "0123456789abcdef";
@@ -126,70 +190,11 @@ void disconnect_hss(){
     }
 
     mysql_library_end();
-}
 
-/* ============================================================== */
-
-/**
- * get_random - Get cryptographically strong pseudo random data
- * @buf: Buffer for pseudo random data
- * @len: Length of the buffer
- * Returns: 0 on success, -1 on failure
- *
- * Orignal function from hostapd:
- * http://svn0.us-east.freebsd.org/base/vendor/hostapd/0.5.8/contrib/hostapd/os_unix.c
- */
-static int get_random(unsigned char *buf, size_t len)
-{
-    FILE *f;
-    size_t rc;
-
-    f = fopen("/dev/urandom", "rb");
-    if (f == NULL) {
-        log_msg(LOG_ERR, errno, "Could not open /dev/urandom.");
-        return -1;
+    if(hssKeys){
+        g_hash_table_destroy(hssKeys);
+        hssKeys = NULL;
     }
-
-    rc = fread(buf, 1, len, f);
-    fclose(f);
-
-    return rc != len ? -1 : 0;
-}
-
-/**
- * @brief generate_Kasme - KDF function to derive the K_ASME
- * @param [in]  ck      Cipher Key - 128 bits
- * @param [in]  ik      Integrity Key - 128 bits
- * @param [in]  sn      Serving Network, it is the Tracking area encoded with TBCD
- * @param [in]  sqnAk   XOR of SQN and Ak - 48 bits
- * @param [out] kasme   derived key - 256 bits
- */
-static void generate_Kasme(const uint8_t *ck, const uint8_t *ik, const uint8_t *sn, const uint8_t *sqnAk, uint8_t *kasme){
-    uint8_t k[32], s[14];
-
-    /*
-    -    FC = 0x10,
-    -    P0 = SN id,
-    -    L0 = length of SN id (i.e. 0x00 0x03),
-    -    P1 = SQN ^ AK
-    -    L1 = length of SQN ⊕ AK (i.e. 0x00 0x06)
-
-    S = FC || P0 || L0 || P1 || L1
-    KEY = Ck || Ik
-
-    derived key = HMAC-SHA-256 ( Key , S ) */
-
-    memcpy(k, ck, 16);
-    memcpy(k+16, ik, 16);
-
-    s[0]=0x10;
-    memcpy(s+1, sn, 3);
-    s[4]=0x00;
-    s[5]=0x03;
-    memcpy(s+6, sqnAk, 6);
-    s[12]=0x00;
-    s[13]=0x06;
-    hmac_sha256(k, 32, s, 14, kasme, 32);
 }
 
 /* ============================================================== */
@@ -206,7 +211,8 @@ static void HSS_newAuthVec(EMMCtx emm, GError **err){
 
     uint8_t i;
     int j;
-    size_t resLen=8;
+    MilenageKey *key;
+    MilenageVector v;
 
     char query[1000];
     uint16_t mcc;
@@ -250,23 +256,38 @@ static void HSS_newAuthVec(EMMCtx emm, GError **err){
 
     increaseSQN(sqn_b);
 
-    if(row[1]==NULL){
-        getOPC(op, k, opc);
-    }else{
-        memcpy(opc, row[1], 16); /* opc*/
-    }
+    key = HSS_getKey(imsi, k, op, (uint8_t *)row[1]); /* opc*/
 
     mysql_free_result(result);
 
-    authVec = g_new0(AuthQuadruplet, 1);
-    get_random(authVec->rAND, 16);
+    if(!key){
+        g_set_error(err, DIAMETER, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE,
+                    "No Milenage key: %" PRIu64, imsi);
+        return;
+    }
+    milenage_key_opc(key, opc);
+
+    rng_bytes(v.rand, 16);
+    memcpy(v.sqn, sqn_b, 6);
+    if(milenage_key_generate(key, amf, &v, 1) != 0){
+        log_msg(LOG_ERR, 0, "Unable to generate the authentication vector");
+        g_set_error(err, DIAMETER, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE,
+                    "Unable to generate the authentication vector: %" PRIu64,
+                    imsi);
+        return;
+    }
+    memcpy(ik, v.ik, 16);
+    memcpy(ck, v.ck, 16);
 
-    milenage_generate(opc, amf, k, sqn_b, authVec->rAND, authVec->aUTN, ik, ck, authVec->xRES, &resLen);
+    authVec = g_new0(AuthQuadruplet, 1);
+    memcpy(authVec->rAND, v.rand, 16);
+    memcpy(authVec->aUTN, v.autn, 16);
+    memcpy(authVec->xRES, v.res, 8);
 
     /* The first 6 bytes of AUTN are SQN^Ak*/
-    generate_Kasme(ck, ik,
-                   emmCtx_getServingNetwork_TBCD(emm),
-                   authVec->aUTN, authVec->kASME);
+    kdf_kasme(ck, ik,
+              emmCtx_getServingNetwork_TBCD(emm),
+              authVec->aUTN, authVec->kASME);
 
     emmCtx_setNewAuthQuadruplet(emm, authVec);
 
@@ -355,7 +376,8 @@ void HSS_syncAuthVec(EMMCtx emm, uint8_t * auts,  GError **err){
 
     uint8_t i;
     int j;
-    size_t resLen=8;
+    MilenageKey *key;
+    MilenageVector v;
 
     char query[1000];
     uint16_t mcc;
@@ -395,17 +417,20 @@ void HSS_syncAuthVec(EMMCtx emm, uint8_t * auts,  GError **err){
     memcpy(op, row[3], 16); /* op*/
     memcpy(amf, row[4], 2); /* amf*/
 
-    if(row[1]==NULL){
-        getOPC(op, k, opc);
-    }else{
-        memcpy(opc, row[1], 16); /* opc*/
-    }
+    key = HSS_getKey(imsi, k, op, (uint8_t *)row[1]); /* opc*/
 
     mysql_free_result(result);
 
+    if(!key){
+        g_set_error(err, DIAMETER, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE,
+                    "No Milenage key: %" PRIu64, imsi);
+        return;
+    }
+    milenage_key_opc(key, opc);
+
     authVec = emmCtx_getFirstAuthQuadruplet(emm);
 
-    if(milenage_auts(opc, k, authVec->rAND, auts, sqn) == 0){
+    if(milenage_key_auts(key, authVec->rAND, auts, sqn) == 0){
         if (memcmp(sqn, sqn_b, 6) == 0){
             log_msg(LOG_ERR, 0, "SEQ Already synchronized");
             emmCtx_freeAuthQuadruplets(emm);
@@ -419,15 +444,26 @@ void HSS_syncAuthVec(EMMCtx emm, uint8_t * auts,  GError **err){
         log_msg(LOG_INFO, 0, "SEQ sync old:0x%s, new:0x%s",
                 bin_to_strhex(sqn_b, 6, sqn_old), bin_to_strhex(sqn, 6, sqn_new));
 
-        newAuthVec = g_new0(AuthQuadruplet, 1);
-        get_random(newAuthVec->rAND, 16);
+        rng_bytes(v.rand, 16);
+        memcpy(v.sqn, sqn, 6);
+        if(milenage_key_generate(key, amf, &v, 1) != 0){
+            log_msg(LOG_ERR, 0, "Unable to generate the authentication vector");
+            g_set_error(err, DIAMETER, DIAMETER_AUTHENTICATION_DATA_UNAVAILABLE,
+                        "Unable to generate the authentication vector: %" PRIu64,
+                        imsi);
+            return;
+        }
+        memcpy(ik, v.ik, 16);
+        memcpy(ck, v.ck, 16);
 
-        milenage_generate(opc, amf, k, sqn, newAuthVec->rAND,
-                          newAuthVec->aUTN, ik, ck, newAuthVec->xRES, &resLen);
+        newAuthVec = g_new0(AuthQuadruplet, 1);
+        memcpy(newAuthVec->rAND, v.rand, 16);
+        memcpy(newAuthVec->aUTN, v.autn, 16);
+        memcpy(newAuthVec->xRES, v.res, 8);
 
         /* The first 6 bytes of AUTN are SQN^Ak*/
-        generate_Kasme(ck, ik, emmCtx_getServingNetwork_TBCD(emm), newAuthVec->aUTN,
-                       newAuthVec->kASME);
+        kdf_kasme(ck, ik, emmCtx_getServingNetwork_TBCD(emm), newAuthVec->aUTN,
+                  newAuthVec->kASME);
 
         emmCtx_setNewAuthQuadruplet(emm, newAuthVec);
 
@@ -31,8 +31,8 @@
 #include "MME.h"
 #include "MME_S6a.h"
 #include "logmgr.h"
+#include "metrics.h"
 
-#include "hmac_sha2.h"
 #include "milenage.h"
 
 #include "HSS.h"
@@ -77,29 +77,6 @@ void s6a_free(gpointer s6a){
     g_free(s6a);
 }
 
-/**
- * @brief generate_KeNB - KDF function to derive the K_eNB
- * @param [in]  kasme       derived key - 256 bits
- * @param [in]  ulNASCount  Uplink NAS COUNT
- * @param [out] keNB        eNB result key - 256 bits
- */
-static void generate_KeNB(const uint8_t *kasme, const uint32_t ulNASCount, uint8_t *keNB){
-
-    /*
-    FC = 0x11,
-    P0 = Uplink NAS COUNT,
-    L0 = length of uplink NAS COUNT (i.e. 0x00 0x04)
-     */
-    uint8_t s[7];
-    s[0]=0x11;
-    memcpy(s+1, &ulNASCount, 4);
-    s[5]=0x00;
-    s[6]=0x04;
-
-    hmac_sha256(kasme, 32, s, 7, keNB, 32);
-}
-
-
 /* ====================================================================== */
 
 static void s6a_errorTranslation(GError *diameter, GError **s6a){
@@ -112,14 +89,29 @@ static void s6a_errorTranslation(GError *diameter, GError **s6a){
     }
 }
 
+/**
+ * Accounts a HSS query started at start*/
+static void s6a_measure(EMMCtx emm, guint64 start, GError *err){
+    guint64 us = metric_now() - start;
+    metric_inc(MC_HSS_REQ);
+    if(err)
+        metric_inc(MC_HSS_ERROR);
+    metric_observe(MH_HSS_LATENCY, us);
+    emmCtx_procSegment(emm, MS_HSS, us);
+}
+
 void s6a_GetAuthInformation(gpointer s6a_h, EMMCtx emm,
                             void(*cb)(gpointer),
                             void(*error_cb)(gpointer, GError *),
                             gpointer args){
     GError *err = NULL, *err_cb=NULL;
+    guint64 start = metric_now();
     log_msg(LOG_DEBUG, 0, "Enter S6a State Machine");
 
+    loopprof_enter(LP_S6A);
     HSS_getAuthVec(emm, &err);
+    loopprof_leave();
+    s6a_measure(emm, start, err);
     /*generate_KeNB(user->sec_ctx.kASME, user->sec_ctx.ulNAScnt, user->sec_ctx.keNB);*/
     if(err){
         log_msg(LOG_ERR, 0, err->message);
@@ -142,8 +134,12 @@ void s6a_SynchAuthVector(gpointer s6a_h,  EMMCtx emm, uint8_t *auts,
                          gpointer args){
     GError *err = NULL, *err_cb=NULL;
     struct s6a_t *s6a = (struct s6a_t*) s6a_h;
+    guint64 start = metric_now();
 
+    loopprof_enter(LP_S6A);
     HSS_syncAuthVec(emm, auts, &err);
+    loopprof_leave();
+    s6a_measure(emm, start, err);
     //generate_KeNB(user->sec_ctx.kASME, user->sec_ctx.ulNAScnt, user->sec_ctx.keNB);
     if(err){
         log_msg(LOG_ERR, 0, err->message);
@@ -165,7 +161,12 @@ void s6a_UpdateLocation(gpointer s6a_h, EMMCtx emm,
                         void(*cb)(gpointer), gpointer args){
 
     struct s6a_t *s6a = (struct s6a_t*) s6a_h;
+    guint64 start = metric_now();
+
+    loopprof_enter(LP_S6A);
     HSS_UpdateLocation(emm, mme_getServedGUMMEIs(s6a->mme));
+    loopprof_leave();
+    s6a_measure(emm, start, NULL);
     cb(args);
 }
 
@@ -0,0 +1,260 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   milenage_evp.c
+ * @brief  Milenage on OpenSSL EVP with a key schedule per subscriber
+ *
+ * The constants are the ones of TS 35.206: r1=64, r2=0, r3=32, r4=64,
+ * r5=96, c1=00..00, c2=00..01, c3=00..02, c4=00..04, c5=00..08.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+
+#include "milenage_evp.h"
+
+struct milenage_key{
+    EVP_CIPHER_CTX *ctx;
+    uint8_t        opc[16];
+};
+
+/* ECB without padding, each call ciphers whole blocks*/
+static int milenage_aes(MilenageKey *key, const uint8_t *in, uint8_t *out,
+                        size_t blocks){
+    int len;
+
+    if(!EVP_EncryptUpdate(key->ctx, out, &len, in, blocks*16)
+       || (size_t)len != blocks*16){
+        return -1;
+    }
+    return 0;
+}
+
+/* out = rot(x XOR OPc, r bytes) XOR c*/
+static void milenage_rot(const MilenageKey *key, const uint8_t *x, int r,
+                         uint8_t c, uint8_t *out){
+    int i;
+
+    for(i=0; i<16; i++){
+        out[(i + 16 - r) % 16] = x[i] ^ key->opc[i];
+    }
+    out[15] ^= c;
+}
+
+/* IN1 = SQN || AMF || SQN || AMF, input of f1 and f1* without TEMP*/
+static void milenage_in1(const MilenageKey *key, const uint8_t *temp,
+                         const uint8_t *sqn, const uint8_t *amf, uint8_t *out){
+    uint8_t in1[16];
+    int i;
+
+    memcpy(in1, sqn, 6);
+    memcpy(in1 + 6, amf, 2);
+    memcpy(in1 + 8, in1, 8);
+    milenage_rot(key, in1, 8, 0, out);
+    for(i=0; i<16; i++){
+        out[i] ^= temp[i];
+    }
+}
+
+/* TEMP = E_K(RAND XOR OPc)*/
+static int milenage_temp(MilenageKey *key, const uint8_t *_rand, uint8_t *temp){
+    int i;
+
+    for(i=0; i<16; i++){
+        temp[i] = _rand[i] ^ key->opc[i];
+    }
+    return milenage_aes(key, temp, temp, 1);
+}
+
+static void milenage_xorOPc(const MilenageKey *key, uint8_t *out, size_t len){
+    size_t i;
+
+    for(i=0; i<len; i++){
+        out[i] ^= key->opc[i];
+    }
+}
+
+MilenageKey *milenage_key_new(const uint8_t *k, const uint8_t *op,
+                              const uint8_t *opc){
+    MilenageKey *key;
+    int i;
+
+    key = calloc(1, sizeof(MilenageKey));
+    if(!key){
+        return NULL;
+    }
+    key->ctx = EVP_CIPHER_CTX_new();
+    if(!key->ctx
+       || !EVP_EncryptInit_ex(key->ctx, EVP_aes_128_ecb(), NULL, k, NULL)){
+        milenage_key_free(key);
+        return NULL;
+    }
+    EVP_CIPHER_CTX_set_padding(key->ctx, 0);
+
+    if(opc){
+        memcpy(key->opc, opc, 16);
+    }else{
+        /* OPc = OP XOR E_K(OP)*/
+        if(milenage_aes(key, op, key->opc, 1) != 0){
+            milenage_key_free(key);
+            return NULL;
+        }
+        for(i=0; i<16; i++){
+            key->opc[i] ^= op[i];
+        }
+    }
+    return key;
+}
+
+void milenage_key_free(MilenageKey *key){
+    if(!key){
+        return;
+    }
+    if(key->ctx){
+        EVP_CIPHER_CTX_free(key->ctx);
+    }
+    OPENSSL_cleanse(key, sizeof(MilenageKey));
+    free(key);
+}
+
+void milenage_key_opc(const MilenageKey *key, uint8_t *opc){
+    memcpy(opc, key->opc, 16);
+}
+
+int milenage_key_f1(MilenageKey *key, const uint8_t *_rand, const uint8_t *sqn,
+                    const uint8_t *amf, uint8_t *mac_a, uint8_t *mac_s){
+    uint8_t temp[16], out[16];
+
+    if(milenage_temp(key, _rand, temp) != 0){
+        return -1;
+    }
+    /* OUT1 = E_K(TEMP XOR rot(IN1 XOR OPc, r1) XOR c1) XOR OPc*/
+    milenage_in1(key, temp, sqn, amf, out);
+    if(milenage_aes(key, out, out, 1) != 0){
+        return -1;
+    }
+    milenage_xorOPc(key, out, 16);
+    if(mac_a)
+        memcpy(mac_a, out, 8);
+    if(mac_s)
+        memcpy(mac_s, out + 8, 8);
+    return 0;
+}
+
+int milenage_key_f2345(MilenageKey *key, const uint8_t *_rand, uint8_t *res,
+                       uint8_t *ck, uint8_t *ik, uint8_t *ak, uint8_t *akstar){
+    uint8_t temp[16], out[4][16];
+
+    if(milenage_temp(key, _rand, temp) != 0){
+        return -1;
+    }
+    /* OUTn = E_K(rot(TEMP XOR OPc, rn) XOR cn) XOR OPc*/
+    milenage_rot(key, temp, 0, 1, out[0]);
+    milenage_rot(key, temp, 4, 2, out[1]);
+    milenage_rot(key, temp, 8, 4, out[2]);
+    milenage_rot(key, temp, 12, 8, out[3]);
+    if(milenage_aes(key, out[0], out[0], 4) != 0){
+        return -1;
+    }
+    milenage_xorOPc(key, out[0], 16);
+    milenage_xorOPc(key, out[1], 16);
+    milenage_xorOPc(key, out[2], 16);
+    milenage_xorOPc(key, out[3], 6);
+    if(res)
+        memcpy(res, out[0] + 8, 8);
+    if(ak)
+        memcpy(ak, out[0], 6);
+    if(ck)
+        memcpy(ck, out[1], 16);
+    if(ik)
+        memcpy(ik, out[2], 16);
+    if(akstar)
+        memcpy(akstar, out[3], 6);
+    return 0;
+}
+
+int milenage_key_generate(MilenageKey *key, const uint8_t *amf,
+                          MilenageVector *v, size_t n){
+    uint8_t temp[MILENAGE_BATCH][16], out[MILENAGE_BATCH][4][16];
+    size_t i, j, m;
+    MilenageVector *w;
+
+    for(w=v; w<v+n; w+=m){
+        m = v + n - w < MILENAGE_BATCH ? v + n - w : MILENAGE_BATCH;
+
+        for(i=0; i<m; i++){
+            for(j=0; j<16; j++){
+                temp[i][j] = w[i].rand[j] ^ key->opc[j];
+            }
+        }
+        if(milenage_aes(key, temp[0], temp[0], m) != 0){
+            return -1;
+        }
+        /* f1, f2 and f5, f3, f4 of each vector*/
+        for(i=0; i<m; i++){
+            milenage_in1(key, temp[i], w[i].sqn, amf, out[i][0]);
+            milenage_rot(key, temp[i], 0, 1, out[i][1]);
+            milenage_rot(key, temp[i], 4, 2, out[i][2]);
+            milenage_rot(key, temp[i], 8, 4, out[i][3]);
+        }
+        if(milenage_aes(key, out[0][0], out[0][0], 4*m) != 0){
+            return -1;
+        }
+        for(i=0; i<m; i++){
+            for(j=0; j<4; j++){
+                milenage_xorOPc(key, out[i][j], 16);
+            }
+            /* AUTN = (SQN XOR AK) || AMF || MAC-A*/
+            for(j=0; j<6; j++){
+                w[i].autn[j] = w[i].sqn[j] ^ out[i][1][j];
+            }
+            memcpy(w[i].autn + 6, amf, 2);
+            memcpy(w[i].autn + 8, out[i][0], 8);
+            memcpy(w[i].res, out[i][1] + 8, 8);
+            memcpy(w[i].ck, out[i][2], 16);
+            memcpy(w[i].ik, out[i][3], 16);
+        }
+    }
+    OPENSSL_cleanse(temp, sizeof(temp));
+    OPENSSL_cleanse(out, sizeof(out));
+    return 0;
+}
+
+int milenage_key_auts(MilenageKey *key, const uint8_t *_rand,
+                      const uint8_t *auts, uint8_t *sqn){
+    static const uint8_t amf[2] = {0x00, 0x00}; /* TS 33.102 v7.0.0, 6.3.3*/
+    uint8_t ak[6], mac_s[8];
+    int i;
+
+    if(milenage_key_f2345(key, _rand, NULL, NULL, NULL, NULL, ak) != 0){
+        return -1;
+    }
+    for(i=0; i<6; i++){
+        sqn[i] = auts[i] ^ ak[i];
+    }
+    if(milenage_key_f1(key, _rand, sqn, amf, NULL, mac_s) != 0){
+        return -1;
+    }
+    if(memcmp(mac_s, auts + 6, 8) != 0){
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   milenage_evp.h
+ * @brief  Milenage on OpenSSL EVP with a key schedule per subscriber
+ *
+ * Same functions as milenage.h (3GPP TS 35.206), the block cipher is the
+ * AES-128 of OpenSSL, which uses AES-NI when available. The key schedule of
+ * the subscriber key K is expanded once in a MilenageKey and used for all
+ * the blocks of the subscriber, the table based aes_128_encrypt_block
+ * expands it on every block.
+ *
+ * milenage_key_generate computes several vectors of a subscriber at once.
+ * The blocks of all the vectors are ciphered in two EVP calls per
+ * MILENAGE_BATCH vectors, so the AES rounds of independent blocks overlap.
+ *
+ * The functions return 0 on success, -1 if OpenSSL fails.
+ */
+
+#ifndef MILENAGE_EVP_H
+#define MILENAGE_EVP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Vectors ciphered per EVP call*/
+#define MILENAGE_BATCH 16
+
+typedef struct milenage_key MilenageKey;
+
+/**
+ * Authentication vector, RAND and SQN are the input*/
+typedef struct{
+    uint8_t rand[16];
+    uint8_t sqn[6];
+    uint8_t autn[16];   /**< SQN^AK || AMF || MAC-A*/
+    uint8_t ik[16];
+    uint8_t ck[16];
+    uint8_t res[8];
+}MilenageVector;
+
+/**
+ * @brief Expand the key schedule of a subscriber
+ * @param [in] k    Subscriber key K, 128 bits
+ * @param [in] op   OP, only used when opc is NULL
+ * @param [in] opc  OPc, NULL to derive it from OP
+ * @return key handler, NULL on failure
+ */
+MilenageKey *milenage_key_new(const uint8_t *k, const uint8_t *op,
+                              const uint8_t *opc);
+
+/**
+ * @brief Erase and free the key
+ */
+void milenage_key_free(MilenageKey *key);
+
+/**
+ * @brief OPc of the key
+ */
+void milenage_key_opc(const MilenageKey *key, uint8_t *opc);
+
+/**
+ * @brief f1 and f1*
+ * @param [out] mac_a  MAC-A (f1), 64 bits, or NULL
+ * @param [out] mac_s  MAC-S (f1*), 64 bits, or NULL
+ */
+int milenage_key_f1(MilenageKey *key, const uint8_t *_rand, const uint8_t *sqn,
+                    const uint8_t *amf, uint8_t *mac_a, uint8_t *mac_s);
+
+/**
+ * @brief f2, f3, f4, f5 and f5*
+ * @param [out] res     RES (f2), 64 bits, or NULL
+ * @param [out] ck      CK (f3), 128 bits, or NULL
+ * @param [out] ik      IK (f4), 128 bits, or NULL
+ * @param [out] ak      AK (f5), 48 bits, or NULL
+ * @param [out] akstar  AK (f5*), 48 bits, or NULL
+ */
+int milenage_key_f2345(MilenageKey *key, const uint8_t *_rand, uint8_t *res,
+                       uint8_t *ck, uint8_t *ik, uint8_t *ak, uint8_t *akstar);
+
+/**
+ * @brief Generate authentication vectors
+ * @param [in]    key  Subscriber key
+ * @param [in]    amf  AMF, 16 bits
+ * @param [inout] v    Vectors with RAND and SQN set
+ * @param [in]    n    Number of vectors
+ */
+int milenage_key_generate(MilenageKey *key, const uint8_t *amf,
+                          MilenageVector *v, size_t n);
+
+/**
+ * @brief Validate an AUTS
+ * @param [out] sqn  SQN of the UE, 48 bits
+ * @return 0 if valid, -1 otherwise
+ */
+int milenage_key_auts(MilenageKey *key, const uint8_t *_rand,
+                      const uint8_t *auts, uint8_t *sqn);
+
+#endif /* MILENAGE_EVP_H */
@@ -28,6 +28,7 @@
 #include <glib.h>
 #include "Subscription.h"
 #include "logmgr.h"
+#include "slab.h"
 
 #include "gtp.h"
 
@@ -71,8 +72,16 @@ typedef struct{
     PDNCtx_t   *pdn;
 }Subs_t;
 
+static Slab subsPool = NULL;
+static Slab pdnPool = NULL;
+
 PDNCtx_t *pdnctx_init(){
-    PDNCtx_t *self = g_new0(PDNCtx_t, 1);
+    PDNCtx_t *self;
+
+    if(!pdnPool){
+        pdnPool = slab_new("pdn_ctx", sizeof(PDNCtx_t), MA_SUBSCRIPTION);
+    }
+    self = slab_alloc0(pdnPool);
     self->apn = g_string_new (NULL);
     return self;
 }
@@ -80,12 +89,17 @@ PDNCtx_t *pdnctx_init(){
 static void pdnctx_free(PDNCtx_t *pdn){
     PDNCtx_t *self = (PDNCtx_t*)pdn;
     g_string_free(self->apn, TRUE);
-    g_free(self);
+    slab_free(pdnPool, self);
 }
 
 
 Subscription subs_init(){
-    Subs_t *self = g_new0(Subs_t, 1);
+    Subs_t *self;
+
+    if(!subsPool){
+        subsPool = slab_new("subscription", sizeof(Subs_t), MA_SUBSCRIPTION);
+    }
+    self = slab_alloc0(subsPool);
     /* self->pdnCtx = g_hash_table_new_full (g_int_hash, */
     /*                                       g_int_equal, */
     /*                                       NULL, */
@@ -102,7 +116,7 @@ void subs_free(Subscription s){
     /* g_hash_table_destroy(self->pdnCtx); */
     pdnctx_free(self->pdn);
 
-    g_free(self);
+    slab_free(subsPool, self);
 }
 
 void subs_cpyQoS_GTP(Subscription s, struct qos_t *qos){
@@ -290,3 +304,55 @@ void pdnCtx_setAPN(PDNCtx _pdn, const char* apn){
     PDNCtx_t *pdn = (PDNCtx_t *)_pdn;
     g_string_assign(pdn->apn, apn);
 }
+
+void subs_snapshot(const Subscription s, SnapSubs_t *snap){
+    Subs_t *self = (Subs_t*)s;
+    PDNCtx_t *pdn = self->pdn;
+
+    snap->msisdn = self->msisdn;
+    snap->imeisv = self->imeisv;
+    snap->ambr_ul = self->ambr_ul;
+    snap->ambr_dl = self->ambr_dl;
+    snap->access_restriction_data = self->access_restriction_data;
+    snap->network_access_mode = self->network_access_mode;
+
+    snap->ctx_id = pdn->ctx_id;
+    snap->pdn_addr_type = pdn->pdn_addr_type;
+    memcpy(snap->pdn_addr, pdn->pdn_addr, 20);
+    snap->apn_ambr_dl = pdn->subscribed_apn_ambr_dl;
+    snap->apn_ambr_ul = pdn->subscribed_apn_ambr_up;
+    snap->charging_characteristics = pdn->charging_characteristics;
+    snap->qci = pdn->qos.qci;
+    snap->arp_level = pdn->qos.arp.level;
+    snap->arp_flags = (pdn->qos.arp.preemption_capability?1:0)
+        | (pdn->qos.arp.preemption_vulnerability?2:0);
+    snap->pgw_allocation_type = pdn->pgw_allocation_type;
+    snap->vplmn_dynamic_address_allowed = pdn->vplmn_dynamic_address_allowed;
+    g_strlcpy(snap->apn, pdn->apn->str, sizeof(snap->apn));
+}
+
+void subs_restore(Subscription s, const SnapSubs_t *snap){
+    Subs_t *self = (Subs_t*)s;
+    PDNCtx_t *pdn = self->pdn;
+
+    self->msisdn = snap->msisdn;
+    self->imeisv = snap->imeisv;
+    self->ambr_ul = snap->ambr_ul;
+    self->ambr_dl = snap->ambr_dl;
+    self->access_restriction_data = snap->access_restriction_data;
+    self->network_access_mode = snap->network_access_mode;
+
+    pdn->ctx_id = snap->ctx_id;
+    pdn->pdn_addr_type = snap->pdn_addr_type;
+    memcpy(pdn->pdn_addr, snap->pdn_addr, 20);
+    pdn->subscribed_apn_ambr_dl = snap->apn_ambr_dl;
+    pdn->subscribed_apn_ambr_up = snap->apn_ambr_ul;
+    pdn->charging_characteristics = snap->charging_characteristics;
+    pdn->qos.qci = snap->qci;
+    pdn->qos.arp.level = snap->arp_level;
+    pdn->qos.arp.preemption_capability = snap->arp_flags & 1;
+    pdn->qos.arp.preemption_vulnerability = (snap->arp_flags & 2) >> 1;
+    pdn->pgw_allocation_type = snap->pgw_allocation_type;
+    pdn->vplmn_dynamic_address_allowed = snap->vplmn_dynamic_address_allowed;
+    g_string_assign(pdn->apn, snap->apn);
+}
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 
 #include "gtp.h"
+#include "snapshot.h"
 
 typedef void* Subscription;
 typedef void* PDNCtx;
@@ -85,4 +86,18 @@ void pdnCtx_setPDNtype(PDNCtx _pdn, guint8 t);
 
 void pdnCtx_setAPN(PDNCtx _pdn, const char* apn);
 
+/**
+ * @brief Save the subscription and its PDN context on a snapshot record
+ * @param [in]  s     Subscription handler
+ * @param [out] snap  Record to fill
+ */
+void subs_snapshot(const Subscription s, SnapSubs_t *snap);
+
+/**
+ * @brief Restore the subscription from a snapshot record
+ * @param [in]  s     Subscription handler, from subs_init
+ * @param [in]  snap  Record filled by subs_snapshot
+ */
+void subs_restore(Subscription s, const SnapSubs_t *snap);
+
 #endif /* SUBSCRIPTION_H*/
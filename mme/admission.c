@@ -0,0 +1,202 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   admission.c
+ * @brief  Admission rate limiting of the NAS procedures
+ */
+
+#include <string.h>
+
+#include "admission.h"
+#include "MME.h"
+#include "NAS.h"
+#include "NASConstants.h"
+#include "StandardIeSchemas.h"
+#include "metrics.h"
+#include "logmgr.h"
+
+#define T3346_IEI            0x5F
+#define EPS_EMERGENCY_ATTACH 6
+
+const char *admissionClassName[] = {"Attach", "TAU", "Service"};
+
+static const NASMessageType_t rejectType[] = {AttachReject,
+                                              TrackingAreaUpdateReject,
+                                              ServiceReject};
+
+static const MetricCounter rejectCounter[] = {MC_ATTACH_REJECT, MC_TAU_REJECT,
+                                              MC_SERVICE_REJECT};
+
+static struct{
+    AdmissionCfg    cfg;
+    AdmissionBucket global[ADM_CLASSES];
+    AdmissionStat   st[ADM_CLASSES];
+}adm;
+
+void admission_init(struct mme_t *mme){
+    guint i;
+    AdmissionLimit *l;
+
+    adm.cfg = mme->admission;
+    memset(adm.global, 0, sizeof(adm.global));
+    if(!adm.cfg.enabled){
+        return;
+    }
+    for(i=0; i<ADM_CLASSES; i++){
+        l = &adm.cfg.limit[i];
+        log_msg(LOG_INFO, 0, "Admission %s: %u/s burst %u, %u/s burst %u "
+                "per eNB", admissionClassName[i], l->rate, l->burst,
+                l->enbRate, l->enbBurst);
+    }
+}
+
+AdmissionClass admission_classify(const guint8 *nas, gsize len,
+                                  gboolean rrcEmergency, gboolean *emergency){
+    SecurityHeaderType_t s;
+    ProtocolDiscriminator_t p;
+    const guint8 *msg = nas;
+
+    *emergency = rrcEmergency;
+    if(!nas_getHeader(nas, len, &s, &p) || p != EPSMobilityManagementMessages){
+        return ADM_NONE;
+    }
+    if(s == SecurityHeaderForServiceRequestMessage){
+        return ADM_SERVICE;
+    }else if(s == IntegrityProtected ||
+             s == IntegrityProtectedWithNewEPSSecurityContext){
+        /* Security header, MAC and sequence number*/
+        msg = nas + 6;
+    }else if(s != PlainNAS){
+        return ADM_NONE;
+    }
+    if(msg + 3 > nas + len){
+        return ADM_NONE;
+    }
+
+    switch(msg[1]){
+    case AttachRequest:
+        if((msg[2] & 0x07) == EPS_EMERGENCY_ATTACH){
+            *emergency = TRUE;
+        }
+        return ADM_ATTACH;
+    case TrackingAreaUpdateRequest:
+        return ADM_TAU;
+    case ExtendedServiceRequest:
+        return ADM_SERVICE;
+    default:
+        return ADM_NONE;
+    }
+}
+
+/* Refills a bucket, TRUE if it has a token*/
+static gboolean admission_refill(AdmissionBucket *b, guint rate, guint burst,
+                                 guint64 now){
+    if(rate == 0){
+        return TRUE;
+    }
+    if(b->last == 0){
+        b->tokens = burst;
+    }else if(now > b->last){
+        b->tokens = MIN(burst, b->tokens + (gdouble)rate*(now - b->last)/1000000);
+    }
+    b->last = now;
+    return b->tokens >= 1;
+}
+
+/* Takes a token from the global and the eNB bucket of a class, or none*/
+static gboolean admission_take(AdmissionENB *enb, AdmissionClass c,
+                               guint64 now){
+    const AdmissionLimit *l = &adm.cfg.limit[c];
+    gboolean global, local;
+
+    global = admission_refill(&adm.global[c], l->rate, l->burst, now);
+    local = admission_refill(&enb->bucket[c], l->enbRate, l->enbBurst, now);
+    if(!global || !local){
+        return FALSE;
+    }
+    if(l->rate){
+        adm.global[c].tokens--;
+    }
+    if(l->enbRate){
+        enb->bucket[c].tokens--;
+    }
+    return TRUE;
+}
+
+gboolean admission_check(AdmissionENB *enb, AdmissionClass c,
+                         gboolean emergency){
+    const AdmissionLimit *attach = &adm.cfg.limit[ADM_ATTACH];
+    guint64 now;
+
+    if(!adm.cfg.enabled || c == ADM_NONE){
+        return TRUE;
+    }
+    if(emergency){
+        adm.st[c].emergency++;
+        return TRUE;
+    }
+
+    now = metric_now();
+    if(admission_take(enb, c, now)){
+        adm.st[c].admitted++;
+        return TRUE;
+    }
+    /* Unlimited Attach buckets would not limit the Service Requests either*/
+    if(c == ADM_SERVICE && (attach->rate || attach->enbRate) &&
+       admission_take(enb, ADM_ATTACH, now)){
+        adm.st[c].admitted++;
+        adm.st[c].borrowed++;
+        return TRUE;
+    }
+    adm.st[c].rejected++;
+    enb->rejected++;
+    return FALSE;
+}
+
+/* GPRS timer 2 (TS 24.008 10.5.7.4), units of 2 s, 1 minute or 1 decihour*/
+static guint8 admission_timer(guint t){
+    if(t <= 31*2){
+        return t/2;
+    }else if(t <= 31*60){
+        return 0x20 | t/60;
+    }
+    return 0x40 | MIN(t/360, 31);
+}
+
+gsize admission_reject(AdmissionClass c, guint8 *buf){
+    guint8 *pointer = buf, cause = EMM_Congestion, t3346;
+
+    metric_inc(rejectCounter[c]);
+    newNASMsg_EMM(&pointer, EPSMobilityManagementMessages, PlainNAS);
+    encaps_EMM(&pointer, rejectType[c]);
+
+    /* EMM Cause */
+    nasIe_v_t3(&pointer, &cause, 1);
+
+    /* T3346 value */
+    if(adm.cfg.t3346){
+        t3346 = admission_timer(adm.cfg.t3346);
+        nasIe_tlv_t4(&pointer, T3346_IEI, &t3346, 1);
+    }
+    return pointer - buf;
+}
+
+gboolean admission_getStat(AdmissionStat st[ADM_CLASSES]){
+    memcpy(st, adm.st, sizeof(adm.st));
+    return adm.cfg.enabled;
+}
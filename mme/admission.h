@@ -0,0 +1,129 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   admission.h
+ * @brief  Admission rate limiting of the NAS procedures
+ *
+ * The Initial UE Messages are classified by the NAS message they carry:
+ * Attach Request, TAU Request or Service Request. Each class has a global
+ * token bucket and one per S1 association, a request takes a token from both
+ * or it is rejected before any EMM context or HSS query is used.
+ *
+ * The emergency requests, by RRC establishment cause or attach type, are
+ * never limited. A Service Request without tokens of its own can take them
+ * from the Attach buckets, so the attaches are rejected first.
+ *
+ * The rejected UEs receive the Reject of the procedure with the EMM cause
+ * congestion and T3346 (TS 24.301 5.5.1.2.5). The reject is not integrity
+ * protected, the UE uses a random T3346 from 15 to 30 minutes instead.
+ */
+
+#ifndef ADMISSION_HFILE
+#define ADMISSION_HFILE
+
+#include <glib.h>
+
+struct mme_t;
+
+typedef enum{
+    ADM_ATTACH,
+    ADM_TAU,
+    ADM_SERVICE,
+    ADM_CLASSES,
+    ADM_NONE = ADM_CLASSES,     /**< Other messages are always admitted*/
+}AdmissionClass;
+
+extern const char *admissionClassName[];
+
+/**
+ * Limits of a class, a rate of 0 disables the bucket*/
+typedef struct{
+    guint rate;         /**< Global requests per second*/
+    guint burst;        /**< Global bucket size*/
+    guint enbRate;      /**< Requests per second of each eNB*/
+    guint enbBurst;     /**< Bucket size of each eNB*/
+}AdmissionLimit;
+
+typedef struct{
+    gboolean       enabled;
+    AdmissionLimit limit[ADM_CLASSES];
+    guint          t3346;   /**< Back-off timer sent on the rejects (s)*/
+}AdmissionCfg;
+
+typedef struct{
+    gdouble tokens;
+    guint64 last;           /**< Time of the last refill, 0 before the first*/
+}AdmissionBucket;
+
+/**
+ * Admission state of an S1 association*/
+typedef struct{
+    AdmissionBucket bucket[ADM_CLASSES];
+    guint64         rejected;
+}AdmissionENB;
+
+typedef struct{
+    guint64 admitted;
+    guint64 rejected;
+    guint64 borrowed;       /**< Service Requests admitted with Attach tokens*/
+    guint64 emergency;      /**< Admitted without limit*/
+}AdmissionStat;
+
+/**
+ * @brief Load the limits
+ * @param [in] mme  MME handler, its admission configuration is used
+ */
+void admission_init(struct mme_t *mme);
+
+/**
+ * @brief Class of the NAS message of an Initial UE Message
+ * @param [in]  nas           NAS PDU
+ * @param [in]  len           NAS PDU length
+ * @param [in]  rrcEmergency  RRC Establishment Cause emergency
+ * @param [out] emergency     TRUE for an emergency request
+ * @return ADM_NONE if the message is not limited
+ */
+AdmissionClass admission_classify(const guint8 *nas, gsize len,
+                                  gboolean rrcEmergency, gboolean *emergency);
+
+/**
+ * @brief Take the tokens of a request
+ * @param [in] enb        Admission state of the S1 association
+ * @param [in] c          Class of the request
+ * @param [in] emergency  Admit without tokens
+ * @return TRUE if the request is admitted
+ */
+gboolean admission_check(AdmissionENB *enb, AdmissionClass c,
+                         gboolean emergency);
+
+/**
+ * @brief Build the Reject of a request with the EMM cause congestion
+ *
+ * The Reject is counted on the metrics of its procedure.
+ * @param [in]  c    Class of the rejected request, not ADM_NONE
+ * @param [out] buf  Plain NAS message, 16 bytes are enough
+ * @return Length of the message
+ */
+gsize admission_reject(AdmissionClass c, guint8 *buf);
+
+/**
+ * @brief Statistics of each class
+ * @return FALSE if the admission control is disabled
+ */
+gboolean admission_getStat(AdmissionStat st[ADM_CLASSES]);
+
+#endif /* ADMISSION_HFILE */
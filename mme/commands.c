@@ -38,6 +38,17 @@
 
 #include "MME.h"
 #include "S1Assoc.h"
+#include "MME_S11.h"
+#include "EMMCtx_iface.h"
+#include "EMM_FSMConfig.h"
+#include "memacct.h"
+#include "slab.h"
+#include "uetrace.h"
+#include "snapshot.h"
+#include "tmsi.h"
+#include "overload.h"
+#include "admission.h"
+#include "metrics.h"
 #include "commands.h"
 #include "logmgr.h"
 
@@ -68,6 +79,13 @@ const char *menu_msg(){
         "\th option \tshow option possible arguments\n"
         "\tm \t\tshow this menu\n"
         "\ts \t\tprint stats\n"
+        "\tp \t\tprint S11 peers path stats\n"
+        "\tt [i imsi|t mtmsi]\tstart UE trace, list traces without args\n"
+        "\tu i imsi|t mtmsi\tstop UE trace\n"
+        "\tr \t\tprint procedure latencies\n"
+        "\tc \t\tprint event loop callback profile\n"
+        "\ta [t]\t\tprint memory used by the UE contexts, t releases"
+        " the free pool chunks\n"
         "\tq \t\tquit console\n";
 }
 
@@ -114,19 +132,301 @@ void help_log_menu(CommandConn_t *self){
 static void printAssoc(gpointer assoc, CommandConn_t *self){
     mme_GlobaleNBid gid;
     s1Assoc_getID(assoc, &gid);
-    conn_print(self, "eNB: \t%u\t%u\t%.6x\t%s\n",
+    conn_print(self, "eNB: \t%u\t%u\t%.6x\t%s\t%" PRIu64 "\n",
                globaleNB_getMCC(&gid),
                globaleNB_getMNC(&gid),
                globaleNB_getCI(&gid),
-               s1Assoc_getName(assoc));
+               s1Assoc_getName(assoc),
+               s1Assoc_getAdmission(assoc)->rejected);
+}
+
+static void conn_printReplica(CommandConn_t *self){
+    ReplicaStat st;
+
+    replica_getStat(&st);
+    switch(st.role){
+    case REPLICA_ACTIVE:
+        conn_print(self, "Replication: active, standby %s, "
+                   "%" PRIu64 " updates, %" PRIu64 " removals, %zu bytes queued\n",
+                   st.connected ? "connected" : "not connected",
+                   st.updates, st.removals, st.queued);
+        break;
+    case REPLICA_STANDBY:
+        conn_print(self, "Replication: standby, %s, %u UEs\n",
+                   st.connected ? "synchronized" : "not synchronized", st.ues);
+        break;
+    default:
+        break;
+    }
+}
+
+static void conn_printTmsi(CommandConn_t *self){
+    TmsiStat st;
+
+    tmsi_getStat(&st);
+    conn_print(self, "M-TMSIs allocated: %" PRIu64 ", %" PRIu64 " values discarded,"
+               " %u in quarantine\n", st.allocated, st.discarded, st.quarantined);
+}
+
+static void conn_printOverload(CommandConn_t *self){
+    OverloadStat st;
+
+    if(!overload_getStat(&st)){
+        return;
+    }
+    conn_print(self, "Overload: %s, load %.2f (lag %.1f ms, HSS %.0f%%, "
+               "%" G_GINT64_FORMAT " S11 pending, %" PRIu64 " requests/s), "
+               "%" PRIu64 " starts, %" PRIu64 " stops\n",
+               overloadLevelName[st.level], st.load, st.lagUs/1000.0,
+               st.hssShare, st.s11Pending, st.admissionRate,
+               st.starts, st.stops);
+}
+
+static void conn_printAdmission(CommandConn_t *self){
+    AdmissionStat st[ADM_CLASSES];
+    guint i;
+
+    if(!admission_getStat(st)){
+        return;
+    }
+    for(i=0; i<ADM_CLASSES; i++){
+        conn_print(self, "Admission %s: %" PRIu64 " admitted, %" PRIu64
+                   " rejected, %" PRIu64 " emergency, %" PRIu64 " borrowed\n",
+                   admissionClassName[i], st[i].admitted, st[i].rejected,
+                   st[i].emergency, st[i].borrowed);
+    }
 }
 
 static void conn_printStats(CommandConn_t *self){
     GList *assocs = mme_getS1Assocs(self->mme);
     conn_print(self, "\t\t== Statistics==\n\n"
-               "\tMCC\tMNC\teNB ID\teNB name\n");
+               "\tMCC\tMNC\teNB ID\teNB name\tAdmission rejects\n");
     g_list_foreach(assocs, (GFunc)printAssoc, self);
     g_list_free(assocs);
+    conn_print(self, "\nLog messages dropped: %lu\n", log_getDropped());
+    conn_print(self, "UEs on the last snapshot: %u\n", snapshot_getCount());
+    conn_printReplica(self);
+    conn_printTmsi(self);
+    conn_printOverload(self);
+    conn_printAdmission(self);
+}
+
+static void printPeer(gpointer peer, CommandConn_t *self){
+    Peer_t *p = (Peer_t *)peer;
+    char addrStr[INET6_ADDRSTRLEN];
+    guint i;
+
+    conn_print(self, "%s\t%s\t%u\t%u.%.3u\t%u\t",
+               inet_ntop(p->addr.sa_family,
+                         &((struct sockaddr_in*)&p->addr)->sin_addr,
+                         addrStr, INET6_ADDRSTRLEN),
+               PeerPathStateName[p->pathState],
+               p->num_sessions,
+               p->srtt/1000, p->srtt%1000,
+               p->pathFailures);
+    for(i=0; i<S11_PEER_RTT_BUCKETS; i++){
+        conn_print(self, " %" G_GUINT64_FORMAT, p->rttHist[i]);
+    }
+    conn_print(self, "\n");
+}
+
+static void conn_printS11Peers(CommandConn_t *self){
+    GList *peers = S11_getPeers(mme_getS11(self->mme));
+    conn_print(self, "\t\t== S11 Peers==\n\n"
+               "Peer\t\tPath\tUEs\tSRTT ms\tFails\t"
+               "RTT <1 <2 <5 <10 <20 <50 <100 >=100 ms\n");
+    g_list_foreach(peers, (GFunc)printPeer, self);
+    g_list_free(peers);
+}
+
+static void conn_printProcLatency(CommandConn_t *self){
+    const HdrHist *h;
+    MetricProc p;
+    MetricSegment s;
+
+    conn_print(self, "\t\t== Procedure latency==\n\n"
+               "Procedure\tSegment\tCount\tp50 ms\tp99 ms\tp999 ms\tmax ms\n");
+    for(p=0; p<MP_NUM; p++){
+        for(s=0; s<MS_NUM; s++){
+            h = metric_procHist(p, s);
+            conn_print(self, "%-10s\t%s\t%" G_GUINT64_FORMAT
+                       "\t%.3f\t%.3f\t%.3f\t%.3f\n",
+                       metricProcName[p], metricSegmentName[s], h->total,
+                       hdr_percentile(h, 50.0)/1000.0,
+                       hdr_percentile(h, 99.0)/1000.0,
+                       hdr_percentile(h, 99.9)/1000.0,
+                       h->max/1000.0);
+        }
+    }
+}
+
+static void conn_printLoopProf(CommandConn_t *self){
+    const LoopProfStat *st;
+    LoopProfSlot s;
+
+    conn_print(self, "\t\t== Event loop callbacks==\n\n"
+               "Callback\tCalls\tCycles\t\tTotal ms\tMax ms\n");
+    for(s=0; s<LP_NUM; s++){
+        st = loopprof_get(s);
+        conn_print(self, "%-10s\t%" G_GUINT64_FORMAT "\t%-12" G_GUINT64_FORMAT
+                   "\t%.3f\t\t%.3f\n",
+                   loopProfName[s], st->calls, st->cycles,
+                   loopprof_us(st->cycles)/1000.0,
+                   loopprof_us(st->maxCycles)/1000.0);
+    }
+    conn_print(self, "\nWatchdog overruns: %" G_GUINT64_FORMAT "\n",
+               loopprof_getOverruns());
+}
+
+typedef struct{
+    guint64    ues[METRICS_EMM_STATES][2];
+    MemAcctUE  objs[METRICS_EMM_STATES][2];
+}UEFootprint_t;
+
+static void addUEFootprint(gpointer k, gpointer emm, gpointer data){
+    UEFootprint_t *f = (UEFootprint_t *)data;
+    MemAcctUE ue = {{0}};
+    guint state, i;
+    gboolean connected;
+
+    emmCtx_footprint(emm, &ue, &state, &connected);
+    f->ues[state][connected]++;
+    for(i=0; i<MA_NUM; i++){
+        f->objs[state][connected].objects[i] += ue.objects[i];
+    }
+}
+
+static void printSlab(const SlabStat *st, void *data){
+    CommandConn_t *self = (CommandConn_t *)data;
+    conn_print(self, "%-12s\t%zu\t%u\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT
+               "\t%" G_GUINT64_FORMAT "\t%zu\n",
+               st->name, st->size, st->chunks, st->inUse, st->peak,
+               (guint64)st->chunks*st->perChunk - st->inUse,
+               st->size*st->perChunk*st->chunks);
+}
+
+static void conn_printMemory(CommandConn_t *self, const char *line){
+    const MemAcctStat *st;
+    UEFootprint_t *f;
+    guint64 total = 0, bytes;
+    MemTag t;
+    guint i, c;
+
+    char option, arg;
+
+    if(sscanf(line, "%c %c", &option, &arg) == 2 && arg == 't'){
+        conn_print(self, "Released %u pool chunks\n", slab_trimAll());
+    }
+
+    conn_print(self, "\t\t== UE context memory==\n\n"
+               "Type\t\tObjects\tBytes\t\tPeak\tAllocs\n");
+    for(t=0; t<MA_NUM; t++){
+        st = memacct_get(t);
+        conn_print(self, "%-12s\t%" G_GUINT64_FORMAT "\t%-12" G_GUINT64_FORMAT
+                   "\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\n",
+                   memTagName[t], st->objects, st->bytes, st->peak, st->allocs);
+        /* The timers in use are inside the pool chunks*/
+        if(t != MA_TIMER){
+            total += st->bytes;
+        }
+    }
+    conn_print(self, "Total\t\t\t%" G_GUINT64_FORMAT "\n\n", total);
+
+    conn_print(self, "Pool\t\tSize\tChunks\tIn use\tPeak\tFree\tBytes\n");
+    slab_foreach(printSlab, self);
+    conn_print(self, "\n");
+
+    f = g_new0(UEFootprint_t, 1);
+    mme_foreachEMMCtxt(self->mme, addUEFootprint, f);
+    conn_print(self, "UEs with GUTI\tECM\tUEs\tBytes/UE\tBytes\n");
+    for(i=0; i<METRICS_EMM_STATES; i++){
+        for(c=0; c<2; c++){
+            if(!f->ues[i][c]){
+                continue;
+            }
+            bytes = memacct_ueBytes(&f->objs[i][c]);
+            conn_print(self, "%s\t\t%s\t%" G_GUINT64_FORMAT "\t%-12" G_GUINT64_FORMAT
+                       "\t%" G_GUINT64_FORMAT "\n",
+                       EMMStateName[i], c ? "CONN" : "IDLE", f->ues[i][c],
+                       bytes/f->ues[i][c], bytes);
+        }
+    }
+    g_free(f);
+}
+
+static void printUETrace(UETraceKey key, guint64 id, guint64 packets,
+                         gpointer data){
+    CommandConn_t *self = (CommandConn_t *)data;
+    if(key == UETRACE_IMSI){
+        conn_print(self, "IMSI\t%" G_GUINT64_FORMAT "\t%" G_GUINT64_FORMAT "\n",
+                   id, packets);
+    }else{
+        conn_print(self, "M-TMSI\t%.8x\t\t%" G_GUINT64_FORMAT "\n",
+                   (guint32)id, packets);
+    }
+}
+
+/**
+ * Parses "i <imsi>" or "t <m-tmsi in hex>" after the command character*/
+static gboolean parseUEId(const char *line, UETraceKey *key, guint64 *id){
+    char type;
+    guint32 mtmsi;
+
+    if(sscanf(line, "%*c %c", &type) != 1){
+        return FALSE;
+    }
+    if(type == 'i' && sscanf(line, "%*c %*c %" G_GUINT64_FORMAT, id) == 1){
+        *key = UETRACE_IMSI;
+        return TRUE;
+    }
+    if(type == 't' && sscanf(line, "%*c %*c %x", &mtmsi) == 1){
+        *key = UETRACE_MTMSI;
+        *id = mtmsi;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void conn_startUETrace(CommandConn_t *self, const char *line){
+    UETraceKey key;
+    guint64 id;
+    gpointer emm = NULL;
+
+    if(!parseUEId(line, &key, &id)){
+        conn_print(self, "\t\t== UE traces==\n\n"
+                   "Type\tId\t\t\tMessages\n");
+        uetrace_foreach(printUETrace, self);
+        return;
+    }
+    if(!uetrace_start(key, id)){
+        conn_print(self, "Trace already active or file not created\n");
+        return;
+    }
+    /* Flag the context if the UE is already registered*/
+    if(key == UETRACE_IMSI){
+        mme_lookupEMMCtxt_byIMSI(self->mme, id, &emm);
+    }else{
+        mme_lookupEMMCtxt(self->mme, (guint32)id, &emm);
+    }
+    if(emm){
+        emmCtx_updateTrace(emm);
+    }
+    conn_print(self, "Trace started\n");
+}
+
+static void conn_stopUETrace(CommandConn_t *self, const char *line){
+    UETraceKey key;
+    guint64 id;
+
+    if(!parseUEId(line, &key, &id)){
+        conn_print(self, "Usage: u i imsi|t mtmsi\n");
+        return;
+    }
+    if(!uetrace_stop(key, id)){
+        conn_print(self, "Trace not active\n");
+        return;
+    }
+    conn_print(self, "Trace stopped\n");
 }
 
 static void process_line(CommandConn_t* self, char * line, size_t len){
@@ -156,6 +456,24 @@ static void process_line(CommandConn_t* self, char * line, size_t len){
     case 's':
         conn_printStats(self);
         break;
+    case 'p':
+        conn_printS11Peers(self);
+        break;
+    case 't':
+        conn_startUETrace(self, line);
+        break;
+    case 'u':
+        conn_stopUETrace(self, line);
+        break;
+    case 'r':
+        conn_printProcLatency(self);
+        break;
+    case 'c':
+        conn_printLoopProf(self);
+        break;
+    case 'a':
+        conn_printMemory(self, line);
+        break;
     case 'q':
         conn_stop(self);
         return;
@@ -175,7 +493,9 @@ static void cmd_read_cb(struct bufferevent *bev, void *ctx){
     struct evbuffer *input = bufferevent_get_input(bev);
     line = evbuffer_readln(input, &len, EVBUFFER_EOL_LF);
 
+    loopprof_enter(LP_COMMANDS);
     process_line(self, line, len);
+    loopprof_leave();
 }
 
 static void cmd_event_cb(struct bufferevent *bev, short events, void *ctx){
@@ -0,0 +1,354 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   metrics.c
+ * @brief  Runtime metrics
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <event2/event.h>
+
+#include "metrics.h"
+#include "MME.h"
+#include "logmgr.h"
+#include "timermgr.h"
+#include "EMM_FSMConfig.h"
+#include "ECMSession_FSMConfig.h"
+
+#define SAMPLE_INTERVAL_US 1000000
+
+Metrics_t metrics;
+
+typedef struct{
+    const char *name;
+    const char *help;
+}MetricDesc_t;
+
+static const MetricDesc_t counterDesc[MC_NUM] = {
+    {"mme_attach_requests_total",      "Attach Requests received"},
+    {"mme_attach_accepts_total",       "Attach Accepts sent"},
+    {"mme_attach_rejects_total",       "Attach Rejects sent"},
+    {"mme_tau_requests_total",         "Tracking Area Update Requests received"},
+    {"mme_tau_accepts_total",          "Tracking Area Update Accepts sent"},
+    {"mme_tau_rejects_total",          "Tracking Area Update Rejects sent"},
+    {"mme_service_requests_total",     "Service Requests received"},
+    {"mme_service_rejects_total",      "Service Rejects sent"},
+    {"mme_detach_requests_total",      "UE originated Detach Requests received"},
+    {"mme_pagings_total",              "S1AP Paging messages sent"},
+    {"mme_s11_tx_requests_total",      "GTPv2-C requests sent on S11"},
+    {"mme_s11_rx_responses_total",     "GTPv2-C responses received on S11"},
+    {"mme_s11_rx_requests_total",      "GTPv2-C requests received on S11"},
+    {"mme_s11_tx_responses_total",     "GTPv2-C responses sent on S11"},
+    {"mme_hss_requests_total",         "HSS queries"},
+    {"mme_hss_errors_total",           "HSS queries failed"},
+};
+
+static const MetricDesc_t histDesc[MH_NUM] = {
+    {"mme_hss_latency_seconds",        "HSS query latency"},
+    {"mme_s11_latency_seconds",        "S11 request to response latency"},
+    {"mme_event_loop_lag_seconds",     "Event loop scheduling lag"},
+};
+
+const char *metricProcName[MP_NUM] = {"Attach", "TAU", "ServiceReq", "Detach"};
+
+const char *metricSegmentName[MS_NUM] = {"total", "HSS", "SGW", "eNB/UE"};
+
+static HdrHist procHist[MP_NUM][MS_NUM];
+
+/** Upper bounds of the histogram buckets, us*/
+static const guint64 bucketBound[METRICS_HIST_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000};
+
+static struct{
+    struct mme_t  *mme;
+    struct event  *sampler;
+    guint64       nextSample;
+    int           fd;
+    pthread_t     thread;
+    gboolean      running;
+}srv = {.fd = -1};
+
+guint64 metric_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec*1000000ULL + ts.tv_nsec/1000;
+}
+
+void metric_observe(MetricHistogram h, guint64 us){
+    MetricHist_t *hist = &metrics.hist[h];
+    guint i;
+
+    for(i=0; i<METRICS_HIST_BUCKETS && us > bucketBound[i]; i++);
+    hist->bucket[i]++;
+    hist->count++;
+    hist->sum += us;
+}
+
+void metric_procRecord(MetricProc p, const guint64 seg[MS_NUM]){
+    guint i;
+    for(i=0; i<MS_NUM; i++){
+        hdr_record(&procHist[p][i], seg[i]);
+    }
+}
+
+const HdrHist *metric_procHist(MetricProc p, MetricSegment s){
+    return &procHist[p][s];
+}
+
+/**
+ * Measures the event loop lag and samples the gauges kept by other modules*/
+static void metrics_sample(evutil_socket_t fd, short event, void *arg){
+    guint64 now = metric_now();
+    guint64 lag = now > srv.nextSample ? now - srv.nextSample : 0;
+
+    loopprof_enter(LP_METRICS);
+    metric_observe(MH_LOOP_LAG, lag);
+    metrics.loopLag = lag;
+    metrics.timers = tm_getCount(mme_getTimerMgr(srv.mme));
+    metrics.s1Assocs = g_hash_table_size(srv.mme->s1_by_GeNBid);
+    srv.nextSample = now + SAMPLE_INTERVAL_US;
+    loopprof_leave();
+}
+
+/* ====================================================================== */
+/* HTTP server thread                                                      */
+
+static void render_hist(GString *out, const MetricDesc_t *d,
+                        const MetricHist_t *h){
+    guint64 cum = 0;
+    guint i;
+
+    g_string_append_printf(out, "# HELP %s %s\n# TYPE %s histogram\n",
+                           d->name, d->help, d->name);
+    for(i=0; i<METRICS_HIST_BUCKETS; i++){
+        cum += h->bucket[i];
+        g_string_append_printf(out, "%s_bucket{le=\"%g\"} %" G_GUINT64_FORMAT "\n",
+                               d->name, bucketBound[i]/1e6, cum);
+    }
+    cum += h->bucket[i];
+    g_string_append_printf(out, "%s_bucket{le=\"+Inf\"} %" G_GUINT64_FORMAT "\n"
+                           "%s_sum %g\n"
+                           "%s_count %" G_GUINT64_FORMAT "\n",
+                           d->name, cum, d->name, h->sum/1e6, d->name, cum);
+}
+
+static void render_loopprof(GString *out){
+    const LoopProfStat *st;
+    guint i;
+
+    g_string_append(out, "# HELP mme_callback_calls_total Event loop callback runs\n"
+                    "# TYPE mme_callback_calls_total counter\n");
+    for(i=0; i<LP_NUM; i++){
+        g_string_append_printf(out, "mme_callback_calls_total{cb=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                               loopProfName[i], loopprof_get(i)->calls);
+    }
+    g_string_append(out, "# HELP mme_callback_cycles_total CPU cycles in the callback, nested callbacks excluded\n"
+                    "# TYPE mme_callback_cycles_total counter\n");
+    for(i=0; i<LP_NUM; i++){
+        g_string_append_printf(out, "mme_callback_cycles_total{cb=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                               loopProfName[i], loopprof_get(i)->cycles);
+    }
+    g_string_append(out, "# HELP mme_callback_seconds_total Time in the callback, nested callbacks excluded\n"
+                    "# TYPE mme_callback_seconds_total counter\n");
+    for(i=0; i<LP_NUM; i++){
+        st = loopprof_get(i);
+        g_string_append_printf(out, "mme_callback_seconds_total{cb=\"%s\"} %g\n",
+                               loopProfName[i], loopprof_us(st->cycles)/1e6);
+    }
+    g_string_append(out, "# HELP mme_callback_max_seconds Longest callback run\n"
+                    "# TYPE mme_callback_max_seconds gauge\n");
+    for(i=0; i<LP_NUM; i++){
+        st = loopprof_get(i);
+        g_string_append_printf(out, "mme_callback_max_seconds{cb=\"%s\"} %g\n",
+                               loopProfName[i], loopprof_us(st->maxCycles)/1e6);
+    }
+    g_string_append_printf(out,
+                           "# HELP mme_loop_overruns_total Callbacks over the watchdog threshold\n"
+                           "# TYPE mme_loop_overruns_total counter\n"
+                           "mme_loop_overruns_total %" G_GUINT64_FORMAT "\n",
+                           loopprof_getOverruns());
+}
+
+static GString *render(){
+    GString *out = g_string_sized_new(8192);
+    guint i;
+
+    for(i=0; i<MC_NUM; i++){
+        g_string_append_printf(out, "# HELP %s %s\n# TYPE %s counter\n"
+                               "%s %" G_GUINT64_FORMAT "\n",
+                               counterDesc[i].name, counterDesc[i].help,
+                               counterDesc[i].name, counterDesc[i].name,
+                               metrics.counter[i]);
+    }
+
+    g_string_append(out, "# HELP mme_emm_ues UE contexts by EMM state\n"
+                    "# TYPE mme_emm_ues gauge\n");
+    for(i=0; i<METRICS_EMM_STATES; i++){
+        g_string_append_printf(out, "mme_emm_ues{state=\"%s\"} %" G_GINT64_FORMAT "\n",
+                               EMMStateName[i], metrics.emmUEs[i]);
+    }
+    g_string_append(out, "# HELP mme_ecm_ues UE contexts by ECM state\n"
+                    "# TYPE mme_ecm_ues gauge\n");
+    for(i=0; i<METRICS_ECM_STATES; i++){
+        g_string_append_printf(out, "mme_ecm_ues{state=\"%s\"} %" G_GINT64_FORMAT "\n",
+                               ECMStateName[i], metrics.ecmUEs[i]);
+    }
+    g_string_append_printf(out,
+                           "# HELP mme_s1_associations eNBs connected\n"
+                           "# TYPE mme_s1_associations gauge\n"
+                           "mme_s1_associations %" G_GINT64_FORMAT "\n"
+                           "# HELP mme_timers Running timers\n"
+                           "# TYPE mme_timers gauge\n"
+                           "mme_timers %" G_GINT64_FORMAT "\n"
+                           "# HELP mme_s11_pending_requests S11 requests waiting for a response\n"
+                           "# TYPE mme_s11_pending_requests gauge\n"
+                           "mme_s11_pending_requests %" G_GINT64_FORMAT "\n"
+                           "# HELP mme_event_loop_lag_last_seconds Last event loop lag sample\n"
+                           "# TYPE mme_event_loop_lag_last_seconds gauge\n"
+                           "mme_event_loop_lag_last_seconds %g\n",
+                           metrics.s1Assocs, metrics.timers, metrics.s11Pending,
+                           metrics.loopLag/1e6);
+    g_string_append_printf(out,
+                           "# HELP mme_log_dropped_total Log messages dropped\n"
+                           "# TYPE mme_log_dropped_total counter\n"
+                           "mme_log_dropped_total %lu\n", log_getDropped());
+
+    for(i=0; i<MH_NUM; i++){
+        render_hist(out, &histDesc[i], &metrics.hist[i]);
+    }
+    render_loopprof(out);
+    return out;
+}
+
+static void serve(int fd){
+    char req[1024];
+    char hdr[128];
+    GString *body;
+    ssize_t n;
+
+    /* The request is not parsed, any path returns the metrics*/
+    n = recv(fd, req, sizeof(req), 0);
+    if(n <= 0){
+        return;
+    }
+    body = render();
+    n = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+                 "Content-Type: text/plain; version=0.0.4\r\n"
+                 "Content-Length: %zu\r\n\r\n", body->len);
+    if(send(fd, hdr, n, MSG_NOSIGNAL) == n){
+        send(fd, body->str, body->len, MSG_NOSIGNAL);
+    }
+    g_string_free(body, TRUE);
+}
+
+static void *metrics_thread(void *arg){
+    struct timeval tv = {.tv_sec = 1, .tv_usec = 0};
+    int fd;
+
+    while(srv.running){
+        fd = accept(srv.fd, NULL, NULL);
+        if(fd < 0){
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        serve(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+/* ====================================================================== */
+
+gboolean metrics_init(gpointer mme, const char *addr, guint16 port){
+    struct sockaddr_in sin;
+    struct timeval tv = {.tv_sec = 1, .tv_usec = 0};
+    int on = 1;
+
+    srv.mme = (struct mme_t *)mme;
+
+    srv.sampler = event_new(srv.mme->evbase, -1, EV_PERSIST, metrics_sample, NULL);
+    srv.nextSample = metric_now() + SAMPLE_INTERVAL_US;
+    event_add(srv.sampler, &tv);
+
+    if(port == 0){
+        return TRUE;
+    }
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    if(!addr){
+        addr = METRICS_ADDRESS;
+    }
+    if(inet_pton(AF_INET, addr, &(sin.sin_addr)) != 1){
+        log_msg(LOG_ERR, 0, "Invalid metrics address %s", addr);
+        return FALSE;
+    }
+    sin.sin_port = htons(port);
+
+    srv.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(srv.fd < 0){
+        log_msg(LOG_ERR, errno, "Metrics socket");
+        return FALSE;
+    }
+    setsockopt(srv.fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if(bind(srv.fd, (struct sockaddr*)&sin, sizeof(sin)) < 0
+       || listen(srv.fd, 8) < 0){
+        log_msg(LOG_ERR, errno, "Error opening the metrics port %u", port);
+        close(srv.fd);
+        srv.fd = -1;
+        return FALSE;
+    }
+
+    srv.running = TRUE;
+    if(pthread_create(&srv.thread, NULL, metrics_thread, NULL) != 0){
+        log_msg(LOG_ERR, 0, "Error starting the metrics server");
+        srv.running = FALSE;
+        close(srv.fd);
+        srv.fd = -1;
+        return FALSE;
+    }
+    log_msg(LOG_INFO, 0, "Metrics served on %s port %u", addr, port);
+    return TRUE;
+}
+
+void metrics_free(){
+    if(srv.sampler){
+        event_free(srv.sampler);
+        srv.sampler = NULL;
+    }
+    if(srv.fd < 0){
+        return;
+    }
+    srv.running = FALSE;
+    /* Wakes up the blocking accept*/
+    shutdown(srv.fd, SHUT_RDWR);
+    pthread_join(srv.thread, NULL);
+    close(srv.fd);
+    srv.fd = -1;
+}
@@ -0,0 +1,169 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   metrics.h
+ * @brief  Runtime metrics
+ *
+ * Counters, gauges and histograms served on a HTTP port in the Prometheus
+ * text exposition format.
+ *
+ * The metrics are only written from the event loop thread, so an update is
+ * a plain increment. The HTTP server runs on its own thread and reads the
+ * values without locking: each value is an aligned 64 bit word, so a scrape
+ * may miss the latest update but never sees a torn value.
+ */
+
+#ifndef METRICS_HFILE
+#define METRICS_HFILE
+
+#include <glib.h>
+#include "hdrhist.h"
+
+#define METRICS_PORT 9100
+#define METRICS_ADDRESS "127.0.0.1"
+
+/**
+ * Counters*/
+typedef enum{
+    MC_ATTACH_REQ,
+    MC_ATTACH_ACCEPT,
+    MC_ATTACH_REJECT,
+    MC_TAU_REQ,
+    MC_TAU_ACCEPT,
+    MC_TAU_REJECT,
+    MC_SERVICE_REQ,
+    MC_SERVICE_REJECT,
+    MC_DETACH_REQ,
+    MC_PAGING,
+    MC_S11_TX_REQ,
+    MC_S11_RX_RSP,
+    MC_S11_RX_REQ,
+    MC_S11_TX_RSP,
+    MC_HSS_REQ,
+    MC_HSS_ERROR,
+    MC_NUM
+}MetricCounter;
+
+/**
+ * Histograms, in microseconds*/
+typedef enum{
+    MH_HSS_LATENCY,
+    MH_S11_LATENCY,
+    MH_LOOP_LAG,
+    MH_NUM
+}MetricHistogram;
+
+/**
+ * Procedures with latency histograms*/
+typedef enum{
+    MP_ATTACH,
+    MP_TAU,
+    MP_SERVICE_REQ,
+    MP_DETACH,
+    MP_NUM
+}MetricProc;
+
+/**
+ * Latency segments of a procedure*/
+typedef enum{
+    MS_TOTAL,
+    MS_HSS,     /**< S6a queries*/
+    MS_SGW,     /**< S11 requests until their response*/
+    MS_RAN,     /**< Rest: eNB, UE and MME processing*/
+    MS_NUM
+}MetricSegment;
+
+extern const char *metricProcName[MP_NUM];
+extern const char *metricSegmentName[MS_NUM];
+
+#define METRICS_HIST_BUCKETS 14
+#define METRICS_EMM_STATES   5
+#define METRICS_ECM_STATES   2
+
+typedef struct{
+    guint64     bucket[METRICS_HIST_BUCKETS+1]; /**< Last one is +Inf*/
+    guint64     count;
+    guint64     sum;
+}MetricHist_t;
+
+typedef struct{
+    guint64      counter[MC_NUM];
+    gint64       emmUEs[METRICS_EMM_STATES];    /**< UEs by EMMState*/
+    gint64       ecmUEs[METRICS_ECM_STATES];    /**< UEs by ECMSessionState*/
+    gint64       s1Assocs;
+    gint64       timers;
+    gint64       s11Pending;                    /**< S11 requests without response*/
+    gint64       loopLag;                       /**< Last sample, us*/
+    MetricHist_t hist[MH_NUM];
+}Metrics_t;
+
+extern Metrics_t metrics;
+
+/** Increment a counter*/
+#define metric_inc(c) (metrics.counter[c]++)
+
+/** Move a UE between EMM states*/
+#define metric_emmState(from, to) do{           \
+        metrics.emmUEs[from]--;                 \
+        metrics.emmUEs[to]++;                   \
+    }while(0)
+
+/** Move a UE between ECM states*/
+#define metric_ecmState(from, to) do{           \
+        metrics.ecmUEs[from]--;                 \
+        metrics.ecmUEs[to]++;                   \
+    }while(0)
+
+/**
+ * @brief Add a sample to a histogram
+ * @param [in] h   Histogram
+ * @param [in] us  Value in microseconds
+ */
+void metric_observe(MetricHistogram h, guint64 us);
+
+/**
+ * @brief Record the latency of a completed procedure
+ * @param [in] p    Procedure
+ * @param [in] seg  Latency of each segment, us
+ */
+void metric_procRecord(MetricProc p, const guint64 seg[MS_NUM]);
+
+/**
+ * @brief Latency histogram of a procedure segment, us
+ */
+const HdrHist *metric_procHist(MetricProc p, MetricSegment s);
+
+/**
+ * @brief Monotonic time in microseconds, used to measure latencies
+ */
+guint64 metric_now();
+
+/**
+ * @brief Start the metrics HTTP server and the event loop sampler
+ * @param [in] mme   MME handler
+ * @param [in] addr  IPv4 address of the HTTP server, the loopback if NULL
+ * @param [in] port  HTTP port, 0 disables the server
+ * @return FALSE if the server couldn't be started
+ */
+gboolean metrics_init(gpointer mme, const char *addr, guint16 port);
+
+/**
+ * @brief Stop the HTTP server and the sampler
+ */
+void metrics_free();
+
+#endif /* METRICS_HFILE */
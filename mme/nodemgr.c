@@ -33,6 +33,8 @@
 #include "nodemgr.h"
 #include "string.h"
 #include "logmgr.h"
+#include "metrics.h"
+#include "loopprof.h"
 
 #include <libconfig.h>
 #include <stdlib.h>
@@ -44,9 +46,249 @@ G_DEFINE_QUARK(MME-Configuration, conf);
 /*Config structure*/
 config_t cfg;
 
+/* Maximum weight of a node, bounds the size of the selection rings*/
+#define NODE_MAX_WEIGHT 100
+
+typedef struct{
+    struct nodeinfo_t info;
+    guint             weight;    /**< Relative capacity, from cfg*/
+    guint32           sessions;  /**< Active sessions, reported by the stacks*/
+}NodeEntry_t;
+
+/** Candidate nodes for a selection, expanded by weight*/
+typedef struct{
+    GPtrArray   *members;   /**< NodeEntry_t candidates*/
+    NodeEntry_t **slots;    /**< Candidates in service, weight times each*/
+    guint       len;
+    guint       next;
+}NodeRing_t;
+
+typedef struct{
+    GPtrArray   *entries;   /**< NodeEntry_t, owned by the table*/
+    NodeRing_t  *all;
+    GHashTable  *byTAC;     /**< NodeRing_t by Tracking Area Code*/
+    GHashTable  *byAPN;     /**< NodeRing_t by APN, lower case*/
+    GHashTable  *byAddr;    /**< GPtrArray of NodeEntry_t by IPv4 address*/
+}NodeTable_t;
+
+/* Config list of each node type, indexed by enum nodeType*/
+static const char *nodeCfgPath[] = {"nodes.mme", NULL, "nodes.sgw",
+                                    "nodes.pgw", NULL, "nodes.sdn"};
+
+static NodeTable_t *nodeTables[CTRL+1];
+
+static NodeRing_t *nodeRing_new(){
+    NodeRing_t *r = g_new0(NodeRing_t, 1);
+    r->members = g_ptr_array_new();
+    return r;
+}
+
+static void nodeRing_free(gpointer ring){
+    NodeRing_t *r = (NodeRing_t *)ring;
+    g_ptr_array_free(r->members, TRUE);
+    g_free(r->slots);
+    g_free(r);
+}
+
+/**
+ * Expand the members in service by weight using the smooth weighted round
+ * robin order, so the slots of a node are spread along the ring. When no
+ * member is in service, all of them are candidates.
+ */
+static void nodeRing_rebuild(NodeRing_t *r){
+    NodeEntry_t *e;
+    gint *cur, best;
+    guint i, j, total = 0;
+    gboolean anyUp = FALSE;
+
+    for(i=0; i<r->members->len; i++){
+        e = g_ptr_array_index(r->members, i);
+        anyUp |= e->info.status == up;
+    }
+    for(i=0; i<r->members->len; i++){
+        e = g_ptr_array_index(r->members, i);
+        if(!anyUp || e->info.status == up){
+            total += e->weight;
+        }
+    }
+
+    g_free(r->slots);
+    r->slots = g_new0(NodeEntry_t *, total);
+    r->len = total;
+    r->next = 0;
+
+    cur = g_new0(gint, r->members->len);
+    for(j=0; j<total; j++){
+        best = -1;
+        for(i=0; i<r->members->len; i++){
+            e = g_ptr_array_index(r->members, i);
+            if(anyUp && e->info.status != up){
+                continue;
+            }
+            cur[i] += e->weight;
+            if(best<0 || cur[i] > cur[best]){
+                best = i;
+            }
+        }
+        cur[best] -= total;
+        r->slots[j] = g_ptr_array_index(r->members, best);
+    }
+    g_free(cur);
+}
+
+/**
+ * Two candidates are taken from the ring, the next one and the one half a
+ * ring away, and the least loaded relative to its weight is used. The ring
+ * order keeps the weights when the load is balanced.
+ */
+static NodeEntry_t *nodeRing_select(NodeRing_t *r){
+    NodeEntry_t *a, *b;
+
+    if(!r || r->len == 0){
+        return NULL;
+    }
+    a = r->slots[r->next];
+    b = r->slots[(r->next + r->len/2) % r->len];
+    r->next = (r->next + 1) % r->len;
+
+    if((guint64)b->sessions*a->weight < (guint64)a->sessions*b->weight){
+        return b;
+    }
+    return a;
+}
+
+static void nodeRing_rebuild_cb(gpointer key, gpointer value, gpointer data){
+    nodeRing_rebuild((NodeRing_t *)value);
+}
+
+static void nodeTable_rebuild(NodeTable_t *t){
+    nodeRing_rebuild(t->all);
+    g_hash_table_foreach(t->byTAC, nodeRing_rebuild_cb, NULL);
+    g_hash_table_foreach(t->byAPN, nodeRing_rebuild_cb, NULL);
+}
+
+static enum nodeStatus parseStatus(const char *status){
+    if(strcmp(status, "down")==0){
+        return down;
+    }else if(strcmp(status, "up")==0){
+        return up;
+    }else if(strcmp(status, "busy")==0){
+        return busy;
+    }
+    log_msg(LOG_ERR ,0, "Node status on cfg file not valid");
+    return down;
+}
+
+/* The key is owned by the table when a new ring is created, freed otherwise*/
+static void nodeTable_addToRing(GHashTable *rings, gpointer key,
+                                GDestroyNotify keyFree, NodeEntry_t *e){
+    NodeRing_t *r = g_hash_table_lookup(rings, key);
+    if(!r){
+        r = nodeRing_new();
+        g_hash_table_insert(rings, key, r);
+    }else if(keyFree){
+        keyFree(key);
+    }
+    g_ptr_array_add(r->members, e);
+}
+
+static NodeEntry_t *nodeTable_parseEntry(config_setting_t *nodecfg,
+                                         const enum nodeType type){
+    NodeEntry_t *e;
+    const char *name, *ip4, *ip6, *status;
+    int weight;
+
+    if(!(config_setting_lookup_string(nodecfg, "name", &name) &&
+            config_setting_lookup_string(nodecfg, "ipv4", &ip4) &&
+            config_setting_lookup_string(nodecfg, "ipv6", &ip6) &&
+            config_setting_lookup_string(nodecfg, "status", &status) )){
+        log_msg(LOG_ERR ,0, "Couldn't parse node info - %s:%d - %s\n",
+                config_error_file(&cfg), config_error_line(&cfg),
+                config_error_text(&cfg));
+        return NULL;
+    }
+    e = g_new0(NodeEntry_t, 1);
+    g_strlcpy(e->info.name, name, MAX_HOST_NAME);
+    inet_pton(AF_INET, ip4, &(e->info.addrv4));
+    inet_pton(AF_INET6, ip6, &(e->info.addrv6));
+    e->info.status = parseStatus(status);
+    e->info.type = type;
+
+    e->weight = 1;
+    if(config_setting_lookup_int(nodecfg, "weight", &weight) && weight > 0){
+        e->weight = MIN(weight, NODE_MAX_WEIGHT);
+    }
+    return e;
+}
+
+static NodeTable_t *nodeTable_load(const enum nodeType type){
+    NodeTable_t *t = g_new0(NodeTable_t, 1);
+    config_setting_t *nodes, *nodecfg, *list;
+    NodeEntry_t *e;
+    GPtrArray *sameAddr;
+    gpointer addrKey;
+    int i, j;
+
+    t->entries = g_ptr_array_new_with_free_func(g_free);
+    t->all = nodeRing_new();
+    t->byTAC = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                     NULL, nodeRing_free);
+    t->byAPN = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                     g_free, nodeRing_free);
+    t->byAddr = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                      (GDestroyNotify)g_ptr_array_unref);
+
+    nodes = config_lookup(&cfg, nodeCfgPath[type]);
+    for(i=0; nodes && i<config_setting_length(nodes); i++){
+        nodecfg = config_setting_get_elem(nodes, i);
+        e = nodeTable_parseEntry(nodecfg, type);
+        if(!e){
+            continue;
+        }
+        g_ptr_array_add(t->entries, e);
+        g_ptr_array_add(t->all->members, e);
+
+        addrKey = GUINT_TO_POINTER(e->info.addrv4.s_addr);
+        sameAddr = g_hash_table_lookup(t->byAddr, addrKey);
+        if(!sameAddr){
+            sameAddr = g_ptr_array_new();
+            g_hash_table_insert(t->byAddr, addrKey, sameAddr);
+        }
+        g_ptr_array_add(sameAddr, e);
+
+        list = config_setting_get_member(nodecfg, "tac");
+        for(j=0; list && j<config_setting_length(list); j++){
+            nodeTable_addToRing(t->byTAC,
+                                GUINT_TO_POINTER(config_setting_get_int_elem(list, j)),
+                                NULL, e);
+        }
+        list = config_setting_get_member(nodecfg, "apn");
+        for(j=0; list && j<config_setting_length(list); j++){
+            nodeTable_addToRing(t->byAPN,
+                                g_ascii_strdown(config_setting_get_string_elem(list, j), -1),
+                                g_free, e);
+        }
+    }
+    nodeTable_rebuild(t);
+    return t;
+}
+
+static void nodeTable_free(NodeTable_t *t){
+    if(!t){
+        return;
+    }
+    g_hash_table_destroy(t->byAddr);
+    g_hash_table_destroy(t->byAPN);
+    g_hash_table_destroy(t->byTAC);
+    nodeRing_free(t->all);
+    g_ptr_array_free(t->entries, TRUE);
+    g_free(t);
+}
+
 bool init_nodemgr(){
     char *defaultCfg = CFGFILENAME;
     char *cfgFile = NULL;
+    enum nodeType type;
     config_init(&cfg);
     cfgFile = getenv("MME_CONFIG");
     if(!cfgFile){
@@ -64,77 +306,98 @@ bool init_nodemgr(){
     else{
         log_msg(LOG_INFO, 0, "Node file opened: %s", cfgFile);
     }
+
+    for(type=node_MME; type<=CTRL; type++){
+        if(nodeCfgPath[type]){
+            nodeTables[type] = nodeTable_load(type);
+        }
+    }
     return true;
 }
 
 void free_nodemgr(){
+    enum nodeType type;
+    for(type=node_MME; type<=CTRL; type++){
+        nodeTable_free(nodeTables[type]);
+        nodeTables[type] = NULL;
+    }
     config_destroy(&cfg);
 }
 
-void getNode(struct nodeinfo_t *node, const enum nodeType type, Subscription subs){
-    static uint8_t imme = 0, ieNB = 0, iSgw = 0, iPgw = 0, iCtrl = 0; /*Index variables*/
-    uint8_t count;
-    config_setting_t *nodes, *nodecfg;
-    const char *name, *ip4, *ip6, *status;
+void selectNode(struct nodeinfo_t *node, const enum nodeType type,
+                const guint16 tac, const char *apn){
+    NodeTable_t *t = NULL;
+    NodeEntry_t *e = NULL;
+    gchar *apnKey;
 
-    switch(type){
-    case node_MME:
-        node->type = invalid;
-        nodes = config_lookup(&cfg, "nodes.mme");
-        nodecfg = config_setting_get_elem(nodes, imme);
-        count = config_setting_length(nodes);
-        imme = (imme+1)%count;
-        break;
-    case eNB:
+    if(type>=node_MME && type<=CTRL){
+        t = nodeTables[type];
+    }
+    if(!t){
         node->type = invalid;
         strcpy(node->name, "Not Implemented");
-        break;
-    case SGW:
-        node->type = SGW;
-        nodes = config_lookup(&cfg, "nodes.sgw");
-        nodecfg = config_setting_get_elem(nodes, iSgw);
-        count = config_setting_length(nodes);
-        iSgw = (iSgw+1)%count;
-        break;
-    case PGW:
-        node->type = PGW;
-        nodes = config_lookup(&cfg, "nodes.pgw");
-        nodecfg = config_setting_get_elem(nodes, iPgw);
-        count = config_setting_length(nodes);
-        iPgw = (iPgw+1)%count;
-        break;
-    case CTRL:
-        node->type = CTRL;
-        nodes = config_lookup(&cfg, "nodes.sdn");
-        nodecfg = config_setting_get_elem(nodes, iCtrl);
-        count = config_setting_length(nodes);
-        iCtrl = (iCtrl+1)%count;
-        break;
-    }
-    /*Parser*/
-    if(!(config_setting_lookup_string(nodecfg, "name", &name) &&
-            config_setting_lookup_string(nodecfg, "ipv4", &ip4) &&
-            config_setting_lookup_string(nodecfg, "ipv6", &ip6) &&
-            config_setting_lookup_string(nodecfg, "status", &status) )){
-        log_msg(LOG_ERR ,0, "Couldn't parse node info - %s:%d - %s\n", config_error_file(&cfg), config_error_line(&cfg), config_error_text(&cfg));
+        return;
     }
-    strcpy(node->name, name);
 
-    inet_pton(AF_INET, ip4, &(node->addrv4));
-    inet_pton(AF_INET6, ip6, &(node->addrv6));
+    if(tac != 0){
+        e = nodeRing_select(g_hash_table_lookup(t->byTAC,
+                                                GUINT_TO_POINTER(tac)));
+    }
+    if(!e && apn && apn[0] != '\0' && g_hash_table_size(t->byAPN) > 0){
+        apnKey = g_ascii_strdown(apn, -1);
+        e = nodeRing_select(g_hash_table_lookup(t->byAPN, apnKey));
+        g_free(apnKey);
+    }
+    if(!e){
+        e = nodeRing_select(t->all);
+    }
+    if(!e){
+        log_msg(LOG_ERR, 0, "No node available in %s", nodeCfgPath[type]);
+        node->type = invalid;
+        strcpy(node->name, "Not Found");
+        return;
+    }
+    *node = e->info;
+}
 
-    /*Conversion to status enum*/
-    if(strcmp(status, "down")==0){
-        node->status=down;
-    }else if(strcmp(status, "up")==0){
-        node->status=up;
-    }else if(strcmp(status, "busy")==0){
-        node->status=busy;
-    }else{
-        log_msg(LOG_ERR ,0, "Node status on cfg file not valid");
-        node->status = invalid;
+void getNode(struct nodeinfo_t *node, const enum nodeType type, Subscription subs){
+    selectNode(node, type, 0, subs ? subs_getAPN(subs) : NULL);
+}
+
+static GPtrArray *nodesByAddr4(const enum nodeType type,
+                               const struct in_addr *addr){
+    if(type<node_MME || type>CTRL || !nodeTables[type]){
+        return NULL;
     }
+    return g_hash_table_lookup(nodeTables[type]->byAddr,
+                               GUINT_TO_POINTER(addr->s_addr));
+}
 
+void setNodeLoad(const enum nodeType type, const struct in_addr *addr,
+                 const guint32 sessions){
+    GPtrArray *nodes = nodesByAddr4(type, addr);
+    guint i;
+
+    for(i=0; nodes && i<nodes->len; i++){
+        ((NodeEntry_t *)g_ptr_array_index(nodes, i))->sessions = sessions;
+    }
+}
+
+void setNodeStatus(const enum nodeType type, const struct in_addr *addr,
+                   const enum nodeStatus status){
+    GPtrArray *nodes = nodesByAddr4(type, addr);
+    NodeEntry_t *e;
+    gboolean changed = FALSE;
+    guint i;
+
+    for(i=0; nodes && i<nodes->len; i++){
+        e = g_ptr_array_index(nodes, i);
+        changed |= e->info.status != status;
+        e->info.status = status;
+    }
+    if(changed){
+        nodeTable_rebuild(nodeTables[type]);
+    }
 }
 
 void saveNode(const struct nodeinfo_t *node){
@@ -169,9 +432,26 @@ void getNodeByAddr6(const struct in6_addr *addr, const enum nodeType type, struc
 
 }
 
+/* The bucket size is one second of requests if it is not set*/
+static void loadAdmissionLimit(config_setting_t *c, AdmissionLimit *l){
+    int tmp;
+
+    if(config_setting_lookup_int(c, "rate", &tmp) && tmp>=0)
+        l->rate = tmp;
+    l->burst = l->rate;
+    if(config_setting_lookup_int(c, "burst", &tmp) && tmp>0)
+        l->burst = tmp;
+    if(config_setting_lookup_int(c, "enb_rate", &tmp) && tmp>=0)
+        l->enbRate = tmp;
+    l->enbBurst = l->enbRate;
+    if(config_setting_lookup_int(c, "enb_burst", &tmp) && tmp>0)
+        l->enbBurst = tmp;
+}
+
 void loadMMEinfo(struct mme_t *mme, GError **err){
     config_setting_t *mmeNAMEconf, *mmeIp4, *gUMMEIsconf,
-        *gummeiconf, *pLMNsconf, *gIDsconf, *mMECsconf, *pLMNconf, *relCapconf, *tmp_c;
+        *gummeiconf, *pLMNsconf, *gIDsconf, *mMECsconf, *pLMNconf, *relCapconf, *tmp_c,
+        *admconf;
     char const *name, *mmeIpv4str, *uE_DNSstr, *tmp_str;
     uint32_t iGUMMEI, lGUMMEI, iPLMN, lPLMN, iGID, lGID, iMMEC, lMMEC;
     int tmp;
@@ -202,6 +482,100 @@ void loadMMEinfo(struct mme_t *mme, GError **err){
         mme->stateDir = g_strdup(config_setting_get_string(tmp_c));
     }
 
+    /* S11 path management, TS 29.274 7.6*/
+    mme->s11_echoInterval = 60;
+    mme->s11_t3 = 3;
+    mme->s11_n3 = 5;
+    if(config_lookup_int(&cfg, "mme.S11.echo_interval", &tmp) && tmp>0)
+        mme->s11_echoInterval = tmp;
+    if(config_lookup_int(&cfg, "mme.S11.t3", &tmp) && tmp>0)
+        mme->s11_t3 = tmp;
+    if(config_lookup_int(&cfg, "mme.S11.n3", &tmp) && tmp>=0)
+        mme->s11_n3 = tmp;
+
+    /* Binary event trace ring*/
+    mme->traceRecords = 0;
+    if(config_lookup_int(&cfg, "mme.trace_records", &tmp) && tmp>=0)
+        mme->traceRecords = tmp;
+
+    /* Metrics HTTP server*/
+    mme->metricsPort = METRICS_PORT;
+    if(config_lookup_int(&cfg, "mme.metrics_port", &tmp) && tmp>=0 && tmp<65536)
+        mme->metricsPort = tmp;
+    if(config_lookup_string(&cfg, "mme.metrics_address", &tmp_str))
+        mme->metricsAddr = g_strdup(tmp_str);
+
+    /* Event loop watchdog*/
+    mme->watchdogMs = LOOP_WATCHDOG_MS;
+    if(config_lookup_int(&cfg, "mme.watchdog_ms", &tmp) && tmp>=0)
+        mme->watchdogMs = tmp;
+
+    /* UE context snapshots*/
+    mme->snapshotInterval = 30;
+    if(config_lookup_int(&cfg, "mme.snapshot_interval", &tmp) && tmp>=0)
+        mme->snapshotInterval = tmp;
+
+    /* Hot-standby replication*/
+    mme->replicaRole = REPLICA_OFF;
+    mme->replicaFlushMs = 100;
+    tmp_c = config_lookup(&cfg, "mme.replication");
+    if(tmp_c){
+        if(!(config_setting_lookup_string(tmp_c, "role", &tmp_str) &&
+             config_setting_lookup_string(tmp_c, "address", &name))){
+            err_msg = "mme.replication requires role and address";
+            goto error;
+        }
+        if(strcmp(tmp_str, "active") == 0){
+            mme->replicaRole = REPLICA_ACTIVE;
+        }else if(strcmp(tmp_str, "standby") == 0){
+            mme->replicaRole = REPLICA_STANDBY;
+        }else{
+            err_msg = "mme.replication.role must be active or standby";
+            goto error;
+        }
+        mme->replicaAddr = g_strdup(name);
+        if(config_setting_lookup_int(tmp_c, "flush_ms", &tmp) && tmp>0)
+            mme->replicaFlushMs = tmp;
+    }
+
+    /* Overload control towards the eNBs*/
+    mme->overload.enabled = FALSE;
+    tmp_c = config_lookup(&cfg, "mme.overload");
+    if(tmp_c){
+        mme->overload.enabled = TRUE;
+        mme->overload.lagMs = 20;
+        mme->overload.hssShare = 50;
+        mme->overload.s11Pending = 5000;
+        mme->overload.admissionRate = 2000;
+        mme->overload.hold = 10;
+        if(config_setting_lookup_int(tmp_c, "loop_lag_ms", &tmp) && tmp>=0)
+            mme->overload.lagMs = tmp;
+        if(config_setting_lookup_int(tmp_c, "hss_share", &tmp) && tmp>=0)
+            mme->overload.hssShare = tmp;
+        if(config_setting_lookup_int(tmp_c, "s11_pending", &tmp) && tmp>=0)
+            mme->overload.s11Pending = tmp;
+        if(config_setting_lookup_int(tmp_c, "admission_rate", &tmp) && tmp>=0)
+            mme->overload.admissionRate = tmp;
+        if(config_setting_lookup_int(tmp_c, "hold", &tmp) && tmp>=0)
+            mme->overload.hold = tmp;
+    }
+
+    /* Admission rate limits of the NAS procedures*/
+    memset(&mme->admission, 0, sizeof(AdmissionCfg));
+    tmp_c = config_lookup(&cfg, "mme.admission");
+    if(tmp_c){
+        mme->admission.enabled = TRUE;
+        mme->admission.t3346 = 60;
+        if(config_setting_lookup_int(tmp_c, "t3346", &tmp) && tmp>=0)
+            mme->admission.t3346 = tmp;
+        if((admconf = config_setting_get_member(tmp_c, "attach")))
+            loadAdmissionLimit(admconf, &mme->admission.limit[ADM_ATTACH]);
+        if((admconf = config_setting_get_member(tmp_c, "tau")))
+            loadAdmissionLimit(admconf, &mme->admission.limit[ADM_TAU]);
+        if((admconf = config_setting_get_member(tmp_c, "service")))
+            loadAdmissionLimit(admconf, &mme->admission.limit[ADM_SERVICE]);
+    }
+
     mme->servedGUMMEIs = new_ServedGUMMEIs();
     gUMMEIsconf = config_lookup(&cfg, "mme.servedGUMMEIs");
     lGUMMEI = config_setting_length(gUMMEIsconf);
@@ -333,6 +707,10 @@ void freeMMEinfo(struct mme_t *mme){
         g_free(mme->s6a_db_user);
     if(mme->s6a_db_passwd)
         g_free(mme->s6a_db_passwd);
+    if(mme->replicaAddr)
+        g_free(mme->replicaAddr);
+    if(mme->metricsAddr)
+        g_free(mme->metricsAddr);
 
     if(mme->servedGUMMEIs!=NULL)
         mme->servedGUMMEIs->freeIE(mme->servedGUMMEIs);
@@ -88,6 +88,37 @@ extern void free_nodemgr();
  */
 extern void getNode(struct nodeinfo_t *node, const enum nodeType type, Subscription subs);
 
+/**@brief Select a node for a UE
+ * @param [out] node Selected node information
+ * @param [in]  type node type to be returned
+ * @param [in]  tac  Tracking Area Code of the UE, 0 for any
+ * @param [in]  apn  APN requested, NULL for any
+ *
+ * The nodes configured for the TAC are preferred, then the ones configured
+ * for the APN and finally all the nodes of the type. Among the candidates up,
+ * the selection follows the configured weights and avoids the nodes with more
+ * sessions relative to their weight. The node lists are parsed once on
+ * init_nodemgr, the selection cost is constant.
+ */
+extern void selectNode(struct nodeinfo_t *node, const enum nodeType type,
+                       const guint16 tac, const char *apn);
+
+/**@brief Update the number of sessions of a node
+ * @param [in] type     Node type
+ * @param [in] addr     IPv4 addr of the node
+ * @param [in] sessions Active sessions on the node
+ */
+extern void setNodeLoad(const enum nodeType type, const struct in_addr *addr,
+                        const guint32 sessions);
+
+/**@brief Update the status of a node
+ * @param [in] type   Node type
+ * @param [in] addr   IPv4 addr of the node
+ * @param [in] status New status, only nodes up are selected
+ */
+extern void setNodeStatus(const enum nodeType type, const struct in_addr *addr,
+                          const enum nodeStatus status);
+
 /**@brief Save node information
  * @param [in] node node info to be stored
  *
@@ -0,0 +1,211 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   overload.c
+ * @brief  MME overload control towards the eNBs
+ */
+
+#include <event2/event.h>
+
+#include "overload.h"
+#include "MME.h"
+#include "S1Assoc.h"
+#include "S1AP.h"
+#include "metrics.h"
+#include "logmgr.h"
+
+const char *overloadLevelName[] = {"none",
+                                   "reject-non-emergency-mo-dt",
+                                   "reject-rrc-cr-signalling"};
+
+/* OverloadAction of each level*/
+static const guint overloadAction[] = {0,
+                                       reject_non_emergency_mo_dt,
+                                       reject_rrc_cr_signalling};
+
+static const char *indicatorName[] = {"event loop lag", "HSS queries",
+                                      "S11 pending requests",
+                                      "admission rate"};
+
+static struct{
+    struct mme_t  *mme;
+    struct event  *ev;
+    OverloadCfg   cfg;
+    guint64       next;         /**< Expected time of the next sample*/
+    guint64       last;
+    guint64       hssSum;       /**< HSS latency sum on the last sample*/
+    guint64       requests;     /**< Requests counted on the last sample*/
+    guint         rise;         /**< Consecutive samples over the next level*/
+    guint64       lowSince;     /**< Start under the low watermark, 0 if not*/
+    OverloadStat  st;
+}ovl;
+
+static guint64 overload_requests(){
+    return metrics.counter[MC_ATTACH_REQ] + metrics.counter[MC_TAU_REQ]
+        + metrics.counter[MC_SERVICE_REQ];
+}
+
+/* Keeps the highest ratio of an indicator to its threshold*/
+static void overload_ratio(gdouble v, guint thr, gdouble *max, guint i,
+                           guint *maxI){
+    if(thr > 0 && v/thr > *max){
+        *max = v/thr;
+        *maxI = i;
+    }
+}
+
+static void overload_send(OverloadLevel level){
+    GHashTableIter iter;
+    gpointer assoc;
+
+    g_hash_table_iter_init(&iter, ovl.mme->s1_by_GeNBid);
+    while(g_hash_table_iter_next(&iter, NULL, &assoc)){
+        if(level == OVERLOAD_NONE){
+            s1Assoc_overloadStop(assoc);
+        }else{
+            s1Assoc_overloadStart(assoc, overloadAction[level]);
+        }
+    }
+}
+
+static void overload_setLevel(OverloadLevel level, guint cause){
+    if(level > ovl.st.level){
+        log_msg(LOG_WARNING, 0, "Overload Start %s, load %.2f by %s",
+                overloadLevelName[level], ovl.st.load, indicatorName[cause]);
+    }else if(level != OVERLOAD_NONE){
+        log_msg(LOG_NOTICE, 0, "Overload Start %s, load %.2f",
+                overloadLevelName[level], ovl.st.load);
+    }else{
+        log_msg(LOG_NOTICE, 0, "Overload Stop, load %.2f", ovl.st.load);
+    }
+    ovl.st.level = level;
+    ovl.rise = 0;
+    ovl.lowSince = 0;
+    if(level == OVERLOAD_NONE){
+        ovl.st.stops++;
+    }else{
+        ovl.st.starts++;
+    }
+    overload_send(level);
+}
+
+static void overload_sample(evutil_socket_t fd, short event, void *arg){
+    guint64 now = metric_now(), elapsed, lag, hssSum, requests;
+    gdouble load = 0, enter;
+    guint cause = 0;
+    OverloadLevel target;
+
+    lag = now > ovl.next ? now - ovl.next : 0;
+    elapsed = now > ovl.last ? now - ovl.last : 1;
+    hssSum = metrics.hist[MH_HSS_LATENCY].sum;
+    requests = overload_requests();
+
+    /* The lag of a single sample is noisy, it is smoothed with a 1/4 weight*/
+    ovl.st.lagUs = (3*ovl.st.lagUs + lag)/4;
+    ovl.st.hssShare = 100.0*(hssSum - ovl.hssSum)/elapsed;
+    ovl.st.s11Pending = metrics.s11Pending;
+    ovl.st.admissionRate = (requests - ovl.requests)*1000000/elapsed;
+    ovl.hssSum = hssSum;
+    ovl.requests = requests;
+    ovl.last = now;
+    ovl.next = now + OVERLOAD_INTERVAL_MS*1000;
+
+    overload_ratio(ovl.st.lagUs/1000.0, ovl.cfg.lagMs, &load, 0, &cause);
+    overload_ratio(ovl.st.hssShare, ovl.cfg.hssShare, &load, 1, &cause);
+    overload_ratio(ovl.st.s11Pending, ovl.cfg.s11Pending, &load, 2, &cause);
+    overload_ratio(ovl.st.admissionRate, ovl.cfg.admissionRate, &load, 3, &cause);
+    ovl.st.load = load;
+
+    if(load >= OVERLOAD_SEVERE){
+        target = OVERLOAD_SIGNALLING;
+    }else if(load >= 1){
+        target = OVERLOAD_MO_DATA;
+    }else{
+        target = OVERLOAD_NONE;
+    }
+
+    /* Up after OVERLOAD_RISE samples, the level can be skipped*/
+    if(target > ovl.st.level){
+        ovl.lowSince = 0;
+        if(++ovl.rise >= OVERLOAD_RISE){
+            overload_setLevel(target, cause);
+        }
+        return;
+    }
+    ovl.rise = 0;
+    if(ovl.st.level == OVERLOAD_NONE){
+        return;
+    }
+
+    /* Down one level after the hold time under the low watermark*/
+    enter = ovl.st.level == OVERLOAD_SIGNALLING ? OVERLOAD_SEVERE : 1;
+    if(load >= enter*OVERLOAD_LOW){
+        ovl.lowSince = 0;
+    }else if(ovl.lowSince == 0){
+        ovl.lowSince = now;
+    }else if(now - ovl.lowSince >= (guint64)ovl.cfg.hold*1000000){
+        overload_setLevel(ovl.st.level - 1, cause);
+    }
+}
+
+void overload_init(struct mme_t *mme){
+    struct timeval tv = {.tv_sec = 0,
+                         .tv_usec = OVERLOAD_INTERVAL_MS*1000};
+
+    ovl.mme = mme;
+    ovl.cfg = mme->overload;
+    if(!ovl.cfg.enabled){
+        return;
+    }
+
+    ovl.last = metric_now();
+    ovl.next = ovl.last + OVERLOAD_INTERVAL_MS*1000;
+    ovl.hssSum = metrics.hist[MH_HSS_LATENCY].sum;
+    ovl.requests = overload_requests();
+
+    ovl.ev = event_new(mme_getEventBase(mme), -1, EV_PERSIST,
+                       overload_sample, NULL);
+    event_add(ovl.ev, &tv);
+    log_msg(LOG_INFO, 0, "Overload control: lag %u ms, HSS %u%%, "
+            "S11 %u pending, %u requests/s, hold %u s", ovl.cfg.lagMs,
+            ovl.cfg.hssShare, ovl.cfg.s11Pending, ovl.cfg.admissionRate,
+            ovl.cfg.hold);
+}
+
+void overload_free(){
+    if(ovl.ev){
+        event_free(ovl.ev);
+        ovl.ev = NULL;
+    }
+    ovl.st.level = OVERLOAD_NONE;
+}
+
+OverloadLevel overload_getLevel(){
+    return ovl.st.level;
+}
+
+void overload_newAssoc(gpointer assoc){
+    if(ovl.st.level != OVERLOAD_NONE){
+        s1Assoc_overloadStart(assoc, overloadAction[ovl.st.level]);
+    }
+}
+
+gboolean overload_getStat(OverloadStat *st){
+    *st = ovl.st;
+    return ovl.cfg.enabled;
+}
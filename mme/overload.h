@@ -0,0 +1,105 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   overload.h
+ * @brief  MME overload control towards the eNBs
+ *
+ * The load is sampled every OVERLOAD_INTERVAL_MS from four indicators: the
+ * event loop lag, the share of time blocked on HSS queries, the S11
+ * requests waiting for a response and the rate of Attach, TAU and Service
+ * Requests. The load is the highest ratio between an indicator and its
+ * threshold.
+ *
+ * When the load stays at 1 for OVERLOAD_RISE samples, every eNB receives an
+ * S1AP Overload Start with reject-non-emergency-mo-dt, at OVERLOAD_SEVERE
+ * with reject-rrc-cr-signalling. A level is left after the hold time under
+ * OVERLOAD_LOW times its threshold, one level at a time, the last step sends
+ * Overload Stop. The eNBs set up during an overload receive its Overload
+ * Start (TS 36.413 8.7.6).
+ */
+
+#ifndef OVERLOAD_HFILE
+#define OVERLOAD_HFILE
+
+#include <glib.h>
+
+#define OVERLOAD_INTERVAL_MS 250
+#define OVERLOAD_RISE        2      /**< Samples over a threshold to start*/
+#define OVERLOAD_SEVERE      1.5    /**< Load that rejects the signalling*/
+#define OVERLOAD_LOW         0.7    /**< Share of a threshold to stop*/
+
+struct mme_t;
+
+typedef enum{
+    OVERLOAD_NONE,
+    OVERLOAD_MO_DATA,       /**< reject-non-emergency-mo-dt*/
+    OVERLOAD_SIGNALLING,    /**< reject-rrc-cr-signalling*/
+}OverloadLevel;
+
+extern const char *overloadLevelName[];
+
+/**
+ * Thresholds, 0 disables an indicator*/
+typedef struct{
+    gboolean enabled;
+    guint    lagMs;         /**< Smoothed event loop lag (ms)*/
+    guint    hssShare;      /**< Time blocked on HSS queries (%)*/
+    guint    s11Pending;    /**< S11 requests without response*/
+    guint    admissionRate; /**< Attach, TAU and Service Requests per second*/
+    guint    hold;          /**< Seconds under the low watermark to stop*/
+}OverloadCfg;
+
+typedef struct{
+    OverloadLevel level;
+    gdouble       load;          /**< Load of the last sample*/
+    guint64       lagUs;
+    gdouble       hssShare;      /**< %*/
+    gint64        s11Pending;
+    guint64       admissionRate; /**< Requests per second*/
+    guint64       starts;        /**< Level changes sent as Overload Start*/
+    guint64       stops;
+}OverloadStat;
+
+/**
+ * @brief Start sampling the load
+ * @param [in] mme  MME handler, its overload configuration is used
+ */
+void overload_init(struct mme_t *mme);
+
+/**
+ * @brief Stop sampling the load
+ */
+void overload_free();
+
+/**
+ * @brief Current level
+ */
+OverloadLevel overload_getLevel();
+
+/**
+ * @brief Send the current Overload Start to a new eNB
+ * @param [in] assoc  S1 association after the S1 Setup
+ */
+void overload_newAssoc(gpointer assoc);
+
+/**
+ * @brief Load statistics
+ * @return FALSE if the overload control is disabled
+ */
+gboolean overload_getStat(OverloadStat *st);
+
+#endif /* OVERLOAD_HFILE */
@@ -0,0 +1,588 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   replica.c
+ * @brief  Hot-standby replication of the UE contexts
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/bufferevent.h>
+#include <event2/buffer.h>
+
+#include "replica.h"
+#include "snapshot.h"
+#include "MME.h"
+#include "MME_S11.h"
+#include "NAS_EMM.h"
+#include "logmgr.h"
+#include "loopprof.h"
+
+#define REPLICA_VERSION    1
+#define REPLICA_BATCH      4096         /**< UEs sent per flush*/
+#define REPLICA_MAX_QUEUED (64<<20)     /**< Bytes queued before dropping the standby*/
+#define REPLICA_RETRY      1            /**< Seconds between connection attempts*/
+#define REPLICA_CONNECT_TIMEOUT 3       /**< Seconds until a connection attempt fails*/
+#define REPLICA_CLOSE_TIMEOUT   2       /**< Seconds to write the queue when closing*/
+
+typedef enum{
+    RMSG_HELLO,     /**< Start of a full synchronization, ReplicaHello_t*/
+    RMSG_UPDATE,    /**< SnapUE_t*/
+    RMSG_REMOVE,    /**< No payload*/
+    RMSG_DROP,      /**< The active drops the standby, it has to resync. No payload*/
+}ReplicaMsgType;
+
+typedef struct{
+    guint32 type;
+    guint32 mtmsi;
+    guint32 len;    /**< Bytes following the header*/
+}ReplicaMsgHdr_t;
+
+typedef struct{
+    guint32 version;
+    guint32 recSize;
+    guint8  restartCounter;
+    guint8  pad[3];
+}ReplicaHello_t;
+
+static struct{
+    struct mme_t            *mme;
+    ReplicaRole             role;
+    struct sockaddr_storage addr;
+    socklen_t               addrLen;
+    guint                   flushMs;
+    void                    (*takeover)(gpointer mme);
+    struct evconnlistener   *listener;
+    struct bufferevent      *bev;       /**< Connection to the peer*/
+    struct bufferevent      *closing;   /**< Dropped standby, writing RMSG_DROP*/
+    struct event            *ev;        /**< Flush on the active, retry on the standby*/
+    GArray                  *dirty;     /**< Changed UEs, NULL without standby*/
+    GHashTable              *replica;   /**< Records by M-TMSI on the standby*/
+    gboolean                synced;     /**< HELLO received*/
+    gboolean                connected;  /**< Connection attempt completed*/
+    gboolean                probing;    /**< Stream lost, checking the active*/
+    guint8                  restartCounter;
+    guint64                 updates;
+    guint64                 removals;
+}repl;
+
+static gboolean replica_parseAddr(const char *addr){
+    struct sockaddr_un *un = (struct sockaddr_un *)&repl.addr;
+    struct sockaddr_in *in = (struct sockaddr_in *)&repl.addr;
+    const char *port;
+    gchar *ip;
+    gboolean ok;
+
+    memset(&repl.addr, 0, sizeof(repl.addr));
+    if(addr[0] == '/'){
+        if(strlen(addr) >= sizeof(un->sun_path)){
+            return FALSE;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, addr);
+        repl.addrLen = sizeof(struct sockaddr_un);
+        return TRUE;
+    }
+    port = strrchr(addr, ':');
+    if(!port){
+        return FALSE;
+    }
+    ip = g_strndup(addr, port-addr);
+    in->sin_family = AF_INET;
+    in->sin_port = htons(atoi(port+1));
+    ok = inet_pton(AF_INET, ip, &(in->sin_addr)) == 1;
+    g_free(ip);
+    repl.addrLen = sizeof(struct sockaddr_in);
+    /* The stream is not authenticated and carries the security contexts*/
+    if(ok && ntohl(in->sin_addr.s_addr)>>24 != 127){
+        log_msg(LOG_ERR, 0, "Replication over TCP is only allowed on the "
+                "loopback, use a Unix socket");
+        return FALSE;
+    }
+    return ok;
+}
+
+static void replica_schedule(guint ms){
+    struct timeval tv = {.tv_sec = ms/1000, .tv_usec = (ms%1000)*1000};
+    evtimer_add(repl.ev, &tv);
+}
+
+/* ======================================================================
+ * Active
+ * ====================================================================== */
+
+static void replica_send(ReplicaMsgType type, guint32 mtmsi,
+                         const void *data, guint32 len){
+    ReplicaMsgHdr_t h = {.type = type, .mtmsi = mtmsi, .len = len};
+    struct evbuffer *out = bufferevent_get_output(repl.bev);
+
+    evbuffer_add(out, &h, sizeof(h));
+    if(len){
+        evbuffer_add(out, data, len);
+    }
+}
+
+static gint cmpMTMSI(gconstpointer a, gconstpointer b){
+    guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void collectMTMSI(gpointer k, gpointer emm, gpointer data){
+    g_array_append_val(repl.dirty, *(guint32 *)k);
+}
+
+static void replica_dropStandby(){
+    bufferevent_free(repl.bev);
+    repl.bev = NULL;
+    g_array_free(repl.dirty, TRUE);
+    repl.dirty = NULL;
+    evtimer_del(repl.ev);
+}
+
+static void replica_closed(struct bufferevent *bev){
+    bufferevent_free(bev);
+    if(bev == repl.closing){
+        repl.closing = NULL;
+    }
+}
+
+static void replica_closeWrite(struct bufferevent *bev, void *ctx){
+    if(evbuffer_get_length(bufferevent_get_output(bev)) == 0){
+        replica_closed(bev);
+    }
+}
+
+static void replica_closeEvent(struct bufferevent *bev, short events,
+                               void *ctx){
+    replica_closed(bev);
+}
+
+/* Drops a connected standby on purpose. It is told to resync, so it doesn't
+ * take the drop for a lost active. The queue is written in the background,
+ * if it takes too long the standby only sees the connection closed, it
+ * reconnects and finds the active alive*/
+static void replica_resyncStandby(){
+    struct timeval tv = {REPLICA_CLOSE_TIMEOUT, 0};
+
+    if(repl.closing){
+        bufferevent_free(repl.closing);
+    }
+    replica_send(RMSG_DROP, 0, NULL, 0);
+    repl.closing = repl.bev;
+    bufferevent_setcb(repl.closing, NULL, replica_closeWrite,
+                      replica_closeEvent, NULL);
+    bufferevent_disable(repl.closing, EV_READ);
+    bufferevent_set_timeouts(repl.closing, NULL, &tv);
+
+    repl.bev = NULL;
+    g_array_free(repl.dirty, TRUE);
+    repl.dirty = NULL;
+    evtimer_del(repl.ev);
+}
+
+/* Sends the current context of up to max changed UEs*/
+static void replica_sendChanges(guint max){
+    SnapUE_t rec;
+    gpointer emm;
+    guint32 mtmsi, last = 0;
+    guint i, sent = 0;
+
+    g_array_sort(repl.dirty, cmpMTMSI);
+    for(i=0; i<repl.dirty->len && sent<max; i++){
+        mtmsi = g_array_index(repl.dirty, guint32, i);
+        if(i>0 && mtmsi == last){
+            continue;
+        }
+        last = mtmsi;
+        sent++;
+
+        mme_lookupEMMCtxt(repl.mme, mtmsi, &emm);
+        memset(&rec, 0, sizeof(SnapUE_t));
+        if(emm && emm_snapshot(emm, &rec)){
+            replica_send(RMSG_UPDATE, mtmsi, &rec, sizeof(SnapUE_t));
+            repl.updates++;
+        }else{
+            replica_send(RMSG_REMOVE, mtmsi, NULL, 0);
+            repl.removals++;
+        }
+    }
+    g_array_remove_range(repl.dirty, 0, i);
+}
+
+static void replica_flush(){
+    if(evbuffer_get_length(bufferevent_get_output(repl.bev))
+       > REPLICA_MAX_QUEUED){
+        log_msg(LOG_WARNING, 0, "The standby MME is too slow, dropping it");
+        replica_resyncStandby();
+        return;
+    }
+    replica_sendChanges(REPLICA_BATCH);
+    /* The rest of a full synchronization is sent on the next loop*/
+    replica_schedule(repl.dirty->len ? 0 : repl.flushMs);
+}
+
+static void replica_activeRead(struct bufferevent *bev, void *ctx){
+    /* The standby sends nothing*/
+    evbuffer_drain(bufferevent_get_input(bev),
+                   evbuffer_get_length(bufferevent_get_input(bev)));
+}
+
+static void replica_activeEvent(struct bufferevent *bev, short events,
+                                void *ctx){
+    if(events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)){
+        log_msg(LOG_WARNING, 0, "Standby MME disconnected");
+        replica_dropStandby();
+    }
+}
+
+static void replica_accept(struct evconnlistener *listener,
+                           evutil_socket_t fd,
+                           struct sockaddr *address,
+                           int socklen,
+                           void *ctx){
+    ReplicaHello_t hello;
+
+    if(repl.bev){
+        log_msg(LOG_WARNING, 0, "Refusing a second standby MME");
+        evutil_closesocket(fd);
+        return;
+    }
+    loopprof_enter(LP_REPLICA);
+    repl.bev = bufferevent_socket_new(evconnlistener_get_base(listener), fd,
+                                      BEV_OPT_CLOSE_ON_FREE);
+    bufferevent_setcb(repl.bev, replica_activeRead, NULL,
+                      replica_activeEvent, NULL);
+    bufferevent_enable(repl.bev, EV_READ|EV_WRITE);
+
+    memset(&hello, 0, sizeof(hello));
+    hello.version = REPLICA_VERSION;
+    hello.recSize = sizeof(SnapUE_t);
+    hello.restartCounter = getRestartCounter(mme_getS11(repl.mme));
+    replica_send(RMSG_HELLO, 0, &hello, sizeof(hello));
+
+    /* Full synchronization, then the changes*/
+    repl.dirty = g_array_new(FALSE, FALSE, sizeof(guint32));
+    mme_foreachEMMCtxt(repl.mme, collectMTMSI, NULL);
+    log_msg(LOG_NOTICE, 0, "Standby MME connected, synchronizing %u UEs",
+            repl.dirty->len);
+    replica_schedule(0);
+    loopprof_leave();
+}
+
+void replica_serve(){
+    struct sockaddr_un *un = (struct sockaddr_un *)&repl.addr;
+    mode_t mask;
+
+    if(repl.role == REPLICA_OFF){
+        return;
+    }
+    repl.role = REPLICA_ACTIVE;
+    if(repl.addr.ss_family == AF_UNIX){
+        unlink(un->sun_path);
+    }
+    /* Only the user of the MME can connect to the Unix socket*/
+    mask = umask(0177);
+    repl.listener = evconnlistener_new_bind(mme_getEventBase(repl.mme),
+                                            replica_accept, NULL,
+                                            LEV_OPT_CLOSE_ON_FREE|LEV_OPT_REUSEABLE,
+                                            -1,
+                                            (struct sockaddr *)&repl.addr,
+                                            repl.addrLen);
+    umask(mask);
+    if(!repl.listener){
+        log_msg(LOG_ERR, errno, "Couldn't open the replication socket, "
+                "no standby MME");
+        return;
+    }
+    log_msg(LOG_INFO, 0, "Waiting for a standby MME");
+}
+
+void replica_touch(guint32 mtmsi){
+    /* 0 is not allocated yet*/
+    if(repl.dirty && mtmsi){
+        g_array_append_val(repl.dirty, mtmsi);
+    }
+}
+
+/* ======================================================================
+ * Standby
+ * ====================================================================== */
+
+static void replica_connect();
+
+/* Reconnects without the replica, the active sends it again*/
+static void replica_resync(){
+    repl.synced = FALSE;
+    bufferevent_free(repl.bev);
+    repl.bev = NULL;
+    replica_schedule(REPLICA_RETRY*1000);
+}
+
+/* The stream of a synchronized active is lost. A lost connection is not
+ * enough to take over, the active may be alive. It has to refuse a new
+ * connection or not answer it*/
+static void replica_lost(){
+    bufferevent_free(repl.bev);
+    repl.bev = NULL;
+    if(repl.synced){
+        log_msg(LOG_WARNING, 0, "Connection to the active MME lost, "
+                "checking it");
+        repl.probing = TRUE;
+        replica_connect();
+    }else{
+        replica_schedule(REPLICA_RETRY*1000);
+    }
+}
+
+static void replica_connectFailed(){
+    bufferevent_free(repl.bev);
+    repl.bev = NULL;
+    if(repl.probing && repl.synced){
+        log_msg(LOG_NOTICE, 0, "Active MME unreachable, taking over with %u "
+                "UEs", g_hash_table_size(repl.replica));
+        repl.probing = FALSE;
+        repl.synced = FALSE;
+        repl.takeover(repl.mme);
+    }else{
+        replica_schedule(REPLICA_RETRY*1000);
+    }
+}
+
+static void replica_standbyRead(struct bufferevent *bev, void *ctx){
+    struct evbuffer *in = bufferevent_get_input(bev);
+    ReplicaMsgHdr_t h;
+    ReplicaHello_t hello;
+    SnapUE_t *rec;
+
+    loopprof_enter(LP_REPLICA);
+    while(evbuffer_copyout(in, &h, sizeof(h)) == sizeof(h)
+          && evbuffer_get_length(in) >= sizeof(h) + h.len){
+        evbuffer_drain(in, sizeof(h));
+        switch(h.type){
+        case RMSG_HELLO:
+            if(h.len != sizeof(ReplicaHello_t)){
+                goto err;
+            }
+            evbuffer_remove(in, &hello, sizeof(ReplicaHello_t));
+            if(hello.version != REPLICA_VERSION
+               || hello.recSize != sizeof(SnapUE_t)){
+                log_msg(LOG_ERR, 0, "Incompatible active MME");
+                goto err;
+            }
+            g_hash_table_remove_all(repl.replica);
+            repl.restartCounter = hello.restartCounter;
+            repl.synced = TRUE;
+            log_msg(LOG_NOTICE, 0, "Synchronizing with the active MME");
+            break;
+        case RMSG_UPDATE:
+            if(!repl.synced || h.len != sizeof(SnapUE_t)){
+                goto err;
+            }
+            rec = g_hash_table_lookup(repl.replica, GUINT_TO_POINTER(h.mtmsi));
+            if(!rec){
+                rec = g_new(SnapUE_t, 1);
+                g_hash_table_insert(repl.replica, GUINT_TO_POINTER(h.mtmsi),
+                                    rec);
+            }
+            evbuffer_remove(in, rec, sizeof(SnapUE_t));
+            repl.updates++;
+            break;
+        case RMSG_REMOVE:
+            evbuffer_drain(in, h.len);
+            g_hash_table_remove(repl.replica, GUINT_TO_POINTER(h.mtmsi));
+            repl.removals++;
+            break;
+        case RMSG_DROP:
+            log_msg(LOG_WARNING, 0, "Dropped by the active MME, "
+                    "synchronizing again");
+            replica_resync();
+            loopprof_leave();
+            return;
+        default:
+            goto err;
+        }
+    }
+    loopprof_leave();
+    return;
+
+ err:
+    log_msg(LOG_ERR, 0, "Wrong message %u on the replication stream, "
+            "reconnecting", h.type);
+    replica_resync();
+    loopprof_leave();
+}
+
+static void replica_standbyEvent(struct bufferevent *bev, short events,
+                                 void *ctx){
+    if(events & BEV_EVENT_CONNECTED){
+        log_msg(LOG_INFO, 0, "Connected to the active MME");
+        repl.connected = TRUE;
+        repl.probing = FALSE;
+        bufferevent_set_timeouts(bev, NULL, NULL);
+    }else if(!(events & (BEV_EVENT_EOF | BEV_EVENT_ERROR | BEV_EVENT_TIMEOUT))){
+        return;
+    }else if(repl.connected){
+        replica_lost();
+    }else{
+        replica_connectFailed();
+    }
+}
+
+static void replica_connect(){
+    struct timeval tv = {REPLICA_CONNECT_TIMEOUT, 0};
+
+    repl.connected = FALSE;
+    repl.bev = bufferevent_socket_new(mme_getEventBase(repl.mme), -1,
+                                      BEV_OPT_CLOSE_ON_FREE);
+    bufferevent_setcb(repl.bev, replica_standbyRead, NULL,
+                      replica_standbyEvent, NULL);
+    bufferevent_set_timeouts(repl.bev, NULL, &tv);
+    bufferevent_enable(repl.bev, EV_READ);
+    if(bufferevent_socket_connect(repl.bev, (struct sockaddr *)&repl.addr,
+                                  repl.addrLen) < 0){
+        replica_connectFailed();
+    }
+}
+
+gboolean replica_restore(){
+    GHashTableIter iter;
+    gpointer v;
+    SnapUE_t *rec;
+    guint n;
+
+    if(!repl.replica || g_hash_table_size(repl.replica) == 0){
+        return FALSE;
+    }
+    S11_keepRestartCounter(mme_getS11(repl.mme), repl.restartCounter);
+    g_hash_table_iter_init(&iter, repl.replica);
+    while(g_hash_table_iter_next(&iter, NULL, &v)){
+        rec = (SnapUE_t *)v;
+        emm_restore(repl.mme, mme_getTimerMgr(repl.mme), rec);
+        mme_reserveTeid(rec->session.lTEID);
+    }
+    n = g_hash_table_size(repl.replica);
+    log_msg(LOG_NOTICE, 0, "Restored %u UEs from the replica", n);
+    g_hash_table_remove_all(repl.replica);
+    return n > 0;
+}
+
+/* ======================================================================*/
+
+static void replica_timer(evutil_socket_t fd, short event, void *arg){
+    loopprof_enter(LP_REPLICA);
+    if(repl.role == REPLICA_STANDBY){
+        replica_connect();
+    }else if(repl.bev){
+        replica_flush();
+    }
+    loopprof_leave();
+}
+
+gboolean replica_init(gpointer mme, ReplicaRole role, const char *addr,
+                      guint flushMs, void (*takeover)(gpointer mme)){
+    memset(&repl, 0, sizeof(repl));
+    if(role == REPLICA_OFF){
+        return TRUE;
+    }
+    if(!replica_parseAddr(addr)){
+        log_msg(LOG_ERR, 0, "Wrong replication address %s", addr);
+        return FALSE;
+    }
+    repl.role = role;
+    repl.mme = (struct mme_t *)mme;
+    repl.flushMs = flushMs;
+    repl.takeover = takeover;
+    repl.ev = evtimer_new(mme_getEventBase(repl.mme), replica_timer, NULL);
+
+    if(role == REPLICA_STANDBY){
+        repl.replica = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, g_free);
+        log_msg(LOG_NOTICE, 0, "Standby MME, connecting to %s", addr);
+        replica_connect();
+    }
+    return TRUE;
+}
+
+void replica_free(){
+    struct evbuffer *out;
+    struct pollfd pfd;
+    gint64 deadline;
+    gint left;
+
+    if(repl.role == REPLICA_OFF){
+        return;
+    }
+    if(repl.role == REPLICA_ACTIVE && repl.bev){
+        /* The pending changes are written before closing*/
+        while(repl.dirty->len){
+            replica_sendChanges(G_MAXUINT);
+        }
+        out = bufferevent_get_output(repl.bev);
+        pfd.fd = bufferevent_getfd(repl.bev);
+        pfd.events = POLLOUT;
+        deadline = g_get_monotonic_time() + REPLICA_CLOSE_TIMEOUT*G_USEC_PER_SEC;
+        while(evbuffer_get_length(out)){
+            left = (deadline - g_get_monotonic_time())/1000;
+            if(left <= 0 || poll(&pfd, 1, left) <= 0
+               || (evbuffer_write(out, pfd.fd) < 0 && errno != EAGAIN)){
+                log_msg(LOG_WARNING, 0, "Closing the replication with %zu "
+                        "bytes unsent", evbuffer_get_length(out));
+                break;
+            }
+        }
+        replica_dropStandby();
+    }
+    if(repl.closing){
+        bufferevent_free(repl.closing);
+    }
+    if(repl.bev){
+        bufferevent_free(repl.bev);
+    }
+    if(repl.listener){
+        evconnlistener_free(repl.listener);
+    }
+    if(repl.replica){
+        g_hash_table_destroy(repl.replica);
+    }
+    event_free(repl.ev);
+    memset(&repl, 0, sizeof(repl));
+}
+
+void replica_getStat(ReplicaStat *st){
+    memset(st, 0, sizeof(ReplicaStat));
+    st->role = repl.role;
+    st->updates = repl.updates;
+    st->removals = repl.removals;
+    if(repl.role == REPLICA_STANDBY){
+        st->connected = repl.synced;
+        st->ues = g_hash_table_size(repl.replica);
+    }else if(repl.bev){
+        st->connected = TRUE;
+        st->queued = evbuffer_get_length(bufferevent_get_output(repl.bev));
+    }
+}
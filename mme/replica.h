@@ -0,0 +1,114 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   replica.h
+ * @brief  Hot-standby replication of the UE contexts
+ *
+ * The active MME streams the changes of its UE contexts to a standby MME
+ * over a Unix socket or TCP. The standby keeps the records in memory and does
+ * not open its interfaces. When the stream of a synchronized active is lost,
+ * the standby connects again to check it. Only if the active refuses or
+ * doesn't answer the connection the standby takes over: it opens the
+ * interfaces, restores the UEs ECM-IDLE and waits for a new standby itself.
+ *
+ * The active drops a standby that is too slow. It is told to synchronize
+ * again before the connection is closed, so the dropped standby doesn't take
+ * over while the active is alive. A second standby is refused.
+ *
+ * The stream is not authenticated and carries the security contexts of the
+ * UEs. The supported transport is a Unix socket, created with mode 0600. TCP
+ * is only allowed on the loopback.
+ *
+ * The UE code only appends the M-TMSI of the changed UEs to an array, only
+ * while a standby is connected. The array is coalesced periodically and the
+ * current context of each UE is sent once as a snapshot record, see
+ * snapshot.h. A UE that is gone or can't be saved is sent as removed.
+ *
+ * The stream uses the host byte order, both processes run the same build.
+ */
+
+#ifndef REPLICA_HFILE
+#define REPLICA_HFILE
+
+#include <glib.h>
+
+typedef enum{
+    REPLICA_OFF,
+    REPLICA_ACTIVE,
+    REPLICA_STANDBY,
+}ReplicaRole;
+
+typedef struct{
+    ReplicaRole role;
+    gboolean    connected;  /**< Standby connected or active synchronized*/
+    guint       ues;        /**< UEs on the standby replica*/
+    guint64     updates;    /**< Records sent or received*/
+    guint64     removals;
+    gsize       queued;     /**< Bytes waiting to be sent*/
+}ReplicaStat;
+
+/**
+ * @brief Start the replication
+ * @param [in] mme       MME handler
+ * @param [in] role      Role on start
+ * @param [in] addr      Unix socket path if it starts with '/', "ip:port" on
+ *                       the loopback otherwise
+ * @param [in] flushMs   Period of the updates sent to the standby (ms)
+ * @param [in] takeover  Called when a standby has to become active
+ * @return FALSE on wrong or non loopback address
+ *
+ * The active starts listening with replica_serve, once its interfaces are
+ * open. The standby connects to the active and retries until it succeeds.
+ */
+gboolean replica_init(gpointer mme, ReplicaRole role, const char *addr,
+                      guint flushMs, void (*takeover)(gpointer mme));
+
+/**
+ * @brief Close the replication
+ */
+void replica_free();
+
+/**
+ * @brief Listen for a standby
+ *
+ * Called when the interfaces are open, on start or after a takeover.
+ */
+void replica_serve();
+
+/**
+ * @brief Restore the replica after a takeover
+ *
+ * Called after the S11 initialization, before S1. The UEs are restored
+ * ECM-IDLE and the S11 restart counter of the old active is kept.
+ * @return TRUE if UEs were restored, the snapshot is not loaded then
+ */
+gboolean replica_restore();
+
+/**
+ * @brief Mark a UE as changed
+ * @param [in] mtmsi M-TMSI of the UE
+ *
+ * Only appends to an array while a standby is connected.
+ */
+void replica_touch(guint32 mtmsi);
+
+/**
+ * @brief Replication counters for the command shell
+ */
+void replica_getStat(ReplicaStat *st);
+
+#endif /* REPLICA_HFILE */
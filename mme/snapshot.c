@@ -0,0 +1,402 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   snapshot.c
+ * @brief  UE context snapshots for a fast restart
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <event2/event.h>
+
+#include "snapshot.h"
+#include "MME.h"
+#include "MME_S11.h"
+#include "NAS_EMM.h"
+#include "logmgr.h"
+
+#define SNAPSHOT_MAGIC    0x534e4150    /**< "SNAP"*/
+#define SNAPSHOT_VERSION  1
+#define SNAPSHOT_BATCH    1024          /**< UEs saved per callback*/
+#define SNAPSHOT_GROW     1024          /**< Minimum slots added to the file*/
+
+typedef struct{
+    guint32 magic;
+    guint16 version;
+    guint16 recSize;        /**< sizeof(SnapUE_t)*/
+    guint32 slots;          /**< Slots in the file*/
+    guint32 count;          /**< UEs saved on the last complete pass*/
+    guint8  restartCounter; /**< S11 restart counter of the saved sessions*/
+    guint8  pad[7];
+    guint64 updated;        /**< Time of the last complete pass (s)*/
+}SnapHdr_t;
+
+static struct{
+    struct mme_t *mme;
+    gchar        *path;
+    int          fd;
+    guint8       *map;
+    gsize        mapLen;
+    guint32      slots;
+    GHashTable   *byMTMSI;  /**< Slot of each saved UE*/
+    GArray       *gen;      /**< Pass of the last save of each slot, 0 free*/
+    GArray       *free;     /**< Free slots*/
+    GArray       *pending;  /**< M-TMSI of the UEs left on the running pass*/
+    guint        next;      /**< Next UE of pending*/
+    guint32      pass;
+    guint        count;     /**< UEs saved on the running pass*/
+    guint        lastCount;
+    guint        interval;
+    struct event *ev;
+}snap;
+
+static SnapHdr_t *snapshot_hdr(){
+    return (SnapHdr_t *)snap.map;
+}
+
+static SnapUE_t *snapshot_slot(guint32 i){
+    return (SnapUE_t *)(snap.map + sizeof(SnapHdr_t) + i*sizeof(SnapUE_t));
+}
+
+/* FNV-1a of the record after the check field*/
+static guint32 snapshot_check(const SnapUE_t *rec){
+    const guint8 *p = (const guint8 *)&(rec->emm);
+    const guint8 *end = (const guint8 *)(rec + 1);
+    guint32 h = 2166136261u;
+
+    for(; p<end; p++){
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static gboolean snapshot_map(guint32 slots){
+    gsize len = sizeof(SnapHdr_t) + (gsize)slots*sizeof(SnapUE_t);
+
+    if(snap.map){
+        munmap(snap.map, snap.mapLen);
+        snap.map = NULL;
+    }
+    if(ftruncate(snap.fd, len) == -1){
+        log_msg(LOG_ERR, errno, "Couldn't resize %s", snap.path);
+        return FALSE;
+    }
+    snap.map = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, snap.fd, 0);
+    if(snap.map == MAP_FAILED){
+        log_msg(LOG_ERR, errno, "Couldn't map %s", snap.path);
+        snap.map = NULL;
+        return FALSE;
+    }
+    snap.mapLen = len;
+    snapshot_hdr()->slots = slots;
+    snap.slots = slots;
+    g_array_set_size(snap.gen, slots);
+    return TRUE;
+}
+
+/* Pushed in reverse so the file is filled from the start*/
+static void snapshot_addFree(guint32 from, guint32 to){
+    guint32 i, slot;
+
+    for(i=to; i>from; i--){
+        slot = i-1;
+        g_array_append_val(snap.free, slot);
+    }
+}
+
+static gboolean snapshot_reset(){
+    SnapHdr_t *hdr;
+
+    snap.slots = 0;
+    g_array_set_size(snap.gen, 0);
+    g_array_set_size(snap.free, 0);
+    if(!snapshot_map(SNAPSHOT_GROW)){
+        return FALSE;
+    }
+    memset(snap.map, 0, snap.mapLen);
+    hdr = snapshot_hdr();
+    hdr->magic = SNAPSHOT_MAGIC;
+    hdr->version = SNAPSHOT_VERSION;
+    hdr->recSize = sizeof(SnapUE_t);
+    hdr->slots = snap.slots;
+    hdr->restartCounter = getRestartCounter(mme_getS11(snap.mme));
+    snapshot_addFree(0, snap.slots);
+    return TRUE;
+}
+
+static gboolean snapshot_newSlot(guint32 *slot){
+    guint32 old = snap.slots;
+
+    if(snap.free->len == 0){
+        if(!snapshot_map(old + MAX(old, SNAPSHOT_GROW))){
+            return FALSE;
+        }
+        snapshot_addFree(old, snap.slots);
+    }
+    *slot = g_array_index(snap.free, guint32, snap.free->len-1);
+    g_array_set_size(snap.free, snap.free->len-1);
+    return TRUE;
+}
+
+static void snapshot_freeSlot(guint32 i){
+    SnapUE_t *rec = snapshot_slot(i);
+
+    g_hash_table_remove(snap.byMTMSI, GUINT_TO_POINTER(rec->emm.guti.mtmsi));
+    rec->magic = 0;
+    g_array_index(snap.gen, guint32, i) = 0;
+    g_array_append_val(snap.free, i);
+}
+
+static void snapshot_load(){
+    SnapHdr_t *hdr;
+    SnapUE_t *rec;
+    struct stat st;
+    gpointer emm;
+    guint32 i, slots;
+    guint restored = 0;
+
+    if(fstat(snap.fd, &st) == -1 || (gsize)st.st_size < sizeof(SnapHdr_t)){
+        snapshot_reset();
+        return;
+    }
+    hdr = mmap(NULL, sizeof(SnapHdr_t), PROT_READ, MAP_SHARED, snap.fd, 0);
+    if(hdr == MAP_FAILED){
+        log_msg(LOG_ERR, errno, "Couldn't map %s", snap.path);
+        snapshot_reset();
+        return;
+    }
+    slots = hdr->slots;
+    if(hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION
+       || hdr->recSize != sizeof(SnapUE_t)
+       || (gsize)st.st_size < sizeof(SnapHdr_t) + (gsize)slots*sizeof(SnapUE_t)){
+        log_msg(LOG_WARNING, 0, "Ignoring the incompatible snapshot %s",
+                snap.path);
+        munmap(hdr, sizeof(SnapHdr_t));
+        snapshot_reset();
+        return;
+    }
+    munmap(hdr, sizeof(SnapHdr_t));
+    if(!snapshot_map(slots)){
+        return;
+    }
+    hdr = snapshot_hdr();
+
+    snap.pass = 1;
+    for(i=slots; i>0; i--){
+        rec = snapshot_slot(i-1);
+        emm = NULL;
+        if(rec->magic == SNAPSHOT_REC_MAGIC
+           && rec->check == snapshot_check(rec)){
+            mme_lookupEMMCtxt(snap.mme, rec->emm.guti.mtmsi, &emm);
+            if(emm){
+                log_msg(LOG_WARNING, 0, "Duplicated M-TMSI %.8x on the "
+                        "snapshot", rec->emm.guti.mtmsi);
+            }else{
+                if(restored == 0){
+                    S11_keepRestartCounter(mme_getS11(snap.mme),
+                                           hdr->restartCounter);
+                }
+                emm_restore(snap.mme, mme_getTimerMgr(snap.mme), rec);
+                mme_reserveTeid(rec->session.lTEID);
+                g_hash_table_insert(snap.byMTMSI,
+                                    GUINT_TO_POINTER(rec->emm.guti.mtmsi),
+                                    GUINT_TO_POINTER(i-1));
+                g_array_index(snap.gen, guint32, i-1) = snap.pass;
+                restored++;
+                continue;
+            }
+        }
+        rec->magic = 0;
+        snapshot_addFree(i-1, i);
+    }
+    hdr->restartCounter = getRestartCounter(mme_getS11(snap.mme));
+    snap.lastCount = restored;
+    log_msg(LOG_NOTICE, 0, "Restored %u UEs from %s", restored, snap.path);
+}
+
+static void snapshot_saveUE(guint32 mtmsi){
+    SnapUE_t rec, *slot;
+    gpointer emm, v;
+    guint32 i;
+
+    mme_lookupEMMCtxt(snap.mme, mtmsi, &emm);
+    if(!emm){
+        return;
+    }
+    /* Zeroed so the padding does not change the record*/
+    memset(&rec, 0, sizeof(SnapUE_t));
+    if(!emm_snapshot(emm, &rec)){
+        return;
+    }
+    rec.magic = SNAPSHOT_REC_MAGIC;
+    rec.check = snapshot_check(&rec);
+
+    if(g_hash_table_lookup_extended(snap.byMTMSI, GUINT_TO_POINTER(mtmsi),
+                                    NULL, &v)){
+        i = GPOINTER_TO_UINT(v);
+    }else{
+        if(!snapshot_newSlot(&i)){
+            return;
+        }
+        g_hash_table_insert(snap.byMTMSI, GUINT_TO_POINTER(mtmsi),
+                            GUINT_TO_POINTER(i));
+    }
+    g_array_index(snap.gen, guint32, i) = snap.pass;
+    snap.count++;
+
+    /* Only the changed records dirty their pages*/
+    slot = snapshot_slot(i);
+    if(memcmp(slot, &rec, sizeof(SnapUE_t)) != 0){
+        memcpy(slot, &rec, sizeof(SnapUE_t));
+    }
+}
+
+static void collectMTMSI(gpointer k, gpointer emm, gpointer data){
+    g_array_append_val(snap.pending, *(guint32 *)k);
+}
+
+static void snapshot_startPass(){
+    snap.pass++;
+    snap.count = 0;
+    snap.next = 0;
+    g_array_set_size(snap.pending, 0);
+    mme_foreachEMMCtxt(snap.mme, collectMTMSI, NULL);
+}
+
+static void snapshot_endPass(){
+    SnapHdr_t *hdr = snapshot_hdr();
+    guint32 i, g;
+
+    for(i=0; i<snap.slots; i++){
+        g = g_array_index(snap.gen, guint32, i);
+        if(g != 0 && g != snap.pass){
+            snapshot_freeSlot(i);
+        }
+    }
+    hdr->count = snap.count;
+    hdr->restartCounter = getRestartCounter(mme_getS11(snap.mme));
+    hdr->updated = g_get_real_time()/G_USEC_PER_SEC;
+    snap.lastCount = snap.count;
+    g_array_set_size(snap.pending, 0);
+    snap.next = 0;
+    log_msg(LOG_DEBUG, 0, "Snapshot pass saved %u UEs", snap.count);
+}
+
+/* Saves up to max UEs of the running pass, returns TRUE when it is done*/
+static gboolean snapshot_runBatch(guint max){
+    guint end = snap.pending->len;
+
+    if(end - snap.next > max){
+        end = snap.next + max;
+    }
+
+    for(; snap.next<end; snap.next++){
+        snapshot_saveUE(g_array_index(snap.pending, guint32, snap.next));
+    }
+    if(snap.next < snap.pending->len){
+        return FALSE;
+    }
+    snapshot_endPass();
+    return TRUE;
+}
+
+static void snapshot_cb(evutil_socket_t fd, short event, void *arg){
+    const struct timeval now = {0, 0};
+    struct timeval tv = {snap.interval, 0};
+
+    if(snap.pending->len == 0){
+        snapshot_startPass();
+    }
+    if(snapshot_runBatch(SNAPSHOT_BATCH)){
+        evtimer_add(snap.ev, &tv);
+    }else{
+        /* Let the event loop run before the next batch*/
+        evtimer_add(snap.ev, &now);
+    }
+}
+
+void snapshot_init(gpointer mme, const char *dir, guint interval,
+                   gboolean load){
+    struct timeval tv = {interval, 0};
+
+    if(interval == 0){
+        return;
+    }
+    snap.mme = (struct mme_t *)mme;
+    snap.interval = interval;
+    snap.path = g_strdup_printf("%s/%s", dir, SNAPSHOT_FILE);
+    snap.byMTMSI = g_hash_table_new(g_direct_hash, g_direct_equal);
+    snap.gen = g_array_new(FALSE, TRUE, sizeof(guint32));
+    snap.free = g_array_new(FALSE, FALSE, sizeof(guint32));
+    snap.pending = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    /* The records hold the security contexts, only the MME reads them*/
+    snap.fd = open(snap.path, O_RDWR | O_CREAT, 0600);
+    if(snap.fd == -1 || fchmod(snap.fd, 0600) == -1){
+        log_msg(LOG_ERR, errno, "Couldn't open %s, snapshots disabled",
+                snap.path);
+        snapshot_free();
+        return;
+    }
+    if(load){
+        snapshot_load();
+    }else{
+        snapshot_reset();
+    }
+    if(!snap.map){
+        snapshot_free();
+        return;
+    }
+
+    snap.ev = evtimer_new(mme_getEventBase(snap.mme), snapshot_cb, NULL);
+    evtimer_add(snap.ev, &tv);
+}
+
+void snapshot_free(){
+    if(snap.map){
+        if(snap.pending->len == 0){
+            snapshot_startPass();
+        }
+        snapshot_runBatch(G_MAXUINT);
+        munmap(snap.map, snap.mapLen);
+    }
+    if(snap.ev){
+        event_free(snap.ev);
+    }
+    /* The fd is only valid once the path is set*/
+    if(snap.path && snap.fd >= 0){
+        close(snap.fd);
+    }
+    if(snap.byMTMSI){
+        g_hash_table_destroy(snap.byMTMSI);
+        g_array_free(snap.gen, TRUE);
+        g_array_free(snap.free, TRUE);
+        g_array_free(snap.pending, TRUE);
+    }
+    g_free(snap.path);
+    memset(&snap, 0, sizeof(snap));
+}
+
+guint snapshot_getCount(){
+    return snap.lastCount;
+}
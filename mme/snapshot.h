@@ -0,0 +1,155 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   snapshot.h
+ * @brief  UE context snapshots for a fast restart
+ *
+ * The registered UEs are saved on <state_directory>/ue-snapshot so they can
+ * be restored when the MME starts, before the S1 interface is opened. The
+ * UEs are restored ECM-IDLE and resume with a Service Request or a TAU, the
+ * S-GW keeps their sessions because the S11 restart counter is kept too.
+ *
+ * The file is a header followed by fixed size slots, one UE per slot, and is
+ * accessed through a shared mapping. A pass over the UEs is split in batches
+ * run from the event loop. Each UE record is built and only copied to its slot
+ * when it differs from the stored one, so the kernel only writes back the
+ * pages of the UEs that changed. The slots of the UEs that are gone are freed
+ * at the end of the pass. Each slot has a checksum, the slots left half
+ * written by a crash are ignored when loading. A complete pass is run when
+ * the MME is stopped.
+ *
+ * A UE is saved in EMM-Registered with one PDN connection whose S11 session
+ * is established, the only case the ESM handles.
+ */
+
+#ifndef SNAPSHOT_HFILE
+#define SNAPSHOT_HFILE
+
+#include <glib.h>
+#include <sys/socket.h>
+
+#include "NAS_Definitions.h"
+#include "gtp.h"
+
+#define SNAPSHOT_FILE "ue-snapshot"
+
+#define SNAPSHOT_REC_MAGIC    0x55450001
+
+/**
+ * Downlink NAS COUNT values skipped on a restored UE. The messages sent after
+ * the last pass are not saved.*/
+#define SNAPSHOT_COUNT_MARGIN 32
+
+/**
+ * EMM context, see EMMCtx_t*/
+typedef struct{
+    guint64          imsi;
+    guint64          msisdn;
+    guint64          imeisv;
+    guti_t           guti;
+    guint8           sn[3];
+    guint16          tac;
+    guint8           t3412;
+    guint8           ksi;
+    guint8           eia;
+    guint8           eea;
+    guint8           kasme[32];
+    guint32          nasCount[2];    /**< Next NAS COUNT, uplink and downlink*/
+    guint32          nasUlCountForSC;
+    guint8           drx[2];
+    guint8           ueCapabilitiesLen;
+    guint8           ueCapabilities[15];
+    guint8           msNetCapLen;
+    guint8           msNetCap[10];
+    struct sockaddr  sgwIP;
+    guint32          sgwIPLen;
+    struct sockaddr  pgwIP;
+    guint32          pgwIPLen;
+}SnapEMM_t;
+
+/**
+ * Subscription and its PDN context, see Subscription.c*/
+typedef struct{
+    guint64          msisdn;
+    guint64          imeisv;
+    guint64          ambr_ul;
+    guint64          ambr_dl;
+    guint32          access_restriction_data;
+    guint8           network_access_mode;
+    guint8           pdn_addr_type;
+    guint8           pdn_addr[20];
+    guint32          ctx_id;
+    guint32          apn_ambr_dl;
+    guint32          apn_ambr_ul;
+    guint16          charging_characteristics;
+    guint8           qci;
+    guint8           arp_level;
+    guint8           arp_flags;      /**< bit 0 capability, bit 1 vulnerability*/
+    guint8           pgw_allocation_type;
+    guint8           vplmn_dynamic_address_allowed;
+    gchar            apn[101];
+}SnapSubs_t;
+
+/**
+ * EPS session with its default bearer and S11 session*/
+typedef struct{
+    guint8           next_ebi;
+    guint8           ebi;
+    guint8           pdn_addr_type;
+    guint8           pdn_addr[20];
+    struct fteid_t   s1u_sgw;
+    struct fteid_t   s5s8u_pgw;
+    guint32          lTEID;          /**< MME S11 TEID*/
+    guint32          rTEID;          /**< S-GW S11 TEID*/
+    struct sockaddr  rAddr;
+    guint32          rAddrLen;
+    struct fteid_t   s5s8;           /**< PGW S5/S8 control plane F-TEID*/
+    guint8           connected;      /**< S-GW has the eNB F-TEID*/
+}SnapSession_t;
+
+typedef struct{
+    guint32          magic;          /**< SNAPSHOT_REC_MAGIC, 0 if free*/
+    guint32          check;          /**< Checksum of the rest of the record*/
+    SnapEMM_t        emm;
+    SnapSubs_t       subs;
+    SnapSession_t    session;
+}SnapUE_t;
+
+/**
+ * @brief Load the snapshot and start the periodic passes
+ * @param [in] mme       MME handler, S11 must be initialized
+ * @param [in] dir       Directory of the snapshot file
+ * @param [in] interval  Seconds between passes, 0 disables the snapshots
+ * @param [in] load      Restore the UEs of an existing snapshot, the file is
+ *                       cleared otherwise
+ */
+void snapshot_init(gpointer mme, const char *dir, guint interval,
+                   gboolean load);
+
+/**
+ * @brief Complete a last pass and close the file
+ *
+ * Called before the S11 interface is freed.
+ */
+void snapshot_free();
+
+/**
+ * @brief Number of UEs saved in the last complete pass
+ */
+guint snapshot_getCount();
+
+#endif /* SNAPSHOT_HFILE */
@@ -0,0 +1,117 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tmsi.c
+ * @brief  M-TMSI allocation
+ */
+
+#include "tmsi.h"
+#include "rng.h"
+
+#include <string.h>
+
+static struct{
+    GHashTable  *gen[2];         /**< Released M-TMSIs, current and previous*/
+    gint64      genStart;        /**< Start of the current generation (us)*/
+    guint64     allocated;
+    guint64     discarded;
+}tmsi;
+
+/* Drop the generations older than TMSI_QUARANTINE/2 seconds*/
+static void tmsi_age(){
+    gint64 now = g_get_monotonic_time();
+    gint64 half = (gint64)TMSI_QUARANTINE*G_USEC_PER_SEC/2;
+    GHashTable *t;
+
+    if(!tmsi.gen[0]){
+        tmsi.gen[0] = g_hash_table_new(NULL, NULL);
+        tmsi.gen[1] = g_hash_table_new(NULL, NULL);
+        tmsi.genStart = now;
+        return;
+    }
+    if(now - tmsi.genStart < half
+       && g_hash_table_size(tmsi.gen[0]) < TMSI_QUARANTINE_MAX){
+        return;
+    }
+    if(now - tmsi.genStart >= 2*half){
+        g_hash_table_remove_all(tmsi.gen[0]);
+    }
+    t = tmsi.gen[1];
+    g_hash_table_remove_all(t);
+    tmsi.gen[1] = tmsi.gen[0];
+    tmsi.gen[0] = t;
+    tmsi.genStart = now;
+}
+
+static gboolean tmsi_isQuarantined(guint32 mtmsi){
+    return g_hash_table_contains(tmsi.gen[0], GUINT_TO_POINTER(mtmsi))
+        || g_hash_table_contains(tmsi.gen[1], GUINT_TO_POINTER(mtmsi));
+}
+
+guint32 tmsi_new(struct mme_t *mme){
+    guint32 mtmsi;
+    gpointer emm;
+
+    tmsi_age();
+    /* The registered and quarantined M-TMSIs are a tiny share of the space,
+     * a retry is rare*/
+    while(TRUE){
+        mtmsi = rng_u32();
+        if(mtmsi == 0 || mtmsi == 0xFFFFFFFF || tmsi_isQuarantined(mtmsi)){
+            tmsi.discarded++;
+            continue;
+        }
+        mme_lookupEMMCtxt(mme, mtmsi, &emm);
+        if(emm){
+            tmsi.discarded++;
+            continue;
+        }
+        break;
+    }
+    tmsi.allocated++;
+    return mtmsi;
+}
+
+void tmsi_release(guint32 mtmsi){
+    if(mtmsi == 0){
+        return;
+    }
+    tmsi_age();
+    if(tmsi_isQuarantined(mtmsi)){
+        return;
+    }
+    g_hash_table_add(tmsi.gen[0], GUINT_TO_POINTER(mtmsi));
+}
+
+void tmsi_free(){
+    if(tmsi.gen[0]){
+        g_hash_table_destroy(tmsi.gen[0]);
+        g_hash_table_destroy(tmsi.gen[1]);
+    }
+    memset(&tmsi, 0, sizeof(tmsi));
+}
+
+void tmsi_getStat(TmsiStat *st){
+    st->allocated = tmsi.allocated;
+    st->discarded = tmsi.discarded;
+    st->quarantined = 0;
+    if(tmsi.gen[0]){
+        st->quarantined = g_hash_table_size(tmsi.gen[0])
+            + g_hash_table_size(tmsi.gen[1]);
+    }
+}
@@ -0,0 +1,71 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   tmsi.h
+ * @brief  M-TMSI allocation
+ *
+ * The M-TMSIs are drawn from the random number generator, see rng.h, so the
+ * values can't be predicted nor linked to the IMSI. A value is discarded when
+ * it is already registered on the EMM index or was released recently. The
+ * released M-TMSIs are kept in two generations of TMSI_QUARANTINE/2 seconds
+ * each, a paging or a Service Request with a stale S-TMSI doesn't reach a
+ * different UE.
+ *
+ * The cost is constant per allocation, the oldest generation is dropped at
+ * once.
+ */
+
+#ifndef TMSI_HFILE
+#define TMSI_HFILE
+
+#include <glib.h>
+
+#include "MME.h"
+
+/** Seconds a released M-TMSI is not allocated again, at least half of it*/
+#define TMSI_QUARANTINE      600
+
+/** Released M-TMSIs on a generation, the generation is closed earlier when full*/
+#define TMSI_QUARANTINE_MAX  (1<<20)
+
+typedef struct{
+    guint64 allocated;
+    guint64 discarded;      /**< Values in use or quarantined*/
+    guint   quarantined;
+}TmsiStat;
+
+/**
+ * @brief Allocate a new M-TMSI
+ * @param [in] mme MME handler, its EMM index is checked
+ * @return M-TMSI, never 0 nor 0xFFFFFFFF
+ */
+guint32 tmsi_new(struct mme_t *mme);
+
+/**
+ * @brief Put a released M-TMSI in quarantine
+ * @param [in] mtmsi M-TMSI removed from the EMM index
+ */
+void tmsi_release(guint32 mtmsi);
+
+/**
+ * @brief Free the quarantine
+ */
+void tmsi_free();
+
+void tmsi_getStat(TmsiStat *st);
+
+#endif /* TMSI_HFILE */
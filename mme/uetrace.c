@@ -0,0 +1,225 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   uetrace.c
+ * @brief  Per UE signalling trace
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+
+#include "uetrace.h"
+#include "logmgr.h"
+
+#define PCAP_MAGIC              0xa1b2c3d4
+#define LINKTYPE_UPPER_PDU      252     /**< Wireshark exported PDU*/
+#define EXP_PDU_TAG_END_OF_OPT  0
+#define EXP_PDU_TAG_PROTO_NAME  12
+
+typedef struct{
+    guint32 magic;
+    guint16 major;
+    guint16 minor;
+    gint32  thiszone;
+    guint32 sigfigs;
+    guint32 snaplen;
+    guint32 linktype;
+}PcapHdr_t;
+
+typedef struct{
+    guint32 sec;
+    guint32 usec;
+    guint32 caplen;
+    guint32 len;
+}PcapRecHdr_t;
+
+typedef struct{
+    UETraceKey key;
+    guint64    id;
+    FILE       *f;
+    gboolean   active;
+    guint      ref;
+    guint64    packets;
+}UETrace_t;
+
+/** Dissector names, padded to 4 bytes as required by the exported PDU tags*/
+static const char protoName[][8] = {"s1ap", "nas-eps", "gtpv2"};
+
+static struct{
+    gchar      *dir;
+    GHashTable *byIMSI;
+    GHashTable *byMTMSI;
+}uetrace;
+
+static void uetrace_release(UETrace_t *self){
+    self->active = FALSE;
+    if(self->f){
+        fclose(self->f);
+        self->f = NULL;
+    }
+    uetrace_unref(self);
+}
+
+void uetrace_init(const char *dir){
+    uetrace.dir = g_strdup(dir);
+    uetrace.byIMSI = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                           (GDestroyNotify)uetrace_release);
+    uetrace.byMTMSI = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                            (GDestroyNotify)uetrace_release);
+}
+
+void uetrace_free(){
+    g_hash_table_destroy(uetrace.byIMSI);
+    g_hash_table_destroy(uetrace.byMTMSI);
+    g_free(uetrace.dir);
+}
+
+static GHashTable *uetrace_table(UETraceKey key){
+    return key == UETRACE_IMSI ? uetrace.byIMSI : uetrace.byMTMSI;
+}
+
+gboolean uetrace_start(UETraceKey key, guint64 id){
+    UETrace_t *self;
+    PcapHdr_t hdr;
+    gchar *path;
+
+    if(g_hash_table_contains(uetrace_table(key), &id)){
+        return FALSE;
+    }
+
+    if(key == UETRACE_IMSI){
+        path = g_strdup_printf("%s/ue-%" G_GUINT64_FORMAT ".pcap",
+                               uetrace.dir, id);
+    }else{
+        path = g_strdup_printf("%s/ue-tmsi-%.8x.pcap",
+                               uetrace.dir, (guint32)id);
+    }
+
+    self = g_new0(UETrace_t, 1);
+    self->key = key;
+    self->id = id;
+    self->ref = 1;
+    self->f = fopen(path, "w");
+    if(!self->f){
+        log_msg(LOG_ERR, errno, "Couldn't create UE trace %s", path);
+        g_free(path);
+        g_free(self);
+        return FALSE;
+    }
+
+    hdr.magic = PCAP_MAGIC;
+    hdr.major = 2;
+    hdr.minor = 4;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = 65535;
+    hdr.linktype = LINKTYPE_UPPER_PDU;
+    fwrite(&hdr, sizeof(hdr), 1, self->f);
+    fflush(self->f);
+    self->active = TRUE;
+
+    g_hash_table_insert(uetrace_table(key), &self->id, self);
+    log_msg(LOG_NOTICE, 0, "UE trace started on %s", path);
+    g_free(path);
+    return TRUE;
+}
+
+gboolean uetrace_stop(UETraceKey key, guint64 id){
+    if(!g_hash_table_remove(uetrace_table(key), &id)){
+        return FALSE;
+    }
+    log_msg(LOG_NOTICE, 0, "UE trace stopped for %s %" G_GUINT64_FORMAT,
+            key == UETRACE_IMSI ? "IMSI" : "M-TMSI", id);
+    return TRUE;
+}
+
+void uetrace_foreach(void (*func)(UETraceKey key, guint64 id,
+                                  guint64 packets, gpointer data),
+                     gpointer data){
+    GHashTableIter iter;
+    gpointer k, v;
+    UETrace_t *t;
+
+    g_hash_table_iter_init(&iter, uetrace.byIMSI);
+    while(g_hash_table_iter_next(&iter, &k, &v)){
+        t = (UETrace_t *)v;
+        func(t->key, t->id, t->packets, data);
+    }
+    g_hash_table_iter_init(&iter, uetrace.byMTMSI);
+    while(g_hash_table_iter_next(&iter, &k, &v)){
+        t = (UETrace_t *)v;
+        func(t->key, t->id, t->packets, data);
+    }
+}
+
+UETrace uetrace_lookup(guint64 imsi, guint32 mtmsi){
+    UETrace_t *self = NULL;
+    guint64 id;
+
+    if(imsi != 0){
+        self = g_hash_table_lookup(uetrace.byIMSI, &imsi);
+    }
+    if(!self && mtmsi != 0){
+        id = mtmsi;
+        self = g_hash_table_lookup(uetrace.byMTMSI, &id);
+    }
+    if(self){
+        self->ref++;
+    }
+    return self;
+}
+
+void uetrace_unref(UETrace t){
+    UETrace_t *self = (UETrace_t *)t;
+    if(--self->ref == 0){
+        g_free(self);
+    }
+}
+
+gboolean uetrace_write(UETrace t, UETraceProto proto,
+                       gconstpointer buf, gsize len){
+    UETrace_t *self = (UETrace_t *)t;
+    PcapRecHdr_t rec;
+    struct timeval tv;
+    guint16 tags[2];
+    guint16 end[2] = {htons(EXP_PDU_TAG_END_OF_OPT), 0};
+
+    if(!self->active){
+        return FALSE;
+    }
+
+    tags[0] = htons(EXP_PDU_TAG_PROTO_NAME);
+    tags[1] = htons(sizeof(protoName[proto]));
+
+    gettimeofday(&tv, NULL);
+    rec.sec = tv.tv_sec;
+    rec.usec = tv.tv_usec;
+    rec.caplen = sizeof(tags) + sizeof(protoName[proto]) + sizeof(end) + len;
+    rec.len = rec.caplen;
+
+    fwrite(&rec, sizeof(rec), 1, self->f);
+    fwrite(tags, sizeof(tags), 1, self->f);
+    fwrite(protoName[proto], sizeof(protoName[proto]), 1, self->f);
+    fwrite(end, sizeof(end), 1, self->f);
+    fwrite(buf, len, 1, self->f);
+    fflush(self->f);
+    self->packets++;
+    return TRUE;
+}
@@ -0,0 +1,115 @@
+/* AaltoMME - Mobility Management Entity for LTE networks
+ * Copyright (C) 2013 Vicent Ferrer Guash & Jesus Llorente Santos
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@file   uetrace.h
+ * @brief  Per UE signalling trace
+ *
+ * The traces are activated by IMSI or M-TMSI from the command shell. The
+ * S1AP, NAS and GTPv2-C messages of a traced UE are written to
+ * <state_directory>/ue-<id>.pcap using the Wireshark exported PDU link type,
+ * so each message is decoded by the protocol dissector it is tagged with.
+ *
+ * The UE contexts keep a flag bit, checked before capturing a message, that
+ * is set when the context identity matches an active trace.
+ */
+
+#ifndef UETRACE_HFILE
+#define UETRACE_HFILE
+
+#include <glib.h>
+
+typedef gpointer UETrace;
+
+/**
+ * Trace target identity type*/
+typedef enum{
+    UETRACE_IMSI,
+    UETRACE_MTMSI,
+}UETraceKey;
+
+/**
+ * Protocol of a captured message*/
+typedef enum{
+    UETRACE_S1AP,
+    UETRACE_NAS,
+    UETRACE_GTPV2,
+}UETraceProto;
+
+/**
+ * @brief Init the UE trace manager
+ * @param [in] dir  Directory of the trace files
+ */
+void uetrace_init(const char *dir);
+
+/**
+ * @brief Stop all the traces and free the UE trace manager
+ */
+void uetrace_free();
+
+/**
+ * @brief Start a UE trace
+ * @param [in] key  Identity type
+ * @param [in] id   IMSI or M-TMSI
+ * @return FALSE if the trace is already active or the file can't be created
+ */
+gboolean uetrace_start(UETraceKey key, guint64 id);
+
+/**
+ * @brief Stop a UE trace
+ * @param [in] key  Identity type
+ * @param [in] id   IMSI or M-TMSI
+ * @return FALSE if the trace is not active
+ *
+ * The UE contexts clear their flag on the next captured message.
+ */
+gboolean uetrace_stop(UETraceKey key, guint64 id);
+
+/**
+ * @brief Iterate the active traces
+ * @param [in] func  Called with the identity type, identity and messages
+ *                   captured
+ * @param [in] data  Passed to func
+ */
+void uetrace_foreach(void (*func)(UETraceKey key, guint64 id,
+                                  guint64 packets, gpointer data),
+                     gpointer data);
+
+/**
+ * @brief Find the trace of a UE
+ * @param [in] imsi   UE IMSI, 0 if unknown
+ * @param [in] mtmsi  UE M-TMSI, 0 if unknown
+ * @return New reference to the trace, NULL if the UE is not traced
+ */
+UETrace uetrace_lookup(guint64 imsi, guint32 mtmsi);
+
+/**
+ * @brief Release a reference returned by uetrace_lookup
+ */
+void uetrace_unref(UETrace t);
+
+/**
+ * @brief Write a message to the trace file
+ * @param [in] t      UE trace
+ * @param [in] proto  Message protocol
+ * @param [in] buf    Encoded message
+ * @param [in] len    Message length
+ * @return FALSE if the trace has been stopped
+ */
+gboolean uetrace_write(UETrace t, UETraceProto proto,
+                       gconstpointer buf, gsize len);
+
+#endif /* UETRACE_HFILE */
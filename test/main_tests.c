@@ -29,9 +29,85 @@
 #include "eia2.h"
 #include "NAS.h"
 #include "NASHandler.h"
+#include "kdf.h"
 
+static void hexToBytes(const char *hex, uint8_t *buf){
+    gsize i;
+    for(i=0; hex[2*i]; i++){
+        buf[i] = g_ascii_xdigit_value(hex[2*i])<<4
+            | g_ascii_xdigit_value(hex[2*i+1]);
+    }
+}
+
+static void assert_hex(const uint8_t *buf, const char *hex){
+    uint8_t x[64];
+    hexToBytes(hex, x);
+    g_assert_true(memcmp(buf, x, strlen(hex)/2) == 0);
+}
+
+/* RFC 4231 test cases 1 and 6*/
 static void test_kdf_test1(){
-    g_assert (1 == 1);
+    KDFKey k;
+    uint8_t key[131], mac[32];
+
+    memset(key, 0x0b, 20);
+    kdf_setKey(&k, key, 20);
+    kdf_derive(&k, (const uint8_t *)"Hi There", 8, mac, 32);
+    assert_hex(mac, "b0344c61d8db38535ca8afceaf0bf12b"
+               "881dc200c9833da726e9376c2e32cff7");
+    /* The precomputed states are not modified*/
+    kdf_derive(&k, (const uint8_t *)"Hi There", 8, mac, 16);
+    assert_hex(mac, "881dc200c9833da726e9376c2e32cff7");
+
+    memset(key, 0xaa, 131);
+    kdf_setKey(&k, key, 131);
+    kdf_derive(&k, (const uint8_t *)"Test Using Larger Than Block-Size Key"
+               " - Hash Key First", 54, mac, 32);
+    assert_hex(mac, "60e431591ee0b67f0d8a26aacbf5b77f"
+               "8e0bc6213728c5140546040f0ee37f54");
+}
+
+/* TS 33.401 Annex A functions from the TS 35.208 Test Set 1 CK and IK*/
+static void test_kdf_fc(){
+    uint8_t ck[16], ik[16], sqnAk[6], sn[3] = {0x02, 0xf8, 0x39};
+    uint8_t kasme[32], keNB[32], nh[32], k[32];
+    KDFKey kk;
+
+    hexToBytes("b40ba9a3c58b2a05bbf0d987b21bf8cb", ck);
+    hexToBytes("f769bcd751044604127672711c6d3441", ik);
+    hexToBytes("55f328b43577", sqnAk);
+
+    kdf_kasme(ck, ik, sn, sqnAk, kasme);
+    assert_hex(kasme, "ba595c5419be71add1212bc8e1bd843a"
+               "fd26e58c0ad8d54f144686b5f55cda77");
+
+    kdf_setKey(&kk, kasme, 32);
+    kdf_keNB(&kk, 0x01020304, keNB);
+    assert_hex(keNB, "fc47d848b6e9677958051b6442e94cd0"
+               "8dd0d67611cb450216f1ec8f33342dbb");
+    kdf_keNB(&kk, 0, keNB);
+    assert_hex(keNB, "1221d2b558e3f2403b6115b5e103535f"
+               "72c300cede7b330b7975d0da633eaa0e");
+
+    kdf_nh(&kk, keNB, nh);
+    assert_hex(nh, "15a16551f74a7eb0a7c7bcf521ccd1d2"
+               "240f7d6cc573796da271a2286e4db698");
+    kdf_nh(&kk, nh, nh);
+    assert_hex(nh, "669529e21ecd3823b7dae4935f8ffd38"
+               "5af74afe24808f23d446b25a10401ad2");
+
+    kdf_algKey(&kk, KDF_NAS_INT, NAS_EIA2, k);
+    assert_hex(k, "ce1b6604ee596826a74973d35e5d0ffd");
+    kdf_algKey(&kk, KDF_NAS_ENC, NAS_EEA0, k);
+    assert_hex(k, "75805d5e110a0b46b83b5ad9855d1b01");
+    kdf_clearKey(&kk);
+
+    kdf_keNBStar(keNB, 300, 3350, k);
+    assert_hex(k, "22114668fed46224aa5479a924e0fbbb"
+               "70dc7bc911c2c05f012fda258320224b");
+    kdf_keNBStar(keNB, 300, 66536, k);
+    assert_hex(k, "fff446d7f9a69adb8a0d9e4fc5a0bd37"
+               "8a6080d7a9b12314c81ba829b8aad434");
 }
 
 
@@ -253,6 +329,7 @@ static void test_dummy(int *n, gconstpointer data){
 int main (int argc, char **argv){
     g_test_init (&argc, &argv, NULL);
     g_test_add_func("/crypto/kdf", test_kdf_test1);
+    g_test_add_func("/crypto/kdf-fc", test_kdf_fc);
     g_test_add_func("/crypto/cmac", test_cmac);
     g_test_add_func("/crypto/eia2-ts1", test_eia2_TestSet1);
     g_test_add_func("/crypto/eia2-ts2", test_eia2_TestSet2);